@@ -8,11 +8,18 @@
 
 #include <cassert>
 #include <cmath>
-#include "AtomSequence.hpp"
+#include <map>
+#include <stdexcept>
+#include <sstream>
 #include "AtomCost.hpp"
+#include "DistanceHistogram.hpp"
+#include "DistanceKernels.hpp"
 #include "Molecule.hpp"
 #include "LigaUtils.hpp"
 #include "Counter.hpp"
+#include "Exceptions.hpp"
+#include "PenaltyForms.hpp"
+#include "SectionTimer.hpp"
 
 using namespace std;
 
@@ -34,15 +41,66 @@ double penalty_gradient(const double& dd, const double& desd)
 }
 
 
+// Local helpers for penalty types
+
+namespace {
+
+map<string,AtomCost::PenaltyType>& penaltyRegistry()
+{
+    static map<string,AtomCost::PenaltyType> the_registry;
+    if (the_registry.empty())
+    {
+        the_registry["square"] = AtomCost::SQUARE;
+        the_registry["huber"] = AtomCost::HUBER;
+        the_registry["flatbottom"] = AtomCost::FLATBOTTOM;
+    }
+    return the_registry;
+}
+
+}   // namespace
+
 ////////////////////////////////////////////////////////////////////////
 // class AtomCost
 ////////////////////////////////////////////////////////////////////////
 
+// class methods
+
+list<string> AtomCost::getPenaltyTypes()
+{
+    list<string> rv;
+    map<string,PenaltyType>::iterator ii = penaltyRegistry().begin();
+    for (; ii != penaltyRegistry().end(); ++ii)
+    {
+        rv.push_back(ii->first);
+    }
+    return rv;
+}
+
+
+bool AtomCost::isPenaltyType(const string& tp)
+{
+    return penaltyRegistry().count(tp);
+}
+
+
+AtomCost::PenaltyType AtomCost::getPenaltyType(const string& tp)
+{
+    if (!isPenaltyType(tp))
+    {
+        ostringstream emsg;
+        emsg << "Penalty type '" << tp << "' not defined.";
+        throw invalid_argument(emsg.str());
+    }
+    return penaltyRegistry()[tp];
+}
+
 // constructor
 
-AtomCost::AtomCost(const Molecule* m) : arg_atom(NULL)
+AtomCost::AtomCost(const Molecule* m) :
+    arg_atom(NULL), distance_bins(NULL)
 {
     this->setScale(1.0);
+    this->setPenalty(SQUARE);
     resetFor(m);
 }
 
@@ -51,13 +109,8 @@ AtomCost::AtomCost(const Molecule* m) : arg_atom(NULL)
 void AtomCost::resetFor(const Molecule* m)
 {
     arg_cluster = m;
-    const DistanceTable& dtgt = arg_cluster->getDistanceTable();
     noCutoff();
     use_distances = !arg_cluster->getDistReuse();
-    if (use_distances && dtgt.size() > useflag.size())
-    {
-        useflag.resize(dtgt.size(), false);
-    }
 }
 
 double AtomCost::eval(const Atom_t& a, int flags)
@@ -67,6 +120,7 @@ double AtomCost::eval(const Atom_t& a, int flags)
 
 double AtomCost::eval(const Atom_t* pa, int flags)
 {
+    SECTION_TIMER("AtomCost::eval");
     // assign arguments
     this->arg_atom = pa;
     this->_selfcost_flag = flags & SELFCOST;
@@ -78,47 +132,112 @@ double AtomCost::eval(const Atom_t* pa, int flags)
     total_cost = 0.0;
     // selfcost is always zero in non-periodic materials
     if (this->_selfcost_flag)  return this->totalCost();
-    vector<double>::iterator tgdii = target_distances.begin();
-    vector<double>::iterator ptcii = partial_costs.begin();
-    const DistanceTable& dtgt = arg_cluster->getDistanceTable();
-    for (AtomSequenceIndex seq(arg_cluster); !seq.finished(); seq.next())
+    this->evalPairCosts(this->packedDistances(arg_atom->r));
+    this->noteLowestCost();
+    this->_gradient_cached = this->_gradient_flag;
+    return total_cost;
+}
+
+
+// Evaluate costs of all atoms in the array, the results and the cutoff
+// updates are the same as from eval(atom) called in sequence.
+// Distances to all cluster atoms are obtained in a single vectorizable
+// loop over the packed cluster coordinates.
+
+const vector<double>& AtomCost::evalBatch(const vector<Atom_t>& atoms)
+{
+    batch_costs.resize(atoms.size());
+    for (size_t i = 0; i != atoms.size(); ++i)
     {
-        // assertion checks
-        assert(tgdii < target_distances.end());
-        assert(ptcii < partial_costs.end());
-        // calculation
-        double d = R3::distance(arg_atom->r, seq.ptr()->r);
-        size_t nearidx = nearDistanceIndex(d);
-        const double& dnear = dtgt[nearidx];
-        const double& desd = dtgt.getesd(dnear);
-        *(tgdii++) = dnear;
-        double dd = dnear - d;
-        double pcost = this->penaltyScaled(dd, desd);
-        *(ptcii++) = pcost;
-        total_cost += pcost;
-        if (use_distances)
-        {
-            useflag[nearidx] = true;
-            useflag_indices.push_back(nearidx);
-            useatom_indices.push_back(seq.idx());
-        }
-        bool cutitoff = !this->_gradient_flag && this->apply_cutoff &&
-            this->total_cost + arg_atom->Badness() > this->cutoff_cost;
-        if (cutitoff)   break;
-        if (this->_gradient_flag && d > NS_LIGA::eps_distance)
-        {
-            static R3::Vector g_dd_xyz;
-            g_dd_xyz = (-1.0/d) * (arg_atom->r - seq.ptr()->r);
-            double g_pcost_dd = penalty_gradient(dd, desd) * this->getScale();
-            this->_gradient += g_pcost_dd * g_dd_xyz;
-        }
+        const double* dcluster = this->packedDistances(atoms[i].r);
+        batch_costs[i] = this->evalDistances(&atoms[i], dcluster);
     }
-    if (apply_cutoff && arg_atom->Badness() + total_cost < lowest_cost)
+    return batch_costs;
+}
+
+
+// Approximate evalBatch for non-periodic structures, distances to the
+// cluster atoms are computed from single precision coordinates.
+// Every pair takes the nearest target distance regardless of its use,
+// which makes the costs lower bounds of the exact costs up to rounding
+// when the target distances have no ESDs.  The cutoff is lowered only
+// by exact costs of the atoms that were best so far, it thus stays an
+// upper bound of the final cutoff from evalBatch.
+
+const vector<double>& AtomCost::screenBatch(const vector<Atom_t>& atoms)
+{
+    const bool exactdist = this->use_distances;
+    const bool screendist = exactdist &&
+        arg_cluster->getDistanceTable().hasESDs();
+    const double cutrng = this->cutoff_range;
+    this->cutoff_range = DOUBLE_MAX;
+    double best = DOUBLE_MAX;
+    batch_costs.resize(atoms.size());
+    for (size_t i = 0; i != atoms.size(); ++i)
     {
-        lowest_cost = arg_atom->Badness() + total_cost;
-        cutoff_cost = min(cutoff_cost, lowest_cost + cutoff_range);
+        const Atom_t& a = atoms[i];
+        this->use_distances = screendist;
+        const double* dscreen = this->screenDistances(a.r);
+        batch_costs[i] = this->evalDistances(&a, dscreen);
+        double c = a.Badness() + batch_costs[i];
+        if (!(c < best && c < cutoff_cost))     continue;
+        best = c;
+        this->use_distances = exactdist;
+        const double* dcluster = this->packedDistances(a.r);
+        double cexact = a.Badness() + this->evalDistances(&a, dcluster);
+        cutoff_cost = min(cutoff_cost, cexact + cutrng);
     }
-    this->_gradient_cached = this->_gradient_flag;
+    this->use_distances = exactdist;
+    this->cutoff_range = cutrng;
+    this->lowest_cost = DOUBLE_MAX;
+    return batch_costs;
+}
+
+
+// Evaluate distance cost and gradient as eval(pa, GRADIENT) together
+// with the overlap cost and gradient from the atomoverlap calculator.
+// Both terms use the same distances to the packed cluster atoms.
+// Intended for non-periodic structures, as in Molecule relaxation.
+
+double AtomCost::evalWithOverlap(const Atom_t* pa,
+        const AtomCost& atomoverlap, double& overlap, R3::Vector& goverlap)
+{
+    SECTION_TIMER("AtomCost::evalWithOverlap");
+    // assign arguments
+    this->arg_atom = pa;
+    this->_selfcost_flag = false;
+    this->_gradient_flag = true;
+    // begin calculation
+    resizeArrays();
+    resetUseFlags();
+    resetGradient();
+    total_cost = 0.0;
+    overlap = 0.0;
+    goverlap = 0.0, 0.0, 0.0;
+    const double* dcluster = this->packedDistances(pa->r);
+    this->evalPairCosts(dcluster);
+    // contact radius terms, the same as in Molecule::getContactRadius
+    const Molecule::PackedAtoms& pk = arg_cluster->getPackedAtoms();
+    const int n = arg_cluster->countAtoms();
+    const double samepairradius = arg_cluster->getSamePairRadius();
+    const int paelement = pa->elementId();
+    for (int j = 0; j < n; ++j)
+    {
+        const double d = dcluster[j];
+        const double r0r1 = (pa->radius < 0 || pk.radius[j] < 0) ? 0.0 :
+            (samepairradius >= 0 && paelement == pk.element[j]) ?
+            (2 * samepairradius) : (pa->radius + pk.radius[j]);
+        if (!(d < r0r1))    continue;
+        const double dd = r0r1 - d;
+        overlap += atomoverlap.penaltyScaled(dd, 1.0);
+        if (!(d > NS_LIGA::eps_distance))   continue;
+        double g_ocost_dd = atomoverlap.penaltyGradientScaled(dd, 1.0);
+        goverlap[0] += g_ocost_dd * ((-1.0/d) * (pa->r[0] - pk.rx[j]));
+        goverlap[1] += g_ocost_dd * ((-1.0/d) * (pa->r[1] - pk.ry[j]));
+        goverlap[2] += g_ocost_dd * ((-1.0/d) * (pa->r[2] - pk.rz[j]));
+    }
+    this->noteLowestCost();
+    this->_gradient_cached = true;
     return total_cost;
 }
 
@@ -205,14 +324,81 @@ const double& AtomCost::getScale() const
 }
 
 
+void AtomCost::setPenalty(PenaltyType tp, double width)
+{
+    mpenalty_type = tp;
+    mpenalty_width = width;
+}
+
+
+AtomCost::PenaltyType AtomCost::getPenaltyType() const
+{
+    return mpenalty_type;
+}
+
+
+const double& AtomCost::getPenaltyWidth() const
+{
+    return mpenalty_width;
+}
+
+
 double AtomCost::penaltyScaled(const double& dd, const double& esd) const
 {
-    double rv = penalty(dd, esd) * this->getScale();
+    static Counter* penalty_calls = Counter::getCounter("penalty_calls");
+    penalty_calls->count();
+    const double w = dd / esd;
+    double pw;
+    switch (mpenalty_type)
+    {
+        case HUBER:
+            pw = HuberPenalty(mpenalty_width).value(w);
+            break;
+        case FLATBOTTOM:
+            pw = FlatBottomPenalty(mpenalty_width).value(w);
+            break;
+        default:
+            pw = SquarePenalty().value(w);
+    }
+    double rv = pw * this->getScale();
+    return rv;
+}
+
+
+double AtomCost::penaltyGradientScaled(const double& dd,
+        const double& esd) const
+{
+    const double w = dd / esd;
+    double gw;
+    switch (mpenalty_type)
+    {
+        case HUBER:
+            gw = HuberPenalty(mpenalty_width).derivative(w);
+            break;
+        case FLATBOTTOM:
+            gw = FlatBottomPenalty(mpenalty_width).derivative(w);
+            break;
+        default:
+            gw = SquarePenalty().derivative(w);
+    }
+    double rv = gw / esd * this->getScale();
     return rv;
 }
 
 // protected methods
 
+// generic evalBatch for derived classes, calls eval for every atom
+
+const vector<double>& AtomCost::evalEach(const vector<Atom_t>& atoms)
+{
+    batch_costs.resize(atoms.size());
+    for (size_t i = 0; i != atoms.size(); ++i)
+    {
+        batch_costs[i] = this->eval(&atoms[i]);
+    }
+    return batch_costs;
+}
+
 const vector<Atom_t*>& AtomCost::getClusterAtoms() const
 {
     return arg_cluster->atoms;
@@ -228,12 +414,18 @@ void AtomCost::resizeArrays()
 
 void AtomCost::resetUseFlags()
 {
-    if (useflag_indices.empty())    return;
-    for (vector<int>::iterator ii = useflag_indices.begin();
-            ii != useflag_indices.end(); ++ii)
+    // start from the target distances consumed by the cluster
+    distance_bins = use_distances ? arg_cluster->getDistanceBins() : NULL;
+    if (distance_bins)
+    {
+        vector<size_t>::const_iterator bi = touched_bins.begin();
+        for (; bi != touched_bins.end(); ++bi)  bin_deltas[*bi] = 0;
+        touched_bins.clear();
+        bin_deltas.resize(distance_bins->size(), 0);
+    }
+    else if (use_distances)
     {
-        assert(*ii < int(useflag.size()));
-        useflag[*ii] = false;
+        used_distances = arg_cluster->getDistanceUsage();
     }
     useflag_indices.clear();
     useatom_indices.clear();
@@ -250,27 +442,82 @@ size_t AtomCost::nearDistanceIndex(const double& d) const
 {
     const DistanceTable& dtgt = arg_cluster->getDistanceTable();
     int idx = dtgt.find_nearest(d) - dtgt.begin();
-    if (use_distances && useflag[idx])
+    if (distance_bins)
     {
-        int hi, lo, nidx = -1;
-        int sz = dtgt.size();
-        for (hi = idx + 1; hi < sz && useflag[hi]; ++hi)
-        { }
-        if (hi < sz)
+        size_t bidx = this->nearBinDistanceIndex(idx, d);
+        if (bidx == size_t(-1))     throwTargetsExhausted();
+        return bidx;
+    }
+    if (use_distances && used_distances.isUsed(idx))
+    {
+        int nidx = -1;
+        size_t hi = used_distances.nextFree(idx);
+        if (hi < dtgt.size())
         {
             nidx = hi;
         }
-        for (lo = idx - 1; lo >= 0 && useflag[lo]; --lo)
-        { }
+        int lo = used_distances.prevFree(idx);
         if (lo >= 0 && (nidx < 0 || d - dtgt[lo] < dtgt[nidx] - d))
         {
             nidx = lo;
         }
+        if (nidx < 0)   throwTargetsExhausted();
         idx = nidx;
     }
     return idx;
 }
 
+
+void AtomCost::throwTargetsExhausted() const
+{
+    const char* emsg = "E: all target distances are used, "
+        "molecule has more pairs than the distance table.";
+    throw InvalidMolecule(emsg);
+}
+
+// Binned counterpart of nearDistanceIndex, return the first target
+// distance of the bin nearest to d that has some free target left.
+// idx is the nearest target distance regardless of use.
+
+size_t AtomCost::nearBinDistanceIndex(size_t idx, const double& d) const
+{
+    const DistanceHistogram& hist = *distance_bins;
+    const int nbins = hist.size();
+    int b = hist.binAt(idx);
+    if (this->isFreeBin(b))     return hist.binStart(b);
+    int hi = b + 1;
+    while (hi < nbins && !this->isFreeBin(hi))  ++hi;
+    int lo = b - 1;
+    while (lo >= 0 && !this->isFreeBin(lo))     --lo;
+    int nb = (hi < nbins) ? hi : -1;
+    if (lo >= 0 && (nb < 0 ||
+                d - hist.binDistance(lo) < hist.binDistance(nb) - d))
+    {
+        nb = lo;
+    }
+    return (nb < 0) ? size_t(-1) : hist.binStart(nb);
+}
+
+
+bool AtomCost::isFreeBin(size_t b) const
+{
+    const vector<int>& usage = arg_cluster->getDistanceBinUsage();
+    return usage[b] + bin_deltas[b] < distance_bins->binCount(b);
+}
+
+
+void AtomCost::useDistanceIndex(size_t idx)
+{
+    if (!distance_bins)
+    {
+        used_distances.setUsed(idx);
+        return;
+    }
+    size_t b = distance_bins->binAt(idx);
+    if (!bin_deltas[b]++)   touched_bins.push_back(b);
+}
+
+
 double AtomCost::nearDistance(const double& d) const
 {
     const DistanceTable& dtgt = arg_cluster->getDistanceTable();
@@ -280,4 +527,198 @@ double AtomCost::nearDistance(const double& d) const
     return dfind;
 }
 
+// Distances from rc to all cluster atoms obtained in a single
+// vectorizable loop over the packed cluster coordinates.  The loop
+// variant for the instruction set of the CPU is chosen at run time.
+
+const double* AtomCost::packedDistances(const R3::Vector& rc)
+{
+    static Counter* R3_distance_calls =
+        Counter::getCounter("R3_distance_calls");
+    const Molecule::PackedAtoms& pk = arg_cluster->getPackedAtoms();
+    const int n = arg_cluster->countAtoms();
+    assert(n == int(pk.rx.size()));
+    batch_distances.resize(n);
+    const double* rx = n ? &pk.rx[0] : NULL;
+    const double* ry = n ? &pk.ry[0] : NULL;
+    const double* rz = n ? &pk.rz[0] : NULL;
+    double* dcluster = n ? &batch_distances[0] : NULL;
+    DistanceKernels::distances(dcluster, rx, ry, rz, n, rc[0], rc[1], rc[2]);
+    R3_distance_calls->count(n);
+    return dcluster;
+}
+
+
+const double* AtomCost::screenDistances(const R3::Vector& rc)
+{
+    const Molecule::PackedAtoms& pk = arg_cluster->getPackedAtoms();
+    const int n = arg_cluster->countAtoms();
+    assert(n == int(pk.fx.size()));
+    batch_distances.resize(n);
+    const float* fx = n ? &pk.fx[0] : NULL;
+    const float* fy = n ? &pk.fy[0] : NULL;
+    const float* fz = n ? &pk.fz[0] : NULL;
+    double* dcluster = n ? &batch_distances[0] : NULL;
+    DistanceKernels::distancesFloat(dcluster, fx, fy, fz, n,
+            rc[0], rc[1], rc[2]);
+    return dcluster;
+}
+
+
+// Add pair costs of arg_atom and cluster atoms at distances dcluster
+// using the kernel instance for the current penalty form and options.
+
+void AtomCost::evalPairCosts(const double* dcluster)
+{
+    const double& w = mpenalty_width;
+    switch (mpenalty_type)
+    {
+        case HUBER:
+            this->evalPairCostsWith(HuberPenalty(w), dcluster);
+            break;
+        case FLATBOTTOM:
+            this->evalPairCostsWith(FlatBottomPenalty(w), dcluster);
+            break;
+        default:
+            this->evalPairCostsWith(SquarePenalty(w), dcluster);
+    }
+}
+
+
+template <class P>
+void AtomCost::evalPairCostsWith(const P& pfunc, const double* dcluster)
+{
+    static Counter* penalty_calls = Counter::getCounter("penalty_calls");
+    // cutoff is never applied when calculating gradient
+    const bool useesd = arg_cluster->getDistanceTable().hasESDs();
+    const bool usedist = this->use_distances;
+    const bool grad = this->_gradient_flag;
+    const bool cut = !grad && this->apply_cutoff;
+    int options = (useesd ? 4 : 0) + (usedist ? 2 : 0) +
+        (grad ? 1 : 0) + (cut ? 8 : 0);
+    int npairs = 0;
+    switch (options)
+    {
+        case 0:
+            npairs = addPairCosts<P,false,false,false,false>(pfunc, dcluster);
+            break;
+        case 1:
+            npairs = addPairCosts<P,false,false,true,false>(pfunc, dcluster);
+            break;
+        case 2:
+            npairs = addPairCosts<P,false,true,false,false>(pfunc, dcluster);
+            break;
+        case 3:
+            npairs = addPairCosts<P,false,true,true,false>(pfunc, dcluster);
+            break;
+        case 4:
+            npairs = addPairCosts<P,true,false,false,false>(pfunc, dcluster);
+            break;
+        case 5:
+            npairs = addPairCosts<P,true,false,true,false>(pfunc, dcluster);
+            break;
+        case 6:
+            npairs = addPairCosts<P,true,true,false,false>(pfunc, dcluster);
+            break;
+        case 7:
+            npairs = addPairCosts<P,true,true,true,false>(pfunc, dcluster);
+            break;
+        case 8:
+            npairs = addPairCosts<P,false,false,false,true>(pfunc, dcluster);
+            break;
+        case 10:
+            npairs = addPairCosts<P,false,true,false,true>(pfunc, dcluster);
+            break;
+        case 12:
+            npairs = addPairCosts<P,true,false,false,true>(pfunc, dcluster);
+            break;
+        case 14:
+            npairs = addPairCosts<P,true,true,false,true>(pfunc, dcluster);
+            break;
+        default:
+            assert(false);
+    }
+    penalty_calls->count(npairs);
+}
+
+
+// Cost kernel for one combination of run-time options.  useesd adds
+// ESD weights of target distances, usedist tracks used distances,
+// grad calculates the gradient and cut stops when the total cost
+// exceeds cutoff.  Return the number of evaluated pairs.
+
+template <class P, bool useesd, bool usedist, bool grad, bool cut>
+int AtomCost::addPairCosts(const P& pfunc, const double* dcluster)
+{
+    const DistanceTable& dtgt = arg_cluster->getDistanceTable();
+    const Molecule::PackedAtoms& pk = arg_cluster->getPackedAtoms();
+    const int n = arg_cluster->countAtoms();
+    assert(n <= int(target_distances.size()));
+    assert(n <= int(partial_costs.size()));
+    const double sc = this->getScale();
+    const double cost0 = arg_atom->Badness();
+    int idx = 0;
+    while (idx != n)
+    {
+        const double& d = dcluster[idx];
+        size_t nearidx = usedist ? this->nearDistanceIndex(d) :
+            size_t(dtgt.find_nearest(d) - dtgt.begin());
+        const double& dnear = dtgt[nearidx];
+        const double desd = useesd ? dtgt.getesdAt(nearidx) : 1.0;
+        target_distances[idx] = dnear;
+        const double w = (dnear - d) / desd;
+        double pcost = pfunc.value(w) * sc;
+        partial_costs[idx] = pcost;
+        total_cost += pcost;
+        if (usedist)
+        {
+            this->useDistanceIndex(nearidx);
+            useflag_indices.push_back(nearidx);
+            useatom_indices.push_back(idx);
+        }
+        if (grad && d > NS_LIGA::eps_distance)
+        {
+            double g_pcost_dd = pfunc.derivative(w) / desd * sc;
+            const R3::Vector& r = arg_atom->r;
+            _gradient[0] += g_pcost_dd * ((-1.0/d) * (r[0] - pk.rx[idx]));
+            _gradient[1] += g_pcost_dd * ((-1.0/d) * (r[1] - pk.ry[idx]));
+            _gradient[2] += g_pcost_dd * ((-1.0/d) * (r[2] - pk.rz[idx]));
+        }
+        ++idx;
+        if (cut && total_cost + cost0 > cutoff_cost)    break;
+    }
+    return idx;
+}
+
+
+
+// eval without gradient for precomputed distances to cluster atoms
+
+double AtomCost::evalDistances(const Atom_t* pa, const double* dcluster)
+{
+    // assign arguments
+    this->arg_atom = pa;
+    this->_selfcost_flag = false;
+    this->_gradient_flag = false;
+    // begin calculation
+    resizeArrays();
+    resetUseFlags();
+    resetGradient();
+    total_cost = 0.0;
+    this->evalPairCosts(dcluster);
+    this->noteLowestCost();
+    this->_gradient_cached = false;
+    return total_cost;
+}
+
+
+void AtomCost::noteLowestCost()
+{
+    if (apply_cutoff && arg_atom->Badness() + total_cost < lowest_cost)
+    {
+        lowest_cost = arg_atom->Badness() + total_cost;
+        cutoff_cost = min(cutoff_cost, lowest_cost + cutoff_range);
+    }
+}
+
 // End of AtomCost.cpp
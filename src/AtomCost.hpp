@@ -9,11 +9,15 @@
 #ifndef ATOMCOST_HPP_INCLUDED
 #define ATOMCOST_HPP_INCLUDED
 
+#include <list>
+#include <string>
 #include <vector>
 #include "R3linalg.hpp"
+#include "UsageMask.hpp"
 
 class Molecule;
 class Atom_t;
+class DistanceHistogram;
 
 ////////////////////////////////////////////////////////////////////////
 // Declarations
@@ -31,6 +35,12 @@ class AtomCost
     public:
 
         enum EvalFlag { NONE, GRADIENT=1, SELFCOST=2 };
+        enum PenaltyType { SQUARE, HUBER, FLATBOTTOM };
+
+        // class methods
+        static std::list<std::string> getPenaltyTypes();
+        static bool isPenaltyType(const std::string& tp);
+        static PenaltyType getPenaltyType(const std::string& tp);
 
         // constructor
         AtomCost(const Molecule* m);
@@ -42,6 +52,12 @@ class AtomCost
         virtual void resetFor(const Molecule* m);
         double eval(const Atom_t& pa, int flags=NONE);
         virtual double eval(const Atom_t* pa, int flags=NONE);
+        virtual const std::vector<double>&
+            evalBatch(const std::vector<Atom_t>& atoms);
+        const std::vector<double>&
+            screenBatch(const std::vector<Atom_t>& atoms);
+        double evalWithOverlap(const Atom_t* pa, const AtomCost& atomoverlap,
+                double& overlap, R3::Vector& goverlap);
         const R3::Vector& gradient();
         double lowest() const;
         double cutoff() const;
@@ -56,7 +72,12 @@ class AtomCost
         const std::vector<int>& usedTargetAtomIndices() const;
         void setScale(double);
         const double& getScale() const;
+        void setPenalty(PenaltyType tp, double width=1.0);
+        PenaltyType getPenaltyType() const;
+        const double& getPenaltyWidth() const;
         double penaltyScaled(const double& dd, const double& desd) const;
+        double penaltyGradientScaled(const double& dd,
+                const double& desd) const;
 
     protected:
 
@@ -66,7 +87,13 @@ class AtomCost
 
         // data - results
         bool use_distances;
-        std::vector<bool> useflag;
+        // target distances used by the cluster and by evaluated pairs
+        UsageMask used_distances;
+        // binned cost counts evaluated pairs per histogram bin and
+        // resets only the bins in touched_bins
+        const DistanceHistogram* distance_bins;
+        std::vector<int> bin_deltas;
+        std::vector<size_t> touched_bins;
         bool apply_cutoff;
         double lowest_cost;
         double cutoff_cost;
@@ -76,6 +103,7 @@ class AtomCost
         std::vector<double> target_distances;
         std::vector<int> useflag_indices;
         std::vector<int> useatom_indices;
+        std::vector<double> batch_costs;
 
         // optimizer specific data
         bool _selfcost_flag;
@@ -84,17 +112,38 @@ class AtomCost
         R3::Vector _gradient;
 
         // protected methods
+        const std::vector<double>& evalEach(const std::vector<Atom_t>& atoms);
         const std::vector<Atom_t*>& getClusterAtoms() const;
         virtual void resizeArrays();
         void resetUseFlags();
         void resetGradient();
         size_t nearDistanceIndex(const double& d) const;
+        void throwTargetsExhausted() const;
+        size_t nearBinDistanceIndex(size_t idx, const double& d) const;
+        bool isFreeBin(size_t b) const;
+        void useDistanceIndex(size_t idx);
         double nearDistance(const double& d) const;
+        const double* packedDistances(const R3::Vector& rc);
+        const double* screenDistances(const R3::Vector& rc);
+        void evalPairCosts(const double* dcluster);
 
     private:
 
         // data - penalty configuration
         double mscale;
+        PenaltyType mpenalty_type;
+        double mpenalty_width;
+
+        // data - distances to cluster atoms
+        std::vector<double> batch_distances;
+
+        // private methods
+        template <class P>
+            void evalPairCostsWith(const P& pfunc, const double* dcluster);
+        template <class P, bool useesd, bool usedist, bool grad, bool cut>
+            int addPairCosts(const P& pfunc, const double* dcluster);
+        double evalDistances(const Atom_t* pa, const double* dcluster);
+        void noteLowestCost();
 
 };  // class AtomCost
 
@@ -7,14 +7,17 @@
  * <license text>
  ***********************************************************************/
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include "AtomCostCrystal.hpp"
 #include "AtomSequence.hpp"
-#include "PointsInSphere.hpp"
+#include "DistanceKernels.hpp"
+#include "LatticeTranslations.hpp"
 #include "LigaUtils.hpp"
 #include "Lattice.hpp"
 #include "Crystal.hpp"
+#include "SymmetryOperation.hpp"
 
 using namespace std;
 
@@ -24,9 +27,13 @@ using namespace std;
 
 // constructor
 
-AtomCostCrystal::AtomCostCrystal(const Crystal* cluster) : AtomCost(cluster)
+AtomCostCrystal::AtomCostCrystal(const Crystal* cluster) :
+    AtomCost(cluster), self_cost(0.0), self_pair_count(0),
+    _orthogonal_cell(false)
 {
     use_distances = false;
+    _cell_length = 0.0;
+    _cell_reclength = 0.0;
 }
 
 // public methods - overloaded
@@ -40,8 +47,7 @@ void AtomCostCrystal::resetFor(const Molecule* clust)
     this->_rmax = arg_cluster->getRmax();
     pair<double,double> rext =
         arg_cluster->getRExtent(0.0, this->arg_cluster->getRmax());
-    _sph.reset(new PointsInSphere(rext.first, rext.second,
-                arg_cluster->getLattice()) );
+    this->cacheLatticeVectors(rext);
 }
 
 
@@ -58,6 +64,7 @@ double AtomCostCrystal::eval(const Atom_t* pa, int flags)
     this->crst_atom = this->arg_atom;
     this->_selfcost_flag = flags & SELFCOST;
     this->_gradient_flag = flags & GRADIENT;
+    if (arg_cluster->hasSymmetry())     return this->evalSymmetric();
     // begin calculation
     resizeArrays();
     resetGradient();
@@ -66,6 +73,8 @@ double AtomCostCrystal::eval(const Atom_t* pa, int flags)
     // reset result data
     this->total_cost = 0.0;
     this->total_pair_count = 0;
+    this->self_cost = 0.0;
+    this->self_pair_count = 0;
     pair<double,int> costcount(0.0, 0);
     // short circuit for selfcost
     if (this->_selfcost_flag)
@@ -110,6 +119,31 @@ double AtomCostCrystal::eval(const Atom_t* pa, int flags)
 }
 
 
+// Evaluate costs of all atoms in the array with the same cutoff updates
+// as from eval(atom) called in sequence.  The periodic images of sites
+// are found once for the whole array.
+
+const vector<double>& AtomCostCrystal::evalBatch(const vector<Atom_t>& atoms)
+{
+    this->batch_costs.resize(atoms.size());
+    if (atoms.empty())  return this->batch_costs;
+    if (arg_cluster->hasSymmetry())
+    {
+        for (size_t i = 0; i != atoms.size(); ++i)
+        {
+            this->batch_costs[i] = this->eval(&atoms[i]);
+        }
+        return this->batch_costs;
+    }
+    this->cacheSiteImages();
+    for (size_t i = 0; i != atoms.size(); ++i)
+    {
+        this->batch_costs[i] = this->evalSiteImages(&atoms[i]);
+    }
+    return this->batch_costs;
+}
+
+
 int AtomCostCrystal::totalPairCount() const
 {
     return this->total_pair_count;
@@ -122,6 +156,12 @@ const vector<int>& AtomCostCrystal::pairCounts() const
 }
 
 
+pair<double,int> AtomCostCrystal::selfCostCount() const
+{
+    return make_pair(this->self_cost, this->self_pair_count);
+}
+
+
 // public methods - specific
 
 // Evaluate cost of Cartesian separation between two sites
@@ -131,49 +171,460 @@ const vector<int>& AtomCostCrystal::pairCounts() const
 pair<double,int>
 AtomCostCrystal::pairCostCount(const R3::Vector& cv)
 {
+    static Counter* R3_norm_calls = Counter::getCounter("R3_norm_calls");
+    if (this->_orthogonal_cell)     return this->pairCostCountOrthogonal(cv);
     const Lattice& lat = arg_cluster->getLattice();
-    static R3::Vector ucv;
-    ucv = lat.ucvCartesian(cv);
+    const R3::Vector ucv = lat.ucvCartesian(cv);
     R3::Vector rc_dd;
-    double paircost = 0.0;
-    int paircount = 0;
-    int loopscale = this->_selfcost_flag ? 1 : 2;
-    double penaltyscale = loopscale * this->getScale();
-    for (_sph->rewind(); !_sph->finished(); _sph->next())
-    {
-        rc_dd = ucv + lat.cartesian(_sph->mno());
-        double d = R3::norm(rc_dd);
-        if (d > this->_rmax)    continue;
-        if (this->_selfcost_flag && d == 0.0)  continue;
-        const pair<double,double>& ddesd = this->pairDistanceDifference(d);
-        paircost += penalty(ddesd.first, ddesd.second) * penaltyscale;
-        paircount += loopscale;
-        if (this->_gradient_flag && d > NS_LIGA::eps_distance)
+    pair<double,int> rv(0.0, 0);
+    // translations are sorted by length, the rest is beyond _rmax when
+    // the translation length exceeds _rmax + |ucv|
+    const double tlenmax = this->_rmax + R3::norm(ucv);
+    const LatticeTranslations& lt = *this->_translations;
+    const size_t nt = lt.size();
+    const double* tx = nt ? &(lt.tx()[0]) : NULL;
+    const double* ty = nt ? &(lt.ty()[0]) : NULL;
+    const double* tz = nt ? &(lt.tz()[0]) : NULL;
+    const double* tlen = nt ? &(lt.tlen()[0]) : NULL;
+    const size_t ni = upper_bound(tlen, tlen + nt, tlenmax) - tlen;
+    // distances of all images in one vectorizable loop over the packed
+    // translations, only those within _rmax are scored
+    this->_image_distances.resize(ni);
+    double* dimage = ni ? &(this->_image_distances[0]) : NULL;
+    const double x = ucv[0];
+    const double y = ucv[1];
+    const double z = ucv[2];
+    for (size_t i = 0; i < ni; ++i)
+    {
+        double dx = x + tx[i];
+        double dy = y + ty[i];
+        double dz = z + tz[i];
+        dimage[i] = sqrt(dx*dx + dy*dy + dz*dz);
+    }
+    R3_norm_calls->count(ni);
+    for (size_t i = 0; i != ni; ++i)
+    {
+        if (dimage[i] > this->_rmax)    continue;
+        rc_dd[0] = x + tx[i];
+        rc_dd[1] = y + ty[i];
+        rc_dd[2] = z + tz[i];
+        this->addPairCost(rc_dd, dimage[i], rv);
+    }
+    return rv;
+}
+
+// Specialized pairCostCount for cells with a diagonal lattice base.
+// The separation is wrapped to the unit cell per axis and the images
+// within _rmax are enumerated separately along each axis.
+
+pair<double,int>
+AtomCostCrystal::pairCostCountOrthogonal(const R3::Vector& cv)
+{
+    for (int i = 0; i != R3::Ndim; ++i)
+    {
+        const double& a = this->_cell_length[i];
+        double f = cv[i] * this->_cell_reclength[i];
+        double u = (f - floor(f)) * a;
+        vector<double>& images = this->_axis_images[i];
+        images.clear();
+        int klo = int(ceil((-this->_rmax - u) / a));
+        int khi = int(floor((this->_rmax - u) / a));
+        for (int k = klo; k <= khi; ++k)    images.push_back(u + k * a);
+    }
+    const double rmax2 = this->_rmax * this->_rmax;
+    const vector<double>& xs = this->_axis_images[0];
+    const vector<double>& ys = this->_axis_images[1];
+    const vector<double>& zs = this->_axis_images[2];
+    R3::Vector rc_dd;
+    pair<double,int> rv(0.0, 0);
+    vector<double>::const_iterator x, y, z;
+    for (x = xs.begin(); x != xs.end(); ++x)
+    {
+        double x2 = (*x) * (*x);
+        if (x2 > rmax2)     continue;
+        for (y = ys.begin(); y != ys.end(); ++y)
         {
-            static R3::Vector g_dd_xyz;
-            g_dd_xyz = (-1.0/d) * rc_dd;
-            double g_pcost_dd =
-                penalty_gradient(ddesd.first, ddesd.second) * penaltyscale;
-            this->_gradient += g_pcost_dd * g_dd_xyz;
+            double xy2 = x2 + (*y) * (*y);
+            if (xy2 > rmax2)    continue;
+            for (z = zs.begin(); z != zs.end(); ++z)
+            {
+                double d2 = xy2 + (*z) * (*z);
+                if (d2 > rmax2)     continue;
+                rc_dd[0] = *x;
+                rc_dd[1] = *y;
+                rc_dd[2] = *z;
+                this->addPairCost(rc_dd, sqrt(d2), rv);
+            }
         }
     }
-    return make_pair(paircost, paircount);
+    return rv;
+}
+
+// Evaluate cost and pair count of two different sites without gradient.
+// The result is the same as the pa1 element of eval(pa0).
+
+pair<double,int>
+AtomCostCrystal::evalPair(const Atom_t* pa0, const Atom_t* pa1)
+{
+    assert(pa0 != pa1);
+    this->arg_atom = pa0;
+    this->crst_atom = pa1;
+    this->_selfcost_flag = false;
+    this->_gradient_flag = false;
+    if (arg_cluster->hasSymmetry())
+    {
+        arg_cluster->siteImages(pa0->r, this->_arg_images);
+        const int mult = this->_arg_images.size();
+        arg_cluster->siteImages(pa1->r, this->_site_images);
+        pair<double,int> rv =
+            this->symmetryPairCostCount(pa1, this->_site_images);
+        rv.first *= mult;
+        rv.second *= mult;
+        return rv;
+    }
+    R3::Vector rcv = pa0->r - pa1->r;
+    return this->pairCostCount(rcv);
 }
 
 // protected methods
 
-const pair<double,double>&
+pair<double,double>
 AtomCostCrystal::pairDistanceDifference(const double& d) const
 {
-    static pair<double,double> rv;
+    pair<double,double> rv;
     const DistanceTable& dtgt = arg_cluster->getDistanceTable();
-    double dn = this->nearDistance(d);
-    rv.first = dn - d;
-    rv.second = dtgt.getesd(dn);
+    size_t nearidx = this->nearDistanceIndex(d);
+    rv.first = dtgt[nearidx] - d;
+    rv.second = dtgt.getesdAt(nearidx);
     return rv;
 }
 
 
+// Collect images of all sites near the unit cell for evalBatch.
+// The cell is split to image_bins^3 bins, which are cells scaled down
+// by image_bins.  Any point in a bin is within half of the longest bin
+// diagonal from the bin center, hence the bin gets all site images
+// within _rmax plus that half diagonal from its center.  The cached
+// lattice translations extend to _rmax + longest cell diagonal, which
+// covers the images for every bin.
+
+void AtomCostCrystal::cacheSiteImages()
+{
+    const Lattice& lat = arg_cluster->getLattice();
+    const int nb = image_bins;
+    const double rcut = this->_rmax + 0.5 * lat.ucMaxDiagonalLength() / nb;
+    const double rcut2 = rcut * rcut;
+    vector<R3::Vector> ucsites;
+    this->_image_sites.clear();
+    for (AtomSequence seq(arg_cluster); !seq.finished(); seq.next())
+    {
+        this->_image_sites.push_back(seq.ptr());
+        ucsites.push_back(lat.ucvCartesian(seq.ptr()->r));
+    }
+    this->_image_offsets.clear();
+    this->_image_x.clear();
+    this->_image_y.clear();
+    this->_image_z.clear();
+    const LatticeTranslations& lt = *this->_translations;
+    const size_t nt = lt.size();
+    size_t maxbinimages = 0;
+    for (int b = 0; b != nb * nb * nb; ++b)
+    {
+        R3::Vector fc((b / (nb * nb) + 0.5) / nb,
+                ((b / nb) % nb + 0.5) / nb, (b % nb + 0.5) / nb);
+        const R3::Vector center = lat.cartesian(fc);
+        size_t binstart = this->_image_x.size();
+        vector<R3::Vector>::const_iterator uci;
+        for (uci = ucsites.begin(); uci != ucsites.end(); ++uci)
+        {
+            this->_image_offsets.push_back(this->_image_x.size());
+            R3::Vector sc = *uci - center;
+            for (size_t i = 0; i != nt; ++i)
+            {
+                double x = sc[0] + lt.tx()[i];
+                double y = sc[1] + lt.ty()[i];
+                double z = sc[2] + lt.tz()[i];
+                if (x * x + y * y + z * z > rcut2)  continue;
+                this->_image_x.push_back(x + center[0]);
+                this->_image_y.push_back(y + center[1]);
+                this->_image_z.push_back(z + center[2]);
+            }
+        }
+        maxbinimages = max(maxbinimages, this->_image_x.size() - binstart);
+    }
+    this->_image_offsets.push_back(this->_image_x.size());
+    this->_image_dd.resize(maxbinimages);
+}
+
+
+// Cost of trial atom pa from the cached site images, the same as
+// eval(pa) up to round-off.  Squared distances to all images in the
+// bin of pa are evaluated first in a single vectorizable loop.
+
+double AtomCostCrystal::evalSiteImages(const Atom_t* pa)
+{
+    // assign arguments
+    this->arg_atom = pa;
+    this->_selfcost_flag = false;
+    this->_gradient_flag = false;
+    resizeArrays();
+    resetGradient();
+    this->total_cost = 0.0;
+    this->total_pair_count = 0;
+    const Lattice& lat = arg_cluster->getLattice();
+    R3::Vector ucf = lat.ucvFractional(lat.fractional(pa->r));
+    const R3::Vector ucv = lat.cartesian(ucf);
+    const int nb = image_bins;
+    int b = 0;
+    for (int i = 0; i != R3::Ndim; ++i)
+    {
+        b = nb * b + min(int(ucf[i] * nb), nb - 1);
+    }
+    const size_t nsites = this->_image_sites.size();
+    const size_t* offsets = &(this->_image_offsets[b * nsites]);
+    const size_t kbin = offsets[0];
+    const size_t nimages = offsets[nsites] - kbin;
+    const double* ix = nimages ? &(this->_image_x[kbin]) : NULL;
+    const double* iy = nimages ? &(this->_image_y[kbin]) : NULL;
+    const double* iz = nimages ? &(this->_image_z[kbin]) : NULL;
+    double* dd = nimages ? &(this->_image_dd[0]) : NULL;
+    DistanceKernels::squaredDistances(dd, ix, iy, iz, int(nimages),
+            ucv[0], ucv[1], ucv[2]);
+    const double rmax2 = this->_rmax * this->_rmax;
+    for (size_t i = 0; i != nsites; ++i)
+    {
+        this->crst_atom = this->_image_sites[i];
+        double paircost = 0.0;
+        int paircount = 0;
+        size_t kend = offsets[i + 1] - kbin;
+        for (size_t k = offsets[i] - kbin; k != kend; ++k)
+        {
+            if (dd[k] > rmax2)  continue;
+            pair<double,double> ddesd =
+                this->pairDistanceDifference(sqrt(dd[k]));
+            paircost += 2 * this->penaltyScaled(ddesd.first, ddesd.second);
+            paircount += 2;
+        }
+        this->partial_costs[i] = paircost;
+        this->pair_counts[i] = paircount;
+        this->total_cost += paircost;
+        this->total_pair_count += paircount;
+        bool cutitoff = this->apply_cutoff &&
+            this->total_cost + this->arg_atom->Badness() > this->cutoff_cost;
+        if (cutitoff)   break;
+    }
+    bool islowestcost = this->apply_cutoff &&
+        this->arg_atom->Badness() + this->total_cost < this->lowest_cost;
+    if (islowestcost)
+    {
+        this->lowest_cost = this->arg_atom->Badness() + this->total_cost;
+        this->cutoff_cost =
+            min(this->cutoff_cost, this->lowest_cost + this->cutoff_range);
+    }
+    return this->totalCost();
+}
+
+
+// Cost of arg_atom in a crystal with symmetry.  The pair cost of two
+// sites is evaluated from arg_atom to all images of the other site and
+// weighted by the multiplicity of arg_atom, which sums all pairs of their
+// images in the unit cell.  The sum is the same from either site, hence
+// every symmetry-distinct pair is evaluated only once.  The weighted self
+// cost of arg_atom with its own images is included in the total cost,
+// but not in the partial costs.
+
+double AtomCostCrystal::evalSymmetric()
+{
+    resizeArrays();
+    resetGradient();
+    arg_cluster->siteImages(arg_atom->r, this->_arg_images,
+            &(this->_arg_image_ops));
+    const int mult = this->_arg_images.size();
+    pair<double,int> costcount = this->symmetrySelfCostCount();
+    this->self_cost = mult * costcount.first;
+    this->self_pair_count = mult * costcount.second;
+    this->total_cost = this->self_cost;
+    this->total_pair_count = this->self_pair_count;
+    if (this->_selfcost_flag)
+    {
+        this->_gradient *= mult;
+        this->_gradient_cached = this->_gradient_flag;
+        return this->totalCost();
+    }
+    vector<double>::iterator ptcii = this->partial_costs.begin();
+    vector<int>::iterator pcntii = this->pair_counts.begin();
+    for (AtomSequenceIndex seq(arg_cluster); !seq.finished(); seq.next())
+    {
+        assert(ptcii < this->partial_costs.end());
+        assert(pcntii < this->pair_counts.end());
+        costcount = (this->arg_atom == seq.ptr()) ? make_pair(0.0, 0) :
+                this->symmetryPairCostCount(seq.ptr(),
+                        this->cachedSiteImages(seq.idx(), seq.ptr()));
+        costcount.first *= mult;
+        costcount.second *= mult;
+        *(ptcii++) = costcount.first;
+        *(pcntii++) = costcount.second;
+        this->total_cost += costcount.first;
+        this->total_pair_count += costcount.second;
+        bool cutitoff = !this->_gradient_flag && this->apply_cutoff &&
+            this->total_cost + this->arg_atom->Badness() > this->cutoff_cost;
+        if (cutitoff)   break;
+    }
+    bool islowestcost = this->apply_cutoff &&
+        this->arg_atom->Badness() + this->total_cost < this->lowest_cost;
+    if (islowestcost)
+    {
+        this->lowest_cost = this->arg_atom->Badness() + this->total_cost;
+        this->cutoff_cost =
+            min(this->cutoff_cost, this->lowest_cost + this->cutoff_range);
+    }
+    this->_gradient *= mult;
+    this->_gradient_cached = this->_gradient_flag;
+    return this->totalCost();
+}
+
+
+// Unweighted self cost and count of arg_atom with its lattice translations
+// and with its symmetry images in _arg_images.  The image separation
+// changes with the site position by the linear part of its operation
+// less identity, which transforms the gradient of the image terms.
+
+pair<double,int> AtomCostCrystal::symmetrySelfCostCount()
+{
+    const Lattice& lat = arg_cluster->getLattice();
+    const vector<SymmetryOperation>& ops = arg_cluster->getSymmetry();
+    const bool selfcost_flag = this->_selfcost_flag;
+    this->_selfcost_flag = true;
+    this->crst_atom = this->arg_atom;
+    R3::Vector zeros(0.0, 0.0, 0.0);
+    pair<double,int> rv = this->pairCostCount(zeros);
+    for (size_t k = 1; k < this->_arg_images.size(); ++k)
+    {
+        const R3::Vector g0 = this->_gradient;
+        pair<double,int> cc =
+            this->pairCostCount(this->_arg_images[k] - this->arg_atom->r);
+        rv.first += cc.first;
+        rv.second += cc.second;
+        if (!this->_gradient_flag)  continue;
+        const SymmetryOperation& op = ops[this->_arg_image_ops[k]];
+        const R3::Vector dg = this->_gradient - g0;
+        R3::Vector gk;
+        for (int i = 0; i != R3::Ndim; ++i)
+        {
+            R3::Vector ei(0.0, 0.0, 0.0);
+            ei[i] = 1.0;
+            R3::Vector dsi = lat.cartesian(
+                    op(lat.fractional(ei)) - op.t) - ei;
+            gk[i] = R3::dot(dsi, dg);
+        }
+        this->_gradient = g0 + gk;
+    }
+    this->_selfcost_flag = selfcost_flag;
+    return rv;
+}
+
+
+// Symmetry images of the idx-th crystal site pa cached for the current
+// lattice and symmetry.
+
+const vector<R3::Vector>&
+AtomCostCrystal::cachedSiteImages(size_t idx, const Atom_t* pa)
+{
+    bool isstale = this->_symmetry_cache_lattice != arg_cluster->_lattice ||
+        this->_symmetry_cache_ops != arg_cluster->_symmetry;
+    if (isstale)
+    {
+        this->_symmetry_cache_lattice = arg_cluster->_lattice;
+        this->_symmetry_cache_ops = arg_cluster->_symmetry;
+        this->_symmetry_cache_sites.clear();
+        this->_symmetry_cache_positions.clear();
+        this->_symmetry_cache_images.clear();
+    }
+    if (idx >= this->_symmetry_cache_sites.size())
+    {
+        this->_symmetry_cache_sites.resize(idx + 1, NULL);
+        this->_symmetry_cache_positions.resize(idx + 1);
+        this->_symmetry_cache_images.resize(idx + 1);
+    }
+    vector<R3::Vector>& images = this->_symmetry_cache_images[idx];
+    bool iscached = this->_symmetry_cache_sites[idx] == pa &&
+        R3::VectorsAlmostEqual(this->_symmetry_cache_positions[idx], pa->r);
+    if (!iscached)
+    {
+        arg_cluster->siteImages(pa->r, images);
+        this->_symmetry_cache_sites[idx] = pa;
+        this->_symmetry_cache_positions[idx] = pa->r;
+    }
+    return images;
+}
+
+
+// Unweighted cost and count of the pairs of arg_atom with the symmetry
+// images of crystal site pa.
+
+pair<double,int> AtomCostCrystal::symmetryPairCostCount(const Atom_t* pa,
+        const vector<R3::Vector>& images)
+{
+    this->crst_atom = pa;
+    pair<double,int> rv(0.0, 0);
+    vector<R3::Vector>::const_iterator ii;
+    for (ii = images.begin(); ii != images.end(); ++ii)
+    {
+        pair<double,int> cc = this->pairCostCount(this->arg_atom->r - *ii);
+        rv.first += cc.first;
+        rv.second += cc.second;
+    }
+    return rv;
+}
+
+
+// Add cost and pair count of one image separation rc_dd of length d
+// to pcc.  This also updates the gradient when requested.
+
+void AtomCostCrystal::addPairCost(const R3::Vector& rc_dd, double d,
+        pair<double,int>& pcc)
+{
+    if (this->_selfcost_flag && d == 0.0)  return;
+    int loopscale = this->_selfcost_flag ? 1 : 2;
+    pair<double,double> ddesd = this->pairDistanceDifference(d);
+    pcc.first += loopscale *
+        this->penaltyScaled(ddesd.first, ddesd.second);
+    pcc.second += loopscale;
+    if (this->_gradient_flag && d > NS_LIGA::eps_distance)
+    {
+        R3::Vector g_dd_xyz;
+        g_dd_xyz = (-1.0/d) * rc_dd;
+        double g_pcost_dd = loopscale *
+            this->penaltyGradientScaled(ddesd.first, ddesd.second);
+        this->_gradient += g_pcost_dd * g_dd_xyz;
+    }
+}
+
+
+// Cartesian lattice translations within rext sorted by length.
+// They are fetched from the shared cache when lattice or rext changes.
+
+void AtomCostCrystal::cacheLatticeVectors(const pair<double,double>& rext)
+{
+    const Lattice& lat = arg_cluster->getLattice();
+    if (this->_translations && this->_translations->matches(lat, rext))
+    {
+        return;
+    }
+    const R3::Matrix& B = lat.base();
+    this->_orthogonal_cell = (B(0,0) > 0.0 && B(1,1) > 0.0 && B(2,2) > 0.0 &&
+            B(0,1) == 0.0 && B(0,2) == 0.0 && B(1,0) == 0.0 &&
+            B(1,2) == 0.0 && B(2,0) == 0.0 && B(2,1) == 0.0);
+    if (this->_orthogonal_cell)
+    {
+        const R3::Matrix& R = lat.recbase();
+        this->_cell_length = B(0,0), B(1,1), B(2,2);
+        this->_cell_reclength = R(0,0), R(1,1), R(2,2);
+    }
+    this->_translations = LatticeTranslations::get(lat, rext);
+}
+
+
 void AtomCostCrystal::resizeArrays()
 {
     size_t sz = arg_cluster->countAtoms();
@@ -10,13 +10,16 @@
 #define ATOMCOSTCRYSTAL_HPP_INCLUDED
 
 #include <vector>
-#include <memory>
+#include <utility>
+#include <boost/shared_ptr.hpp>
 #include "AtomCost.hpp"
 #include "R3linalg.hpp"
-#include "PointsInSphere.hpp"
 
 class Crystal;
 class Atom_t;
+class Lattice;
+class LatticeTranslations;
+class SymmetryOperation;
 
 class AtomCostCrystal : public AtomCost
 {
@@ -32,17 +35,24 @@ class AtomCostCrystal : public AtomCost
         virtual void resetFor(const Molecule* clust);
         double eval(const Atom_t& a, int flags=NONE);
         virtual double eval(const Atom_t* pa, int flags=NONE);
+        virtual const std::vector<double>&
+            evalBatch(const std::vector<Atom_t>& atoms);
         int totalPairCount() const;
         const std::vector<int>& pairCounts() const;
+        // self cost and count included in the totals from eval
+        std::pair<double,int> selfCostCount() const;
 
         // public methods - specific
         std::pair<double,int> pairCostCount(const R3::Vector& cv);
+        std::pair<double,int> evalPair(const Atom_t* pa0, const Atom_t* pa1);
 
     protected:
 
         // data - results
         int total_pair_count;
         std::vector<int> pair_counts;
+        double self_cost;
+        int self_pair_count;
 
         // data - arguments
         const Crystal* arg_cluster;
@@ -52,13 +62,53 @@ class AtomCostCrystal : public AtomCost
         // data - for intermediate cost evaluation
         // maximum r for PDF range
         double _rmax;
-        // lattice points sequencer
-        std::auto_ptr<PointsInSphere> _sph;
+        // Cartesian lattice translations sorted by length, shared
+        // by all calculators with the same lattice and extent
+        boost::shared_ptr<const LatticeTranslations> _translations;
+        // lengths of the shifted separations in pairCostCount
+        std::vector<double> _image_distances;
+        // orthogonal cells use per-axis wrap and image enumeration
+        bool _orthogonal_cell;
+        R3::Vector _cell_length;
+        R3::Vector _cell_reclength;
+        std::vector<double> _axis_images[R3::Ndim];
+        // site images near the unit cell bins for evalBatch, images of
+        // the i-th site for bin b start at _image_offsets[b * nsites + i]
+        static const int image_bins = 3;
+        std::vector<const Atom_t*> _image_sites;
+        std::vector<size_t> _image_offsets;
+        std::vector<double> _image_x;
+        std::vector<double> _image_y;
+        std::vector<double> _image_z;
+        std::vector<double> _image_dd;
+        // symmetry images of the argument atom and cached images of the
+        // crystal sites valid for the cached lattice and symmetry
+        std::vector<R3::Vector> _arg_images;
+        std::vector<int> _arg_image_ops;
+        std::vector<R3::Vector> _site_images;
+        boost::shared_ptr<const Lattice> _symmetry_cache_lattice;
+        boost::shared_ptr<const std::vector<SymmetryOperation> >
+            _symmetry_cache_ops;
+        std::vector<const Atom_t*> _symmetry_cache_sites;
+        std::vector<R3::Vector> _symmetry_cache_positions;
+        std::vector< std::vector<R3::Vector> > _symmetry_cache_images;
 
         // methods
-        virtual const std::pair<double,double>&
+        virtual std::pair<double,double>
             pairDistanceDifference(const double& d) const;
+        std::pair<double,int> pairCostCountOrthogonal(const R3::Vector& cv);
+        void addPairCost(const R3::Vector& rc_dd, double d,
+                std::pair<double,int>& pcc);
+        void cacheSiteImages();
+        double evalSiteImages(const Atom_t* pa);
+        double evalSymmetric();
+        std::pair<double,int> symmetrySelfCostCount();
+        const std::vector<R3::Vector>&
+            cachedSiteImages(size_t idx, const Atom_t* pa);
+        std::pair<double,int> symmetryPairCostCount(const Atom_t* pa,
+                const std::vector<R3::Vector>& images);
         void resizeArrays();
+        void cacheLatticeVectors(const std::pair<double,double>& rext);
 
 };  // class AtomCostCrystal
 
@@ -6,15 +6,32 @@
 * <license text>
 ***********************************************************************/
 
+#include <algorithm>
 #include <list>
+#include <time.h>
 #include "AtomFilter_t.hpp"
 #include "LigaUtils.hpp"
-#include "AtomSequence.hpp"
 #include "Molecule.hpp"
 
 using namespace NS_LIGA;
 using namespace std;
 
+// Local helpers for AtomFilterPipeline --------------------------------------
+
+namespace {
+
+// number of checks between reordering of the filters
+const int FILTER_REORDER_INTERVAL = 256;
+
+double nanoseconds_now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1.0e9 * ts.tv_sec + ts.tv_nsec;
+}
+
+}   // namespace
+
 
 ////////////////////////////////////////////////////////////////////////
 // class BondAngleFilter_t - derived from AtomFilter_t
@@ -39,17 +56,20 @@ bool BondAngleFilter_t::Check(Atom_t* pta, Molecule* pm)
     list<Atom_t*> second_neighbors;
     list<double>  second_distances;
     // find first and second neighbors and corresponding distances
-    typedef vector<Atom_t*>::iterator VPAit;
-    for (AtomSequence seq(pm); !seq.finished(); seq.next())
+    vector<int> near;
+    pm->findNearAtoms(near, pta->r, 2*max_blen);
+    typedef vector<int>::iterator VIit;
+    for (VIit ii = near.begin(); ii != near.end(); ++ii)
     {
-        double blen = R3::distance(pta->r, seq.ptr()->r);
+        Atom_t* pa = pm->atoms[*ii];
+        double blen = R3::distance(pta->r, pa->r);
         if (0.0 < blen && blen < 2*max_blen)
         {
-            second_neighbors.push_back(seq.ptr());
+            second_neighbors.push_back(pa);
             second_distances.push_back(blen);
             if (blen < max_blen)
             {
-                first_neighbors.push_back(seq.ptr());
+                first_neighbors.push_back(pa);
                 first_distances.push_back(blen);
             }
         }
@@ -131,4 +151,106 @@ bool LoneAtomFilter_t::Check(Atom_t* pta, Molecule* pm)
     return isnotalone;
 }
 
+
+bool LoneAtomFilter_t::Precheck(Atom_t* pta, Molecule* pm)
+{
+    // the first atom is never alone
+    if (!pm->countAtoms())  return true;
+    return pm->hasNearAtoms(pta->r, mmaxbondlength);
+}
+
+////////////////////////////////////////////////////////////////////////
+// class AtomFilterPipeline
+////////////////////////////////////////////////////////////////////////
+
+// constructor
+
+AtomFilterPipeline::AtomFilterPipeline() : mchecks(0)
+{ }
+
+// methods
+
+void AtomFilterPipeline::setFilters(const vector<AtomFilter_t*>& filters)
+{
+    bool same = (filters.size() == mstats.size());
+    for (size_t i = 0; same && i != mstats.size(); ++i)
+    {
+        same = count(filters.begin(), filters.end(), mstats[i].filter);
+    }
+    if (same)   return;
+    mstats.resize(filters.size());
+    for (size_t i = 0; i != filters.size(); ++i)
+    {
+        FilterStats& st = mstats[i];
+        st.filter = filters[i];
+        st.checks = st.rejects = st.nanoseconds = 0.0;
+    }
+    mchecks = 0;
+}
+
+
+bool AtomFilterPipeline::Check(Atom_t* pta, Molecule* pm)
+{
+    vector<FilterStats>::iterator st;
+    for (st = mstats.begin(); st != mstats.end(); ++st)
+    {
+        if (!st->filter->Precheck(pta, pm))     return false;
+    }
+    bool isgood = true;
+    for (st = mstats.begin(); isgood && st != mstats.end(); ++st)
+    {
+        double t0 = nanoseconds_now();
+        isgood = st->filter->Check(pta, pm);
+        st->nanoseconds += nanoseconds_now() - t0;
+        st->checks += 1;
+        st->rejects += !isgood;
+    }
+    if (++mchecks >= FILTER_REORDER_INTERVAL)   this->reorder();
+    return isgood;
+}
+
+
+vector<AtomFilter_t*> AtomFilterPipeline::getOrder() const
+{
+    vector<AtomFilter_t*> rv;
+    vector<FilterStats>::const_iterator st;
+    for (st = mstats.begin(); st != mstats.end(); ++st)
+    {
+        rv.push_back(st->filter);
+    }
+    return rv;
+}
+
+// private methods
+
+namespace {
+
+// filters with more rejections per nanosecond go first, the rates are
+// compared as cross products to avoid division by zero
+
+template <class T>
+bool higherRejectionRate(const T& st0, const T& st1)
+{
+    return (st0.rejects * (st1.nanoseconds + 1.0) >
+            st1.rejects * (st0.nanoseconds + 1.0));
+}
+
+}   // namespace
+
+
+void AtomFilterPipeline::reorder()
+{
+    stable_sort(mstats.begin(), mstats.end(),
+            higherRejectionRate<FilterStats>);
+    // halve the statistics to follow the changing structure
+    vector<FilterStats>::iterator st;
+    for (st = mstats.begin(); st != mstats.end(); ++st)
+    {
+        st->checks /= 2;
+        st->rejects /= 2;
+        st->nanoseconds /= 2;
+    }
+    mchecks = 0;
+}
+
 // End of file
@@ -10,6 +10,7 @@
 #define ATOMFILTER_T_HPP_INCLUDED
 
 #include <cstddef>
+#include <vector>
 
 class Atom_t;
 class Molecule;
@@ -27,6 +28,8 @@ class AtomFilter_t
 
         // methods
         virtual bool Check(Atom_t*, Molecule* pm=NULL)  { return true; }
+        // cheap test before Check, false only for atoms failing Check
+        virtual bool Precheck(Atom_t*, Molecule* pm=NULL)  { return true; }
 
 };
 
@@ -58,6 +61,7 @@ class LoneAtomFilter_t : public AtomFilter_t
 
         // methods
         bool Check(Atom_t*, Molecule* pm);
+        bool Precheck(Atom_t*, Molecule* pm);
 
     private:
 
@@ -65,4 +69,45 @@ class LoneAtomFilter_t : public AtomFilter_t
         double mmaxbondlength;
 };
 
+////////////////////////////////////////////////////////////////////////
+// class AtomFilterPipeline
+//   applies prechecks of all filters and then their full checks
+//   starting with the filter that rejects the most atoms per unit
+//   of time spent in its Check.  The result is the same as for
+//   checking the filters in a fixed order.
+////////////////////////////////////////////////////////////////////////
+
+class AtomFilterPipeline
+{
+    public:
+
+        // constructor
+        AtomFilterPipeline();
+
+        // methods
+        // use filters and reset statistics when they differ from current
+        void setFilters(const std::vector<AtomFilter_t*>& filters);
+        bool Check(Atom_t*, Molecule* pm);
+        // filters in the current order of their checks
+        std::vector<AtomFilter_t*> getOrder() const;
+
+    private:
+
+        // types
+        struct FilterStats
+        {
+            AtomFilter_t* filter;
+            double checks;
+            double rejects;
+            double nanoseconds;
+        };
+
+        // data
+        std::vector<FilterStats> mstats;
+        int mchecks;
+
+        // methods
+        void reorder();
+};
+
 #endif  // ATOMFILTER_T_HPP_INCLUDED
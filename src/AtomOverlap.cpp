@@ -19,7 +19,6 @@
 #include <vector>
 
 #include "AtomOverlap.hpp"
-#include "AtomSequence.hpp"
 #include "Molecule.hpp"
 #include "LigaUtils.hpp"
 #include "Counter.hpp"
@@ -60,23 +59,29 @@ double AtomOverlap::eval(const Atom_t* pa, int flags)
     total_cost = 0.0;
     fill(partial_costs.begin(), partial_costs.end(), 0.0);
     if (this->_selfcost_flag)  return this->totalCost();
-    for (AtomSequenceIndex seq(arg_cluster); !seq.finished(); seq.next())
+    // only atoms within the largest contact radius can overlap
+    double rcut = arg_cluster->getMaxContactRadius(*arg_atom);
+    arg_cluster->findNearAtoms(near_indices, arg_atom->r, rcut);
+    const vector<Atom_t*>& clatoms = this->getClusterAtoms();
+    vector<int>::const_iterator ii;
+    for (ii = near_indices.begin(); ii != near_indices.end(); ++ii)
     {
+        const Atom_t* pa1 = clatoms[*ii];
         // do not calculate own overlap
-        if (seq.ptr() == arg_atom)  continue;
+        if (pa1 == arg_atom)  continue;
         // calculation
-        double d = R3::distance(arg_atom->r, seq.ptr()->r);
+        double d = R3::distance(arg_atom->r, pa1->r);
         // force zero overlap when disabled by negative atom radius
-        double r0r1 = arg_cluster->getContactRadius(*arg_atom, seq.ref());
+        double r0r1 = arg_cluster->getContactRadius(*arg_atom, *pa1);
         double dd = (d < r0r1) ? (r0r1 - d) : 0.0;
         double pcost = this->penaltyScaled(dd, 1.0);
-        partial_costs[seq.idx()] = pcost;
+        partial_costs[*ii] = pcost;
         total_cost += pcost;
         if (this->_gradient_flag && d > NS_LIGA::eps_distance)
         {
-            static R3::Vector g_dd_xyz;
-            g_dd_xyz = (-1.0/d) * (arg_atom->r - seq.ptr()->r);
-            double g_pcost_dd = penalty_gradient(dd, 1.0) * this->getScale();
+            R3::Vector g_dd_xyz;
+            g_dd_xyz = (-1.0/d) * (arg_atom->r - pa1->r);
+            double g_pcost_dd = this->penaltyGradientScaled(dd, 1.0);
             this->_gradient += g_pcost_dd * g_dd_xyz;
         }
     }
@@ -84,4 +89,10 @@ double AtomOverlap::eval(const Atom_t* pa, int flags)
     return total_cost;
 }
 
+
+const vector<double>& AtomOverlap::evalBatch(const vector<Atom_t>& atoms)
+{
+    return this->evalEach(atoms);
+}
+
 // End of file
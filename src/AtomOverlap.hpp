@@ -32,6 +32,13 @@ class AtomOverlap : public AtomCost
         virtual void resetFor(const Molecule* clust);
         double eval(const Atom_t& a, int flags=NONE);
         virtual double eval(const Atom_t* pa, int flags=NONE);
+        virtual const std::vector<double>&
+            evalBatch(const std::vector<Atom_t>& atoms);
+
+    private:
+
+        // data
+        std::vector<int> near_indices;
 
 };  // class AtomOverlap
 
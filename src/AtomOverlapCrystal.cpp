@@ -44,16 +44,14 @@ void AtomOverlapCrystal::resetFor(const Molecule* clust)
     assert(!this->use_distances);
     this->_rmax = 2 * arg_cluster->getMaxAtomRadius();
     pair<double,double> rext = arg_cluster->getRExtent(0.0, this->_rmax);
-    _sph.reset(new PointsInSphere(rext.first, rext.second,
-                arg_cluster->getLattice()) );
+    this->cacheLatticeVectors(rext);
 }
 
 
-const pair<double,double>&
+pair<double,double>
 AtomOverlapCrystal::pairDistanceDifference(const double& d) const
 {
-    static pair<double,double> rv(0.0, 1.0);
-    assert(1.0 == rv.second);
+    pair<double,double> rv(0.0, 1.0);
     // force zero overlap when disabled by negative atom radius
     double r0r1 = arg_cluster->getContactRadius(*arg_atom, *crst_atom);
     rv.first = (d < r0r1) ? (r0r1 - d) : 0.0;
@@ -30,7 +30,7 @@ class AtomOverlapCrystal : public AtomCostCrystal
 
         // public methods - overloaded
         virtual void resetFor(const Molecule* crst);
-        virtual const std::pair<double,double>&
+        virtual std::pair<double,double>
             pairDistanceDifference(const double& d) const;
 
 };  // class AtomOverlap
@@ -6,25 +6,84 @@
 * <license text>
 ***********************************************************************/
 
+#include <deque>
+#include <map>
+#include <boost/thread/mutex.hpp>
+
 #include "LigaUtils.hpp"
 #include "Atom_t.hpp"
 
 using namespace std;
 
+// Local helpers for the element symbol table -------------------------------
+
+namespace {
+
+// symbols are only added, deque keeps references to them valid
+
+boost::mutex element_lock;
+
+deque<string>& element_symbols()
+{
+    static deque<string> the_symbols;
+    return the_symbols;
+}
+
+
+map<string,int>& element_ids()
+{
+    static map<string,int> the_ids;
+    return the_ids;
+}
+
+}   // namespace
+
 ////////////////////////////////////////////////////////////////////////
 // class Atom_t
 ////////////////////////////////////////////////////////////////////////
 
+// class methods
+
+int Atom_t::elementId(const string& elsmbl)
+{
+    boost::mutex::scoped_lock lock(element_lock);
+    map<string,int>& ids = element_ids();
+    map<string,int>::iterator ii = ids.find(elsmbl);
+    if (ii != ids.end())    return ii->second;
+    int eid = element_symbols().size();
+    element_symbols().push_back(elsmbl);
+    ids[elsmbl] = eid;
+    return eid;
+}
+
+const string& Atom_t::elementSymbol(int eid)
+{
+    boost::mutex::scoped_lock lock(element_lock);
+    return element_symbols().at(eid);
+}
+
 // constructors
 
 Atom_t::Atom_t(const string& elsmbl, double rx, double ry, double rz) :
-    element(elsmbl), mstorage_ptr(NULL)
+    element(elsmbl), _element_id(elementId(elsmbl)), mstorage_ptr(NULL)
 {
     this->init(rx, ry, rz);
 }
 
 // public methods
 
+void Atom_t::setElement(const string& elsmbl)
+{
+    this->element = elsmbl;
+    this->_element_id = elementId(elsmbl);
+}
+
+void Atom_t::setElement(int eid)
+{
+    this->element = elementSymbol(eid);
+    this->_element_id = eid;
+}
+
 const double& Atom_t::Badness() const
 {
     return this->_badness;
@@ -110,7 +169,7 @@ void Atom_t::init(double rx, double ry, double rz)
 
 bool operator==(const Atom_t& a1, const Atom_t& a2)
 {
-    bool rv = (a1.element == a2.element &&
+    bool rv = (a1.elementId() == a2.elementId() &&
             equal(a1.r.data(), a1.r.data() + 3, a2.r.data()));
     return rv;
 }
@@ -28,6 +28,11 @@ class Atom_t
         friend class Molecule;
         friend class Crystal;
 
+        // class methods
+        // integer id of an element symbol, the same in all threads
+        static int elementId(const std::string& elsmbl);
+        static const std::string& elementSymbol(int eid);
+
         // constructors
         Atom_t(const std::string& elsmbl, double rx, double ry, double rz);
         template <class V> Atom_t(const std::string& elsmbl, const V& rxyz);
@@ -41,6 +46,9 @@ class Atom_t
         double radius;
 
         // methods
+        int elementId() const  { return this->_element_id; }
+        void setElement(const std::string& elsmbl);
+        void setElement(int eid);
         const double& Badness() const;
         double FreeBadness() const;
         void IncBadness(const double& db);
@@ -57,6 +65,7 @@ class Atom_t
     private:
 
         // data
+        int _element_id;
         double _badness;
         double _overlap;
         mutable int pmxidx;     // pair matrix index
@@ -81,7 +90,7 @@ bool operator==(const Atom_t& a1, const Atom_t& a2);
 
 template <class V>
 Atom_t::Atom_t(const std::string& elsmbl, const V& rxyz) :
-    element(elsmbl), mstorage_ptr(NULL)
+    element(elsmbl), _element_id(elementId(elsmbl)), mstorage_ptr(NULL)
 {
     this->init(double(rxyz[0]), double(rxyz[1]), double(rxyz[2]));
 }
@@ -89,7 +98,8 @@ Atom_t::Atom_t(const std::string& elsmbl, const V& rxyz) :
 
 template <class V>
 Atom_t::Atom_t(Atom_t* asrc, const V& rxyz) :
-    element(asrc->element), mstorage_ptr(asrc)
+    element(asrc->element), _element_id(asrc->_element_id),
+    mstorage_ptr(asrc)
 {
     this->init(double(rxyz[0]), double(rxyz[1]), double(rxyz[2]));
 }
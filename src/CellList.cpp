@@ -0,0 +1,196 @@
+/***********************************************************************
+* Short Title: uniform grid of cells for spatial neighbor queries
+*
+* Comments: CellList sorts points into cubic cells of a bounding box
+*     grid, so that points close to a given position can be found
+*     without scanning all of them.  Point indices are returned in
+*     ascending order, which keeps the order of cost summations.
+*
+* <license text>
+***********************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "CellList.hpp"
+
+using namespace std;
+
+namespace {
+
+// upper limit of the number of cells per point
+const size_t MAX_CELLS_PER_POINT = 2;
+const size_t MIN_CELLS = 8;
+
+inline int cellIndex(double x, double lo, double cellsize, int dim)
+{
+    int rv = int((x - lo) / cellsize);
+    return min(max(rv, 0), dim - 1);
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class CellList
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+CellList::CellList() : mbuilt(false), mcellsize(0.0)
+{
+    fill(mlo, mlo + 3, 0.0);
+    fill(mdim, mdim + 3, 0);
+}
+
+// Public Methods ------------------------------------------------------------
+
+void CellList::build(const vector<double>& rx, const vector<double>& ry,
+        const vector<double>& rz, double cellsize)
+{
+    assert(rx.size() == ry.size() && rx.size() == rz.size());
+    const vector<double>* xyz[3] = {&rx, &ry, &rz};
+    size_t npts = rx.size();
+    double extent[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i != 3; ++i)
+    {
+        const vector<double>& v = *(xyz[i]);
+        mlo[i] = npts ? *min_element(v.begin(), v.end()) : 0.0;
+        extent[i] = npts ? (*max_element(v.begin(), v.end()) - mlo[i]) : 0.0;
+    }
+    double maxextent = *max_element(extent, extent + 3);
+    // a single cell when cellsize is not usable
+    if (!(cellsize > 0.0))  cellsize = maxextent + 1.0;
+    // grow cells until their count is comparable to the number of points
+    size_t maxcells = max(MIN_CELLS, MAX_CELLS_PER_POINT * npts);
+    while (true)
+    {
+        size_t ncells = 1;
+        for (int i = 0; i != 3; ++i)
+        {
+            mdim[i] = int(min(extent[i] / cellsize, double(maxcells))) + 1;
+            ncells *= mdim[i];
+        }
+        if (ncells <= maxcells)    break;
+        cellsize *= max(1.01, pow(double(ncells) / maxcells, 1.0 / 3));
+    }
+    mcellsize = cellsize;
+    // counting sort of point indices by their cells
+    size_t ncells = size_t(mdim[0]) * mdim[1] * mdim[2];
+    vector<int> pcell(npts);
+    mcell_start.assign(ncells + 1, 0);
+    for (size_t k = 0; k != npts; ++k)
+    {
+        int ix = cellIndex(rx[k], mlo[0], mcellsize, mdim[0]);
+        int iy = cellIndex(ry[k], mlo[1], mcellsize, mdim[1]);
+        int iz = cellIndex(rz[k], mlo[2], mcellsize, mdim[2]);
+        pcell[k] = (ix * mdim[1] + iy) * mdim[2] + iz;
+        ++mcell_start[pcell[k] + 1];
+    }
+    for (size_t c = 0; c != ncells; ++c)
+    {
+        mcell_start[c + 1] += mcell_start[c];
+    }
+    mpoint_index.resize(npts);
+    vector<int> cfill(mcell_start.begin(), mcell_start.end() - 1);
+    for (size_t k = 0; k != npts; ++k)
+    {
+        mpoint_index[cfill[pcell[k]]++] = k;
+    }
+    mbuilt = true;
+}
+
+
+void CellList::clear()
+{
+    mbuilt = false;
+    mcell_start.clear();
+    mpoint_index.clear();
+}
+
+
+bool CellList::isBuilt() const
+{
+    return mbuilt;
+}
+
+
+size_t CellList::countPoints() const
+{
+    return mpoint_index.size();
+}
+
+
+double CellList::getCellSize() const
+{
+    return mcellsize;
+}
+
+
+void CellList::findNear(vector<int>& indices,
+        double x, double y, double z, double rcut) const
+{
+    assert(mbuilt);
+    indices.clear();
+    int lo[3], hi[3];
+    if (!this->cellRange(lo[0], hi[0], 0, x, rcut) ||
+        !this->cellRange(lo[1], hi[1], 1, y, rcut) ||
+        !this->cellRange(lo[2], hi[2], 2, z, rcut))
+    {
+        return;
+    }
+    for (int ix = lo[0]; ix <= hi[0]; ++ix)
+    {
+        for (int iy = lo[1]; iy <= hi[1]; ++iy)
+        {
+            // cells along z are adjacent in the cell arrays
+            int c0 = (ix * mdim[1] + iy) * mdim[2] + lo[2];
+            int c1 = c0 + hi[2] - lo[2] + 1;
+            indices.insert(indices.end(),
+                    mpoint_index.begin() + mcell_start[c0],
+                    mpoint_index.begin() + mcell_start[c1]);
+        }
+    }
+    // indices from a single cell are already sorted
+    bool onecell = (lo[0] == hi[0] && lo[1] == hi[1] && lo[2] == hi[2]);
+    if (!onecell)   sort(indices.begin(), indices.end());
+}
+
+
+bool CellList::hasNear(double x, double y, double z, double rcut) const
+{
+    assert(mbuilt);
+    int lo[3], hi[3];
+    if (!this->cellRange(lo[0], hi[0], 0, x, rcut) ||
+        !this->cellRange(lo[1], hi[1], 1, y, rcut) ||
+        !this->cellRange(lo[2], hi[2], 2, z, rcut))
+    {
+        return false;
+    }
+    for (int ix = lo[0]; ix <= hi[0]; ++ix)
+    {
+        for (int iy = lo[1]; iy <= hi[1]; ++iy)
+        {
+            int c0 = (ix * mdim[1] + iy) * mdim[2] + lo[2];
+            int c1 = c0 + hi[2] - lo[2] + 1;
+            if (mcell_start[c0] != mcell_start[c1])     return true;
+        }
+    }
+    return false;
+}
+
+// Private Methods -----------------------------------------------------------
+
+bool CellList::cellRange(int& lo, int& hi,
+        int axis, double x, double rcut) const
+{
+    // work in doubles to avoid integer overflow for very large rcut
+    double flo = floor((x - rcut - mlo[axis]) / mcellsize);
+    double fhi = floor((x + rcut - mlo[axis]) / mcellsize);
+    if (fhi < 0.0 || flo >= mdim[axis])   return false;
+    lo = int(max(flo, 0.0));
+    hi = int(min(fhi, double(mdim[axis] - 1)));
+    return true;
+}
+
+// End of file
@@ -0,0 +1,54 @@
+/***********************************************************************
+* Short Title: uniform grid of cells for spatial neighbor queries
+*
+* Comments: CellList sorts points into cubic cells of a bounding box
+*     grid, so that points close to a given position can be found
+*     without scanning all of them.  Point indices are returned in
+*     ascending order, which keeps the order of cost summations.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef CELLLIST_HPP_INCLUDED
+#define CELLLIST_HPP_INCLUDED
+
+#include <vector>
+
+class CellList
+{
+    public:
+
+        // constructor
+        CellList();
+
+        // methods
+        void build(const std::vector<double>& rx,
+                const std::vector<double>& ry,
+                const std::vector<double>& rz, double cellsize);
+        void clear();
+        bool isBuilt() const;
+        size_t countPoints() const;
+        double getCellSize() const;
+        // replace indices with points in cells within rcut from (x, y, z)
+        void findNear(std::vector<int>& indices,
+                double x, double y, double z, double rcut) const;
+        // false when cells within rcut from (x, y, z) hold no points,
+        // checks only the bounding box and the cell counts
+        bool hasNear(double x, double y, double z, double rcut) const;
+
+    private:
+
+        // data
+        bool mbuilt;
+        double mcellsize;
+        double mlo[3];
+        int mdim[3];
+        std::vector<int> mcell_start;
+        std::vector<int> mpoint_index;
+
+        // methods
+        bool cellRange(int& lo, int& hi, int axis, double x, double rcut) const;
+
+};
+
+#endif  // CELLLIST_HPP_INCLUDED
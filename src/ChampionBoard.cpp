@@ -0,0 +1,141 @@
+/***********************************************************************
+* Short Title: lock-free board of the best champion of forked ligas
+*
+* Comments: implementation of ChampionBoard
+*
+* <license text>
+***********************************************************************/
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "ChampionBoard.hpp"
+
+using namespace std;
+
+// Local helpers for cost bits -----------------------------------------------
+
+namespace {
+
+// bit patterns of non-negative doubles are ordered as their values
+
+boost::uint64_t cost_to_bits(double cost)
+{
+    boost::uint64_t bits;
+    memcpy(&bits, &cost, sizeof(bits));
+    return bits;
+}
+
+
+double bits_to_cost(boost::uint64_t bits)
+{
+    double cost;
+    memcpy(&cost, &bits, sizeof(cost));
+    return cost;
+}
+
+
+// atomic read also on 32-bit platforms
+boost::uint64_t load_bits(volatile boost::uint64_t* p)
+{
+    return __sync_fetch_and_add(p, boost::uint64_t(0));
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class ChampionBoard
+//////////////////////////////////////////////////////////////////////////////
+
+// constructor and destructor
+
+ChampionBoard::ChampionBoard(int maxatoms) :
+    _maxatoms(maxatoms), _mapsize(0), _board(NULL)
+{
+    if (maxatoms < 0)
+    {
+        const char* emsg = "ChampionBoard requires non-negative maxatoms.";
+        throw invalid_argument(emsg);
+    }
+    _mapsize = sizeof(Board) + maxatoms * sizeof(boost::uint64_t);
+    void* p = mmap(NULL, _mapsize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        ostringstream emsg;
+        emsg << "ChampionBoard: cannot map shared memory, " <<
+            strerror(errno) << '.';
+        throw runtime_error(emsg.str());
+    }
+    _board = static_cast<Board*>(p);
+    _board->top = -1;
+    _board->epoch = 0;
+    const boost::uint64_t nocost =
+        cost_to_bits(numeric_limits<double>::max());
+    for (int i = 0; i <= maxatoms; ++i)     _board->costs[i] = nocost;
+    __sync_synchronize();
+}
+
+
+ChampionBoard::~ChampionBoard()
+{
+    munmap(_board, _mapsize);
+}
+
+// public methods
+
+bool ChampionBoard::publish(int natoms, double cost)
+{
+    if (natoms < 0 || natoms > _maxatoms || !(cost >= 0.0))  return false;
+    // normalize negative zero, which has the highest bits
+    const boost::uint64_t newbits = cost_to_bits(cost + 0.0);
+    volatile boost::uint64_t* slot = _board->costs + natoms;
+    boost::uint64_t oldbits = load_bits(slot);
+    bool improved = false;
+    while (newbits < oldbits)
+    {
+        boost::uint64_t prev =
+            __sync_val_compare_and_swap(slot, oldbits, newbits);
+        improved = (prev == oldbits);
+        if (improved)   break;
+        oldbits = prev;
+    }
+    // raise the top level only after its cost is set
+    long top = __sync_fetch_and_add(&_board->top, 0L);
+    while (natoms > top)
+    {
+        long prev = __sync_val_compare_and_swap(&_board->top, top, natoms);
+        if (prev == top)    break;
+        top = prev;
+    }
+    if (improved)   __sync_fetch_and_add(&_board->epoch, 1UL);
+    return improved;
+}
+
+
+bool ChampionBoard::best(int& natoms, double& cost) const
+{
+    long top = __sync_fetch_and_add(&_board->top, 0L);
+    if (top < 0)    return false;
+    natoms = top;
+    cost = bits_to_cost(load_bits(_board->costs + top));
+    return true;
+}
+
+
+unsigned long ChampionBoard::epoch() const
+{
+    return __sync_fetch_and_add(&_board->epoch, 0UL);
+}
+
+
+int ChampionBoard::maxAtoms() const
+{
+    return _maxatoms;
+}
+
+// End of file
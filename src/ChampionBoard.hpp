@@ -0,0 +1,57 @@
+/***********************************************************************
+* Short Title: lock-free board of the best champion of forked ligas
+*
+* Comments: ChampionBoard keeps the lowest champion cost at every
+*     level in an anonymous shared memory map, which is inherited by
+*     processes forked after the board is created.  Ligas of island or
+*     sweep processes publish their champions with compare-and-swap
+*     on the level cost and readers take a snapshot of the best
+*     champion without ever blocking the publishers.  The epoch counts
+*     improvements so that readers can cheaply check for a new champion.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef CHAMPIONBOARD_HPP_INCLUDED
+#define CHAMPIONBOARD_HPP_INCLUDED
+
+#include <boost/cstdint.hpp>
+
+class ChampionBoard
+{
+    public:
+
+        // constructor and destructor
+        ChampionBoard(int maxatoms);
+        ~ChampionBoard();
+
+        // methods
+        // return true when cost improves the champion of its level
+        bool publish(int natoms, double cost);
+        // champion with the most atoms, false when nothing was published
+        bool best(int& natoms, double& cost) const;
+        unsigned long epoch() const;
+        int maxAtoms() const;
+
+    private:
+
+        // types
+        struct Board
+        {
+            volatile long top;
+            volatile unsigned long epoch;
+            // bits of the lowest cost at each level
+            volatile boost::uint64_t costs[1];
+        };
+
+        // data
+        int _maxatoms;
+        size_t _mapsize;
+        Board* _board;
+
+        // disable copying
+        ChampionBoard(const ChampionBoard&);
+        ChampionBoard& operator=(const ChampionBoard&);
+};
+
+#endif  // CHAMPIONBOARD_HPP_INCLUDED
@@ -9,19 +9,31 @@
 #include <iostream>
 #include <unistd.h>
 #include <sys/times.h>
+#include <boost/thread/mutex.hpp>
 
 #include "Counter.hpp"
 
 using namespace std;
 
+namespace {
+
+boost::mutex counter_storage_lock;
+
+}   // namespace
+
 // class constants
 
 const time_t Counter::_start_walltime = time(NULL);
 
+// class data
+
+__thread vector<Counter::ValueType>* Counter::_thread_values = NULL;
+
 // class methods
 
 Counter* Counter::getCounter(string name)
 {
+    boost::mutex::scoped_lock lock(counter_storage_lock);
     if (!storage().count(name))
     {
         storage()[name] = new Counter(name);
@@ -42,6 +54,14 @@ double Counter::WallTime()
     return rv;
 }
 
+double Counter::PreciseWallTime()
+{
+    // monotonic clock for timing short intervals
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
 void Counter::printCounters()
 {
     CounterStorage::iterator ii;
@@ -75,10 +95,23 @@ Counter::CounterStorage& Counter::storage()
 }
 
 
+void Counter::mergeThreadValues(const vector<ValueType>& values)
+{
+    boost::mutex::scoped_lock lock(counter_storage_lock);
+    CounterStorage::iterator ii;
+    for (ii = storage().begin(); ii != storage().end(); ++ii)
+    {
+        Counter& cii = *(ii->second);
+        if (cii._index >= values.size())    continue;
+        __sync_fetch_and_add(&cii._value, values[cii._index]);
+    }
+}
+
+
 
 // constructor - private
 
-Counter::Counter(string name) : _name(name)
+Counter::Counter(string name) : _name(name), _index(storage().size())
 {
     reset();
 }
@@ -93,6 +126,27 @@ ostream& operator<<(ostream& os, const Counter& cnt)
 }
 
 
+////////////////////////////////////////////////////////////////////////
+// definitions for Counter::ThreadTally
+////////////////////////////////////////////////////////////////////////
+
+Counter::ThreadTally::ThreadTally()
+{
+    {
+        boost::mutex::scoped_lock lock(counter_storage_lock);
+        _values.assign(storage().size(), 0);
+    }
+    _saved_values = _thread_values;
+    _thread_values = &_values;
+}
+
+
+Counter::ThreadTally::~ThreadTally()
+{
+    _thread_values = _saved_values;
+    Counter::mergeThreadValues(_values);
+}
+
 ////////////////////////////////////////////////////////////////////////
 // definitions for Counter::CounterStorage
 ////////////////////////////////////////////////////////////////////////
@@ -12,6 +12,7 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <vector>
 #include <ctime>
 
 class Counter
@@ -24,17 +25,33 @@ class Counter
         // types
         typedef unsigned long long ValueType;
 
+        // private tally of a worker thread, which is added to the
+        // counters when ThreadTally goes out of scope
+        class ThreadTally
+        {
+            public:
+
+                ThreadTally();
+                ~ThreadTally();
+
+            private:
+
+                std::vector<ValueType> _values;
+                std::vector<ValueType>* _saved_values;
+        };
+
         // class methods
         static Counter* getCounter(std::string name);
         static double CPUTime();
         static double WallTime();
+        static double PreciseWallTime();
         static void printCounters();
         static void printRunStats();
 
         // public methods
         inline const std::string& name() const  { return _name; }
         inline ValueType value() const          { return _value; }
-        inline void count(int tics=1)           { _value += tics; }
+        inline void count(int tics=1);
         inline void reset(ValueType cnt=0)      { _value = cnt; }
 
     private:
@@ -48,17 +65,31 @@ class Counter
 
         // class methods
         static CounterStorage& storage();
+        static void mergeThreadValues(const std::vector<ValueType>& values);
 
         // constructor
         Counter(std::string name);
 
         // Data Members
         const std::string _name;
+        const size_t _index;
         ValueType _value;
         static const time_t _start_walltime;
+        static __thread std::vector<ValueType>* _thread_values;
 
 };
 
+// Inline Definitions --------------------------------------------------------
+
+inline void Counter::count(int tics)
+{
+    std::vector<ValueType>* tvalues = _thread_values;
+    if (tvalues && _index < tvalues->size())    (*tvalues)[_index] += tics;
+    // no tally or counter created after the ThreadTally, other threads
+    // may merge their tallies concurrently
+    else    __sync_fetch_and_add(&_value, ValueType(tics));
+}
+
 // non-member operators
 
 std::ostream& operator<<(std::ostream& os, const Counter& cnt);
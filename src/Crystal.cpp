@@ -9,6 +9,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <boost/foreach.hpp>
+#include <boost/thread/tss.hpp>
 #include "Crystal.hpp"
 #include "Lattice.hpp"
 #include "Atom_t.hpp"
@@ -16,6 +17,8 @@
 #include "AtomOverlapCrystal.hpp"
 #include "LigaUtils.hpp"
 #include "AtomSequence.hpp"
+#include "SectionTimer.hpp"
+#include "WorkerPool.hpp"
 
 using namespace std;
 using namespace NS_LIGA;
@@ -49,11 +52,13 @@ Crystal& Crystal::operator=(const Molecule& mol)
 
 Crystal& Crystal::operator=(const Crystal& crs)
 {
+    SECTION_TIMER("Crystal::operator=");
     if (this == &crs)   return *this;
     // execute base assignment
     Molecule::operator=(crs);
     // copy Crystal specific data
     this->_lattice = crs._lattice;
+    this->_symmetry = crs._symmetry;
     this->_lattice_max_ucd = crs._lattice_max_ucd;
     this->_rmin = crs._rmin;
     this->_rmax = crs._rmax;
@@ -62,12 +67,19 @@ Crystal& Crystal::operator=(const Crystal& crs)
     this->pmx_pair_counts = crs.pmx_pair_counts;
     this->_count_pairs = crs._count_pairs;
     this->_cost_data_cached = crs._cost_data_cached;
+    this->_pmx_rows_cached = crs._pmx_rows_cached;
+    this->_pmx_cost_scale = crs._pmx_cost_scale;
+    this->_pmx_cost_penalty = crs._pmx_cost_penalty;
+    this->_pmx_cost_penalty_width = crs._pmx_cost_penalty_width;
+    this->_pmx_row_current = crs._pmx_row_current;
+    this->_pmx_row_position = crs._pmx_row_position;
     return *this;
 }
 
 
 Molecule* Crystal::copy() const
 {
+    SECTION_TIMER("Crystal::copy");
     Molecule* pclone = new Crystal(*this);
     return pclone;
 }
@@ -97,6 +109,7 @@ void Crystal::setLattice(const Lattice& lat)
 {
     this->_lattice.reset(new Lattice(lat));
     this->_lattice_max_ucd = this->_lattice->ucMaxDiagonalLength();
+    this->uncacheOverlapPairs();
     this->uncacheCostData();
 }
 
@@ -134,6 +147,67 @@ pair<double,double> Crystal::getRExtent(double rmin, double rmax) const
 }
 
 
+void Crystal::setSymmetry(const vector<SymmetryOperation>& ops)
+{
+    if (!SymmetryOperation::isGroup(ops))
+    {
+        const char* emsg = "Symmetry operations do not form a group.";
+        throw invalid_argument(emsg);
+    }
+    this->_symmetry.reset(new vector<SymmetryOperation>(ops));
+    this->uncacheOverlapPairs();
+    this->uncacheCostData();
+}
+
+
+const vector<SymmetryOperation>& Crystal::getSymmetry() const
+{
+    return *_symmetry;
+}
+
+
+bool Crystal::hasSymmetry() const
+{
+    return this->_symmetry->size() > 1;
+}
+
+
+// Cartesian positions of the distinct symmetry images of site rc.
+// The first image is rc itself, the others are in the unit cell.
+// Images that coincide up to a lattice translation are included only
+// once, hence the number of images is the site multiplicity.
+// When specified, opidx is filled with the operation for every image.
+
+void Crystal::siteImages(const R3::Vector& rc, vector<R3::Vector>& images,
+        vector<int>* opidx) const
+{
+    const Lattice& lat = this->getLattice();
+    const vector<SymmetryOperation>& ops = this->getSymmetry();
+    const R3::Vector lv = lat.fractional(rc);
+    images.assign(1, rc);
+    if (opidx)  opidx->clear();
+    for (size_t k = 0; k != ops.size(); ++k)
+    {
+        if (ops[k].isIdentity())
+        {
+            if (opidx && opidx->empty())    opidx->push_back(k);
+            continue;
+        }
+        R3::Vector rk = lat.cartesian(lat.ucvFractional(ops[k](lv)));
+        vector<R3::Vector>::const_iterator ii;
+        for (ii = images.begin(); ii != images.end(); ++ii)
+        {
+            double dk = R3::norm(lat.nearZeroCartesian(rk - *ii));
+            if (dk < NS_LIGA::eps_distance)     break;
+        }
+        if (ii != images.end())     continue;
+        images.push_back(rk);
+        if (opidx)  opidx->push_back(k);
+    }
+    assert(!opidx || opidx->size() == images.size());
+}
+
+
 double Crystal::cost() const
 {
     if (!this->_cost_data_cached)   recalculate();
@@ -150,94 +224,150 @@ int Crystal::countPairs() const
 
 void Crystal::recalculate() const
 {
-    // reset molecule
-    this->ResetBadness();
-    this->pmx_partial_costs.fill(0.0);
-    this->pmx_pair_counts.fill(0);
-    this->_count_pairs = 0;
-    // reset all atoms
-    for (AtomSequence seq(this); !seq.finished(); seq.next())
-    {
-        seq.ptr()->ResetBadness();
-    }
+    SECTION_TIMER("Crystal::recalculate");
+    this->updatePairRows(NULL);
     AtomCostCrystal* atomcost;
     atomcost = static_cast<AtomCostCrystal*>(getAtomCostCalculator());
-    // fill in self contributions
+    // fill in self contributions, these depend on the site position
+    // only for a crystal with symmetry
     if (this->countAtoms())
     {
         atomcost->eval(this->getAtom(0), AtomCost::SELFCOST);
     }
     double diagpaircost = atomcost->totalCost();
     int diagpaircount = atomcost->totalPairCount();
+    // sum the molecule and atom badness and the pair counts
+    this->ResetBadness();
+    this->_count_pairs = 0;
     for (AtomSequence seq(this); !seq.finished(); seq.next())
     {
+        if (this->hasSymmetry())
+        {
+            atomcost->eval(seq.ptr(), AtomCost::SELFCOST);
+            diagpaircost = atomcost->totalCost();
+            diagpaircount = atomcost->totalPairCount();
+        }
         int idx = seq.ptr()->pmxidx;
         this->pmx_partial_costs(idx, idx) = diagpaircost;
-        this->IncBadness(diagpaircost);
-        seq.ptr()->IncBadness(diagpaircost);
         this->pmx_pair_counts(idx, idx) = diagpaircount;
+        seq.ptr()->ResetBadness(diagpaircost);
+        this->IncBadness(diagpaircost);
         this->_count_pairs += diagpaircount;
     }
-    // fill off-diagonal elements
-    for (AtomSequenceIndex seq0(this); !seq0.finished(); seq0.next())
+    for (AtomSequence seq0(this); !seq0.finished(); seq0.next())
     {
-        double paircost = atomcost->eval(seq0.ptr());
-        const vector<double>& ptcs = atomcost->partialCosts();
-        const vector<int>& pcnt = atomcost->pairCounts();
-        for (AtomSequenceIndex seq1(this); !seq1.finished(); seq1.next())
+        AtomSequence seq1 = seq0;
+        for (seq1.next(); !seq1.finished(); seq1.next())
         {
-            if (seq1.ptr() == seq0.ptr())  continue;
             int idx0 = seq0.ptr()->pmxidx;
             int idx1 = seq1.ptr()->pmxidx;
-            assert(idx0 != idx1);
-            // check pair count elements that were already filled
-            const int& pcnt01 = pcnt[seq1.idx()];
-            assert(seq0.idx() < seq1.idx() ||
-                    this->pmx_pair_counts(idx0, idx1) == pcnt01);
-            this->pmx_pair_counts(idx0, idx1) = pcnt01;
-            // check partial cost elements that were already filled
-            const double& ptcs01 = ptcs[seq1.idx()];
-            assert(seq0.idx() < seq1.idx() ||
-                    eps_eq(this->pmx_partial_costs(idx0, idx1), ptcs01));
-            this->pmx_partial_costs(idx0, idx1) = ptcs01;
+            double paircost = this->partialCost(idx0, idx1);
+            double paircosthalf = paircost / 2.0;
+            seq0.ptr()->IncBadness(paircosthalf);
+            seq1.ptr()->IncBadness(paircosthalf);
+            this->IncBadness(paircost);
+            this->_count_pairs += this->pairCount(idx0, idx1);
         }
-        seq0.ptr()->IncBadness(paircost);
-        // off diagonal cost values are doubled, but we sum here
-        // over whole pair matrix.
-        this->IncBadness(paircost / 2.0);
-        // the same stands for pair counts
-        assert(atomcost->totalPairCount() % 2 == 0);
-        this->_count_pairs += atomcost->totalPairCount() / 2;
     }
     this->_cost_data_cached = true;
     this->recalculateOverlap();
 }
 
 
+// Job which evaluates the stale pairs of one pair row per task.
+// Every task writes its own matrix elements, hence the pair matrices
+// do not depend on the number of workers.
+
+class Crystal::PairRowsJob : public WorkerPool::Job
+{
+    public:
+
+        // constructor
+        PairRowsJob(const Crystal* crs, const vector<bool>& stale) :
+            crystal(crs), stale_rows(stale)
+        { }
+
+        // methods
+        void run(size_t task)
+        {
+            crystal->evalPairRow(task, stale_rows);
+        }
+
+        // data
+        const Crystal* crystal;
+        const vector<bool>& stale_rows;
+};
+
+
+void Crystal::cacheCost(WorkerPool& workers) const
+{
+    SECTION_TIMER("Crystal::cacheCost");
+    if (this->_cost_data_cached)    return;
+    // the expensive pair rows are evaluated by the workers,
+    // the remaining sums use the current rows
+    this->updatePairRows(&workers);
+    this->recalculate();
+}
+
+
 AtomCost* Crystal::getAtomCostCalculator() const
 {
     static AtomCostCrystal the_acc(this);
-    the_acc.resetFor(this);
-    return &the_acc;
+    AtomCostCrystal* rv = &the_acc;
+    // worker threads use private calculators with the same penalty
+    if (WorkerPool::isWorkerThread())
+    {
+        static boost::thread_specific_ptr<AtomCostCrystal> worker_acc;
+        if (!worker_acc.get())  worker_acc.reset(new AtomCostCrystal(this));
+        rv = worker_acc.get();
+        rv->setScale(the_acc.getScale());
+        rv->setPenalty(the_acc.getPenaltyType(), the_acc.getPenaltyWidth());
+    }
+    rv->resetFor(this);
+    return rv;
 }
 
 
 AtomCost* Crystal::getAtomOverlapCalculator() const
 {
     static AtomOverlapCrystal the_overlap_calculator(this);
-    the_overlap_calculator.resetFor(this);
-    return &the_overlap_calculator;
+    AtomOverlapCrystal* rv = &the_overlap_calculator;
+    // worker threads use private calculators with the same scale
+    if (WorkerPool::isWorkerThread())
+    {
+        static boost::thread_specific_ptr<AtomOverlapCrystal> worker_aoc;
+        if (!worker_aoc.get())  worker_aoc.reset(new AtomOverlapCrystal(this));
+        rv = worker_aoc.get();
+        rv->setScale(the_overlap_calculator.getScale());
+    }
+    rv->resetFor(this);
+    return rv;
 }
 
 
 void Crystal::Shift(const R3::Vector& drc)
 {
     this->Molecule::Shift(drc);
+    // symmetry images do not follow a common translation
+    if (this->hasSymmetry())
+    {
+        for (AtomSequence seq(this); !seq.finished(); seq.next())
+        {
+            seq.ptr()->r = this->ucvCartesianAdjusted(seq.ptr()->r);
+        }
+        this->packAtoms();
+        this->uncacheOverlapPairs();
+        this->uncacheCostData();
+        return;
+    }
     for (AtomSequence seq(this); !seq.finished(); seq.next())
     {
         Atom_t* pa = seq.ptr();
         pa->r = this->ucvCartesianAdjusted(pa->r);
+        // pair costs do not change with a common translation
+        if (this->_pmx_row_current[pa->pmxidx])  this->setCurrentPairRow(pa);
     }
+    this->packAtoms();
 }
 
 
@@ -260,6 +390,75 @@ AtomPtr Crystal::getNearestAtom(const R3::Vector& rc) const
 }
 
 
+// pair counts and the cached pair rows follow the molecule state
+
+void Crystal::writeCheckpoint(ostream& out) const
+{
+    this->Molecule::writeCheckpoint(out);
+    const SymmetricMatrix<int>& counts = this->pmx_pair_counts;
+    write_binary(out, counts.rows());
+    for (size_t i = 0; i != counts.rows(); ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)     write_binary(out, counts(i, j));
+    }
+    write_binary(out, this->_cost);
+    write_binary(out, this->_count_pairs);
+    write_binary(out, this->_cost_data_cached);
+    write_binary(out, this->_pmx_rows_cached);
+    write_binary(out, this->_pmx_cost_scale);
+    write_binary(out, this->_pmx_cost_penalty);
+    write_binary(out, this->_pmx_cost_penalty_width);
+    write_binary(out, this->_pmx_row_current.size());
+    for (size_t i = 0; i != this->_pmx_row_current.size(); ++i)
+    {
+        bool current = this->_pmx_row_current[i];
+        const R3::Vector& rc = this->_pmx_row_position[i];
+        write_binary(out, current);
+        write_binary(out, rc[0]);
+        write_binary(out, rc[1]);
+        write_binary(out, rc[2]);
+    }
+}
+
+
+bool Crystal::readCheckpoint(istream& in)
+{
+    if (!this->Molecule::readCheckpoint(in))    return false;
+    size_t sz;
+    size_t npmx = this->pmx_partial_costs.rows();
+    if (!read_binary(in, sz) || sz != npmx)     return false;
+    this->pmx_pair_counts.resize(sz, 0);
+    for (size_t i = 0; i != sz; ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)
+        {
+            if (!read_binary(in, this->pmx_pair_counts(i, j)))    return false;
+        }
+    }
+    bool isread = read_binary(in, this->_cost) &&
+        read_binary(in, this->_count_pairs) &&
+        read_binary(in, this->_cost_data_cached) &&
+        read_binary(in, this->_pmx_rows_cached) &&
+        read_binary(in, this->_pmx_cost_scale) &&
+        read_binary(in, this->_pmx_cost_penalty) &&
+        read_binary(in, this->_pmx_cost_penalty_width) &&
+        read_binary(in, sz) && sz == npmx;
+    if (!isread)    return false;
+    this->_pmx_row_current.resize(sz);
+    this->_pmx_row_position.resize(sz);
+    for (size_t i = 0; i != sz; ++i)
+    {
+        bool current;
+        R3::Vector& rc = this->_pmx_row_position[i];
+        isread = read_binary(in, current) && read_binary(in, rc[0]) &&
+            read_binary(in, rc[1]) && read_binary(in, rc[2]);
+        if (!isread)    return false;
+        this->_pmx_row_current[i] = current;
+    }
+    return true;
+}
+
+
 void Crystal::Clear()
 {
     this->Molecule::Clear();
@@ -267,14 +466,22 @@ void Crystal::Clear()
 }
 
 
-const pair<int*,int*>& Crystal::Evolve(const int* est_triang)
+pair<int*,int*> Crystal::Evolve(const int* est_triang,
+        const double* max_costs)
 {
-    const pair<int*,int*>& acc_tot = this->Molecule::Evolve(est_triang);
+    pair<int*,int*> acc_tot = this->Molecule::Evolve(est_triang, max_costs);
     this->shiftToOrigin();
     return acc_tot;
 }
 
 
+int Crystal::countTriangulationTypes(int natoms) const
+{
+    // periodic images provide anchors for all triangulation types
+    return NTGTYPES;
+}
+
+
 void Crystal::Degenerate(int Npop, DegenerateFlags flags)
 {
     this->Molecule::Degenerate(Npop, flags);
@@ -315,13 +522,20 @@ void Crystal::addNewAtomPairs(Atom_t* pa)
         int paircount = pcnt[seq.idx()];
         this->pmx_pair_counts(idx0, idx1) = paircount;
     }
-    this->IncBadness(atomcost->totalCost());
-    this->_count_pairs += atomcost->totalPairCount();
+    // total cost includes self contribution for a crystal with symmetry
+    pair<double,int> selfcc = atomcost->selfCostCount();
+    this->IncBadness(atomcost->totalCost() - selfcc.first);
+    this->_count_pairs += atomcost->totalPairCount() - selfcc.second;
     // add self contribution:
     // calculates self cost and self pair count
     double diagpaircost;
     int diagpaircount;
-    if (this->atoms.empty())
+    if (this->hasSymmetry())
+    {
+        diagpaircost = selfcc.first;
+        diagpaircount = selfcc.second;
+    }
+    else if (this->atoms.empty())
     {
         R3::Vector zeros(0.0, 0.0, 0.0);
         Atom_t adummy("", 0.0, 0.0, 0.0);
@@ -332,8 +546,8 @@ void Crystal::addNewAtomPairs(Atom_t* pa)
     else
     {
         int idx1 = atoms.front()->pmxidx;
-        diagpaircost = this->pmx_partial_costs(idx1, idx1);
-        diagpaircount = this->pmx_pair_counts(idx1, idx1);
+        diagpaircost = this->partialCost(idx1, idx1);
+        diagpaircount = this->pairCount(idx1, idx1);
     }
     int idx0 = pa->pmxidx;
     this->pmx_partial_costs(idx0, idx0) = diagpaircost;
@@ -341,6 +555,7 @@ void Crystal::addNewAtomPairs(Atom_t* pa)
     this->IncBadness(diagpaircost);
     this->pmx_pair_counts(idx0, idx0) = diagpaircount;
     this->_count_pairs += diagpaircount;
+    this->setCurrentPairRow(pa);
     // take care of small round offs
     if (isNearZeroRoundOff(this->Badness()))  this->ResetBadness();
     // add overlap contributions
@@ -350,19 +565,20 @@ void Crystal::addNewAtomPairs(Atom_t* pa)
 
 void Crystal::removeAtomPairs(Atom_t* pa)
 {
+    this->_pmx_row_current[pa->pmxidx] = false;
     // remove associated pair costs and pair counts
     for (AtomSequence seq(this); !seq.finished(); seq.next())
     {
         int idx0 = pa->pmxidx;
         int idx1 = seq.ptr()->pmxidx;
         // remove pair costs
-        double paircost = pmx_partial_costs(idx0, idx1);
+        double paircost = partialCost(idx0, idx1);
         double paircosthalf = paircost/2.0;
         pa->DecBadness(paircosthalf);
         seq.ptr()->DecBadness(paircosthalf);
         this->DecBadness(paircost);
         // remove pair counts
-        this->_count_pairs -= this->pmx_pair_counts(idx0, idx1);
+        this->_count_pairs -= this->pairCount(idx0, idx1);
     }
     if (isNearZeroRoundOff(this->Badness()))  this->ResetBadness();
     assert(this->_count_pairs >= 0);
@@ -371,11 +587,41 @@ void Crystal::removeAtomPairs(Atom_t* pa)
 }
 
 
-const Crystal::TriangulationAnchor&
+void Crystal::removeAtomPairs(const vector<char>& popmask)
+{
+    assert(popmask.size() == atoms.size());
+    // pairs of two popped atoms are removed with the higher one
+    for (int ri = countAtoms() - 1; ri >= 0; --ri)
+    {
+        if (!popmask[ri])   continue;
+        int idx0 = atoms[ri]->pmxidx;
+        this->_pmx_row_current[idx0] = false;
+        for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
+        {
+            int j = seq.idx();
+            if (j > ri && popmask[j])   continue;
+            int idx1 = seq.ptr()->pmxidx;
+            double paircost = partialCost(idx0, idx1);
+            if (j != ri)    seq.ptr()->DecBadness(paircost/2.0);
+            this->DecBadness(paircost);
+            this->_count_pairs -= this->pairCount(idx0, idx1);
+        }
+    }
+    for (int i = 0; i != countAtoms(); ++i)
+    {
+        if (popmask[i])     atoms[i]->ResetBadness();
+    }
+    if (isNearZeroRoundOff(this->Badness()))  this->ResetBadness();
+    assert(this->_count_pairs >= 0);
+    this->removeOverlapContributions(popmask);
+}
+
+
+Crystal::TriangulationAnchor
 Crystal::getLineAnchor(const RandomWeighedGenerator& rwg)
 {
     assert(countAtoms() >= 1);
-    static TriangulationAnchor anch;
+    TriangulationAnchor anch;
     anch.count = 2;
     anch.B0 = anyOffsetAtomSite(rwg);
     anch.B1 = anyOffsetAtomSite(rwg);
@@ -383,11 +629,11 @@ Crystal::getLineAnchor(const RandomWeighedGenerator& rwg)
 }
 
 
-const Crystal::TriangulationAnchor&
+Crystal::TriangulationAnchor
 Crystal::getPlaneAnchor(const RandomWeighedGenerator& rwg)
 {
     assert(countAtoms() >= 1);
-    static TriangulationAnchor anch;
+    TriangulationAnchor anch;
     anch.count = 3;
     anch.B0 = anyOffsetAtomSite(rwg);
     anch.B1 = anyOffsetAtomSite(rwg);
@@ -396,7 +642,7 @@ Crystal::getPlaneAnchor(const RandomWeighedGenerator& rwg)
 }
 
 
-const Crystal::TriangulationAnchor&
+Crystal::TriangulationAnchor
 Crystal::getPyramidAnchor(const RandomWeighedGenerator& rwg)
 {
     return Crystal::getPlaneAnchor(rwg);
@@ -407,7 +653,9 @@ void Crystal::resizePairMatrices(int sz)
 {
     Molecule::resizePairMatrices(sz);
     size_t sznew = this->pmx_partial_costs.rows();
-    this->pmx_pair_counts.resize(sznew, sznew, 0);
+    this->pmx_pair_counts.resize(sznew, 0);
+    this->_pmx_row_current.resize(sznew, false);
+    this->_pmx_row_position.resize(sznew);
 }
 
 
@@ -442,20 +690,37 @@ void Crystal::setFromDiffPyStructure(boost::python::object stru)
 }
 
 
+// nearest image distances do not change when atoms are shifted
+// by lattice vectors
+
+double Crystal::fingerprintDistance(
+        const Atom_t* pa0, const Atom_t* pa1) const
+{
+    const Lattice& lat = this->getLattice();
+    return R3::norm(lat.nearZeroCartesian(pa1->r - pa0->r));
+}
+
+
 // Private Class Methods -----------------------------------------------------
 
 
 boost::shared_ptr<Lattice> Crystal::getDefaultLattice()
 {
-    static boost::shared_ptr<Lattice> default_lattice;
-    if (!default_lattice.get())
-    {
-        default_lattice.reset(new Lattice());
-    }
+    // initialized once also when crystals are created in worker threads
+    static boost::shared_ptr<Lattice> default_lattice(new Lattice());
     return default_lattice;
 }
 
 
+boost::shared_ptr<const vector<SymmetryOperation> >
+Crystal::getDefaultSymmetry()
+{
+    static boost::shared_ptr<const vector<SymmetryOperation> >
+        identity(new vector<SymmetryOperation>(1));
+    return identity;
+}
+
+
 // Private Methods -----------------------------------------------------------
 
 
@@ -464,10 +729,14 @@ void Crystal::init()
     this->_rmin = 0.0;
     this->_rmax = 0.0;
     this->_lattice = Crystal::getDefaultLattice();
+    this->_symmetry = Crystal::getDefaultSymmetry();
     this->_lattice_max_ucd = this->_lattice->ucMaxDiagonalLength();
     this->_full_distance_table = this->Molecule::_distance_table;
     // the default _distance_table should exist and be blank
     assert(this->_full_distance_table.get());
+    this->_pmx_cost_scale = 0.0;
+    this->_pmx_cost_penalty = AtomCost::SQUARE;
+    this->_pmx_cost_penalty_width = 0.0;
     this->uncacheCostData();
     this->setDistReuse(true);
 }
@@ -476,6 +745,9 @@ void Crystal::init()
 void Crystal::uncacheCostData() const
 {
     this->_cost_data_cached = false;
+    this->_pmx_rows_cached = false;
+    this->uncacheAnchorGenerator();
+    this->_pmx_row_current.assign(this->_pmx_row_current.size(), false);
     if (countAtoms() == 0)
     {
         this->ResetBadness();
@@ -486,6 +758,86 @@ void Crystal::uncacheCostData() const
 }
 
 
+// update off-diagonal elements of pairs with a stale row,
+// every unordered pair is evaluated only once
+
+void Crystal::updatePairRows(WorkerPool* workers) const
+{
+    AtomCostCrystal* atomcost;
+    atomcost = static_cast<AtomCostCrystal*>(getAtomCostCalculator());
+    // all pair rows are stale after a change of lattice, rmax, cost scale
+    // or penalty form
+    if (!this->_pmx_rows_cached ||
+            this->_pmx_cost_scale != atomcost->getScale() ||
+            this->_pmx_cost_penalty != atomcost->getPenaltyType() ||
+            this->_pmx_cost_penalty_width != atomcost->getPenaltyWidth())
+    {
+        this->_pmx_row_current.assign(this->_pmx_row_current.size(), false);
+    }
+    vector<bool> stale(this->countAtoms());
+    for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
+    {
+        stale[seq.idx()] = !this->isCurrentPairRow(seq.ptr());
+    }
+    // the pool is not reentrant, evaluate nested rows in this thread
+    if (workers && !WorkerPool::isWorkerThread())
+    {
+        PairRowsJob job(this, stale);
+        workers->execute(job, stale.size());
+    }
+    else
+    {
+        for (int i0 = 0; i0 < this->countAtoms(); ++i0)
+        {
+            this->evalPairRow(i0, stale);
+        }
+    }
+    for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
+    {
+        if (stale[seq.idx()])   this->setCurrentPairRow(seq.ptr());
+    }
+    this->_pmx_rows_cached = true;
+    this->_pmx_cost_scale = atomcost->getScale();
+    this->_pmx_cost_penalty = atomcost->getPenaltyType();
+    this->_pmx_cost_penalty_width = atomcost->getPenaltyWidth();
+}
+
+
+void Crystal::evalPairRow(int i0, const vector<bool>& stale) const
+{
+    AtomCostCrystal* atomcost;
+    atomcost = static_cast<AtomCostCrystal*>(getAtomCostCalculator());
+    const Atom_t* pa0 = this->atoms[i0];
+    for (int i1 = i0 + 1; i1 < this->countAtoms(); ++i1)
+    {
+        if (!stale[i0] && !stale[i1])   continue;
+        const Atom_t* pa1 = this->atoms[i1];
+        int idx0 = pa0->pmxidx;
+        int idx1 = pa1->pmxidx;
+        assert(idx0 != idx1);
+        pair<double,int> costcount = atomcost->evalPair(pa0, pa1);
+        this->pmx_partial_costs(idx0, idx1) = costcount.first;
+        this->pmx_pair_counts(idx0, idx1) = costcount.second;
+    }
+}
+
+
+bool Crystal::isCurrentPairRow(const Atom_t* pa) const
+{
+    int idx = pa->pmxidx;
+    return this->_pmx_row_current[idx] &&
+        R3::VectorsAlmostEqual(this->_pmx_row_position[idx], pa->r);
+}
+
+
+void Crystal::setCurrentPairRow(const Atom_t* pa) const
+{
+    int idx = pa->pmxidx;
+    this->_pmx_row_current[idx] = true;
+    this->_pmx_row_position[idx] = pa->r;
+}
+
+
 void Crystal::cropDistanceTable()
 {
     boost::shared_ptr<DistanceTable> cropped(new DistanceTable);
@@ -498,22 +850,33 @@ void Crystal::cropDistanceTable()
     for (DistanceTable::const_iterator xi = lo; xi != hi; ++xi)
     {
         cropped->push_back(*xi);
-        cesds.push_back(this->_full_distance_table->getesd(*xi));
+        cesds.push_back(this->_full_distance_table->getesdAt(xi - lo));
     }
     if (this->_full_distance_table->hasESDs())  cropped->setESDs(cesds);
+    cropped->buildBucketIndex();
     this->_distance_table = cropped;
+    this->_distance_usage.resize(cropped->size());
 }
 
 
 // position of random atom site offset by random lattice vector
-const R3::Vector&
+R3::Vector
 Crystal::anyOffsetAtomSite(const RandomWeighedGenerator& rwg) const
 {
     assert(countAtoms() >= 1);
-    static R3::Vector rv;
+    R3::Vector rv;
     int idx = rwg.weighedInt();
     R3::Vector mno(randomInt(2), randomInt(2), randomInt(2));
-    rv = this->atoms[idx]->r + getLattice().cartesian(mno);
+    R3::Vector rc = this->atoms[idx]->r;
+    // use any symmetry image of the atom site
+    if (this->hasSymmetry())
+    {
+        const Lattice& lat = this->getLattice();
+        const vector<SymmetryOperation>& ops = this->getSymmetry();
+        const SymmetryOperation& op = ops[randomInt(ops.size())];
+        rc = lat.cartesian(op(lat.fractional(rc)));
+    }
+    rv = rc + getLattice().cartesian(mno);
     return rv;
 }
 
@@ -544,7 +907,8 @@ R3::Vector Crystal::ucvCartesianAdjusted(const R3::Vector& cv) const
 // Move first atom to the origin of the lattice coordinate system.
 void Crystal::shiftToOrigin()
 {
-    if (this->countAtoms() == 0)    return;
+    // symmetry operations fix the origin
+    if (this->countAtoms() == 0 || this->hasSymmetry())    return;
     // make sure the first atom is at the origin
     const R3::Vector rc0 = this->getAtom(0).r;
     if (R3::norm(rc0) > NS_LIGA::eps_distance)  this->Shift(-rc0);
@@ -9,8 +9,11 @@
 #ifndef CRYSTAL_T_HPP_INCLUDED
 #define CRYSTAL_T_HPP_INCLUDED
 
+#include <vector>
 #include <boost/shared_ptr.hpp>
 #include "Molecule.hpp"
+#include "AtomCost.hpp"
+#include "SymmetryOperation.hpp"
 
 class Lattice;
 class AtomCostCrystal;
@@ -48,17 +51,30 @@ class Crystal : public Molecule
         double getRmax() const;
         std::pair<double,double> getRExtent(double rlo, double rhi) const;
 
+        // symmetry operations that generate the crystal from its atoms,
+        // the default identity keeps all atoms independent
+        void setSymmetry(const std::vector<SymmetryOperation>& ops);
+        const std::vector<SymmetryOperation>& getSymmetry() const;
+        bool hasSymmetry() const;
+        void siteImages(const R3::Vector& rc, std::vector<R3::Vector>& images,
+                std::vector<int>* opidx=NULL) const;
+
         virtual double cost() const;
         virtual int countPairs() const;
         virtual void recalculate() const;
+        virtual void cacheCost(WorkerPool& workers) const;
         virtual AtomCost* getAtomCostCalculator() const;
         virtual AtomCost* getAtomOverlapCalculator() const;
 
         virtual void Shift(const R3::Vector& drc);
+        virtual void writeCheckpoint(std::ostream& out) const;
+        virtual bool readCheckpoint(std::istream& in);
 
         virtual AtomPtr getNearestAtom(const R3::Vector& rc) const;
         virtual void Clear();
-        virtual const std::pair<int*,int*>& Evolve(const int* est_triang);
+        virtual std::pair<int*,int*> Evolve(const int* est_triang,
+                const double* max_costs=NULL);
+        virtual int countTriangulationTypes(int natoms) const;
         virtual void Degenerate(int Npop, DegenerateFlags flags=NONE);
 
     protected:
@@ -68,38 +84,66 @@ class Crystal : public Molecule
         mutable SymmetricMatrix<int> pmx_pair_counts;
 
         // methods
+        inline int pairCount(int i0, int i1) const
+        {
+            const SymmetricMatrix<int>& pmx = pmx_pair_counts;
+            return pmx(i0, i1);
+        }
         virtual void AddInternal(Atom_t* pa);  // add atom from the storage
         virtual void addNewAtomPairs(Atom_t* pa);
         virtual void removeAtomPairs(Atom_t* pa);
-        virtual const TriangulationAnchor&
+        virtual void removeAtomPairs(const std::vector<char>& popmask);
+        virtual TriangulationAnchor
             getLineAnchor(const RandomWeighedGenerator& rwg);
-        virtual const TriangulationAnchor&
+        virtual TriangulationAnchor
             getPlaneAnchor(const RandomWeighedGenerator& rwg);
-        virtual const TriangulationAnchor&
+        virtual TriangulationAnchor
             getPyramidAnchor(const RandomWeighedGenerator& rwg);
         virtual void resizePairMatrices(int sz);
         virtual boost::python::object newDiffPyStructure() const;
         virtual void setFromDiffPyStructure(boost::python::object);
+        virtual double fingerprintDistance(
+                const Atom_t* pa0, const Atom_t* pa1) const;
 
     private:
 
+        // job which evaluates the stale pairs of one pair row per task
+        class PairRowsJob;
+        friend class PairRowsJob;
+
         // crystal specific data
         boost::shared_ptr<const Lattice> _lattice;
+        boost::shared_ptr<const std::vector<SymmetryOperation> > _symmetry;
         double _rmin;
         double _rmax;
         mutable double _cost;
         mutable int _count_pairs;
         mutable bool _cost_data_cached;
         double _lattice_max_ucd;
+        // pair matrix rows that are valid for the current lattice and rmax,
+        // with atom positions and cost scale and penalty used for their
+        // evaluation
+        mutable bool _pmx_rows_cached;
+        mutable double _pmx_cost_scale;
+        mutable AtomCost::PenaltyType _pmx_cost_penalty;
+        mutable double _pmx_cost_penalty_width;
+        mutable std::vector<bool> _pmx_row_current;
+        mutable std::vector<R3::Vector> _pmx_row_position;
 
         // class methods
         boost::shared_ptr<Lattice> getDefaultLattice();
+        boost::shared_ptr<const std::vector<SymmetryOperation> >
+            getDefaultSymmetry();
 
         // methods
         void init();
         void uncacheCostData() const;
+        void updatePairRows(WorkerPool* workers) const;
+        void evalPairRow(int i0, const std::vector<bool>& stale) const;
+        bool isCurrentPairRow(const Atom_t* pa) const;
+        void setCurrentPairRow(const Atom_t* pa) const;
         void cropDistanceTable();
-        const R3::Vector&
+        R3::Vector
             anyOffsetAtomSite(const RandomWeighedGenerator& rwg) const;
         R3::Vector ucvCartesianAdjusted(const R3::Vector& cv) const;
         void shiftToOrigin();
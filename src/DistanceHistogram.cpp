@@ -0,0 +1,89 @@
+/***********************************************************************
+* Short Title: histogram of target distances on a fixed grid
+*
+* Comments: implementation of DistanceHistogram
+*
+* <license text>
+***********************************************************************/
+
+#include <cmath>
+
+#include "DistanceHistogram.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////
+// class DistanceHistogram
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructors --------------------------------------------------------------
+
+DistanceHistogram::DistanceHistogram() : mbinwidth(0.0)
+{
+    mstart.push_back(0);
+}
+
+
+// Bins span grid cells of the table resolution starting at the shortest
+// distance, only equal distances share a bin when the resolution is zero.
+
+DistanceHistogram::DistanceHistogram(const DistanceTable& dtbl) :
+    mbinwidth(max(0.0, dtbl.getResolution()))
+{
+    const size_t n = dtbl.size();
+    const double dmin = dtbl.empty() ? 0.0 : dtbl.front();
+    mbin.resize(n);
+    double lastcell = -1.0;
+    for (size_t i = 0; i != n; ++i)
+    {
+        double cell = (mbinwidth > 0.0) ?
+            floor((dtbl[i] - dmin) / mbinwidth) : dtbl[i];
+        if (mstart.empty() || cell != lastcell)
+        {
+            mstart.push_back(i);
+            mdistance.push_back(0.0);
+            mesd.push_back(0.0);
+            lastcell = cell;
+        }
+        mbin[i] = mdistance.size() - 1;
+        mdistance.back() += dtbl[i];
+        mesd.back() += dtbl.getesdAt(i);
+    }
+    mstart.push_back(n);
+    for (size_t b = 0; b != this->size(); ++b)
+    {
+        mdistance[b] /= this->binCount(b);
+        mesd[b] /= this->binCount(b);
+    }
+    if (!dtbl.hasESDs())    mesd.clear();
+}
+
+// Public Methods ------------------------------------------------------------
+
+size_t DistanceHistogram::size() const
+{
+    return mdistance.size();
+}
+
+
+double DistanceHistogram::binWidth() const
+{
+    return mbinwidth;
+}
+
+
+DistanceTable DistanceHistogram::binnedTable() const
+{
+    vector<double> dbinned(mbin.size());
+    vector<double> esdbinned(mesd.empty() ? 0 : mbin.size());
+    for (size_t i = 0; i != mbin.size(); ++i)
+    {
+        dbinned[i] = mdistance[mbin[i]];
+        if (!mesd.empty())  esdbinned[i] = mesd[mbin[i]];
+    }
+    DistanceTable rv(dbinned);
+    if (!mesd.empty())  rv.setESDs(esdbinned);
+    return rv;
+}
+
+// End of file
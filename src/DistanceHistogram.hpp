@@ -0,0 +1,61 @@
+/***********************************************************************
+* Short Title: histogram of target distances on a fixed grid
+*
+* Comments: DistanceHistogram groups sorted target distances into bins
+*     of the distance table resolution.  Every non-empty bin holds the
+*     mean distance and ESD of its targets, binnedTable returns the
+*     targets replaced by these means.  Bins are numbered in the order
+*     of distances and entries of the binned table map to their bins.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef DISTANCEHISTOGRAM_HPP_INCLUDED
+#define DISTANCEHISTOGRAM_HPP_INCLUDED
+
+#include <vector>
+#include "DistanceTable.hpp"
+
+class DistanceHistogram
+{
+    public:
+
+        // constructors
+        DistanceHistogram();
+        DistanceHistogram(const DistanceTable& dtbl);
+
+        // methods
+        size_t size() const;
+        double binWidth() const;
+        DistanceTable binnedTable() const;
+        // bin of the idx-th target distance
+        size_t binAt(size_t idx) const
+        {
+            return mbin[idx];
+        }
+        // index of the first target distance in the bin
+        size_t binStart(size_t b) const
+        {
+            return mstart[b];
+        }
+        int binCount(size_t b) const
+        {
+            return mstart[b + 1] - mstart[b];
+        }
+        const double& binDistance(size_t b) const
+        {
+            return mdistance[b];
+        }
+
+    private:
+
+        // data
+        double mbinwidth;
+        std::vector<double> mdistance;
+        std::vector<double> mesd;
+        // offsets of bins in the target distances, size() + 1 entries
+        std::vector<size_t> mstart;
+        std::vector<size_t> mbin;
+};
+
+#endif  // DISTANCEHISTOGRAM_HPP_INCLUDED
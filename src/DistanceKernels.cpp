@@ -0,0 +1,267 @@
+/***********************************************************************
+* Short Title: distance loops of the cost kernels with CPU dispatch
+*
+* Comments: implementation of DistanceKernels functions
+*
+* <license text>
+***********************************************************************/
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "DistanceKernels.hpp"
+
+using namespace std;
+
+// Dispatch among x86 instruction sets needs the GCC target attributes.
+// Other platforms use the generic loops, for example aarch64, where
+// NEON is always available and used by the compiler vectorizer.
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__INTEL_COMPILER)
+#define LIGA_KERNEL_DISPATCH
+#endif
+
+// Local helpers for the kernel variants -------------------------------------
+
+namespace {
+
+// Loop bodies are inlined into every variant and vectorized for its
+// instruction set.  Contraction of multiply and add to FMA instructions
+// is disabled, because it would change the rounding of the results.
+// Unsafe math is disabled too, because with -ffast-math it replaces
+// the float square roots with reciprocal estimates that differ among
+// instruction sets.  The float loop calls the builtin square root,
+// because a std::sqrt or sqrtf call is not inlined into the variants
+// with these options and would keep the loop scalar.
+
+#define KERNEL_OPTIONS optimize("fp-contract=off", \
+        "no-unsafe-math-optimizations")
+
+#define KERNEL_INLINE inline \
+    __attribute__((always_inline, KERNEL_OPTIONS))
+
+KERNEL_INLINE
+void distances_body(double* d, const double* rx, const double* ry,
+        const double* rz, int n, double x, double y, double z)
+{
+    for (int j = 0; j < n; ++j)
+    {
+        double dx = x - rx[j];
+        double dy = y - ry[j];
+        double dz = z - rz[j];
+        d[j] = sqrt(dx*dx + dy*dy + dz*dz);
+    }
+}
+
+
+KERNEL_INLINE
+void distances_float_body(double* d, const float* fx, const float* fy,
+        const float* fz, int n, float x, float y, float z)
+{
+    for (int j = 0; j < n; ++j)
+    {
+        float dx = x - fx[j];
+        float dy = y - fy[j];
+        float dz = z - fz[j];
+        d[j] = __builtin_sqrtf(dx*dx + dy*dy + dz*dz);
+    }
+}
+
+
+KERNEL_INLINE
+void squared_distances_body(double* dd, const double* rx, const double* ry,
+        const double* rz, int n, double x, double y, double z)
+{
+    for (int j = 0; j < n; ++j)
+    {
+        double dx = x - rx[j];
+        double dy = y - ry[j];
+        double dz = z - rz[j];
+        dd[j] = dx*dx + dy*dy + dz*dz;
+    }
+}
+
+#undef KERNEL_INLINE
+
+// Define the 3 kernels of one variant with the specified attributes.
+
+#define DEFINE_KERNELS(suffix, attr) \
+    attr void distances_##suffix(double* d, const double* rx, \
+            const double* ry, const double* rz, int n, \
+            double x, double y, double z) \
+    { \
+        distances_body(d, rx, ry, rz, n, x, y, z); \
+    } \
+    attr void distances_float_##suffix(double* d, const float* fx, \
+            const float* fy, const float* fz, int n, \
+            float x, float y, float z) \
+    { \
+        distances_float_body(d, fx, fy, fz, n, x, y, z); \
+    } \
+    attr void squared_distances_##suffix(double* dd, const double* rx, \
+            const double* ry, const double* rz, int n, \
+            double x, double y, double z) \
+    { \
+        squared_distances_body(dd, rx, ry, rz, n, x, y, z); \
+    }
+
+DEFINE_KERNELS(generic, __attribute__((KERNEL_OPTIONS)))
+
+#ifdef LIGA_KERNEL_DISPATCH
+DEFINE_KERNELS(avx2, __attribute__((target("avx2"), KERNEL_OPTIONS)))
+DEFINE_KERNELS(avx512, __attribute__((target("avx512f"), KERNEL_OPTIONS)))
+#endif
+
+#undef KERNEL_OPTIONS
+
+#undef DEFINE_KERNELS
+
+struct KernelSet
+{
+    const char* name;
+    bool (*supported)();
+    void (*distances)(double*, const double*, const double*,
+            const double*, int, double, double, double);
+    void (*distances_float)(double*, const float*, const float*,
+            const float*, int, float, float, float);
+    void (*squared_distances)(double*, const double*, const double*,
+            const double*, int, double, double, double);
+};
+
+
+bool supports_generic()
+{
+    return true;
+}
+
+#ifdef LIGA_KERNEL_DISPATCH
+
+bool supports_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+
+bool supports_avx512()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+
+#endif
+
+// all variants ordered from the most portable to the fastest
+
+const KernelSet kernel_sets[] = {
+    { "generic", supports_generic, distances_generic,
+        distances_float_generic, squared_distances_generic },
+#ifdef LIGA_KERNEL_DISPATCH
+    { "avx2", supports_avx2, distances_avx2,
+        distances_float_avx2, squared_distances_avx2 },
+    { "avx512", supports_avx512, distances_avx512,
+        distances_float_avx512, squared_distances_avx512 },
+#endif
+};
+
+const size_t kernel_sets_count = sizeof(kernel_sets) / sizeof(KernelSet);
+
+
+const KernelSet* best_kernel_set()
+{
+    const KernelSet* rv = kernel_sets;
+    for (size_t i = 0; i != kernel_sets_count; ++i)
+    {
+        if (kernel_sets[i].supported())     rv = kernel_sets + i;
+    }
+    return rv;
+}
+
+
+const KernelSet*& active_kernel_set()
+{
+    static const KernelSet* kset = best_kernel_set();
+    return kset;
+}
+
+}   // namespace
+
+namespace DistanceKernels {
+
+void distances(double* d, const double* rx, const double* ry,
+        const double* rz, int n, double x, double y, double z)
+{
+    active_kernel_set()->distances(d, rx, ry, rz, n, x, y, z);
+}
+
+
+void distancesFloat(double* d, const float* fx, const float* fy,
+        const float* fz, int n, float x, float y, float z)
+{
+    active_kernel_set()->distances_float(d, fx, fy, fz, n, x, y, z);
+}
+
+
+void squaredDistances(double* dd, const double* rx, const double* ry,
+        const double* rz, int n, double x, double y, double z)
+{
+    active_kernel_set()->squared_distances(dd, rx, ry, rz, n, x, y, z);
+}
+
+
+string getISA()
+{
+    return active_kernel_set()->name;
+}
+
+
+void setISA(const string& isa)
+{
+    if (isa == "auto")
+    {
+        active_kernel_set() = best_kernel_set();
+        return;
+    }
+    for (size_t i = 0; i != kernel_sets_count; ++i)
+    {
+        if (isa != kernel_sets[i].name)     continue;
+        if (!kernel_sets[i].supported())
+        {
+            ostringstream emsg;
+            emsg << "Kernels '" << isa << "' are not supported by this CPU.";
+            throw invalid_argument(emsg.str());
+        }
+        active_kernel_set() = kernel_sets + i;
+        return;
+    }
+    ostringstream emsg;
+    emsg << "Unknown kernels '" << isa << "'.";
+    throw invalid_argument(emsg.str());
+}
+
+
+vector<string> getSupportedISAs()
+{
+    vector<string> rv;
+    for (size_t i = 0; i != kernel_sets_count; ++i)
+    {
+        if (kernel_sets[i].supported())     rv.push_back(kernel_sets[i].name);
+    }
+    return rv;
+}
+
+
+vector<string> getCompiledISAs()
+{
+    vector<string> rv;
+    for (size_t i = 0; i != kernel_sets_count; ++i)
+    {
+        rv.push_back(kernel_sets[i].name);
+    }
+    return rv;
+}
+
+}   // namespace DistanceKernels
+
+// End of file
@@ -0,0 +1,47 @@
+/***********************************************************************
+* Short Title: distance loops of the cost kernels with CPU dispatch
+*
+* Comments: DistanceKernels computes distances from one point to
+*     packed coordinate arrays.  The loops are compiled for several
+*     instruction sets and the widest one supported by the running CPU
+*     is selected on first use, so that a single installed binary is
+*     fast on every node.  All variants return identical results.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef DISTANCEKERNELS_HPP_INCLUDED
+#define DISTANCEKERNELS_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+
+namespace DistanceKernels {
+
+// distances d[j] from (x, y, z) to (rx[j], ry[j], rz[j]) for j < n
+void distances(double* d, const double* rx, const double* ry,
+        const double* rz, int n, double x, double y, double z);
+
+// single precision differences, converted distances stored in d
+void distancesFloat(double* d, const float* fx, const float* fy,
+        const float* fz, int n, float x, float y, float z);
+
+// squared distances dd[j] from (x, y, z) for j < n
+void squaredDistances(double* dd, const double* rx, const double* ry,
+        const double* rz, int n, double x, double y, double z);
+
+// name of the selected instruction set variant
+std::string getISA();
+
+// select variant by name, "auto" picks the best supported one
+void setISA(const std::string& isa);
+
+// variant names supported by the running CPU, best last
+std::vector<std::string> getSupportedISAs();
+
+// all variant names compiled in this binary
+std::vector<std::string> getCompiledISAs();
+
+}   // namespace DistanceKernels
+
+#endif  // DISTANCEKERNELS_HPP_INCLUDED
@@ -7,8 +7,18 @@
 *****************************************************************************/
 
 #include <sstream>
+#include <fstream>
 #include <cmath>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/cstdint.hpp>
 
 #include "DistanceTable.hpp"
 #include "Exceptions.hpp"
@@ -17,10 +27,111 @@
 
 using namespace std;
 
+// Local helpers for DistanceTable::readESDFormat
+
+namespace {
+
+bool compareFirst(const pair<double,double>& p0,
+        const pair<double,double>& p1)
+{
+    return p0.first < p1.first;
+}
+
+}   // namespace
+
+// Local helpers for the binary ".dtbl" format.  The file starts with
+// DtblHeader followed by arrays of sorted distances, ESDs when present
+// and bucket index of find_nearest.  Values are stored in the native
+// byte order, which is verified by the byteorder field.
+
+namespace {
+
+const char DTBL_MAGIC[8] = {'L', 'I', 'G', 'A', 'D', 'T', 'B', 'L'};
+const boost::uint32_t DTBL_VERSION = 1;
+const boost::uint32_t DTBL_BYTE_ORDER = 0x01020304;
+
+struct DtblHeader
+{
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t byteorder;
+    boost::uint64_t count;
+    boost::uint64_t hasesds;
+    boost::uint64_t nbucket;
+    double resolution;
+    double bucket_dmin;
+    double bucket_width;
+};
+
+
+size_t dtblSize(const DtblHeader& hdr)
+{
+    size_t rv = sizeof(DtblHeader) +
+        (hdr.hasesds ? 2 : 1) * hdr.count * sizeof(double) +
+        hdr.nbucket * sizeof(boost::uint64_t);
+    return rv;
+}
+
+
+// read-only memory mapping of a file, unmapped when out of scope
+
+class MappedFile
+{
+    public:
+
+        MappedFile(const string& filename) : mdata(MAP_FAILED), msize(0)
+        {
+            int fd = open(filename.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                msize = st.st_size;
+                mdata = mmap(NULL, msize, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            if (fd >= 0)    close(fd);
+            if (mdata == MAP_FAILED)
+            {
+                ostringstream emsg;
+                emsg << "Unable to read '" << filename << "'";
+                throw IOError(emsg.str());
+            }
+        }
+
+        ~MappedFile()
+        {
+            munmap(mdata, msize);
+        }
+
+        const char* data() const  { return static_cast<const char*>(mdata); }
+        size_t size() const  { return msize; }
+
+    private:
+
+        void* mdata;
+        size_t msize;
+
+        // disable copying
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+};
+
+}   // namespace
+
 //////////////////////////////////////////////////////////////////////////////
 // class DistanceTable
 //////////////////////////////////////////////////////////////////////////////
 
+// Class Methods -------------------------------------------------------------
+
+bool DistanceTable::isBinaryFile(const string& filename)
+{
+    char magic[sizeof(DTBL_MAGIC)];
+    ifstream fid(filename.c_str(), ios::binary);
+    bool rv = fid.read(magic, sizeof(magic)) &&
+        equal(magic, magic + sizeof(magic), DTBL_MAGIC);
+    return rv;
+}
+
 // Constructors --------------------------------------------------------------
 
 DistanceTable::DistanceTable() : vector<double>()
@@ -63,8 +174,12 @@ DistanceTable& DistanceTable::operator= (const DistanceTable& d0)
     if (this == &d0)    return *this;
     assign(d0.begin(), d0.end());
     mcount_unique = d0.mcount_unique;
+    mmaxdistancerepr = d0.mmaxdistancerepr;
     mresolution = d0.mresolution;
     mesd = d0.mesd;
+    mbucket = d0.mbucket;
+    mbucket_dmin = d0.mbucket_dmin;
+    mbucket_width = d0.mbucket_width;
     return *this;
 }
 
@@ -73,8 +188,18 @@ DistanceTable& DistanceTable::operator= (const DistanceTable& d0)
 DistanceTable::const_iterator
 DistanceTable::find_nearest(const double& dfind) const
 {
-    const_iterator ii = lower_bound(begin(), end(), dfind);
-    bool shiftleft = (ii == end() && !empty()) ||
+    if (empty())    return end();
+    if (mbucket.empty())    buildBucketIndex();
+    // find bucket of dfind, the bucket edges must be evaluated the same way
+    // as in buildBucketIndex so that the lower bound is within its range
+    long nb = mbucket.size() - 1;
+    double bf = (dfind - mbucket_dmin) / mbucket_width;
+    long b = (bf <= 0.0) ? 0 : (bf >= nb) ? (nb - 1) : long(bf);
+    while (b > 0 && dfind < bucketEdge(b))  --b;
+    while (b + 1 < nb && !(dfind < bucketEdge(b + 1)))  ++b;
+    const_iterator ii = lower_bound(begin() + mbucket[b],
+            begin() + mbucket[b + 1], dfind);
+    bool shiftleft = (ii == end()) ||
             (ii != begin() && (dfind - *(ii-1)) < (*ii - dfind));
     if (shiftleft)  --ii;
     return ii;
@@ -83,15 +208,49 @@ DistanceTable::find_nearest(const double& dfind) const
 
 DistanceTable::iterator DistanceTable::return_back(const double& dback)
 {
+    mbucket.clear();
     iterator ii = lower_bound(begin(), end(), dback);
+    if (this->hasESDs())
+    {
+        double esd = this->getesd(dback);
+        mesd.insert(mesd.begin() + (ii - begin()), esd);
+    }
     return insert(ii, dback);
 }
 
 
+DistanceTable::iterator DistanceTable::erase(iterator pos)
+{
+    mbucket.clear();
+    if (this->hasESDs())    mesd.erase(mesd.begin() + (pos - begin()));
+    return vector<double>::erase(pos);
+}
+
+
+void DistanceTable::push_back(const double& d)
+{
+    mbucket.clear();
+    if (this->hasESDs())
+    {
+        double esd = this->getesd(d);
+        mesd.push_back(esd);
+    }
+    vector<double>::push_back(d);
+}
+
+
 const double& DistanceTable::getesd(const double& d) const
 {
     static const double one = 1.0;
-    return mesd.empty() ? one : mesd.at(d);
+    if (mesd.empty())   return one;
+    const_iterator ii = upper_bound(begin(), end(), d);
+    if (ii == begin() || *(ii - 1) != d)
+    {
+        ostringstream emsg;
+        emsg << "ESD not defined for distance " << d;
+        throw out_of_range(emsg.str());
+    }
+    return mesd[ii - begin() - 1];
 }
 
 
@@ -102,10 +261,11 @@ void DistanceTable::setESDs(const std::vector<double>& esds)
         const char* emsg = "Incompatible length of the ESD vector.";
         throw std::invalid_argument(emsg);
     }
-    this->clearESDs();
-    for (size_t i = 0; i != this->size(); ++i)
+    mesd = esds;
+    // equal distances share the ESD of the last one
+    for (size_t i = mesd.size(); i > 1; --i)
     {
-        mesd[this->at(i)] = esds[i];
+        if (this->at(i - 2) == this->at(i - 1))  mesd[i - 2] = mesd[i - 1];
     }
     return;
 }
@@ -155,7 +315,7 @@ DistanceTable DistanceTable::unique() const
         if (dtu.empty() || (*di - dtu.back()) > mresolution)
         {
             dtu.push_back(*di);
-            uesds.push_back(this->getesd(*di));
+            uesds.push_back(this->getesdAt(di - begin()));
         }
     }
     if (this->hasESDs())  dtu.setESDs(uesds);
@@ -173,6 +333,7 @@ void DistanceTable::setResolution(double res)
 {
     mresolution = res;
     mcount_unique = -1;
+    mbucket.clear();
 }
 
 
@@ -204,10 +365,128 @@ double DistanceTable::maxDistanceRepr() const
     return mmaxdistancerepr;
 }
 
+
+void DistanceTable::readBinary(const string& filename)
+{
+    MappedFile mf(filename);
+    DtblHeader hdr;
+    bool valid = mf.size() >= sizeof(DtblHeader);
+    if (valid)  memcpy(&hdr, mf.data(), sizeof(DtblHeader));
+    valid = valid &&
+        equal(hdr.magic, hdr.magic + sizeof(DTBL_MAGIC), DTBL_MAGIC) &&
+        hdr.version == DTBL_VERSION &&
+        hdr.byteorder == DTBL_BYTE_ORDER &&
+        mf.size() == dtblSize(hdr);
+    if (!valid)
+    {
+        ostringstream emsg;
+        emsg << "Invalid or incompatible dtbl file '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    const double* pd = reinterpret_cast<const double*>(
+            mf.data() + sizeof(DtblHeader));
+    const double* pe = pd + hdr.count;
+    const boost::uint64_t* pb = reinterpret_cast<const boost::uint64_t*>(
+            hdr.hasesds ? (pe + hdr.count) : pe);
+    // distances are stored sorted, check them instead of sorting
+    const double* pdend = pd + hdr.count;
+    bool sorted = (pd == pdend) || (*pd >= 0.0 &&
+            adjacent_find(pd, pdend, greater<double>()) == pdend);
+    if (!sorted)
+    {
+        ostringstream emsg;
+        emsg << "Unsorted distances in dtbl file '" << filename << "'";
+        throw InvalidDistanceTable(emsg.str());
+    }
+    vector<double>& this_vector = *this;
+    this_vector.assign(pd, pdend);
+    mcount_unique = -1;
+    mmaxdistancerepr = -1;
+    mresolution = hdr.resolution;
+    mesd.clear();
+    if (hdr.hasesds)    mesd.assign(pe, pe + hdr.count);
+    mbucket.assign(pb, pb + hdr.nbucket);
+    mbucket_dmin = hdr.bucket_dmin;
+    mbucket_width = hdr.bucket_width;
+    // discard bucket index inconsistent with the distances
+    bool validindex = !mbucket.empty() && mbucket.back() == this->size();
+    for (size_t i = 1; validindex && i < mbucket.size(); ++i)
+    {
+        validindex = (mbucket[i - 1] <= mbucket[i]);
+    }
+    if (!validindex)    mbucket.clear();
+}
+
+
+void DistanceTable::writeBinary(const string& filename) const
+{
+    this->buildBucketIndex();
+    DtblHeader hdr;
+    memset(&hdr, 0, sizeof(DtblHeader));
+    copy(DTBL_MAGIC, DTBL_MAGIC + sizeof(DTBL_MAGIC), hdr.magic);
+    hdr.version = DTBL_VERSION;
+    hdr.byteorder = DTBL_BYTE_ORDER;
+    hdr.count = this->size();
+    hdr.hasesds = this->hasESDs();
+    hdr.nbucket = mbucket.size();
+    hdr.resolution = mresolution;
+    hdr.bucket_dmin = mbucket_dmin;
+    hdr.bucket_width = mbucket_width;
+    vector<boost::uint64_t> bucket(mbucket.begin(), mbucket.end());
+    ofstream fid(filename.c_str(), ios::binary);
+    fid.write(reinterpret_cast<const char*>(&hdr), sizeof(DtblHeader));
+    if (!this->empty())
+    {
+        fid.write(reinterpret_cast<const char*>(&(this->front())),
+                this->size() * sizeof(double));
+    }
+    if (!mesd.empty())
+    {
+        fid.write(reinterpret_cast<const char*>(&mesd[0]),
+                mesd.size() * sizeof(double));
+    }
+    if (!bucket.empty())
+    {
+        fid.write(reinterpret_cast<const char*>(&bucket[0]),
+                bucket.size() * sizeof(boost::uint64_t));
+    }
+    fid.close();
+    if (!fid)
+    {
+        ostringstream emsg;
+        emsg << "Unable to write '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+}
+
+
+// Bucket index for find_nearest with about one distance per bucket.
+// The bucket width is never smaller than the distance resolution.
+// The index is kept until the distances or resolution change.
+
+void DistanceTable::buildBucketIndex() const
+{
+    if (empty() || !mbucket.empty())    return;
+    mbucket_dmin = this->front();
+    double drange = this->back() - this->front();
+    mbucket_width = max(mresolution, drange / size());
+    size_t nb = size_t(drange / mbucket_width) + 1;
+    mbucket.resize(nb + 1);
+    const_iterator ii = begin();
+    for (size_t i = 0; i != nb; ++i)
+    {
+        double edge = bucketEdge(i);
+        while (ii != end() && *ii < edge)  ++ii;
+        mbucket[i] = ii - begin();
+    }
+    mbucket[nb] = size();
+}
+
 // Private Methods -----------------------------------------------------------
 
 void DistanceTable::init()
 {
+    mbucket.clear();
     mcount_unique = -1;
     mresolution = NS_LIGA::eps_cost;
     mmaxdistancerepr = -1;
@@ -226,10 +505,15 @@ void DistanceTable::init()
 }
 
 
+double DistanceTable::bucketEdge(size_t i) const
+{
+    return mbucket_dmin + i * mbucket_width;
+}
+
+
 void DistanceTable::readESDFormat(istream& fid)
 {
-    vector<double> positions;
-    vector<double> esds;
+    vector< pair<double,double> > pesds;
     string line;
     vector<string> words;
     while (!fid.eof() && getline(fid, line))
@@ -240,8 +524,7 @@ void DistanceTable::readESDFormat(istream& fid)
         double p, e;
         if (istrs >> p >> e)
         {
-            positions.push_back(p);
-            esds.push_back(e);
+            pesds.push_back(make_pair(p, e));
         }
         else
         {
@@ -251,6 +534,15 @@ void DistanceTable::readESDFormat(istream& fid)
             throw IOError(emsg.str());
         }
     }
+    // keep ESDs with their distances when sorted in init
+    stable_sort(pesds.begin(), pesds.end(), compareFirst);
+    vector<double> positions(pesds.size());
+    vector<double> esds(pesds.size());
+    for (size_t i = 0; i != pesds.size(); ++i)
+    {
+        positions[i] = pesds[i].first;
+        esds[i] = pesds[i].second;
+    }
     this->swap(positions);
     this->init();
     this->setESDs(esds);
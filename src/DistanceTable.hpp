@@ -11,7 +11,7 @@
 
 #include <vector>
 #include <iostream>
-#include <boost/unordered_map.hpp>
+#include <string>
 
 class DistanceTable : public std::vector<double>
 {
@@ -20,6 +20,10 @@ class DistanceTable : public std::vector<double>
         // friends
         friend std::istream& operator>>(std::istream&, DistanceTable&);
 
+        // class methods
+        // check if filename starts with the binary ".dtbl" signature
+        static bool isBinaryFile(const std::string& filename);
+
         // constructors
         DistanceTable();
         DistanceTable(const double* v, size_t sz);
@@ -30,8 +34,18 @@ class DistanceTable : public std::vector<double>
         DistanceTable& operator= (const std::vector<double>&);
         DistanceTable& operator= (const DistanceTable&);
         const_iterator find_nearest(const double& d) const;
+        // prepare find_nearest lookups, needed before sharing with threads
+        void buildBucketIndex() const;
         iterator return_back(const double&);
+        iterator erase(iterator pos);
+        void push_back(const double& d);
         const double& getesd(const double& d) const;
+        // ESD of the idx-th distance, use with find_nearest results
+        const double& getesdAt(size_t idx) const
+        {
+            static const double one = 1.0;
+            return mesd.empty() ? one : mesd[idx];
+        }
         void setESDs(const std::vector<double>& esds);
         void clearESDs();
         bool hasESDs() const;
@@ -42,6 +56,9 @@ class DistanceTable : public std::vector<double>
         void setResolution(double res);
         double maxDistance() const;
         double maxDistanceRepr() const;
+        // binary ".dtbl" format with ESDs, resolution and bucket index
+        void readBinary(const std::string& filename);
+        void writeBinary(const std::string& filename) const;
 
     private:
 
@@ -49,10 +66,17 @@ class DistanceTable : public std::vector<double>
         mutable int mcount_unique;
         mutable double mmaxdistancerepr;
         double mresolution;
-        boost::unordered_map<double,double> mesd;
+        // ESDs aligned with the sorted distances, empty when not set
+        std::vector<double> mesd;
+        // nearest distance lookup, mbucket[i] is the lower bound index
+        // of distance mbucket_dmin + i * mbucket_width
+        mutable std::vector<size_t> mbucket;
+        mutable double mbucket_dmin;
+        mutable double mbucket_width;
 
         // methods
         void init();
+        double bucketEdge(size_t i) const;
         void readESDFormat(std::istream&);
         void readPWAFormat(std::istream&);
         void readSimpleFormat(std::istream&);
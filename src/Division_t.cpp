@@ -6,6 +6,7 @@
 * <license text>
 ***********************************************************************/
 
+#include <algorithm>
 #include <cassert>
 
 #include "Division_t.hpp"
@@ -39,20 +40,28 @@ inline bool comp_PMOL_Badness( const PMOL lhs, const PMOL rhs)
 
 Division_t::Division_t(size_t fullsize, size_t level) :
     vector<PMOL>(),
-    _fullsize(fullsize), _level(level), _trials(0.0)
+    _fullsize(fullsize), _level(level), _trials(0.0),
+    _costs_current(false)
 {
     fill(acc_triang, acc_triang + NTGTYPES, 0);
     fill(tot_triang, tot_triang + NTGTYPES, 0);
     fill(est_triang, est_triang + NTGTYPES, 0);
+    fill(timed_triang, timed_triang + NTGTYPES, 0);
+    fill(sec_triang, sec_triang + NTGTYPES, 0.0);
 }
 
+// copies own duplicates of the source teams
 Division_t::Division_t(const Division_t& src) :
-    vector<PMOL>(src),
-    _fullsize(src._fullsize), _level(src._level), _trials(0.0)
+    vector<PMOL>(),
+    _fullsize(src._fullsize), _level(src._level), _trials(0.0),
+    _costs_current(false)
 {
     fill(acc_triang, acc_triang + NTGTYPES, 0);
     fill(tot_triang, tot_triang + NTGTYPES, 0);
     fill(est_triang, est_triang + NTGTYPES, 0);
+    fill(timed_triang, timed_triang + NTGTYPES, 0);
+    fill(sec_triang, sec_triang + NTGTYPES, 0.0);
+    this->copyTeams(src);
 }
 
 Division_t::~Division_t()
@@ -64,40 +73,66 @@ Division_t::~Division_t()
 
 Division_t& Division_t::operator= (const Division_t& src)
 {
-    static_cast< vector<PMOL> >(*this) = src;
+    if (this == &src)   return *this;
+    this->copyTeams(src);
     _fullsize = src._fullsize;
     _level = src._level;
     copy(src.acc_triang, src.acc_triang + NTGTYPES, acc_triang);
     copy(src.tot_triang, src.tot_triang + NTGTYPES, tot_triang);
     copy(src.est_triang, src.est_triang + NTGTYPES, est_triang);
+    copy(src.timed_triang, src.timed_triang + NTGTYPES, timed_triang);
+    copy(src.sec_triang, src.sec_triang + NTGTYPES, sec_triang);
     return *this;
 }
 
+// container methods
+
+void Division_t::push_back(PMOL team)
+{
+    vector<PMOL>::push_back(team);
+    this->noteTeamChanged(size() - 1);
+}
+
+Division_t::iterator Division_t::erase(iterator position)
+{
+    _costs_current = false;
+    return vector<PMOL>::erase(position);
+}
+
+void Division_t::clear()
+{
+    _costs_current = false;
+    vector<PMOL>::clear();
+}
+
 // public methods
 
+// Teams modified in place or replaced through operator[] or at() must be
+// noted here before the next selection, their costs are not queried again.
+
+void Division_t::noteTeamChanged(size_t idx)
+{
+    assert(idx < size());
+    if (_costs_current)     _changed_teams.push_back(idx);
+}
+
+void Division_t::noteTeamChanged(const Molecule* team)
+{
+    const_iterator ti = find(begin(), end(), team);
+    if (ti != end())    this->noteTeamChanged(ti - begin());
+}
+
 int Division_t::find_winner()
 {
-    // evaluate molecule fitness
-    valarray<double> vmfit(size());
-    double *pd = &vmfit[0];
-    for (iterator mi = begin(); mi != end(); ++mi, ++pd)
-        *pd = (*mi)->cost();
-    // then get the reciprocal value
-    vmfit = costToFitness(vmfit);
-    double *mfit = &vmfit[0];
-    int idx = randomWeighedInt(size(), mfit);
+    this->updateCosts();
+    int idx = _winner_generator.weighedInt();
     return idx;
 }
 
 int Division_t::find_looser()
 {
-    // evaluate molecule fitness
-    valarray<double> vmbad(size());
-    double *pd = &vmbad[0];
-    for (iterator mi = begin(); mi != end(); ++mi, ++pd)
-        *pd = (*mi)->cost();
-    double *mbad = &vmbad[0];
-    int idx = randomWeighedInt(size(), mbad);
+    this->updateCosts();
+    int idx = _looser_generator.weighedInt();
     return idx;
 }
 
@@ -107,6 +142,23 @@ int Division_t::find_best()
     return idx;
 }
 
+// index of another team with the same structure as mol or -1
+
+int Division_t::find_duplicate(const Molecule* mol) const
+{
+    this->updateFingerprints();
+    size_t fp = mol->fingerprint();
+    for (size_t i = 0; i != size(); ++i)
+    {
+        const Molecule* team = (*this)[i];
+        bool same = (team != mol) && (_fingerprints[i] == fp) &&
+            team->countAtoms() == mol->countAtoms() &&
+            eps_eq(team->cost(), mol->cost());
+        if (same)   return i;
+    }
+    return -1;
+}
+
 Division_t::PMOL& Division_t::best()
 {
     return at(find_best());
@@ -114,14 +166,19 @@ Division_t::PMOL& Division_t::best()
 
 double Division_t::averageCost() const
 {
+    this->updateCosts();
     double total = 0.0;
-    for (const_iterator ii = begin(); ii != end(); ++ii)
-    {
-        total += (*ii)->cost();
-    }
+    vector<double>::const_iterator ci;
+    for (ci = _costs.begin(); ci != _costs.end(); ++ci)     total += *ci;
     return size() ? total / size() : 0.0;
 }
 
+double Division_t::worstCost() const
+{
+    this->updateCosts();
+    return size() ? *max_element(_costs.begin(), _costs.end()) : DOUBLE_MAX;
+}
+
 const int* Division_t::estimateTriangulations()
 {
     const double pdef[NTGTYPES] = { 2.0/18, 4.0/18, 12.0/18 };
@@ -135,13 +192,23 @@ const int* Division_t::estimateTriangulations()
         double b = tot_triang[i] - acc_triang[i] + 1;
         pbtg[i] = randomBeta(a, b);
     }
-    // nasty hack to fix triangulation probabilities for Crystal object
-    // Triangulation statistics should be moved to Molecule and Crystal.
-    // size_t nd = min(ndim, level());
+    // usable triangulation types depend on the structure type
     size_t nd = ndim;
-    if (!this->empty() && this->front()->type() == MOLECULE)
+    if (!this->empty())
+    {
+        int ntypes = this->front()->countTriangulationTypes(this->level());
+        nd = min(ndim, size_t(ntypes));
+    }
+    // weigh success probabilities with the trial atoms per second
+    // once every usable type has been timed
+    bool timed = efficiency_sharing;
+    for (size_t i = 0; timed && i != nd; ++i)
     {
-        nd = min(ndim, this->level());
+        timed = timed_triang[i] && sec_triang[i] > 0.0;
+    }
+    for (size_t i = 0; timed && i != nd; ++i)
+    {
+        pbtg[i] *= timed_triang[i] / sec_triang[i];
     }
     switch (nd)
     {
@@ -162,7 +229,8 @@ const int* Division_t::estimateTriangulations()
     return est_triang;
 }
 
-void Division_t::noteTriangulations(const pair<int*,int*>& acc_tot)
+void Division_t::noteTriangulations(const pair<int*,int*>& acc_tot,
+        const double* seconds)
 {
     const int* acc = acc_tot.first;
     const int* tot = acc_tot.second;
@@ -172,10 +240,112 @@ void Division_t::noteTriangulations(const pair<int*,int*>& acc_tot)
         tot_triang[i] += tot[i];
         assert(acc_triang[i] <= tot_triang[i]);
     }
+    if (!seconds)   return;
+    for (int i = 0; i < NTGTYPES; ++i)
+    {
+        timed_triang[i] += tot[i];
+        sec_triang[i] += seconds[i];
+    }
+}
+
+// trials and triangulation statistics, teams are saved by Liga_t
+void Division_t::writeCheckpoint(ostream& out) const
+{
+    write_binary(out, _trials);
+    write_binary(out, acc_triang);
+    write_binary(out, tot_triang);
+    write_binary(out, est_triang);
+}
+
+bool Division_t::readCheckpoint(istream& in)
+{
+    return read_binary(in, _trials) && read_binary(in, acc_triang) &&
+        read_binary(in, tot_triang) && read_binary(in, est_triang);
+}
+
+// private methods
+
+void Division_t::copyTeams(const Division_t& src)
+{
+    // assign into the existing teams and allocate only the missing ones
+    _fingerprint_teams.clear();
+    _costs_current = false;
+    size_t nkeep = min(size(), src.size());
+    for (size_t i = 0; i != nkeep; ++i)     *(*this)[i] = *src[i];
+    for (size_t i = nkeep; i != size(); ++i)    delete (*this)[i];
+    resize(nkeep);
+    reserve(src.size());
+    for (size_t i = nkeep; i != src.size(); ++i)
+    {
+        push_back(src[i]->copy());
+    }
+}
+
+void Division_t::updateCosts() const
+{
+    // the weighed generators are rebuilt only after teams were removed,
+    // otherwise changed teams update their weights in O(log N)
+    bool rebuild = !_costs_current || (_costs.size() != size());
+    if (!_costs_current)
+    {
+        _costs.resize(size());
+        for (size_t i = 0; i != size(); ++i)    _costs[i] = (*this)[i]->cost();
+        _fitness.resize(_costs.size());
+        transform(_costs.begin(), _costs.end(), _fitness.begin(),
+                convertCostToFitness);
+    }
+    else
+    {
+        _costs.resize(size());
+        _fitness.resize(size());
+        vector<size_t>::const_iterator ii;
+        for (ii = _changed_teams.begin(); ii != _changed_teams.end(); ++ii)
+        {
+            double c = (*this)[*ii]->cost();
+            if (!rebuild && c == _costs[*ii])   continue;
+            _costs[*ii] = c;
+            _fitness[*ii] = convertCostToFitness(c);
+            if (rebuild)    continue;
+            _winner_generator.setWeight(*ii, _fitness[*ii]);
+            _looser_generator.setWeight(*ii, c);
+        }
+    }
+    _changed_teams.clear();
+    _costs_current = true;
+#ifndef NDEBUG
+    for (size_t i = 0; i != size(); ++i)
+    {
+        assert(_costs[i] == (*this)[i]->cost());
+    }
+#endif
+    if (!rebuild || _costs.empty())     return;
+    _winner_generator.setWeights(_fitness.begin(), _fitness.end());
+    _looser_generator.setWeights(_costs.begin(), _costs.end());
+}
+
+void Division_t::updateFingerprints() const
+{
+    // fingerprints are recomputed only for replaced or modified teams
+    _fingerprints.resize(size());
+    _fingerprint_teams.resize(size(), NULL);
+    _fingerprint_costs.resize(size());
+    for (size_t i = 0; i != size(); ++i)
+    {
+        const Molecule* team = (*this)[i];
+        double c = team->cost();
+        if (team == _fingerprint_teams[i] && c == _fingerprint_costs[i])
+        {
+            continue;
+        }
+        _fingerprints[i] = team->fingerprint();
+        _fingerprint_teams[i] = team;
+        _fingerprint_costs[i] = c;
+    }
 }
 
 // class data
 
 size_t Division_t::ndim = 3;
+bool Division_t::efficiency_sharing = false;
 
 // End of file
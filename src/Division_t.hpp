@@ -9,6 +9,7 @@
 #ifndef DIVISION_T_HPP_INCLUDED
 #define DIVISION_T_HPP_INCLUDED
 
+#include <iosfwd>
 #include <vector>
 #include "Atom_t.hpp"   // for NTGTYPES
 #include "Random.hpp"
@@ -33,10 +34,18 @@ class Division_t : public std::vector<Molecule*>
         // operators
         Division_t& operator= (const Division_t& src);
 
+        // container methods that keep the cached costs consistent
+        void push_back(PMOL team);
+        iterator erase(iterator position);
+        void clear();
+
         // public methods
+        void noteTeamChanged(size_t idx);
+        void noteTeamChanged(const Molecule* team);
         int find_winner();
         int find_looser();
         int find_best();
+        int find_duplicate(const Molecule* mol) const;
         PMOL& best();
         bool full() const;
         size_t fullsize() const;
@@ -44,13 +53,19 @@ class Division_t : public std::vector<Molecule*>
         void assignTrials(double t);
         double trials();
         double averageCost() const;
+        double worstCost() const;
         const int* estimateTriangulations();
-        void noteTriangulations(const std::pair<int*,int*>& acc_tot);
+        void noteTriangulations(const std::pair<int*,int*>& acc_tot,
+                const double* seconds=NULL);
+        void writeCheckpoint(std::ostream& out) const;
+        bool readCheckpoint(std::istream& in);
 
     private:
 
         // class data
         static size_t ndim;
+        // share triangulations by accepted atoms per second
+        static bool efficiency_sharing;
 
         // data members
         size_t _fullsize;
@@ -59,6 +74,28 @@ class Division_t : public std::vector<Molecule*>
         long long acc_triang[NTGTYPES];
         long long tot_triang[NTGTYPES];
         int est_triang[NTGTYPES];
+        // trial atoms of timed triangulations and their seconds,
+        // these are measured again after restart from a checkpoint
+        long long timed_triang[NTGTYPES];
+        double sec_triang[NTGTYPES];
+        // team costs and fitnesses with their weighed generators,
+        // only the changed teams are updated unless _costs_current is false
+        mutable std::vector<double> _costs;
+        mutable std::vector<double> _fitness;
+        mutable std::vector<size_t> _changed_teams;
+        mutable bool _costs_current;
+        mutable NS_LIGA::RandomWeighedGenerator _winner_generator;
+        mutable NS_LIGA::RandomWeighedGenerator _looser_generator;
+        // structure fingerprints of the teams with the teams and costs
+        // they were computed for
+        mutable std::vector<size_t> _fingerprints;
+        mutable std::vector<const Molecule*> _fingerprint_teams;
+        mutable std::vector<double> _fingerprint_costs;
+
+        // private methods
+        void copyTeams(const Division_t& src);
+        void updateCosts() const;
+        void updateFingerprints() const;
 
 };
 
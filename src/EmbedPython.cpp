@@ -15,6 +15,12 @@ void initializePython()
     {
         return;
     }
+    // keep the interpreter and sys.argv of the ligacost extension module
+    if (Py_IsInitialized())
+    {
+        is_initialized = true;
+        return;
+    }
     static int py_argc = 1;
     static wchar_t arg0[7] = L"python";
     static wchar_t* py_argv[] = {arg0};
@@ -9,6 +9,10 @@
 
 // routines
 
+// Start the embedded interpreter on the first call.  It must be called
+// only where Python is needed, i.e., for scoop functions, structure
+// formats without a native reader or writer and diffpy structures, so
+// that runs with native formats start without Python.
 void initializePython();
 
 
@@ -0,0 +1,216 @@
+/***********************************************************************
+* Short Title: binary log of match decisions for record and replay
+*
+* Comments: implementation of EventLog
+*
+* <license text>
+***********************************************************************/
+
+#include <iomanip>
+#include <sstream>
+#include <boost/cstdint.hpp>
+
+#include "EventLog.hpp"
+#include "Exceptions.hpp"
+#include "LigaUtils.hpp"
+
+using namespace std;
+
+// Local helpers for the event log format ------------------------------------
+
+namespace {
+
+const string eventlog_signature = "LIGA-EVENTS-1";
+
+const char* event_names[] = {
+    "SEASON", "WINNER", "EVOLVE", "LOOSER", "DEGENERATE" };
+
+const size_t event_names_count = sizeof(event_names) / sizeof(char*);
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class EventLog
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+EventLog::EventLog(const string& filename, Mode mode) :
+    _filename(filename), _mode(mode), _ended(false), _season(0), _count(0)
+{
+    if (mode == RECORD)
+    {
+        _out.open(filename.c_str(),
+                ios_base::out | ios_base::trunc | ios_base::binary);
+        if (_out)   write_binary(_out, eventlog_signature);
+        if (!_out)
+        {
+            ostringstream emsg;
+            emsg << "Unable to write to '" << filename << "'";
+            throw IOError(emsg.str());
+        }
+        return;
+    }
+    _in.open(filename.c_str(), ios_base::in | ios_base::binary);
+    if (!_in)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    string signature;
+    if (!read_binary(_in, signature) || signature != eventlog_signature)
+    {
+        ostringstream emsg;
+        emsg << "Invalid event log file '" << filename << "'.";
+        throw IOError(emsg.str());
+    }
+}
+
+// Public Methods ------------------------------------------------------------
+
+void EventLog::note(EventType tp, int level, int value, double cost)
+{
+    Event e = { tp, level, value, hasCost(tp) ? cost : 0.0 };
+    if (tp == SEASON)   _season = value;
+    ++_count;
+    if (_mode == RECORD)
+    {
+        this->writeEvent(e);
+        return;
+    }
+    // the run goes on when the replayed log ends
+    if (_ended)     return;
+    Event expected;
+    if (!this->readEvent(expected))
+    {
+        _ended = true;
+        return;
+    }
+    bool same = (e.type == expected.type) && (e.level == expected.level) &&
+        (e.value == expected.value) && (e.cost == expected.cost);
+    if (same)   return;
+    ostringstream emsg;
+    emsg << "Replay differs from event log '" << _filename <<
+        "' in season " << _season << ", expected " << describe(expected) <<
+        ", found " << describe(e) << '.';
+    throw ReplayError(emsg.str());
+}
+
+
+void EventLog::seekSeason(int season)
+{
+    if (_mode != REPLAY)    return;
+    while (true)
+    {
+        streampos pos = _in.tellg();
+        Event e;
+        if (!this->readEvent(e))
+        {
+            ostringstream emsg;
+            emsg << "Event log '" << _filename << "' has no season after " <<
+                season << '.';
+            throw IOError(emsg.str());
+        }
+        if (e.type == SEASON && e.value > season)
+        {
+            _in.seekg(pos);
+            return;
+        }
+    }
+}
+
+
+bool EventLog::exhausted()
+{
+    if (_mode != REPLAY)    return false;
+    if (!_ended && _in.peek() == char_traits<char>::eof())  _ended = true;
+    return _ended;
+}
+
+
+void EventLog::flush()
+{
+    if (_mode != RECORD)    return;
+    _out.flush();
+    if (!_out)
+    {
+        ostringstream emsg;
+        emsg << "Unable to write to '" << _filename << "'";
+        throw IOError(emsg.str());
+    }
+}
+
+
+EventLog::Mode EventLog::mode() const
+{
+    return _mode;
+}
+
+
+const string& EventLog::filename() const
+{
+    return _filename;
+}
+
+
+size_t EventLog::countEvents() const
+{
+    return _count;
+}
+
+// Private Methods -----------------------------------------------------------
+
+bool EventLog::hasCost(EventType tp)
+{
+    return tp == EVOLVE || tp == DEGENERATE;
+}
+
+
+string EventLog::describe(const Event& e)
+{
+    ostringstream out;
+    out << event_names[e.type] << " level " << e.level <<
+        " value " << e.value;
+    if (hasCost(e.type))
+    {
+        out << " cost " << setprecision(17) << e.cost;
+    }
+    return out.str();
+}
+
+
+void EventLog::writeEvent(const Event& e)
+{
+    write_binary(_out, boost::uint8_t(e.type));
+    write_binary(_out, boost::int32_t(e.level));
+    write_binary(_out, boost::int32_t(e.value));
+    if (hasCost(e.type))    write_binary(_out, e.cost);
+}
+
+
+bool EventLog::readEvent(Event& e)
+{
+    boost::uint8_t tp;
+    boost::int32_t level, value;
+    // log of an interrupted run may end with a partial event
+    if (!read_binary(_in, tp) || !read_binary(_in, level) ||
+            !read_binary(_in, value))
+    {
+        return false;
+    }
+    if (tp >= event_names_count)
+    {
+        ostringstream emsg;
+        emsg << "Invalid event in event log '" << _filename << "'.";
+        throw IOError(emsg.str());
+    }
+    e.type = EventType(tp);
+    e.level = level;
+    e.value = value;
+    e.cost = 0.0;
+    if (hasCost(e.type) && !read_binary(_in, e.cost))   return false;
+    return true;
+}
+
+// End of file
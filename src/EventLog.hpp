@@ -0,0 +1,72 @@
+/***********************************************************************
+* Short Title: binary log of match decisions for record and replay
+*
+* Comments: EventLog writes the match decisions of a liga run to a
+*     compact binary file, which are the picks of winners and loosers,
+*     the atom counts and costs after Evolve and Degenerate and season
+*     marks.  In the replay mode the same calls compare the decisions
+*     with the log and raise ReplayError at the first difference.
+*     Replay can start at a later season, for example after a restart
+*     from checkpoint.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef EVENTLOG_HPP_INCLUDED
+#define EVENTLOG_HPP_INCLUDED
+
+#include <fstream>
+#include <string>
+
+class EventLog
+{
+    public:
+
+        // types
+        enum EventType { SEASON, WINNER, EVOLVE, LOOSER, DEGENERATE };
+        enum Mode { RECORD, REPLAY };
+
+        // constructor
+        EventLog(const std::string& filename, Mode mode);
+
+        // methods
+        void note(EventType tp, int level, int value, double cost=0.0);
+        // skip replayed events before the start of the next season
+        void seekSeason(int season);
+        // replayed log has no more events
+        bool exhausted();
+        void flush();
+        Mode mode() const;
+        const std::string& filename() const;
+        size_t countEvents() const;
+
+    private:
+
+        // types
+        struct Event
+        {
+            EventType type;
+            int level;
+            int value;
+            double cost;
+        };
+
+        // class methods
+        static bool hasCost(EventType tp);
+        static std::string describe(const Event& e);
+
+        // data
+        std::string _filename;
+        Mode _mode;
+        std::ofstream _out;
+        std::ifstream _in;
+        bool _ended;
+        int _season;
+        size_t _count;
+
+        // methods
+        void writeEvent(const Event& e);
+        bool readEvent(Event& e);
+};
+
+#endif  // EVENTLOG_HPP_INCLUDED
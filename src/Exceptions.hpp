@@ -48,4 +48,13 @@ class InvalidMolecule : public std::runtime_error
         { }
 };
 
+
+class ReplayError : public std::runtime_error
+{
+    public:
+
+        ReplayError(const std::string msg="") : std::runtime_error(msg)
+        { }
+};
+
 #endif  // EXCEPTIONS_HPP_INCLUDED
@@ -0,0 +1,200 @@
+/***********************************************************************
+* Short Title: ring of forked LIGA island processes
+*
+* Comments: IslandRing forks several copies of the running process
+*     which are connected in a ring by pipes.  Every island can send
+*     text messages to its successor and read messages of its
+*     predecessor without blocking.
+*
+* <license text>
+***********************************************************************/
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "IslandRing.hpp"
+#include "Random.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////
+// class IslandRing
+//////////////////////////////////////////////////////////////////////////////
+
+// constructor and destructor
+
+IslandRing::IslandRing(int nislands) :
+    _nislands(nislands), _index(0), _read_fd(-1), _write_fd(-1)
+{
+    if (nislands < 1)
+    {
+        const char* emsg = "IslandRing requires at least one island.";
+        throw invalid_argument(emsg);
+    }
+    // pipe i delivers messages to island i
+    vector<int> pipefds(2 * nislands, -1);
+    for (int i = 0; i < nislands; ++i)
+    {
+        if (pipe(&pipefds[2 * i]) == 0)     continue;
+        ostringstream emsg;
+        emsg << "IslandRing: cannot create pipe, " << strerror(errno) << '.';
+        for (int j = 0; j < 2 * i; ++j)     close(pipefds[j]);
+        throw runtime_error(emsg.str());
+    }
+    // every island continues with its own stream split from this seed
+    unsigned long int ringseed = NS_LIGA::randomStreamSeed();
+    // flush pending output so that the children do not repeat it
+    cout.flush();
+    cerr.flush();
+    fflush(NULL);
+    for (int i = 1; i < nislands; ++i)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            _index = i;
+            _children.clear();
+            break;
+        }
+        if (pid < 0)
+        {
+            ostringstream emsg;
+            emsg << "IslandRing: cannot fork island " << i << ", " <<
+                strerror(errno) << '.';
+            this->connect(pipefds);
+            close(_read_fd);
+            close(_write_fd);
+            this->stopChildren();
+            throw runtime_error(emsg.str());
+        }
+        _children.push_back(pid);
+    }
+    this->connect(pipefds);
+    NS_LIGA::randomSeed(NS_LIGA::randomStreamSeed(ringseed, _index));
+    // neighbor islands may finish before reading all messages
+    signal(SIGPIPE, SIG_IGN);
+}
+
+
+IslandRing::~IslandRing()
+{
+    if (_read_fd >= 0)  close(_read_fd);
+    if (_write_fd >= 0) close(_write_fd);
+    _read_fd = _write_fd = -1;
+    this->stopChildren();
+}
+
+// public methods
+
+int IslandRing::size() const
+{
+    return _nislands;
+}
+
+
+int IslandRing::index() const
+{
+    return _index;
+}
+
+
+bool IslandRing::isMain() const
+{
+    return _index == 0;
+}
+
+
+void IslandRing::send(const string& msg)
+{
+    if (_write_fd < 0)  return;
+    string line = msg + '\n';
+    const char* p = line.data();
+    size_t n = line.size();
+    while (n > 0)
+    {
+        ssize_t cnt = write(_write_fd, p, n);
+        if (cnt < 0 && errno == EINTR)  continue;
+        // successor has finished, stop sending
+        if (cnt < 0)
+        {
+            close(_write_fd);
+            _write_fd = -1;
+            return;
+        }
+        p += cnt;
+        n -= cnt;
+    }
+}
+
+
+bool IslandRing::receive(string& msg)
+{
+    char buf[4096];
+    while (_read_fd >= 0)
+    {
+        ssize_t cnt = read(_read_fd, buf, sizeof(buf));
+        if (cnt > 0)
+        {
+            _read_buffer.append(buf, cnt);
+            continue;
+        }
+        if (cnt < 0 && errno == EINTR)  continue;
+        // end of file, predecessor has finished
+        if (cnt == 0)
+        {
+            close(_read_fd);
+            _read_fd = -1;
+        }
+        break;
+    }
+    size_t pos = _read_buffer.find('\n');
+    if (pos == string::npos)    return false;
+    msg = _read_buffer.substr(0, pos);
+    _read_buffer.erase(0, pos + 1);
+    return true;
+}
+
+// private methods
+
+void IslandRing::connect(const vector<int>& pipefds)
+{
+    // keep only the input pipe and the pipe to the successor
+    int next = (_index + 1) % _nislands;
+    for (int i = 0; i < _nislands; ++i)
+    {
+        int rfd = pipefds[2 * i];
+        int wfd = pipefds[2 * i + 1];
+        if (i == _index)    _read_fd = rfd;
+        else                close(rfd);
+        if (i == next)      _write_fd = wfd;
+        else                close(wfd);
+    }
+    int flags = fcntl(_read_fd, F_GETFL);
+    fcntl(_read_fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+void IslandRing::stopChildren()
+{
+    // ask the remaining islands to finish gracefully and wait for them
+    vector<pid_t>::iterator pii;
+    for (pii = _children.begin(); pii != _children.end(); ++pii)
+    {
+        kill(*pii, SIGHUP);
+    }
+    for (pii = _children.begin(); pii != _children.end(); ++pii)
+    {
+        while (waitpid(*pii, NULL, 0) < 0 && errno == EINTR)  { }
+    }
+    _children.clear();
+}
+
+// End of file
@@ -0,0 +1,54 @@
+/***********************************************************************
+* Short Title: ring of forked LIGA island processes
+*
+* Comments: IslandRing forks several copies of the running process
+*     which are connected in a ring by pipes.  Every island can send
+*     text messages to its successor and read messages of its
+*     predecessor without blocking.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef ISLANDRING_HPP_INCLUDED
+#define ISLANDRING_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class IslandRing
+{
+    public:
+
+        // constructor and destructor
+        IslandRing(int nislands);
+        ~IslandRing();
+
+        // methods
+        int size() const;
+        int index() const;
+        bool isMain() const;
+        // messages must not contain newline characters
+        void send(const std::string& msg);
+        bool receive(std::string& msg);
+
+    private:
+
+        // data
+        int _nislands;
+        int _index;
+        int _read_fd;
+        int _write_fd;
+        std::string _read_buffer;
+        std::vector<pid_t> _children;
+
+        // methods
+        void connect(const std::vector<int>& pipefds);
+        void stopChildren();
+
+        // disable copying
+        IslandRing(const IslandRing&);
+        IslandRing& operator=(const IslandRing&);
+};
+
+#endif  // ISLANDRING_HPP_INCLUDED
@@ -6,7 +6,6 @@
 * <license text>
 ***********************************************************************/
 
-#include <list>
 #include <stdexcept>
 #include "Lattice.hpp"
 
@@ -208,39 +207,34 @@ void Lattice::setLatBase(const R3::Vector& va0,
                _c*_a*cosb,  _c*_b*cosa,  _c*_c;
 }
 
-const R3::Vector& Lattice::cartesian(const R3::Vector& lv) const
+void Lattice::cartesian(const double* lxyz, double* cxyz, size_t n) const
 {
-    static R3::Vector res;
-    res = R3::product(lv, _base);
-    return res;
-}
-
-const R3::Vector& Lattice::fractional(const R3::Vector& cv) const
-{
-    static R3::Vector res;
-    res = R3::product(cv, _recbase);
-    return res;
-}
-
-const R3::Vector& Lattice::ucvCartesian(const R3::Vector& cv) const
-{
-    static R3::Vector res;
-    res = cartesian(ucvFractional(fractional(cv)));
-    return res;
+    const R3::Matrix& M = _base;
+    for (const double* lv = lxyz; lv != lxyz + 3 * n; lv += 3, cxyz += 3)
+    {
+        double x = lv[0], y = lv[1], z = lv[2];
+        cxyz[0] = x*M(0,0) + y*M(1,0) + z*M(2,0);
+        cxyz[1] = x*M(0,1) + y*M(1,1) + z*M(2,1);
+        cxyz[2] = x*M(0,2) + y*M(1,2) + z*M(2,2);
+    }
 }
 
-const R3::Vector& Lattice::ucvFractional(const R3::Vector& lv) const
+void Lattice::fractional(const double* cxyz, double* lxyz, size_t n) const
 {
-    static R3::Vector res;
-    res = lv - floor(lv);
-    return res;
+    const R3::Matrix& M = _recbase;
+    for (const double* cv = cxyz; cv != cxyz + 3 * n; cv += 3, lxyz += 3)
+    {
+        double x = cv[0], y = cv[1], z = cv[2];
+        lxyz[0] = x*M(0,0) + y*M(1,0) + z*M(2,0);
+        lxyz[1] = x*M(0,1) + y*M(1,1) + z*M(2,1);
+        lxyz[2] = x*M(0,2) + y*M(1,2) + z*M(2,2);
+    }
 }
 
 
-const R3::Vector& Lattice::nearZeroCartesian(const R3::Vector& cv) const
+R3::Vector Lattice::nearZeroCartesian(const R3::Vector& cv) const
 {
-    static R3::Vector rv;
-    rv = this->ucvCartesian(cv);
+    R3::Vector rv = this->ucvCartesian(cv);
     R3::Vector cv1 = rv;
     R3::Vector cv2 = rv;
     double rvsquare = R3::dot(rv, rv);
@@ -260,18 +254,18 @@ const R3::Vector& Lattice::nearZeroCartesian(const R3::Vector& cv) const
 }
 
 
-const R3::Matrix& Lattice::cartesianMatrix(const R3::Matrix& Ml) const
+R3::Matrix Lattice::cartesianMatrix(const R3::Matrix& Ml) const
 {
     using R3::product;
-    static R3::Matrix res;
+    R3::Matrix res;
     res = product(Ml, _normbase);
     res = product(R3::transpose(_normbase), res);
     return res;
 }
 
-const R3::Matrix& Lattice::fractionalMatrix(const R3::Matrix& Mc) const
+R3::Matrix Lattice::fractionalMatrix(const R3::Matrix& Mc) const
 {
-    static R3::Matrix res0, res1;
+    R3::Matrix res0, res1;
     res0 = R3::product(Mc, _recnormbase);
     res1 = R3::product(R3::transpose(_recnormbase), res0);
     return res1;
@@ -280,18 +274,15 @@ const R3::Matrix& Lattice::fractionalMatrix(const R3::Matrix& Mc) const
 
 R3::Vector Lattice::ucMaxDiagonal() const
 {
-    static list<R3::Vector> ucdiagonals;
-    if (ucdiagonals.empty())
-    {
-        ucdiagonals.push_back(R3::Vector(+1, +1, +1));
-        ucdiagonals.push_back(R3::Vector(-1, +1, +1));
-        ucdiagonals.push_back(R3::Vector(+1, -1, +1));
-        ucdiagonals.push_back(R3::Vector(+1, +1, -1));
-    }
+    const R3::Vector ucdiagonals[4] = {
+        R3::Vector(+1, +1, +1),
+        R3::Vector(-1, +1, +1),
+        R3::Vector(+1, -1, +1),
+        R3::Vector(+1, +1, -1)
+    };
     double maxnorm = -1;
-    list<R3::Vector>::iterator ucd;
-    list<R3::Vector>::iterator maxucd = ucdiagonals.end();
-    for (ucd = ucdiagonals.begin(); ucd != ucdiagonals.end(); ++ucd)
+    const R3::Vector* maxucd = NULL;
+    for (const R3::Vector* ucd = ucdiagonals; ucd != ucdiagonals + 4; ++ucd)
     {
         double normucd = this->norm(*ucd);
         if (normucd > maxnorm)
@@ -300,7 +291,7 @@ R3::Vector Lattice::ucMaxDiagonal() const
             maxucd = ucd;
         }
     }
-    assert(maxucd != ucdiagonals.end());
+    assert(maxucd != NULL);
     return *maxucd;
 }
 
@@ -82,25 +82,30 @@ class Lattice
         // angle in radians
         template <class V>
             double anglerad(const V& u, const V& v) const;
-        // conversion of coordinates and tensors
-        const R3::Vector& cartesian(const R3::Vector& lv) const;
+        // conversion of coordinates and tensors, results are returned
+        // by value so that the methods are safe to call from many threads
+        R3::Vector cartesian(const R3::Vector& lv) const;
         template <class V>
-            const R3::Vector& cartesian(const V& lv) const;
-        const R3::Vector& fractional(const R3::Vector& cv) const;
+            R3::Vector cartesian(const V& lv) const;
+        R3::Vector fractional(const R3::Vector& cv) const;
         template <class V>
-            const R3::Vector& fractional(const V& cv) const;
-        const R3::Vector& ucvCartesian(const R3::Vector& cv) const;
+            R3::Vector fractional(const V& cv) const;
+        R3::Vector ucvCartesian(const R3::Vector& cv) const;
         template <class V>
-            const R3::Vector& ucvCartesian(const V& cv) const;
-        const R3::Vector& ucvFractional(const R3::Vector& lv) const;
+            R3::Vector ucvCartesian(const V& cv) const;
+        R3::Vector ucvFractional(const R3::Vector& lv) const;
         template <class V>
-            const R3::Vector& ucvFractional(const V& lv) const;
+            R3::Vector ucvFractional(const V& lv) const;
         /// Cartesian coordinates of an quivalent point nearest to zero
-        const R3::Vector& nearZeroCartesian(const R3::Vector& cv) const;
+        R3::Vector nearZeroCartesian(const R3::Vector& cv) const;
         template <class V>
-            const R3::Vector& nearZeroCartesian(const V& cv) const;
-        const R3::Matrix& cartesianMatrix(const R3::Matrix& Ml) const;
-        const R3::Matrix& fractionalMatrix(const R3::Matrix& Mc) const;
+            R3::Vector nearZeroCartesian(const V& cv) const;
+        R3::Matrix cartesianMatrix(const R3::Matrix& Ml) const;
+        R3::Matrix fractionalMatrix(const R3::Matrix& Mc) const;
+        // conversion of n points stored as consecutive xyz triplets,
+        // the input and output arrays may be the same
+        void cartesian(const double* lxyz, double* cxyz, size_t n) const;
+        void fractional(const double* cxyz, double* lxyz, size_t n) const;
         // largest cell diagonal in fractional coordinates
         R3::Vector ucMaxDiagonal() const;
         double ucMaxDiagonalLength() const;
@@ -187,7 +192,7 @@ double Lattice::norm(const V& u) const
 template <class V>
 double Lattice::distance(const V& u, const V& v) const
 {
-    static R3::Vector duv;
+    R3::Vector duv;
     duv[0] = u[0] - v[0];
     duv[1] = u[1] - v[1];
     duv[2] = u[2] - v[2];
@@ -207,44 +212,61 @@ double Lattice::anglerad(const V& u, const V& v) const
     return acos(ca);
 }
 
+inline R3::Vector Lattice::cartesian(const R3::Vector& lv) const
+{
+    return R3::product(lv, _base);
+}
+
 template <class V>
-const R3::Vector& Lattice::cartesian(const V& lv) const
+R3::Vector Lattice::cartesian(const V& lv) const
 {
-    static R3::Vector lvcopy;
-    lvcopy = double(lv[0]), double(lv[1]), double(lv[2]);
+    R3::Vector lvcopy(lv[0], lv[1], lv[2]);
     return cartesian(lvcopy);
 }
 
+inline R3::Vector Lattice::fractional(const R3::Vector& cv) const
+{
+    return R3::product(cv, _recbase);
+}
+
 template <class V>
-const R3::Vector& Lattice::fractional(const V& cv) const
+R3::Vector Lattice::fractional(const V& cv) const
 {
-    static R3::Vector cvcopy;
-    cvcopy = cv[0], cv[1], cv[2];
+    R3::Vector cvcopy(cv[0], cv[1], cv[2]);
     return fractional(cvcopy);
 }
 
+inline R3::Vector Lattice::ucvCartesian(const R3::Vector& cv) const
+{
+    return cartesian(ucvFractional(fractional(cv)));
+}
+
 template <class V>
-const R3::Vector& Lattice::ucvCartesian(const V& cv) const
+R3::Vector Lattice::ucvCartesian(const V& cv) const
 {
-    static R3::Vector cvcopy;
-    cvcopy = cv[0], cv[1], cv[2];
+    R3::Vector cvcopy(cv[0], cv[1], cv[2]);
     return ucvCartesian(cvcopy);
 }
 
+inline R3::Vector Lattice::ucvFractional(const R3::Vector& lv) const
+{
+    R3::Vector res;
+    res = lv - floor(lv);
+    return res;
+}
+
 template <class V>
-const R3::Vector& Lattice::ucvFractional(const V& cv) const
+R3::Vector Lattice::ucvFractional(const V& cv) const
 {
-    static R3::Vector cvcopy;
-    cvcopy = cv[0], cv[1], cv[2];
+    R3::Vector cvcopy(cv[0], cv[1], cv[2]);
     return ucvFractional(cvcopy);
 }
 
 
 template <class V>
-const R3::Vector& Lattice::nearZeroCartesian(const V& cv) const
+R3::Vector Lattice::nearZeroCartesian(const V& cv) const
 {
-    static R3::Vector cvcopy;
-    cvcopy = cv[0], cv[1], cv[2];
+    R3::Vector cvcopy(cv[0], cv[1], cv[2]);
     return this->nearZeroCartesian(cvcopy);
 }
 
@@ -0,0 +1,446 @@
+/***********************************************************************
+* Short Title: sweep of lattice parameter hypotheses
+*
+* Comments: implementation of LatticeSweep
+*
+* <license text>
+***********************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "LatticeSweep.hpp"
+#include "Crystal.hpp"
+#include "Exceptions.hpp"
+#include "Lattice.hpp"
+#include "Liga_t.hpp"
+#include "ParseArgs.hpp"
+#include "Random.hpp"
+
+using namespace std;
+
+// Local helpers for lattice files and ranking -------------------------------
+
+namespace {
+
+// parse a value or lo:hi:step range, return empty vector when invalid
+
+vector<double> parseLatticeValues(const string& word)
+{
+    vector<double> rv;
+    string w = word;
+    replace(w.begin(), w.end(), ':', ' ');
+    istringstream wsm(w);
+    vector<double> fields;
+    double x;
+    while (wsm >> x)    fields.push_back(x);
+    bool valid = wsm.eof() && (fields.size() == 1 || fields.size() == 3);
+    if (!valid)     return rv;
+    if (fields.size() == 1)
+    {
+        rv.push_back(fields[0]);
+        return rv;
+    }
+    double lo = fields[0], hi = fields[1], step = fields[2];
+    if (!(step > 0.0) || hi < lo)   return rv;
+    int n = int(floor((hi - lo) / step + 1e-8)) + 1;
+    for (int i = 0; i < n; ++i)     rv.push_back(lo + i * step);
+    return rv;
+}
+
+
+void appendGrid(vector< vector<double> >& lattices,
+        const vector< vector<double> >& axes, vector<double>& latpar,
+        size_t k)
+{
+    if (k == axes.size())
+    {
+        lattices.push_back(latpar);
+        return;
+    }
+    for (size_t i = 0; i != axes[k].size(); ++i)
+    {
+        latpar[k] = axes[k][i];
+        appendGrid(lattices, axes, latpar, k + 1);
+    }
+}
+
+
+// liga of one lattice running in a child process
+
+struct SweepJob
+{
+    pid_t pid;
+    int fd;
+    size_t idx;
+};
+
+
+class EntryIsBetter
+{
+    public:
+
+        EntryIsBetter(const vector<LatticeSweep::Entry>& entries) :
+            mentries(entries)
+        { }
+
+        // more atoms first, then by cost, failed runs last
+        bool operator()(size_t i, size_t j) const
+        {
+            const LatticeSweep::Entry& ei = mentries[i];
+            const LatticeSweep::Entry& ej = mentries[j];
+            if (ei.natoms != ej.natoms)     return ei.natoms > ej.natoms;
+            return ei.cost < ej.cost;
+        }
+
+    private:
+
+        const vector<LatticeSweep::Entry>& mentries;
+};
+
+
+string latparString(const vector<double>& latpar)
+{
+    ostringstream out;
+    for (size_t i = 0; i != latpar.size(); ++i)
+    {
+        out << (i ? "," : "") << latpar[i];
+    }
+    return out.str();
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class LatticeSweep
+//////////////////////////////////////////////////////////////////////////////
+
+// Class Methods -------------------------------------------------------------
+
+vector< vector<double> >
+LatticeSweep::readLatticeFile(const string& filename)
+{
+    ifstream fid(filename.c_str());
+    if (!fid)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    vector< vector<double> > rv;
+    string line;
+    for (int lineno = 1; getline(fid, line); ++lineno)
+    {
+        line = line.substr(0, line.find('#'));
+        replace(line.begin(), line.end(), ',', ' ');
+        istringstream words(line);
+        vector< vector<double> > axes;
+        string w;
+        while (words >> w)
+        {
+            axes.push_back(parseLatticeValues(w));
+            if (!axes.back().empty())   continue;
+            ostringstream emsg;
+            emsg << filename << ':' << lineno <<
+                ": invalid lattice parameter '" << w << "'.";
+            throw ParseArgsError(emsg.str());
+        }
+        if (axes.empty())   continue;
+        if (axes.size() != 6)
+        {
+            ostringstream emsg;
+            emsg << filename << ':' << lineno <<
+                ": lattice must define 6 parameters.";
+            throw ParseArgsError(emsg.str());
+        }
+        vector<double> latpar(6);
+        appendGrid(rv, axes, latpar, 0);
+    }
+    if (rv.empty())
+    {
+        ostringstream emsg;
+        emsg << "No lattice parameters in '" << filename << "'.";
+        throw ParseArgsError(emsg.str());
+    }
+    return rv;
+}
+
+// Constructor ---------------------------------------------------------------
+
+LatticeSweep::LatticeSweep(RunPar_t* runpar) :
+    rp(runpar), stopflag(NULL), sweepseed(NS_LIGA::randomStreamSeed())
+{
+    Entry e;
+    e.rounds = 0;
+    e.natoms = -1;
+    e.cost = DOUBLE_MAX;
+    for (size_t i = 0; i != rp->sweeplatpars.size(); ++i)
+    {
+        e.latpar = rp->sweeplatpars[i];
+        mentries.push_back(e);
+    }
+}
+
+// Public Methods ------------------------------------------------------------
+
+void LatticeSweep::run()
+{
+    vector<size_t> alive(mentries.size());
+    for (size_t i = 0; i != alive.size(); ++i)  alive[i] = i;
+    double cputime = rp->sweeptime;
+    this->board.reset(NULL);
+    if (rp->championboard)
+    {
+        this->board.reset(new ChampionBoard(rp->mol->getMaxAtomCount()));
+    }
+    for (int round = 1; !alive.empty(); ++round, cputime *= 2)
+    {
+        cout << "Lattice sweep round " << round << ", " <<
+            alive.size() << " lattices, maxcputime=" << cputime << endl;
+        this->playRound(alive, round, cputime);
+        this->rankEntries(alive);
+        this->printRanking(alive, round);
+        if (alive.size() == 1 || this->stopFlag())  break;
+        if (this->isSolved(mentries[alive.front()]))  break;
+        // keep the better half
+        alive.resize((alive.size() + 1) / 2);
+    }
+    this->printSummary();
+}
+
+
+void LatticeSweep::useStopFlag(int* flag)
+{
+    stopflag = flag;
+}
+
+
+bool LatticeSweep::solutionFound() const
+{
+    for (size_t i = 0; i != mentries.size(); ++i)
+    {
+        if (this->isSolved(mentries[i]))    return true;
+    }
+    return false;
+}
+
+
+const vector<LatticeSweep::Entry>& LatticeSweep::entries() const
+{
+    return mentries;
+}
+
+// Private Methods -----------------------------------------------------------
+
+bool LatticeSweep::stopFlag() const
+{
+    return stopflag && *stopflag;
+}
+
+
+bool LatticeSweep::isSolved(const Entry& e) const
+{
+    return e.natoms == rp->mol->getMaxAtomCount() && e.cost < rp->tolcost;
+}
+
+
+// Run ligas for the alive lattices in at most sweepjobs concurrent
+// child processes, every child reports "natoms cost" through a pipe.
+
+void LatticeSweep::playRound(const vector<size_t>& alive, int round,
+        double cputime)
+{
+    vector<SweepJob> running;
+    size_t next = 0;
+    bool signaled = false;
+    while (next < alive.size() || !running.empty())
+    {
+        while (next < alive.size() && !this->stopFlag() &&
+                int(running.size()) < rp->sweepjobs)
+        {
+            int pipefds[2];
+            if (pipe(pipefds) != 0)
+            {
+                ostringstream emsg;
+                emsg << "LatticeSweep: cannot create pipe, " <<
+                    strerror(errno) << '.';
+                throw runtime_error(emsg.str());
+            }
+            size_t idx = alive[next++];
+            // flush pending output so that the child does not repeat it
+            cout.flush();
+            cerr.flush();
+            fflush(NULL);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                close(pipefds[0]);
+                this->runLattice(idx, round, cputime, pipefds[1]);
+            }
+            close(pipefds[1]);
+            if (pid < 0)
+            {
+                ostringstream emsg;
+                emsg << "LatticeSweep: cannot fork, " <<
+                    strerror(errno) << '.';
+                close(pipefds[0]);
+                throw runtime_error(emsg.str());
+            }
+            SweepJob job = { pid, pipefds[0], idx };
+            running.push_back(job);
+        }
+        if (running.empty())    break;
+        // children finish gracefully after a stop request
+        if (this->stopFlag() && !signaled)
+        {
+            for (size_t i = 0; i != running.size(); ++i)
+            {
+                kill(running[i].pid, SIGHUP);
+            }
+            signaled = true;
+        }
+        pid_t pid = waitpid(-1, NULL, 0);
+        if (pid < 0 && errno == EINTR)  continue;
+        vector<SweepJob>::iterator jj = running.begin();
+        while (jj != running.end() && jj->pid != pid)   ++jj;
+        if (jj == running.end())    continue;
+        // the child has exited, its short report is in the pipe buffer
+        string report;
+        char buf[256];
+        ssize_t cnt;
+        while ((cnt = read(jj->fd, buf, sizeof(buf))) != 0)
+        {
+            if (cnt < 0 && errno == EINTR)  continue;
+            if (cnt < 0)    break;
+            report.append(buf, cnt);
+        }
+        close(jj->fd);
+        Entry& e = mentries[jj->idx];
+        e.rounds = round;
+        e.natoms = -1;
+        e.cost = DOUBLE_MAX;
+        istringstream rsm(report);
+        int natoms;
+        double cost;
+        if (rsm >> natoms >> cost)
+        {
+            e.natoms = natoms;
+            e.cost = cost;
+        }
+        running.erase(jj);
+    }
+}
+
+
+// Child process, play the liga for lattice idx and exit.
+
+void LatticeSweep::runLattice(size_t idx, int round, double cputime, int fd)
+{
+    int exit_code = EXIT_SUCCESS;
+    try {
+        if (!freopen("/dev/null", "w", stdout))  perror("/dev/null");
+        const vector<double>& lp = mentries[idx].latpar;
+        rp->latpar = lp;
+        Crystal& crst = dynamic_cast<Crystal&>(*rp->mol);
+        crst.setLattice(Lattice(lp[0], lp[1], lp[2], lp[3], lp[4], lp[5]));
+        rp->maxcputime = cputime;
+        rp->resetClocks();
+        unsigned long int seed = NS_LIGA::randomStreamSeed(sweepseed,
+                (round - 1) * mentries.size() + idx);
+        NS_LIGA::randomSeed(seed);
+        Liga_t liga(rp);
+        liga.useStopFlag(stopflag);
+        liga.useChampionBoard(this->board.get());
+        liga.prepare();
+        while (!liga.finished())    liga.playSeason();
+        const Molecule* champ = liga.bestChamp();
+        ostringstream report;
+        report.precision(12);
+        report << champ->countAtoms() << ' ' << champ->cost() << '\n';
+        const string& s = report.str();
+        if (write(fd, s.data(), s.size()) < 0)  exit_code = EXIT_FAILURE;
+    }
+    catch (exception& e) {
+        cerr << "lattice " << latparString(mentries[idx].latpar) << ": " <<
+            e.what() << endl;
+        exit_code = EXIT_FAILURE;
+    }
+    close(fd);
+    fflush(NULL);
+    _exit(exit_code);
+}
+
+
+void LatticeSweep::rankEntries(vector<size_t>& alive) const
+{
+    stable_sort(alive.begin(), alive.end(), EntryIsBetter(mentries));
+}
+
+
+void LatticeSweep::printRanking(const vector<size_t>& alive,
+        int round) const
+{
+    cout << "Lattice ranking after round " << round <<
+        " - rank natoms cost latpar:\n";
+    for (size_t i = 0; i != alive.size(); ++i)
+    {
+        const Entry& e = mentries[alive[i]];
+        cout << "LR " << (i + 1) << ' ' << e.natoms << ' ';
+        if (e.natoms < 0)   cout << "failed";
+        else                cout << e.cost;
+        cout << ' ' << latparString(e.latpar) << '\n';
+    }
+    cout << endl;
+}
+
+
+void LatticeSweep::printSummary() const
+{
+    // lattices kept for more rounds rank higher
+    vector<size_t> order;
+    int maxrounds = 0;
+    for (size_t i = 0; i != mentries.size(); ++i)
+    {
+        maxrounds = max(maxrounds, mentries[i].rounds);
+    }
+    for (int r = maxrounds; r >= 0; --r)
+    {
+        vector<size_t> inround;
+        for (size_t i = 0; i != mentries.size(); ++i)
+        {
+            if (mentries[i].rounds == r)    inround.push_back(i);
+        }
+        this->rankEntries(inround);
+        order.insert(order.end(), inround.begin(), inround.end());
+    }
+    cout << "Lattice sweep summary - rank rounds natoms cost latpar:\n";
+    for (size_t i = 0; i != order.size(); ++i)
+    {
+        const Entry& e = mentries[order[i]];
+        cout << "LS " << (i + 1) << ' ' << e.rounds << ' ' << e.natoms << ' ';
+        if (e.natoms < 0)   cout << "failed";
+        else                cout << e.cost;
+        cout << ' ' << latparString(e.latpar) << '\n';
+    }
+    cout << '\n';
+    if (!order.empty() && mentries[order[0]].natoms >= 0)
+    {
+        cout << "Best lattice latpar=" <<
+            latparString(mentries[order[0]].latpar) << "\n";
+    }
+    if (this->solutionFound())  cout << "Solution found!!!\n";
+    cout << endl;
+}
+
+// End of file
@@ -0,0 +1,74 @@
+/***********************************************************************
+* Short Title: sweep of lattice parameter hypotheses
+*
+* Comments: LatticeSweep runs short crystal ligas for a list of lattice
+*     parameters.  Every liga runs in a forked process, so that all
+*     lattices use the distance table parsed once by the main process.
+*     Lattices are ranked after every round, the better half is kept
+*     and played again with a doubled CPU time.  The sweep ends with
+*     the last lattice or with a solution.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef LATTICESWEEP_HPP_INCLUDED
+#define LATTICESWEEP_HPP_INCLUDED
+
+#include <string>
+#include <memory>
+#include <vector>
+
+#include "ChampionBoard.hpp"
+
+class RunPar_t;
+
+class LatticeSweep
+{
+    public:
+
+        // types
+        struct Entry
+        {
+            std::vector<double> latpar;
+            int rounds;
+            int natoms;
+            double cost;
+        };
+
+        // class methods
+        // lattice lines "a b c alpha beta gamma" with optional lo:hi:step
+        // ranges that are expanded to a grid
+        static std::vector< std::vector<double> >
+            readLatticeFile(const std::string& filename);
+
+        // constructor
+        LatticeSweep(RunPar_t* runpar);
+
+        // methods
+        void run();
+        void useStopFlag(int* flag);
+        bool solutionFound() const;
+        const std::vector<Entry>& entries() const;
+
+    private:
+
+        // data
+        RunPar_t* rp;
+        int* stopflag;
+        unsigned long int sweepseed;
+        std::vector<Entry> mentries;
+        // best champions of the sweep processes with championboard
+        std::auto_ptr<ChampionBoard> board;
+
+        // methods
+        bool stopFlag() const;
+        bool isSolved(const Entry& e) const;
+        void playRound(const std::vector<size_t>& alive, int round,
+                double cputime);
+        void runLattice(size_t idx, int round, double cputime, int fd);
+        void rankEntries(std::vector<size_t>& alive) const;
+        void printRanking(const std::vector<size_t>& alive, int round) const;
+        void printSummary() const;
+};
+
+#endif  // LATTICESWEEP_HPP_INCLUDED
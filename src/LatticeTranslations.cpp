@@ -0,0 +1,167 @@
+/***********************************************************************
+* Short Title: shared sets of lattice translations
+*
+* Comments: implementation of LatticeTranslations
+*
+* <license text>
+***********************************************************************/
+
+#include <algorithm>
+#include <list>
+#include <boost/thread/mutex.hpp>
+
+#include "LatticeTranslations.hpp"
+#include "PointsInSphere.hpp"
+#include "Lattice.hpp"
+
+using namespace std;
+
+// Local helpers for the cache of translation sets ---------------------------
+
+namespace {
+
+// number of recently used sets kept alive by the cache
+const size_t MAX_CACHED_SETS = 8;
+
+typedef boost::shared_ptr<const LatticeTranslations> TranslationsPtr;
+
+list<TranslationsPtr>& cached_sets()
+{
+    static list<TranslationsPtr> the_sets;
+    return the_sets;
+}
+
+
+boost::mutex& cache_lock()
+{
+    static boost::mutex the_lock;
+    return the_lock;
+}
+
+
+struct TranslationItem
+{
+    double len;
+    R3::Vector xyz;
+    int mno[3];
+
+    bool operator<(const TranslationItem& other) const
+    {
+        return this->len < other.len;
+    }
+};
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class LatticeTranslations
+//////////////////////////////////////////////////////////////////////////////
+
+// Class Methods -------------------------------------------------------------
+
+TranslationsPtr LatticeTranslations::get(const Lattice& lat,
+        const pair<double,double>& rext)
+{
+    boost::mutex::scoped_lock lock(cache_lock());
+    list<TranslationsPtr>& sets = cached_sets();
+    list<TranslationsPtr>::iterator ii;
+    for (ii = sets.begin(); ii != sets.end(); ++ii)
+    {
+        if (!(*ii)->matches(lat, rext))     continue;
+        // keep the most recently used set at the front
+        sets.splice(sets.begin(), sets, ii);
+        return sets.front();
+    }
+    TranslationsPtr rv(new LatticeTranslations(lat, rext));
+    sets.push_front(rv);
+    if (sets.size() > MAX_CACHED_SETS)  sets.pop_back();
+    return rv;
+}
+
+// Constructor ---------------------------------------------------------------
+
+LatticeTranslations::LatticeTranslations(const Lattice& lat,
+        const pair<double,double>& rext) :
+    _base(lat.base()), _rext(rext)
+{
+    vector<int> mno;
+    vector<double> txyz;
+    PointsInSphere sph(rext.first, rext.second, lat);
+    for (sph.rewind(); !sph.finished(); sph.next())
+    {
+        mno.insert(mno.end(), sph.mno(), sph.mno() + 3);
+        txyz.insert(txyz.end(), sph.mno(), sph.mno() + 3);
+    }
+    size_t nt = txyz.size() / 3;
+    if (nt)     lat.cartesian(&txyz[0], &txyz[0], nt);
+    vector<TranslationItem> items(nt);
+    for (size_t i = 0; i != nt; ++i)
+    {
+        TranslationItem& ti = items[i];
+        copy(mno.begin() + 3 * i, mno.begin() + 3 * i + 3, ti.mno);
+        ti.xyz = txyz[3 * i], txyz[3 * i + 1], txyz[3 * i + 2];
+        ti.len = R3::norm(ti.xyz);
+    }
+    sort(items.begin(), items.end());
+    this->_mno.resize(3 * nt);
+    this->_tx.resize(nt);
+    this->_ty.resize(nt);
+    this->_tz.resize(nt);
+    this->_tlen.resize(nt);
+    for (size_t i = 0; i != nt; ++i)
+    {
+        copy(items[i].mno, items[i].mno + 3, this->_mno.begin() + 3 * i);
+        this->_tx[i] = items[i].xyz[0];
+        this->_ty[i] = items[i].xyz[1];
+        this->_tz[i] = items[i].xyz[2];
+        this->_tlen[i] = items[i].len;
+    }
+}
+
+// Public Methods ------------------------------------------------------------
+
+bool LatticeTranslations::matches(const Lattice& lat,
+        const pair<double,double>& rext) const
+{
+    bool rv = (rext == this->_rext) &&
+        R3::MatricesAlmostEqual(lat.base(), this->_base);
+    return rv;
+}
+
+
+size_t LatticeTranslations::size() const
+{
+    return this->_tlen.size();
+}
+
+
+const vector<int>& LatticeTranslations::mno() const
+{
+    return this->_mno;
+}
+
+
+const vector<double>& LatticeTranslations::tx() const
+{
+    return this->_tx;
+}
+
+
+const vector<double>& LatticeTranslations::ty() const
+{
+    return this->_ty;
+}
+
+
+const vector<double>& LatticeTranslations::tz() const
+{
+    return this->_tz;
+}
+
+
+const vector<double>& LatticeTranslations::tlen() const
+{
+    return this->_tlen;
+}
+
+// End of file
@@ -0,0 +1,58 @@
+/***********************************************************************
+* Short Title: shared sets of lattice translations
+*
+* Comments: LatticeTranslations holds the lattice points with distance
+*     from the origin within a radius range, sorted by length.  The sets
+*     are immutable and cached by lattice base and radius range, so that
+*     all crystals with the same lattice share one instance.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef LATTICETRANSLATIONS_HPP_INCLUDED
+#define LATTICETRANSLATIONS_HPP_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+#include "R3linalg.hpp"
+
+class Lattice;
+
+class LatticeTranslations
+{
+    public:
+
+        // class methods
+        static boost::shared_ptr<const LatticeTranslations>
+            get(const Lattice& lat, const std::pair<double,double>& rext);
+
+        // methods
+        bool matches(const Lattice& lat,
+                const std::pair<double,double>& rext) const;
+        size_t size() const;
+        // lattice indices of the i-th translation start at mno[3 * i]
+        const std::vector<int>& mno() const;
+        // Cartesian coordinates and lengths
+        const std::vector<double>& tx() const;
+        const std::vector<double>& ty() const;
+        const std::vector<double>& tz() const;
+        const std::vector<double>& tlen() const;
+
+    private:
+
+        // constructor
+        LatticeTranslations(const Lattice& lat,
+                const std::pair<double,double>& rext);
+
+        // data
+        R3::Matrix _base;
+        std::pair<double,double> _rext;
+        std::vector<int> _mno;
+        std::vector<double> _tx;
+        std::vector<double> _ty;
+        std::vector<double> _tz;
+        std::vector<double> _tlen;
+};
+
+#endif  // LATTICETRANSLATIONS_HPP_INCLUDED
@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -84,6 +85,25 @@ ofstream& mktempofstream(ofstream& out, string& writefile)
     return out;
 }
 
+void replace_file(const string& filename, const string& content)
+{
+    // test if filename is writeable
+    ofstream fid(filename.c_str(), ios_base::out|ios_base::ate);
+    if (!fid)
+    {
+        ostringstream emsg;
+        emsg << "unable to write to '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    fid.close();
+    // write via temporary file
+    string writefile = filename + "XXXXXX";
+    mktempofstream(fid, writefile);
+    fid << content;
+    fid.close();
+    rename(writefile.c_str(), filename.c_str());
+}
+
 // read lines that do not start with number
 bool read_header(istream& fid, string& header)
 {
@@ -117,4 +137,20 @@ bool read_header(istream& fid)
     return read_header(fid, dummy);
 }
 
+// strings are written as their length followed by characters
+void write_binary(ostream& out, const string& s)
+{
+    write_binary(out, s.size());
+    out.write(s.data(), s.size());
+}
+
+bool read_binary(istream& in, string& s)
+{
+    size_t sz;
+    if (!read_binary(in, sz))   return false;
+    s.resize(sz);
+    if (sz)     in.read(&s[0], sz);
+    return in.good();
+}
+
 // End of file
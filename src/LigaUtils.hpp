@@ -46,9 +46,16 @@ template <typename Container>
 // file utilities
 // similar to mkstemp(3)
 std::ofstream& mktempofstream(std::ofstream& out, std::string& writefile);
+// replace filename with content written to a temporary file
+void replace_file(const std::string& filename, const std::string& content);
 bool read_header(std::istream& fid, std::string& header);
 bool read_header(std::istream& fid);
 template<typename T> bool read_data(std::istream& fid, std::vector<T>& v);
+// binary values of plain types and strings in checkpoint files
+template<typename T> void write_binary(std::ostream& out, const T& value);
+template<typename T> bool read_binary(std::istream& in, T& value);
+void write_binary(std::ostream& out, const std::string& s);
+bool read_binary(std::istream& in, std::string& s);
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -125,4 +132,17 @@ bool read_data(std::istream& fid, std::vector<T>& v)
     return !(fid.rdstate() & std::ios::badbit);
 }
 
+template<typename T>
+void write_binary(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_binary(std::istream& in, T& value)
+{
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return in.good();
+}
+
 #endif  // LIGAUTILS_HPP_INCLUDED
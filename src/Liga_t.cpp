@@ -7,6 +7,9 @@
 *****************************************************************************/
 
 #include <queue>
+#include <limits>
+#include <numeric>
+#include <sstream>
 
 #include <boost/python.hpp>
 #include <boost/filesystem.hpp>
@@ -16,8 +19,13 @@
 #include "TraceId_t.hpp"
 #include "Molecule.hpp"
 #include "RunPar_t.hpp"
+#include "Random.hpp"
+#include "SectionTimer.hpp"
+#include "Exceptions.hpp"
 
 using namespace std;
+using NS_LIGA::randomStreamSeed;
+using NS_LIGA::RandomStreamScope;
 using namespace NS_LIGA_VERBOSE_FLAG;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -71,10 +79,63 @@ void Liga_t::setVerboseVector(vector<bool>& vb, string flag, bool value)
     setVerboseVector(vb, vbf, value);
 }
 
+
+// Fixed atoms are the same on all islands, the message has only the free
+// atoms.  Element symbols are prefixed with ':' as they can be empty.
+
+string Liga_t::migrantMessage(const Molecule& champ, bool solved)
+{
+    ostringstream oss;
+    oss << setprecision(numeric_limits<double>::digits10 + 2);
+    oss << solved << ' ' << (champ.countAtoms() - champ.NFixed());
+    for (int i = 0; i != champ.countAtoms(); ++i)
+    {
+        const Atom_t& a = champ.getAtom(i);
+        if (a.fixed)    continue;
+        oss << " :" << a.element << ' ' << a.r[0] << ' ' << a.r[1] <<
+            ' ' << a.r[2];
+    }
+    return oss.str();
+}
+
+
+bool Liga_t::readMigrant(const string& msg, Molecule& mol)
+{
+    istringstream iss(msg);
+    bool solved;
+    int nfree;
+    iss >> solved >> nfree;
+    bool valid = iss && nfree >= 0 &&
+        nfree <= mol.getMaxAtomCount() - mol.countAtoms();
+    for (int i = 0; valid && i != nfree; ++i)
+    {
+        string smbl;
+        double x, y, z;
+        iss >> smbl >> x >> y >> z;
+        valid = iss && smbl[0] == ':';
+        if (!valid)     break;
+        // element must be still available in the atom bucket
+        try {
+            mol.AddAt(smbl.substr(1), x, y, z);
+        }
+        catch (invalid_argument&) {
+            valid = false;
+        }
+    }
+    valid = valid && (iss >> ws).eof();
+    if (!valid)
+    {
+        const char* emsg = "Invalid migrant message from another island.";
+        throw runtime_error(emsg);
+    }
+    return solved;
+}
+
 // Constructor and destructor
 
 Liga_t::Liga_t(RunPar_t* runpar) :
-    vector<Division_t>(), rp(runpar), stopflag(NULL)
+    vector<Division_t>(), rp(runpar), stopflag(NULL),
+    islands(NULL), board(NULL), outstru_savecnt(0)
 {
     world_champ = NULL;
     setVerbose(rp->verbose);
@@ -93,32 +154,98 @@ void Liga_t::prepare()
     this->printed_scooped_structures = false;
     this->saved_scooped_structures = false;
     this->tdistributor.reset( TrialDistributor::create(rp) );
+    this->workers.reset(NULL);
+    if (rp->nthreads > 1)   this->workers.reset(new WorkerPool(rp->nthreads));
+    if (this->workers.get())    this->workers->setNodeAffinity(rp->numa);
+    this->worker_pools.clear();
+    this->season_exchanges = 0;
+    this->writer.reset(new StructureWriter);
+    this->timersfid.reset(NULL);
+    if (!rp->timersfile.empty())
+    {
+        this->timersfid.reset(new ofstream(rp->timersfile.c_str()));
+        if (!*this->timersfid)
+        {
+            ostringstream emsg;
+            emsg << "Unable to write to '" << rp->timersfile << "'";
+            throw IOError(emsg.str());
+        }
+    }
+    this->telemetry.reset(NULL);
+    this->eventlog.reset(NULL);
+    if (!rp->telemetry.empty())
+    {
+        this->telemetry.reset(new TelemetrySink(rp->telemetry));
+    }
+    this->checkpoint_walltime = Counter::WallTime();
+    this->season_trialtime = 0.0;
+    this->season_overdue = false;
+    this->walltime_per_trialtime = 0.0;
+    this->cputime_per_trialtime = 0.0;
     this->base_level = rp->base_level;
     // initialize divisions, primitive divisions have only 1 team
     Division_t::ndim = rp->ndim;
+    Division_t::efficiency_sharing = (rp->triangsharing == "efficiency");
     for (int lev = 0; lev <= rp->mol->getMaxAtomCount(); ++lev)
     {
         int divsize = divSize(lev);
         push_back(Division_t(divsize, lev));
+        back().reserve(divsize);
     }
     // put initial molecule to its division
     PMOL first_team = rp->mol->copy();
+    if (this->workers.get())    first_team->cacheCost(*this->workers);
     cout << "Initial team" << endl;
     cout << season << " I " << first_team->countAtoms() << ' ' <<
         first_team->cost() << '\n';
     at(first_team->countAtoms()).push_back(first_team);
     // fill lower divisions
     cout << "Filling lower divisions\n";
-    for (int lev = first_team->countAtoms()-1; lev >= base_level; --lev)
+    this->fillLowerDivisions(first_team);
+    cout << "Done" << endl;
+    if (!rp->restart.empty())   this->loadCheckpoint(rp->restart);
+    // record or replay the match decisions from the restarted season
+    if (!rp->eventlog.empty())
     {
-        PMOL parent_team = at(lev+1).back();
-        PMOL lower_team = parent_team->copy();
-        lower_team->Degenerate(1, Molecule::FAST);
-        cout << season << " L " << lower_team->countAtoms() << ' '
-            << lower_team->cost() << endl;
-        at(lev).push_back(lower_team);
+        this->eventlog.reset(new EventLog(rp->eventlog, EventLog::RECORD));
     }
-    cout << "Done" << endl;
+    if (!rp->replay.empty())
+    {
+        this->eventlog.reset(new EventLog(rp->replay, EventLog::REPLAY));
+        this->eventlog->seekSeason(this->season);
+        cout << "Replaying " << rp->replay << " from season " <<
+            this->season << endl;
+    }
+    // preallocate the teams that fill the divisions and the copies made
+    // for scooping and concurrent matches, seasons then only recycle them
+    size_t nslots = 0;
+    size_t nteams = 0;
+    for (iterator dv = begin(); dv != end(); ++dv)
+    {
+        nslots += dv->fullsize();
+        nteams += dv->size();
+    }
+    size_t nextra = rp->scoopfunction.empty() ? 0 : back().fullsize();
+    bool numapools = this->workers.get() && rp->numa;
+    if (this->workers.get() && !numapools)    nextra += size();
+    this->team_pool.reserve(*rp->mol, nslots - nteams + nextra);
+    // spare teams for the matches are allocated by their own workers
+    if (numapools)
+    {
+        this->worker_pools.resize(rp->nthreads);
+        for (int i = 0; i != rp->nthreads; ++i)
+        {
+            this->worker_pools[i].reset(new MoleculePool);
+        }
+        WorkerPool::MethodJob<Liga_t>
+            reservejob(this, &Liga_t::reserveWorkerPool);
+        this->workers->executeBlocks(reservejob, rp->nthreads);
+    }
+    this->outstru_savecnt = 0;
+    this->outstru_costs.assign(size(), DOUBLE_MAX);
+    SavedFrame sf0 = {0, NULL, 0, DOUBLE_MAX};
+    this->saved_frame = sf0;
+    this->frames_trace = queue<TraceId_t>(rp->framestrace);
     updateWorldChamp();
     printWorldChamp();
     updateBestChamp();
@@ -132,13 +259,28 @@ void Liga_t::playSeason()
 {
     if (stopFlag())     return;
     ++season;
+    this->noteEvent(EventLog::SEASON, 0, season);
+    season_exchanges = 0;
+    fill(season_acc, season_acc + NTGTYPES, 0);
+    fill(season_tot, season_tot + NTGTYPES, 0);
+    season_walltime = Counter::PreciseWallTime();
+    season_cputime = Counter::CPUTime();
     shareSeasonTrials();
-    for (size_t lo_level = base_level; lo_level < size() - 1; ++lo_level)
+    if (this->workers.get())
     {
-        playLevel(lo_level);
-        if (stopFlag())     break;
+        playLevelsParallel();
     }
+    else
+    {
+        for (size_t lo_level = base_level; lo_level < size() - 1; ++lo_level)
+        {
+            playLevel(lo_level);
+            if (stopFlag() || (rp->fitseasons && outOfTime()))  break;
+        }
+    }
+    exchangeMigrants();
     printLevelAverages();
+    printMemoryUsage();
     updateWorldChamp();
     printWorldChamp();
     updateBestChamp();
@@ -148,17 +290,22 @@ void Liga_t::playSeason()
     cout.flush();
     saveOutStru();
     saveFrames();
+    saveTimers();
+    saveTelemetry();
+    saveCheckpoint();
+    if (this->eventlog.get())   this->eventlog->flush();
+    measureSeasonTime();
 }
 
 
 void Liga_t::playLevel(size_t lo_level)
 {
+    SECTION_TIMER("Liga_t::playLevel");
     iterator lo_div = begin() + lo_level;
     if (lo_div->empty())    return;
-    // keep set of modified molecul for tracing
-    set<PMOL> modified;
     // find winner
     int winner_idx = lo_div->find_winner();
+    this->noteEvent(EventLog::WINNER, lo_level, winner_idx);
     PMOL advancing = lo_div->at(winner_idx);
     if (advancing->cost() >= rp->stopgame)    return;
     bool advancing_best = (advancing == lo_div->best());
@@ -166,70 +313,24 @@ void Liga_t::playLevel(size_t lo_level)
     if (!lo_div->full())
     {
         // save copy of advancing winner
-        PMOL winner_clone = advancing->copy();
+        PMOL winner_clone = this->team_pool.copy(*advancing);
         lo_div->push_back(winner_clone);
     }
     // advance as far as possible
     const int* etg = lo_div->estimateTriangulations();
-    const pair<int*,int*> acc_tot = advancing->Evolve(etg);
-    lo_div->noteTriangulations(acc_tot);
-    size_t hi_level = advancing->countAtoms();
-    if (lo_level != hi_level)   modified.insert(advancing);
-    iterator hi_div = begin() + hi_level;
-    // fill intermediate empty divisions, loop will stop at non-empty lo_div
-    for (iterator empty_div = hi_div; empty_div->empty(); --empty_div)
-    {
-        PMOL pioneer = advancing->copy();
-        pioneer->Degenerate(hi_div - empty_div);
-        empty_div->push_back(pioneer);
-        modified.insert(pioneer);
-    }
-    // find looser
-    int looser_idx = hi_div->find_looser();
-    PMOL descending = hi_div->at(looser_idx);
-    double desc_bad0 = descending->cost();
-    if (!hi_div->full())
-    {
-        // save copy of descending looser
-        PMOL looser_clone = descending->copy();
-        hi_div->push_back(looser_clone);
-    }
-    // copy winner if he made a good advance
-    if (eps_gt(descending->cost(), advancing->cost()))
-    {
-        *descending = *advancing;
-    }
-    descending->Degenerate(hi_level - lo_level);
-    if (lo_level != hi_level)   modified.insert(descending);
-    // all set now so we can swap winner and looser
-    hi_div->at(looser_idx) = advancing;
-    lo_div->at(winner_idx) = descending;
-    // make sure the original best cluster is preserved if it was much much
-    // better than whatever left in the low division
-    const double spoil_factor = 10.0;
-    if ( advancing_best && eps_gt(lo_div->best()->cost(),
-                spoil_factor*adv_bad0) )
-    {
-        PMOL lo_looser = lo_div->at(lo_div->find_looser());
-        *lo_looser = *advancing;
-        for (size_t nlast = hi_level; nlast != lo_level;)
-            lo_looser->Pop(--nlast);
-        modified.insert(lo_looser);
-    }
-    if (verbose[AD])
-    {
-        cout << season;
-        cout << " A " <<
-            lo_level << ' ' << adv_bad0 << ' ' <<
-            hi_level << ' ' << advancing->cost() << "    ";
-        cout << " D " <<
-            hi_level << ' ' << desc_bad0 << ' ' <<
-            lo_level << ' ' << descending->cost() << '\n';
-    }
-    recordFramesTrace(modified, lo_level);
-    saveFramesTrace(modified, lo_level);
-    // update world champ so that the season can be cut short by stopFlag()
-    if (advancing->full())  updateWorldChamp();
+    const double* maxcosts = this->matchCostLimits(lo_level);
+    double t0 = Counter::PreciseWallTime();
+    const pair<int*,int*> acc_tot = advancing->Evolve(etg, maxcosts);
+    double seconds = Counter::PreciseWallTime() - t0;
+    lo_div->noteTeamChanged(winner_idx);
+    this->noteEvent(EventLog::EVOLVE, lo_level,
+            advancing->countAtoms(), advancing->cost());
+    lo_div->noteTriangulations(acc_tot, Molecule::triangulationSeconds());
+    this->noteSeasonTriangulations(acc_tot);
+    tdistributor->setLevelTrialTime(lo_level,
+            accumulate(etg, etg + NTGTYPES, 0), seconds);
+    this->finishLevel(lo_level, winner_idx, advancing,
+            adv_bad0, advancing_best);
 }
 
 
@@ -245,9 +346,24 @@ void Liga_t::useStopFlag(int* flag)
 }
 
 
+void Liga_t::useIslands(IslandRing* ring)
+{
+    islands = ring;
+}
+
+
+void Liga_t::useChampionBoard(ChampionBoard* cb)
+{
+    board = cb;
+}
+
+
 bool Liga_t::finished() const
 {
-    bool isfinished = stopFlag() || solutionFound() || outOfTime();
+    bool isfinished = stopFlag() || solutionFound() || boardSolved() ||
+        outOfTime() ||
+        (rp->lastseason > 0 && season >= rp->lastseason) ||
+        (this->eventlog.get() && this->eventlog->exhausted());
     return isfinished;
 }
 
@@ -259,26 +375,38 @@ bool Liga_t::solutionFound() const
 }
 
 
+// Solution published on the champion board by another liga.  Islands keep
+// playing, because they pass the solution to the main island in the ring.
+
+bool Liga_t::boardSolved() const
+{
+    int natoms;
+    double cost;
+    if (!this->board || this->islands || !this->board->best(natoms, cost))
+    {
+        return false;
+    }
+    return natoms == rp->mol->getMaxAtomCount() && cost < rp->tolcost;
+}
+
+
+const Molecule* Liga_t::bestChamp() const
+{
+    return this->best_champ.get();
+}
+
+
 bool Liga_t::outOfTime() const
 {
-    return rp->outOfCPUTime() || rp->outOfWallTime();
+    return rp->outOfCPUTime() || rp->outOfWallTime() || season_overdue;
 }
 
 
 void Liga_t::printFramesTrace() const
 {
     if (!rp->trace)     return;
-    // needs clean up
     cout << "Trace - season level natoms cost id:\n";
-    list<TraceId_t>::iterator tii = this->best_champ->trace.begin();
-    for (; tii != this->best_champ->trace.end(); ++tii)
-    {
-        cout << "TR " << tii->season <<
-            ' ' << tii->level <<
-            ' ' << tii->mol_natoms <<
-            ' ' << tii->mol_norm_badness <<
-            ' ' << tii->mol_id << '\n';
-    }
+    this->best_champ->trace.write(cout);
     cout << endl;
 }
 
@@ -289,7 +417,14 @@ void Liga_t::printSummary() const
     if (solutionFound())    cout << "Solution found!!!\n\n";
     else if (rp->outOfCPUTime())   cout << "Exceeded maxcputime.\n\n";
     else if (rp->outOfWallTime())  cout << "Exceeded maxwalltime.\n\n";
+    else if (season_overdue)    cout << "No time left for another season.\n\n";
+    else if (boardSolved())     cout << "Solution found by another liga.\n\n";
     else if (stopFlag())    cout << "Simulation stopped, graceful death.\n\n";
+    // keep the final state unless the search is over
+    if (!solutionFound())   this->saveCheckpoint(true);
+    // make sure all structure and checkpoint files are written
+    this->writer->flush();
+    if (this->telemetry.get())  this->telemetry->flush();
     printFramesTrace();
     Counter::printRunStats();
 }
@@ -323,6 +458,364 @@ int Liga_t::divSize(int level)
 }
 
 
+Molecule& Liga_t::scratchTeam(const Molecule& src)
+{
+    if (this->scratch_team.get())   *this->scratch_team = src;
+    else    this->scratch_team.reset(src.copy());
+    return *this->scratch_team;
+}
+
+
+void Liga_t::fillLowerDivisions(PMOL first_team)
+{
+    SECTION_TIMER("Liga_t::fillLowerDivisions");
+    int toplevel = first_team->countAtoms();
+    if (!this->workers.get())
+    {
+        for (int lev = toplevel - 1; lev >= base_level; --lev)
+        {
+            PMOL parent_team = at(lev+1).back();
+            PMOL lower_team = parent_team->copy();
+            lower_team->Degenerate(1, Molecule::FAST);
+            cout << season << " L " << lower_team->countAtoms() << ' '
+                << lower_team->cost() << endl;
+            at(lev).push_back(lower_team);
+        }
+        return;
+    }
+    // With worker threads the lower levels are split in contiguous blocks
+    // and every worker degenerates a chain of teams for one block, which
+    // starts from a copy of the initial team.  Blocks have their own random
+    // streams, the teams are thus reproducible for a fixed number of threads.
+    if (toplevel <= base_level)     return;
+    size_t nfills = toplevel - base_level;
+    this->fill_teams.assign(nfills + 1, NULL);
+    this->fill_teams.back() = first_team;
+    this->fill_seed = randomStreamSeed();
+    this->fill_blocks = min(nfills, size_t(this->workers->size()));
+    WorkerPool::MethodJob<Liga_t>
+        degeneratejob(this, &Liga_t::degenerateFillChain);
+    try {
+        this->workers->execute(degeneratejob, this->fill_blocks);
+    }
+    catch (...) {
+        for (size_t task = 0; task != nfills; ++task)
+        {
+            delete this->fill_teams[task];
+        }
+        this->fill_teams.clear();
+        throw;
+    }
+    for (size_t task = nfills; task != 0; --task)
+    {
+        PMOL lower_team = this->fill_teams[task - 1];
+        cout << season << " L " << lower_team->countAtoms() << ' '
+            << lower_team->cost() << endl;
+        at(lower_team->countAtoms()).push_back(lower_team);
+    }
+    this->fill_teams.clear();
+}
+
+
+void Liga_t::degenerateFillChain(size_t block)
+{
+    SECTION_TIMER("Liga_t::degenerateFillChain");
+    RandomStreamScope randomstream(this->fill_seed, block);
+    size_t nfills = this->fill_teams.size() - 1;
+    size_t lo = block * nfills / this->fill_blocks;
+    size_t hi = (block + 1) * nfills / this->fill_blocks;
+    const Molecule* team = this->fill_teams.back();
+    int npop = team->countAtoms() - (base_level + hi - 1);
+    for (size_t task = hi; task != lo; --task, npop = 1)
+    {
+        auto_ptr<Molecule> lower_team(team->copy());
+        lower_team->Degenerate(npop, Molecule::FAST);
+        // evaluate the cost here rather than in the main thread
+        lower_team->cost();
+        team = this->fill_teams[task - 1] = lower_team.release();
+    }
+}
+
+
+void Liga_t::playLevelsParallel()
+{
+    SECTION_TIMER("Liga_t::playLevelsParallel");
+    if (!(size_t(base_level) + 1 < size()))     return;
+    // Winners of all lower divisions evolve concurrently, each match with
+    // its own random stream split from the season seed by level index.
+    // The outcome is thus independent of thread scheduling and of the
+    // number of threads.  With numa=true every worker plays a contiguous
+    // range of levels with its own spare teams.
+    size_t nmatches = size() - 1 - base_level;
+    this->level_matches.resize(nmatches);
+    unsigned long int seasonseed = randomStreamSeed();
+    // cost limits are shared by all matches, divisions do not change
+    // until the matches are resolved
+    const double* maxcosts = this->matchCostLimits(base_level);
+    // start with the top levels which take the longest to evolve
+    for (size_t task = 0; task != nmatches; ++task)
+    {
+        LevelMatch& lm = this->level_matches[task];
+        lm.lo_level = size() - 2 - task;
+        lm.seed = seasonseed;
+        lm.max_costs = maxcosts;
+        // workers evolve their winner copies in the spare teams
+        lm.spare = this->worker_pools.empty() ? this->team_pool.take() : NULL;
+        lm.advancing = NULL;
+    }
+    WorkerPool::MethodJob<Liga_t> evolvejob(this, &Liga_t::evolveLevelWinner);
+    try {
+        if (this->worker_pools.empty())
+        {
+            this->workers->execute(evolvejob, nmatches);
+        }
+        else    this->workers->executeBlocks(evolvejob, nmatches);
+    }
+    catch (...) {
+        for (size_t task = 0; task != nmatches; ++task)
+        {
+            LevelMatch& lm = this->level_matches[task];
+            this->recycleMatchTeam(task, lm.spare);
+            this->recycleMatchTeam(task, lm.advancing);
+            lm.spare = NULL;
+            lm.advancing = NULL;
+        }
+        throw;
+    }
+    // return spare teams of the matches that were not played
+    for (size_t task = 0; task != nmatches; ++task)
+    {
+        LevelMatch& lm = this->level_matches[task];
+        this->recycleMatchTeam(task, lm.spare);
+        lm.spare = NULL;
+    }
+    // Resolve the matches from the top level down.  A match only modifies
+    // its own and higher divisions so the winners of the lower pending
+    // matches stay at their original positions.
+    for (size_t task = 0; task != nmatches; ++task)
+    {
+        LevelMatch& lm = this->level_matches[task];
+        if (!lm.advancing)  continue;
+        iterator lo_div = begin() + lm.lo_level;
+        PMOL winner = lo_div->at(lm.winner_idx);
+        // decisions of the concurrent matches are noted in task order
+        this->noteEvent(EventLog::WINNER, lm.lo_level, lm.winner_idx);
+        this->noteEvent(EventLog::EVOLVE, lm.lo_level,
+                lm.advancing->countAtoms(), lm.advancing->cost());
+        lo_div->noteTriangulations(make_pair(lm.acc, lm.tot), lm.tsec);
+        this->noteSeasonTriangulations(make_pair(lm.acc, lm.tot));
+        tdistributor->setLevelTrialTime(lm.lo_level, lm.trials, lm.seconds);
+        PMOL retired = NULL;
+        if (lm.advancing->countAtoms() == int(lm.lo_level))
+        {
+            // winner did not advance, it plays itself just as in playLevel
+            // and its evolved copy is reused as the saved winner copy
+            PMOL winner_clone = lm.advancing;
+            lm.advancing = winner;
+            if (lo_div->full())     this->recycleMatchTeam(task, winner_clone);
+            else
+            {
+                *winner_clone = *winner;
+                lo_div->push_back(winner_clone);
+            }
+        }
+        // the original winner takes place of the saved winner copy
+        else if (!lo_div->full())   lo_div->push_back(winner);
+        else                        retired = winner;
+        int adv_level = lm.advancing->countAtoms();
+        bool exchanged = !this->worker_pools.empty() &&
+            this->levelWorker(adv_level) != this->levelWorker(lm.lo_level);
+        this->season_exchanges += exchanged;
+        this->finishLevel(lm.lo_level, lm.winner_idx, lm.advancing,
+                lm.adv_bad0, lm.advancing_best);
+        lm.advancing = NULL;
+        if (retired)
+        {
+            this->recycleMatchTeam(task, retired);
+            updateWorldChamp();
+        }
+    }
+}
+
+
+void Liga_t::evolveLevelWinner(size_t task)
+{
+    SECTION_TIMER("Liga_t::evolveLevelWinner");
+    LevelMatch& lm = this->level_matches[task];
+    iterator lo_div = begin() + lm.lo_level;
+    if (lo_div->empty() || stopFlag())  return;
+    RandomStreamScope randomstream(lm.seed, lm.lo_level);
+    lm.winner_idx = lo_div->find_winner();
+    PMOL winner = lo_div->at(lm.winner_idx);
+    if (winner->cost() >= rp->stopgame)    return;
+    lm.advancing_best = (winner == lo_div->best());
+    lm.adv_bad0 = winner->cost();
+    // evolve a copy, divisions are updated later in the main thread
+    auto_ptr<Molecule> advancing(lm.spare);
+    lm.spare = NULL;
+    if (!this->worker_pools.empty())
+    {
+        advancing.reset(worker_pools[WorkerPool::workerIndex()]->take());
+    }
+    if (advancing.get())    *advancing = *winner;
+    else                    advancing.reset(winner->copy());
+    const int* etg = lo_div->estimateTriangulations();
+    double t0 = Counter::PreciseWallTime();
+    const pair<int*,int*> acc_tot = advancing->Evolve(etg, lm.max_costs);
+    lm.seconds = Counter::PreciseWallTime() - t0;
+    lm.trials = accumulate(etg, etg + NTGTYPES, 0);
+    copy(acc_tot.first, acc_tot.first + NTGTYPES, lm.acc);
+    copy(acc_tot.second, acc_tot.second + NTGTYPES, lm.tot);
+    const double* tsec = Molecule::triangulationSeconds();
+    copy(tsec, tsec + NTGTYPES, lm.tsec);
+    lm.advancing = advancing.release();
+}
+
+
+// numa worker fills its own pool with enough spare teams for its levels
+
+void Liga_t::reserveWorkerPool(size_t task)
+{
+    size_t nmatches = size() - 1 - base_level;
+    size_t capacity = nmatches / this->worker_pools.size() + 2;
+    this->worker_pools[task]->reserve(*rp->mol, capacity);
+}
+
+
+void Liga_t::recycleMatchTeam(size_t task, PMOL team)
+{
+    if (this->worker_pools.empty())
+    {
+        this->team_pool.recycle(team);
+        return;
+    }
+    size_t nmatches = size() - 1 - base_level;
+    int worker = this->workers->blockWorker(task, nmatches);
+    this->worker_pools[worker]->recycle(team);
+}
+
+
+// worker of the match at level, the top level goes with the match below
+
+int Liga_t::levelWorker(size_t level) const
+{
+    size_t nmatches = size() - 1 - base_level;
+    size_t toplevel = size() - 2;
+    size_t task = toplevel - min(level, toplevel);
+    return this->workers->blockWorker(min(task, nmatches - 1), nmatches);
+}
+
+
+const double* Liga_t::matchCostLimits(size_t lo_level)
+{
+    if (!(rp->matchcutoff > 0.0))   return NULL;
+    // advancing team should not end worse than all teams of a full division
+    this->cost_limits.assign(size(), DOUBLE_MAX);
+    for (size_t level = lo_level + 1; level < size(); ++level)
+    {
+        const Division_t& dv = at(level);
+        if (!dv.full())     continue;
+        this->cost_limits[level] = rp->matchcutoff * dv.worstCost();
+    }
+    return &(this->cost_limits[0]);
+}
+
+
+void Liga_t::finishLevel(size_t lo_level, int winner_idx, PMOL advancing,
+        double adv_bad0, bool advancing_best)
+{
+    iterator lo_div = begin() + lo_level;
+    // keep set of modified molecul for tracing
+    set<PMOL> modified;
+    size_t hi_level = advancing->countAtoms();
+    if (lo_level != hi_level)   modified.insert(advancing);
+    iterator hi_div = begin() + hi_level;
+    // fill intermediate empty divisions, loop will stop at non-empty lo_div
+    for (iterator empty_div = hi_div; empty_div->empty(); --empty_div)
+    {
+        PMOL pioneer = this->team_pool.copy(*advancing);
+        pioneer->Degenerate(hi_div - empty_div);
+        this->noteEvent(EventLog::DEGENERATE, hi_level,
+                pioneer->countAtoms(), pioneer->cost());
+        empty_div->push_back(pioneer);
+        modified.insert(pioneer);
+    }
+    // find looser
+    int looser_idx = hi_div->find_looser();
+    this->noteEvent(EventLog::LOOSER, hi_level, looser_idx);
+    PMOL descending = hi_div->at(looser_idx);
+    double desc_bad0 = descending->cost();
+    if (!hi_div->full())
+    {
+        // save copy of descending looser
+        PMOL looser_clone = this->team_pool.copy(*descending);
+        hi_div->push_back(looser_clone);
+    }
+    // copy winner if he made a good advance
+    if (eps_gt(descending->cost(), advancing->cost()))
+    {
+        *descending = *advancing;
+    }
+    descending->Degenerate(hi_level - lo_level);
+    this->noteEvent(EventLog::DEGENERATE, hi_level,
+            descending->countAtoms(), descending->cost());
+    if (lo_level != hi_level)   modified.insert(descending);
+    // all set now so we can swap winner and looser
+    hi_div->at(looser_idx) = advancing;
+    lo_div->at(winner_idx) = descending;
+    hi_div->noteTeamChanged(looser_idx);
+    lo_div->noteTeamChanged(winner_idx);
+    // make sure the original best cluster is preserved if it was much much
+    // better than whatever left in the low division
+    const double spoil_factor = 10.0;
+    if ( advancing_best && eps_gt(lo_div->best()->cost(),
+                spoil_factor*adv_bad0) )
+    {
+        int lo_looser_idx = lo_div->find_looser();
+        this->noteEvent(EventLog::LOOSER, lo_level, lo_looser_idx);
+        PMOL lo_looser = lo_div->at(lo_looser_idx);
+        *lo_looser = *advancing;
+        for (size_t nlast = hi_level; nlast != lo_level;)
+            lo_looser->Pop(--nlast);
+        lo_div->noteTeamChanged(lo_looser_idx);
+        modified.insert(lo_looser);
+    }
+    if (verbose[AD])
+    {
+        cout << season;
+        cout << " A " <<
+            lo_level << ' ' << adv_bad0 << ' ' <<
+            hi_level << ' ' << advancing->cost() << "    ";
+        cout << " D " <<
+            hi_level << ' ' << desc_bad0 << ' ' <<
+            lo_level << ' ' << descending->cost() << '\n';
+    }
+    recordFramesTrace(modified, lo_level);
+    saveFramesTrace(modified, lo_level);
+    // duplicate structures would only waste division slots
+    bool advancing_full = advancing->full();
+    bool rejected = rp->uniqueteams &&
+        (rejectDuplicate(advancing) | rejectDuplicate(descending));
+    // update world champ so that the season can be cut short by stopFlag()
+    if (advancing_full || rejected)     updateWorldChamp();
+}
+
+
+// remove team from its division if another team there has the same
+// structure, return true when removed
+
+bool Liga_t::rejectDuplicate(PMOL team)
+{
+    Division_t& dv = this->at(team->countAtoms());
+    if (dv.find_duplicate(team) < 0)    return false;
+    Division_t::iterator ti = find(dv.begin(), dv.end(), team);
+    if (ti == dv.end())     return false;
+    dv.erase(ti);
+    this->team_pool.recycle(team);
+    return true;
+}
+
+
 void Liga_t::shareSeasonTrials()
 {
     // copy level costs and fill rate to trials distributor
@@ -335,6 +828,7 @@ void Liga_t::shareSeasonTrials()
     }
     // share it
     tdistributor->share(rp->seasontrials);
+    fitSeasonTrials();
     for (size_t level = base_level; level != size(); ++level)
     {
         Division_t* lvdiv = &(at(level));
@@ -344,6 +838,38 @@ void Liga_t::shareSeasonTrials()
 }
 
 
+// shrink the season when the last season takes longer than the time
+// left before the deadline
+
+void Liga_t::fitSeasonTrials()
+{
+    if (!rp->fitseasons)    return;
+    this->season_trialtime = tdistributor->estimateSeasonTime();
+    if (!(this->walltime_per_trialtime > 0.0))  return;
+    double budget = rp->wallTimeLeft() / this->walltime_per_trialtime;
+    if (this->cputime_per_trialtime > 0.0)
+    {
+        budget = min(budget, rp->cpuTimeLeft() / this->cputime_per_trialtime);
+    }
+    if (budget >= this->season_trialtime)   return;
+    // the game ends after this season when it gets no trials
+    bool trialsleft = tdistributor->fitSeasonTime(budget);
+    this->season_overdue = !(budget > 0.0 && trialsleft);
+    // fixed costs dominate in short seasons, keep the measured rates
+    this->season_trialtime = 0.0;
+}
+
+
+void Liga_t::measureSeasonTime()
+{
+    if (!rp->fitseasons || !(this->season_trialtime > 0.0))    return;
+    double wallsec = Counter::PreciseWallTime() - season_walltime;
+    double cpusec = Counter::CPUTime() - season_cputime;
+    this->walltime_per_trialtime = wallsec / this->season_trialtime;
+    this->cputime_per_trialtime = cpusec / this->season_trialtime;
+}
+
+
 Molecule* Liga_t::updateWorldChamp()
 {
     reverse_iterator ii;
@@ -361,9 +887,21 @@ void Liga_t::updateBestChamp()
         eps_lt(this->world_champ->cost(), this->best_champ->cost());
     if (hasnewchamp)
     {
+        if (rp->champrelax)
+        {
+            this->world_champ->RelaxAll();
+            at(world_champ->countAtoms()).noteTeamChanged(world_champ);
+        }
         if (this->season > 0)  this->injectOverlapMinimization();
-        this->best_champ.reset(this->world_champ->copy());
+        // reuse the previous best champ when there is one
+        if (this->best_champ.get())     *this->best_champ = *world_champ;
+        else    this->best_champ.reset(this->world_champ->copy());
         this->printed_best_champ = false;
+        if (this->board)
+        {
+            this->board->publish(this->best_champ->countAtoms(),
+                    this->best_champ->cost());
+        }
     }
 }
 
@@ -414,10 +952,31 @@ void Liga_t::printTrialShares() const
 }
 
 
+// bytes held by the teams in every division and their total
+
+void Liga_t::printMemoryUsage() const
+{
+    if (!verbose[MU])   return;
+    double total = 0.0;
+    for (size_t level = base_level; level < size(); ++level)
+    {
+        const Division_t& lvdiv = at(level);
+        double bytes = 0.0;
+        Division_t::const_iterator mi = lvdiv.begin();
+        for (; mi != lvdiv.end(); ++mi)     bytes += (*mi)->memoryUsage();
+        cout << season << " MU " << level << ' ' << lvdiv.size() <<
+            ' ' << bytes << '\n';
+        total += bytes;
+    }
+    cout << season << " MU total " << total << '\n';
+}
+
+
 void Liga_t::saveOutStru()
 {
-    static int savecnt = 0;
-    static valarray<double> bestMcost(DOUBLE_MAX, size());
+    SECTION_TIMER("Liga_t::saveOutStru");
+    int& savecnt = this->outstru_savecnt;
+    vector<double>& bestMcost = this->outstru_costs;
     ++savecnt;
     bool dontsave = rp->outstru.empty() || this->empty() ||
         (!this->finished() && (rp->saverate == 0 || savecnt < rp->saverate));
@@ -437,12 +996,20 @@ void Liga_t::saveOutStru()
         size_t level = level_champ->countAtoms();
         // do not save empty structure
         if (level == 0) break;
+        // relax a copy, the output must not change the teams
+        const Molecule* saved_champ = level_champ;
+        if (rp->champrelax)
+        {
+            Molecule& relaxed = this->scratchTeam(*level_champ);
+            relaxed.RelaxAll();
+            saved_champ = &relaxed;
+        }
         // save only if there is clear improvement
-        bool improved = eps_lt(level_champ->cost(), bestMcost[level]);
+        bool improved = eps_lt(saved_champ->cost(), bestMcost[level]);
         if (!improved)  continue;
         // something to save here
         savecnt = 0;
-        bestMcost[level] = level_champ->cost();
+        bestMcost[level] = saved_champ->cost();
         // construct file name
         ostringstream fname;
         fname << rp->outstru;
@@ -450,7 +1017,7 @@ void Liga_t::saveOutStru()
         {
             fname << ".L" << level;
         }
-        level_champ->WriteFile(fname.str().c_str());
+        this->writer->write(fname.str(), *saved_champ);
     }
     this->saveScoopedStructures();
 }
@@ -458,12 +1025,8 @@ void Liga_t::saveOutStru()
 
 void Liga_t::saveFrames()
 {
-    static struct {
-        int cnt;
-        PMOL champ;
-        double level;
-        double cost;
-    } saved = {0, NULL, 0, DOUBLE_MAX};
+    SECTION_TIMER("Liga_t::saveFrames");
+    SavedFrame& saved = this->saved_frame;
     bool dontsave = rp->frames.empty() || rp->framesrate == 0 ||
         (++saved.cnt < rp->framesrate && !finished()) || empty() ||
         (world_champ == saved.champ &&
@@ -479,7 +1042,7 @@ void Liga_t::saveFrames()
     ostringstream oss;
     oss << rp->frames << '.' << season;
     string fname = oss.str();
-    world_champ->WriteFile(fname.c_str());
+    this->writer->write(fname, *world_champ);
 }
 
 
@@ -508,9 +1071,10 @@ void Liga_t::recordFramesTrace(set<PMOL>& modified, size_t lo_level)
 
 void Liga_t::saveFramesTrace(set<PMOL>& modified, size_t lo_level)
 {
+    SECTION_TIMER("Liga_t::saveFramesTrace");
     bool dontsave = rp->frames.empty();
     if (dontsave)    return;
-    static queue<TraceId_t> qtrace(rp->framestrace);
+    queue<TraceId_t>& qtrace = this->frames_trace;
     while (!qtrace.empty())
     {
         TraceId_t tid = qtrace.front();
@@ -529,15 +1093,208 @@ void Liga_t::saveFramesTrace(set<PMOL>& modified, size_t lo_level)
         ostringstream oss;
         oss << rp->frames << "." << tid.season << '.' << tno;
         string fname = oss.str();
-        traced->WriteFile(fname.c_str());
+        this->writer->write(fname, *traced);
     }
 }
 
 
+void Liga_t::saveTimers()
+{
+    if (!this->timersfid.get())     return;
+    SectionTimer::printSeason(*this->timersfid, this->season);
+}
+
+
+void Liga_t::noteSeasonTriangulations(const pair<int*,int*>& acc_tot)
+{
+    for (int i = 0; i < NTGTYPES; ++i)
+    {
+        season_acc[i] += acc_tot.first[i];
+        season_tot[i] += acc_tot.second[i];
+    }
+}
+
+
+void Liga_t::saveTelemetry()
+{
+    if (!this->telemetry.get())     return;
+    SECTION_TIMER("Liga_t::saveTelemetry");
+    // one JSON object per season, written by the background sink
+    static const char* tgnames[NTGTYPES] = {"linear", "planar", "spatial"};
+    double seconds = Counter::PreciseWallTime() - season_walltime;
+    long long trials = accumulate(season_tot, season_tot + NTGTYPES, 0LL);
+    ostringstream rec;
+    rec << setprecision(numeric_limits<double>::digits10);
+    rec << "{\"season\": " << season <<
+        ", \"cputime\": " << Counter::CPUTime() <<
+        ", \"seconds\": " << seconds <<
+        ", \"trials\": " << trials <<
+        ", \"trialrate\": " << (seconds > 0.0 ? trials / seconds : 0.0);
+    if (!this->worker_pools.empty())
+    {
+        rec << ", \"exchanges\": " << season_exchanges;
+    }
+    rec << ", \"acceptance\": {";
+    for (int i = 0; i < NTGTYPES; ++i)
+    {
+        double ratio = season_tot[i] ?
+            1.0 * season_acc[i] / season_tot[i] : 0.0;
+        rec << (i ? ", " : "") << '"' << tgnames[i] << "\": " << ratio;
+    }
+    rec << '}';
+    const Molecule* champs[2] = {this->world_champ, this->best_champ.get()};
+    const char* champnames[2] = {"worldchamp", "bestchamp"};
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!champs[i])     continue;
+        rec << ", \"" << champnames[i] << "\": {\"natoms\": " <<
+            champs[i]->countAtoms() << ", \"cost\": " <<
+            champs[i]->cost() << '}';
+    }
+    int bnatoms;
+    double bcost;
+    if (this->board && this->board->best(bnatoms, bcost))
+    {
+        rec << ", \"board\": {\"natoms\": " << bnatoms <<
+            ", \"cost\": " << bcost <<
+            ", \"epoch\": " << this->board->epoch() << '}';
+    }
+    rec << '}';
+    this->telemetry->send(rec.str());
+}
+
+// Local helpers for checkpoint files
+
+namespace {
+
+const string checkpoint_signature = "LIGA-CHECKPOINT-2";
+
+// teams keep their pair costs and distance assignments, a restarted
+// team thus continues exactly as the saved one
+Molecule* read_team(istream& in, const Molecule& base)
+{
+    auto_ptr<Molecule> team(base.copy());
+    if (!team->readCheckpoint(in))  return NULL;
+    return team.release();
+}
+
+}   // namespace
+
+
+void Liga_t::saveCheckpoint(bool force) const
+{
+    SECTION_TIMER("Liga_t::saveCheckpoint");
+    bool dontsave = rp->checkpoint.empty() || (!force &&
+        Counter::WallTime() < this->checkpoint_walltime + rp->checkpointrate);
+    if (dontsave)   return;
+    ostringstream out;
+    this->writeCheckpoint(out);
+    // the file is written in the background
+    this->writer->write(rp->checkpoint, out.str());
+    this->checkpoint_walltime = Counter::WallTime();
+}
+
+
+void Liga_t::writeCheckpoint(ostream& out) const
+{
+    write_binary(out, checkpoint_signature);
+    write_binary(out, this->season);
+    write_binary(out, NS_LIGA::randomState());
+    write_binary(out, size());
+    this->tdistributor->writeCheckpoint(out);
+    for (const_iterator dv = begin(); dv != end(); ++dv)
+    {
+        dv->writeCheckpoint(out);
+        write_binary(out, dv->size());
+        Division_t::const_iterator mii;
+        for (mii = dv->begin(); mii != dv->end(); ++mii)
+        {
+            (*mii)->writeCheckpoint(out);
+        }
+    }
+    bool hasbest = this->best_champ.get();
+    write_binary(out, hasbest);
+    if (hasbest)    this->best_champ->writeCheckpoint(out);
+}
+
+
+void Liga_t::noteEvent(EventLog::EventType tp, size_t level, int value,
+        double cost)
+{
+    if (this->eventlog.get())   this->eventlog->note(tp, level, value, cost);
+}
+
+
+void Liga_t::loadCheckpoint(const string& filename)
+{
+    ifstream in(filename.c_str(), ios_base::in | ios_base::binary);
+    if (!in)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    this->readCheckpoint(in, filename);
+    this->printed_best_champ = false;
+    cout << "Restarted from " << filename << " at season " <<
+        this->season << endl;
+}
+
+
+void Liga_t::readCheckpoint(istream& in, const string& filename)
+{
+    string signature;
+    int ckseason;
+    string rngstate;
+    size_t ndivisions;
+    bool valid = read_binary(in, signature) &&
+        signature == checkpoint_signature &&
+        read_binary(in, ckseason) &&
+        read_binary(in, rngstate) &&
+        rngstate.size() == NS_LIGA::randomState().size() &&
+        read_binary(in, ndivisions) && ndivisions == size() &&
+        this->tdistributor->readCheckpoint(in);
+    // teams are read into copies of the base level team, which has
+    // the same atom storage
+    auto_ptr<Molecule> base(at(base_level).back()->copy());
+    for (iterator dv = begin(); valid && dv != end(); ++dv)
+    {
+        size_t nteams;
+        valid = dv->readCheckpoint(in) && read_binary(in, nteams) &&
+            nteams <= dv->fullsize();
+        for (Division_t::iterator mii = dv->begin(); mii != dv->end(); ++mii)
+        {
+            this->team_pool.recycle(*mii);
+        }
+        dv->clear();
+        for (size_t i = 0; valid && i != nteams; ++i)
+        {
+            PMOL team = read_team(in, *base);
+            valid = team && team->countAtoms() == int(dv->level());
+            if (team)   dv->push_back(team);
+        }
+    }
+    bool hasbest;
+    valid = valid && read_binary(in, hasbest);
+    this->best_champ.reset(valid && hasbest ? read_team(in, *base) : NULL);
+    valid = valid && (!hasbest || this->best_champ.get()) &&
+        in.peek() == char_traits<char>::eof();
+    if (!valid)
+    {
+        ostringstream emsg;
+        emsg << "Invalid or incompatible checkpoint file '" <<
+            filename << "'.";
+        throw IOError(emsg.str());
+    }
+    NS_LIGA::setRandomState(rngstate);
+    this->season = ckseason;
+}
+
+
 void Liga_t::prepareScooping()
 {
     if (rp->scoopfunction.empty())  return;
-    rp->importMapFunction();
+    this->scooper.reset(new ScoopExecutor(rp->scoopfunction, rp->ncpu));
     cout << "Team scooping will use " << rp->ncpu << " processors.\n";
     cout << "Executing scoopfunction check run.\n" << endl;
     rp->checkScoopFunction(*(rp->mol));
@@ -546,6 +1303,7 @@ void Liga_t::prepareScooping()
 
 void Liga_t::updateScoopedStructures()
 {
+    SECTION_TIMER("Liga_t::updateScoopedStructures");
     namespace python = boost::python;
     bool dontscoop = rp->scoopfunction.empty() ||
         (this->empty() || this->back().empty()) ||
@@ -557,22 +1315,48 @@ void Liga_t::updateScoopedStructures()
     {
         this->mscoop_cost_stru.reset(new python::list());
     }
-    // collect competitors from the top level
-    python::list toplevelteams;
+    // results of a background evaluation are merged at the next scooping
+    python::list res = this->scooper->collect();
+    // collect competitors from the top level, their overlap
+    // is minimized concurrently when there are worker threads
     const Division_t& topdivision = this->back();
     Division_t::const_iterator tt;
     for (tt = topdivision.begin(); tt != topdivision.end(); ++tt)
     {
-        auto_ptr<Molecule> ttcp((*tt)->copy());
-        ttcp->DownhillOverlapMinimization();
-        python::object stru = ttcp->convertToDiffPyStructure();
-        toplevelteams.append(stru);
+        // scoop only the first of several teams with the same structure
+        int dupidx = rp->uniqueteams ? topdivision.find_duplicate(*tt) : -1;
+        if (0 <= dupidx && dupidx < tt - topdivision.begin())   continue;
+        this->scooped_teams.push_back(this->team_pool.copy(**tt));
+    }
+    try {
+        size_t nteams = this->scooped_teams.size();
+        WorkerPool::MethodJob<Liga_t>
+            minimizejob(this, &Liga_t::minimizeTeamOverlap);
+        if (this->workers.get())
+        {
+            this->workers->execute(minimizejob, nteams);
+        }
+        for (size_t i = 0; !this->workers.get() && i != nteams; ++i)
+        {
+            this->minimizeTeamOverlap(i);
+        }
+        this->scooper->submit(this->scooped_teams);
+    }
+    catch (...) {
+        this->clearScoopedTeams();
+        throw;
+    }
+    this->clearScoopedTeams();
+    if (!this->scooper->isAsync() || this->finished())
+    {
+        res.extend(this->scooper->collect());
     }
-    python::object mapfnc = rp->importMapFunction();
-    python::object scfnc = rp->importScoopFunction();
-    python::object res = mapfnc(scfnc, toplevelteams);
+    if (python::len(res) == 0)  return;
     mscoop_cost_stru->extend(res);
-    mscoop_cost_stru->sort();
+    // sort by cost only, structures are not comparable in Python 3
+    python::dict sortkw;
+    sortkw["key"] = python::import("operator").attr("itemgetter")(0);
+    mscoop_cost_stru->attr("sort")(*python::tuple(), **sortkw);
     // filter duplicate structures that have very close cost difference.
     int last_idx = 0;
     double last_cost = -DOUBLE_MAX;
@@ -602,6 +1386,23 @@ void Liga_t::updateScoopedStructures()
 }
 
 
+void Liga_t::minimizeTeamOverlap(size_t task)
+{
+    this->scooped_teams[task]->DownhillOverlapMinimization();
+}
+
+
+void Liga_t::clearScoopedTeams()
+{
+    vector<PMOL>::iterator ti;
+    for (ti = scooped_teams.begin(); ti != scooped_teams.end(); ++ti)
+    {
+        this->team_pool.recycle(*ti);
+    }
+    this->scooped_teams.clear();
+}
+
+
 void Liga_t::printScoopedStructures() const
 {
     namespace python = boost::python;
@@ -652,32 +1453,78 @@ void Liga_t::injectBestScoop()
     namespace python = boost::python;
     if (python::len(*mscoop_cost_stru) == 0)  return;
     python::object stru = (*mscoop_cost_stru)[0][1];
-    auto_ptr<Molecule> bestscoop(this->back().back()->copy());
-    bestscoop->setFromDiffPyStructure(stru);
-    this->injectCompetitor(bestscoop.get());
+    Molecule& bestscoop = this->scratchTeam(*this->back().back());
+    bestscoop.setFromDiffPyStructure(stru);
+    this->injectCompetitor(&bestscoop);
 }
 
 
 void Liga_t::injectOverlapMinimization()
 {
     world_champ->DownhillOverlapMinimization();
+    at(world_champ->countAtoms()).noteTeamChanged(world_champ);
     this->injectCompetitor(world_champ);
 }
 
 
 void Liga_t::injectCompetitor(const Molecule* mol)
 {
-    auto_ptr<Molecule> injector(mol->copy());
-    while (injector->countAtoms() > base_level + 1)
+    // mol may be the scratch team itself
+    Molecule& injector = this->scratchTeam(*mol);
+    while (injector.countAtoms() > base_level + 1)
     {
-        injector->Degenerate(1);
-        int level = injector->countAtoms();
+        injector.Degenerate(1);
+        int level = injector.countAtoms();
+        this->noteEvent(EventLog::DEGENERATE, level + 1,
+                level, injector.cost());
         Division_t& dv = this->at(level);
         if (dv.size() < 2)  continue;
+        if (rp->uniqueteams && dv.find_duplicate(&injector) >= 0)  continue;
         int tgt_idx = dv.find_looser();
+        this->noteEvent(EventLog::LOOSER, level, tgt_idx);
         PMOL tgt_mol = dv[tgt_idx];
-        *tgt_mol = *injector;
+        *tgt_mol = injector;
+        dv.noteTeamChanged(tgt_idx);
+    }
+}
+
+
+void Liga_t::exchangeMigrants()
+{
+    SECTION_TIMER("Liga_t::exchangeMigrants");
+    if (!this->islands)     return;
+    // take in champions of the preceding island
+    string msg;
+    while (this->islands->receive(msg))     this->injectMigrant(msg);
+    PMOL champ = updateWorldChamp();
+    // pass on a solution immediately so that every island can finish
+    bool solved = solutionFound();
+    bool migrate = solved || (this->season % rp->migrationrate == 0);
+    if (!champ || !migrate)     return;
+    this->islands->send(migrantMessage(*champ, solved));
+}
+
+
+void Liga_t::injectMigrant(const string& msg)
+{
+    // base level molecule holds just the fixed atoms
+    Molecule& migrant = this->scratchTeam(*this->at(base_level).back());
+    bool solved = readMigrant(msg, migrant);
+    if (!solved)
+    {
+        this->injectCompetitor(&migrant);
+        return;
+    }
+    // solution found on another island replaces the worst team
+    Division_t& dv = this->at(migrant.countAtoms());
+    if (rp->uniqueteams && dv.find_duplicate(&migrant) >= 0)   return;
+    if (dv.full())
+    {
+        int tgt_idx = dv.find_looser();
+        *dv[tgt_idx] = migrant;
+        dv.noteTeamChanged(tgt_idx);
     }
+    else    dv.push_back(this->team_pool.copy(migrant));
 }
 
 
@@ -9,7 +9,9 @@
 #ifndef LIGA_T_HPP_INCLUDED
 #define LIGA_T_HPP_INCLUDED
 
+#include <fstream>
 #include <memory>
+#include <queue>
 #include <set>
 #include <vector>
 #include <string>
@@ -17,17 +19,25 @@
 #include <boost/shared_ptr.hpp>
 
 #include "Division_t.hpp"
+#include "MoleculePool.hpp"
 #include "RunPar_t.hpp"
 #include "Counter.hpp"
+#include "EventLog.hpp"
 #include "LigaUtils.hpp"
 #include "TrialDistributor.hpp"
+#include "WorkerPool.hpp"
+#include "IslandRing.hpp"
+#include "ChampionBoard.hpp"
+#include "ScoopExecutor.hpp"
+#include "StructureWriter.hpp"
+#include "TelemetrySink.hpp"
 
 namespace NS_LIGA_VERBOSE_FLAG {
 
-enum VerboseFlag { AD, WC, BC, AV, TS, SC, ALL, VERBOSE_SIZE };
+enum VerboseFlag { AD, WC, BC, AV, TS, SC, MU, ALL, VERBOSE_SIZE };
 
 const std::string verbose_flags_array[VERBOSE_SIZE] = {
-    "ad", "wc", "bc", "av", "ts", "sc", "all" };
+    "ad", "wc", "bc", "av", "ts", "sc", "mu", "all" };
 
 }   // namespace NS_LIGA_VERBOSE_FLAG
 
@@ -48,6 +58,12 @@ class Liga_t : public std::vector<Division_t>
                 VerboseFlag flag, bool value=true);
         static void setVerboseVector(std::vector<bool>& vb,
                 std::string flag, bool value=true);
+        // text message of the free atoms of a champion for the next island
+        static std::string migrantMessage(const Molecule& champ,
+                bool solved);
+        // add free atoms of a migrant message to mol and return its
+        // solved flag, throw runtime_error for a malformed message
+        static bool readMigrant(const std::string& msg, Molecule& mol);
 
         // instance data
         int season;
@@ -61,8 +77,12 @@ class Liga_t : public std::vector<Division_t>
         void playLevel(size_t lo_level);
         bool stopFlag() const;
         void useStopFlag(int* flag);
+        void useIslands(IslandRing* ring);
+        void useChampionBoard(ChampionBoard* cb);
         bool finished() const;
         bool solutionFound() const;
+        bool boardSolved() const;
+        const Molecule* bestChamp() const;
         bool outOfTime() const;
         void printFramesTrace() const;
         void printSummary() const;
@@ -73,6 +93,31 @@ class Liga_t : public std::vector<Division_t>
 
         // Types
         typedef Molecule* PMOL;
+        // division winner evolved concurrently in playLevelsParallel
+        struct LevelMatch
+        {
+            size_t lo_level;
+            unsigned long int seed;
+            int winner_idx;
+            PMOL spare;
+            PMOL advancing;
+            double adv_bad0;
+            bool advancing_best;
+            int acc[NTGTYPES];
+            int tot[NTGTYPES];
+            double tsec[NTGTYPES];
+            int trials;
+            double seconds;
+            const double* max_costs;
+        };
+        // world champion saved in the last frame
+        struct SavedFrame
+        {
+            int cnt;
+            PMOL champ;
+            double level;
+            double cost;
+        };
         struct epsDoubleCompare : public std::binary_function<double,double,bool>
         {
             bool operator()(const double& x0, const double& x1) const
@@ -84,6 +129,8 @@ class Liga_t : public std::vector<Division_t>
         // Data members
         RunPar_t* rp;
         int* stopflag;
+        IslandRing* islands;
+        ChampionBoard* board;
         int base_level;
         PMOL world_champ;
         std::auto_ptr<Molecule> best_champ;
@@ -93,27 +140,98 @@ class Liga_t : public std::vector<Division_t>
         std::auto_ptr<TrialDistributor> tdistributor;
         std::vector<bool> verbose;
         std::auto_ptr<boost::python::list> mscoop_cost_stru;
+        std::auto_ptr<ScoopExecutor> scooper;
+        std::auto_ptr<WorkerPool> workers;
+        std::vector<LevelMatch> level_matches;
+        // teams of the lower divisions derived concurrently from the
+        // initial team, which is the last entry, in chains of fill_blocks
+        // contiguous level ranges
+        std::vector<PMOL> fill_teams;
+        unsigned long int fill_seed;
+        size_t fill_blocks;
+        std::vector<double> cost_limits;
+        std::vector<PMOL> scooped_teams;
+        // spare teams recycled for new team copies and the scratch
+        // team for injected competitors
+        MoleculePool team_pool;
+        // spare teams of the match workers with numa=true, allocated
+        // by the worker that plays the levels of the pool
+        std::vector< boost::shared_ptr<MoleculePool> > worker_pools;
+        // teams advanced across levels of different workers
+        int season_exchanges;
+        std::auto_ptr<Molecule> scratch_team;
+        std::auto_ptr<StructureWriter> writer;
+        std::auto_ptr<std::ofstream> timersfid;
+        std::auto_ptr<TelemetrySink> telemetry;
+        // match decisions recorded or compared in replay
+        std::auto_ptr<EventLog> eventlog;
+        // triangulations and start time of the current season
+        long long season_acc[NTGTYPES];
+        long long season_tot[NTGTYPES];
+        double season_walltime;
+        // with fitseasons the CPU time at the season start, estimated
+        // trial time of the season, flag for a season without time left
+        // and measured season durations per second of estimated trial time
+        double season_cputime;
+        double season_trialtime;
+        bool season_overdue;
+        double walltime_per_trialtime;
+        double cputime_per_trialtime;
+        mutable double checkpoint_walltime;
+        // state of output saves, private to each liga
+        int outstru_savecnt;
+        std::vector<double> outstru_costs;
+        SavedFrame saved_frame;
+        std::queue<TraceId_t> frames_trace;
 
         // Private methods
         int divSize(int level);
+        void fillLowerDivisions(PMOL first_team);
+        void degenerateFillChain(size_t block);
+        Molecule& scratchTeam(const Molecule& src);
+        void playLevelsParallel();
+        void evolveLevelWinner(size_t task);
+        void reserveWorkerPool(size_t task);
+        void recycleMatchTeam(size_t task, PMOL team);
+        int levelWorker(size_t level) const;
+        const double* matchCostLimits(size_t lo_level);
+        void finishLevel(size_t lo_level, int winner_idx, PMOL advancing,
+                double adv_bad0, bool advancing_best);
+        bool rejectDuplicate(PMOL team);
         void shareSeasonTrials();
+        void fitSeasonTrials();
+        void measureSeasonTime();
         PMOL updateWorldChamp();
         void updateBestChamp();
         void printWorldChamp() const;
         void printBestChamp() const;
         void printLevelAverages() const;
         void printTrialShares() const;
+        void printMemoryUsage() const;
         void saveOutStru();
         void saveFrames();
+        void saveTimers();
+        void noteSeasonTriangulations(const std::pair<int*,int*>& acc_tot);
+        void saveTelemetry();
+        void saveCheckpoint(bool force=false) const;
+        void writeCheckpoint(std::ostream& out) const;
+        void readCheckpoint(std::istream& in, const std::string& filename);
+        void noteEvent(EventLog::EventType tp, size_t level, int value,
+                double cost=0.0);
+        void loadCheckpoint(const std::string& filename);
         void recordFramesTrace(std::set<PMOL>& modified, size_t lo_level);
         void saveFramesTrace(std::set<PMOL>& modified, size_t lo_level);
         void prepareScooping();
         void updateScoopedStructures();
+        void minimizeTeamOverlap(size_t task);
+        void clearScoopedTeams();
         void printScoopedStructures() const;
         void saveScoopedStructures() const;
         void injectBestScoop();
         void injectOverlapMinimization();
         void injectCompetitor(const Molecule*);
+        void exchangeMigrants();
+        void injectMigrant(const std::string& msg);
 };
 
 #endif  // LIGA_T_HPP_INCLUDED
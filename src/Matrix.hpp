@@ -15,25 +15,39 @@
 * template class Matrix
 *
 * Comments: optimized from original vector of vectors
+*     Copies share the element storage until one of them is written to.
 *
 ***********************************************************************/
 
 #ifndef MATRIX_HPP_INCLUDED
 #define MATRIX_HPP_INCLUDED
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
+#include <boost/shared_array.hpp>
 
 template <class T> class Matrix
 {
     private:
 
         // Data Methods
+        boost::shared_array<T> mstorage;
         T* mdata;
         size_t mrows;
         size_t mcols;
         size_t msize;
 
+        // make private copy of the storage shared with other matrices
+        void unshare()
+        {
+            if (mstorage.unique() || !mdata)    return;
+            T* pcopy = new T[msize];
+            std::copy(mdata, mdata + msize, pcopy);
+            mstorage.reset(pcopy);
+            mdata = pcopy;
+        }
+
     public:
 
         // Constructors
@@ -42,35 +56,28 @@ template <class T> class Matrix
         { }
 
         Matrix(const Matrix& src) :
-            mdata(new T[src.mrows*src.mcols]),
+            mstorage(src.mstorage), mdata(src.mdata),
             mrows(src.mrows), mcols(src.mcols), msize(src.msize)
-        {
-            std::copy(src.mdata, src.mdata + src.msize, mdata);
-        }
+        { }
 
         Matrix(size_t m, size_t n) :
             mrows(m), mcols(n), msize(mrows*mcols)
         {
             mdata = new T[mrows*mcols];
+            mstorage.reset(mdata);
             std::fill(mdata, mdata + msize, T(0));
         }
 
         // Destructor
         virtual ~Matrix()
-        {
-            delete[] mdata;
-        }
+        { }
 
         // Methods
         Matrix& operator=(const Matrix& src)
         {
             if (this == &src)   return *this;
-            if (msize != src.msize)
-            {
-                delete[] mdata;
-                mdata = new T[src.msize];
-            }
-            std::copy(src.mdata, src.mdata + src.msize, mdata);
+            mstorage = src.mstorage;
+            mdata = src.mdata;
             mrows = src.mrows;
             mcols = src.mcols;
             msize = src.msize;
@@ -79,6 +86,11 @@ template <class T> class Matrix
 
         void fill(const T& value)
         {
+            if (!mstorage.unique() && mdata)
+            {
+                mdata = new T[msize];
+                mstorage.reset(mdata);
+            }
             std::fill_n(mdata, msize, value);
         }
 
@@ -95,10 +107,10 @@ template <class T> class Matrix
             {
                 for (size_t j = 0; j != std::min(n, mcols); ++j)
                 {
-                    resized[offset+j] = (*this)(i, j);
+                    resized[offset+j] = mdata[i*mcols + j];
                 }
             }
-            delete[] mdata;
+            mstorage.reset(resized);
             mdata = resized;
             mrows = m;
             mcols = n;
@@ -112,7 +124,7 @@ template <class T> class Matrix
 
         void clear()
         {
-            delete[] mdata;
+            mstorage.reset();
             mdata = NULL;
             mrows = mcols = msize = 0;
         }
@@ -142,7 +154,14 @@ template <class T> class Matrix
             return mcols;
         }
 
-        inline T& operator()(size_t i, size_t j) const
+        // element access, detaches storage shared with other copies
+        inline T& operator()(size_t i, size_t j)
+        {
+            if (!mstorage.unique())     unshare();
+            return *(mdata + i*mcols + j);
+        }
+
+        inline const T& operator()(size_t i, size_t j) const
         {
             return *(mdata + i*mcols + j);
         }
@@ -204,48 +223,175 @@ template <class T> class Matrix
         }
 };
 
-template <class T> class SymmetricMatrix : public Matrix<T>
+// Symmetric matrix stored as a packed lower triangle, where row i holds
+// the elements (i,0) ... (i,i) at offset i*(i+1)/2.  Resizing keeps the
+// offsets of existing rows.  Copies share the element storage until one
+// of them is written to.
+
+template <class T> class SymmetricMatrix
 {
+    private:
+
+        // Data Methods
+        boost::shared_array<T> mstorage;
+        T* mdata;
+        size_t mrows;
+        size_t msize;
+
+        static size_t packedSize(size_t n)
+        {
+            return n * (n + 1) / 2;
+        }
+
+        static size_t packedIndex(size_t i, size_t j)
+        {
+            return (i < j) ? (j * (j + 1) / 2 + i) : (i * (i + 1) / 2 + j);
+        }
+
+        // make private copy of the storage shared with other matrices
+        void unshare()
+        {
+            if (mstorage.unique() || !mdata)    return;
+            T* pcopy = new T[msize];
+            std::copy(mdata, mdata + msize, pcopy);
+            mstorage.reset(pcopy);
+            mdata = pcopy;
+        }
+
     public:
 
         // Constructors
 
-        SymmetricMatrix() : Matrix<T>() { }
-        SymmetricMatrix(const Matrix<T>& src) : Matrix<T>(src) { }
-        SymmetricMatrix(size_t m) : Matrix<T>(m, m) { }
+        SymmetricMatrix() : mdata(NULL), mrows(0), msize(0)
+        { }
 
-        // Overloaded methods
+        SymmetricMatrix(const SymmetricMatrix& src) :
+            mstorage(src.mstorage), mdata(src.mdata),
+            mrows(src.mrows), msize(src.msize)
+        { }
+
+        SymmetricMatrix(size_t m) : mrows(m), msize(packedSize(m))
+        {
+            mdata = new T[msize];
+            mstorage.reset(mdata);
+            std::fill(mdata, mdata + msize, T(0));
+        }
+
+        // Methods
 
         SymmetricMatrix& operator=(const SymmetricMatrix& src)
         {
-            this->Matrix<T>::operator=(src);
+            if (this == &src)   return *this;
+            mstorage = src.mstorage;
+            mdata = src.mdata;
+            mrows = src.mrows;
+            msize = src.msize;
             return *this;
         }
 
-        inline T& operator()(size_t i, size_t j) const
+        void fill(const T& value)
+        {
+            if (!mstorage.unique() && mdata)
+            {
+                mdata = new T[msize];
+                mstorage.reset(mdata);
+            }
+            std::fill_n(mdata, msize, value);
+        }
+
+        // set all elements (i,j) and (j,i) of row i to value
+        void fillRow(size_t i, const T& value)
         {
-            T& rv = (i < j) ?
-                Matrix<T>::operator()(i, j) :
-                Matrix<T>::operator()(j, i);
-            return rv;
+            T* pt = rowBegin(i);
+            std::fill(pt, pt + i + 1, value);
+            // continue down column i from the diagonal element
+            pt += i;
+            for (size_t j = i + 1; j < mrows; ++j)
+            {
+                pt += j;
+                *pt = value;
+            }
         }
 
-        virtual std::vector<T> rowVector(size_t i) const
+        void resize(size_t m, const T& value)
         {
-            std::vector<T> rv(Matrix<T>::columns());
-            for (size_t j = 0; j != Matrix<T>::columns(); ++j)
+            if (m == mrows)     return;
+            size_t sznew = packedSize(m);
+            T* resized = new T[sznew];
+            size_t szkeep = std::min(msize, sznew);
+            std::copy(mdata, mdata + szkeep, resized);
+            std::fill(resized + szkeep, resized + sznew, value);
+            mstorage.reset(resized);
+            mdata = resized;
+            mrows = m;
+            msize = sznew;
+        }
+
+        void clear()
+        {
+            mstorage.reset();
+            mdata = NULL;
+            mrows = msize = 0;
+        }
+
+        std::vector<T> rowVector(size_t i) const
+        {
+            std::vector<T> rv(mrows);
+            for (size_t j = 0; j != mrows; ++j)
             {
-                rv[j] = operator()(i, j);
+                rv[j] = mdata[packedIndex(i, j)];
             }
             return rv;
         }
 
-        virtual std::vector<T> columnVector(size_t j) const
+        std::vector<T> columnVector(size_t j) const
         {
             std::vector<T> rv = rowVector(j);
             return rv;
         }
 
+        inline size_t rows() const
+        {
+            return mrows;
+        }
+
+        inline size_t columns() const
+        {
+            return mrows;
+        }
+
+        // bytes of the element storage divided among its sharing copies
+        double storageBytes() const
+        {
+            long nshared = std::max(1L, mstorage.use_count());
+            return double(msize * sizeof(T)) / nshared;
+        }
+
+        // contiguous elements (i,0) ... (i,i) of row i,
+        // detaches storage shared with other copies
+        inline T* rowBegin(size_t i)
+        {
+            if (!mstorage.unique())     unshare();
+            return mdata + packedSize(i);
+        }
+
+        inline const T* rowBegin(size_t i) const
+        {
+            return mdata + packedSize(i);
+        }
+
+        // element access, detaches storage shared with other copies
+        inline T& operator()(size_t i, size_t j)
+        {
+            if (!mstorage.unique())     unshare();
+            return *(mdata + packedIndex(i, j));
+        }
+
+        inline const T& operator()(size_t i, size_t j) const
+        {
+            return *(mdata + packedIndex(i, j));
+        }
+
         SymmetricMatrix<T> transposed()
         {
             return SymmetricMatrix<T>(*this);
@@ -6,11 +6,16 @@
 * <license text>
 *****************************************************************************/
 
+#include <memory>
+#include <numeric>
 #include <sstream>
 #include <cassert>
 #include <gsl/gsl_multimin.h>
 #include <gsl/gsl_multifit_nlin.h>
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "Molecule.hpp"
 #include "LigaUtils.hpp"
@@ -22,10 +27,22 @@
 #include "Random.hpp"
 #include "R3linalg.hpp"
 #include "Exceptions.hpp"
+#include "WorkerPool.hpp"
+#include "StructureIO.hpp"
+#include "SectionTimer.hpp"
 
 using namespace std;
 using namespace NS_LIGA;
 
+// Local helpers for pair matrices -------------------------------------------
+
+namespace {
+
+// pmx_used_indices of pairs with targets removed from the distance table
+const boost::uint32_t FROZEN_PAIR = 0xffffffffu;
+
+}   // namespace
+
 //////////////////////////////////////////////////////////////////////////////
 // class Molecule
 //////////////////////////////////////////////////////////////////////////////
@@ -35,9 +52,12 @@ using namespace NS_LIGA;
 double Molecule::tol_nbad = 0.05*0.05;
 double Molecule::tol_r = 1.0e-8;
 double Molecule::promotefrac = 0.1;
+int Molecule::candidatecache = 0;
 bool Molecule::promotejump = true;
 bool Molecule::promoterelax = false;
 bool Molecule::demoterelax = false;
+bool Molecule::floatscreen = false;
+bool Molecule::adaptivefilters = false;
 vector<AtomFilter_t*> Molecule::atom_filters;
 string Molecule::output_format = "rawxyz";
 
@@ -46,6 +66,8 @@ string Molecule::output_format = "rawxyz";
 long Molecule::getUniqueId()
 {
     static long uid = 0;
+    static boost::mutex uid_lock;
+    boost::mutex::scoped_lock lock(uid_lock);
     return uid++;
 }
 
@@ -69,52 +91,53 @@ Molecule::Molecule(const Molecule& M) : id(Molecule::getUniqueId())
 
 Molecule& Molecule::operator=(const Molecule& M)
 {
+    SECTION_TIMER("Molecule::operator=");
     if (this == &M) return *this;
     // Clear() must be the first statement
     Clear();
-    // assign distance table - share reference when distances are reused
-    if (M.getDistReuse())
-    {
-        this->_distance_table = M._distance_table;
-    }
-    else
-    {
-        this->setDistanceTable(*M._distance_table);
-    }
+    // share the immutable distance table and copy its used distances
+    this->_distance_table = M._distance_table;
+    this->_distance_usage = M._distance_usage;
+    this->_distance_bins = M._distance_bins;
+    this->_distance_bin_usage = M._distance_bin_usage;
     this->_atom_radii_table = M._atom_radii_table;
     // duplicate source atoms
     atoms_storage = M.atoms_storage;
-    // build dictionary to find equivalent Atom_t pointers
-    map<const Atom_t*,Atom_t*> mapatomptr;
-    list<Atom_t>::const_iterator asrc = M.atoms_storage.begin();
-    list<Atom_t>::iterator adst = atoms_storage.begin();
-    for (; adst != atoms_storage.end(); ++asrc, ++adst)
-    {
-        mapatomptr[&(*asrc)] = &(*adst);
-    }
-    // translate pointers to the atoms present in the molecule
+    // translate atom pointers by their offsets in the storage
+    const Atom_t* asrc = M.atoms_storage.empty() ? NULL : &M.atoms_storage[0];
+    Atom_t* adst = atoms_storage.empty() ? NULL : &atoms_storage[0];
     atoms.resize(M.atoms.size());
     for (size_t i = 0; i != M.atoms.size(); ++i)
     {
-        atoms[i] = mapatomptr[M.atoms[i]];
-        assert(atoms[i] != NULL);
+        atoms[i] = adst + (M.atoms[i] - asrc);
     }
-    // translate pointers to the unassigned atoms in the bucket
     atoms_bucket.resize(M.atoms_bucket.size());
     for (size_t i = 0; i != M.atoms_bucket.size(); ++i)
     {
-        assert(mapatomptr.count(M.atoms_bucket[i]));
-        atoms_bucket[i] = mapatomptr[M.atoms_bucket[i]];
-        assert(atoms_bucket[i] != NULL);
+        atoms_bucket[i] = adst + (M.atoms_bucket[i] - asrc);
     }
-    pmx_used_distances = M.pmx_used_distances;
+    packed_atoms = M.packed_atoms;
+    atom_cells.clear();
+    _packed_max_radius = M._packed_max_radius;
+    // pair matrices share their storage until modified
+    pmx_used_indices = M.pmx_used_indices;
     pmx_partial_costs = M.pmx_partial_costs;
     free_pmx_slots = M.free_pmx_slots;
     // finished duplication
     this->_badness = M._badness;
     this->_overlap = M._overlap;
+    this->_overlap_pairs = M._overlap_pairs;
+    this->_overlap_pairs_cached = M._overlap_pairs_cached;
+    this->_overlap_pairs_scale = M._overlap_pairs_scale;
+    if (M._anchor_generator_cached)
+    {
+        this->_anchor_generator = M._anchor_generator;
+        this->_anchor_generator_cached = true;
+    }
     this->_distreuse = M._distreuse;
     this->_samepairradius = M._samepairradius;
+    // cached candidates refer to atoms by their storage indices
+    this->candidate_cache = M.candidate_cache;
     // IO helpers
     trace = M.trace;
     return *this;
@@ -123,6 +146,7 @@ Molecule& Molecule::operator=(const Molecule& M)
 
 Molecule* Molecule::copy() const
 {
+    SECTION_TIMER("Molecule::copy");
     Molecule* pclone = new Molecule(*this);
     return pclone;
 }
@@ -133,16 +157,32 @@ void Molecule::init()
     static boost::shared_ptr<DistanceTable>
         empty_distance_table(new DistanceTable());
     this->_distance_table = empty_distance_table;
+    this->_distance_usage.resize(0);
+    this->_distance_bins.reset();
+    this->_distance_bin_usage.clear();
     this->_badness = 0.0;
     this->_overlap = 0.0;
+    this->_overlap_pairs_cached = false;
+    this->_overlap_pairs_scale = 0.0;
+    this->_anchor_generator_cached = false;
     this->_distreuse = false;
     this->_samepairradius = -1.0;
+    this->_packed_max_radius = 0.0;
 }
 
 
 void Molecule::setDistanceTable(const DistanceTable& dtbl)
 {
     this->_distance_table.reset(new DistanceTable(dtbl));
+    // binned cost uses targets replaced by the means of their bins
+    if (this->_distance_bins.get())
+    {
+        this->_distance_bins.reset(new DistanceHistogram(dtbl));
+        *(this->_distance_table) = this->_distance_bins->binnedTable();
+        this->_distance_bin_usage.assign(this->_distance_bins->size(), 0);
+    }
+    this->_distance_table->buildBucketIndex();
+    this->_distance_usage.resize(dtbl.size());
     if (atoms_storage.empty() && !dtbl.empty())
     {
         ChemicalFormula chfm;
@@ -174,6 +214,55 @@ DistanceTable Molecule::getDistanceTable()
 }
 
 
+const UsageMask& Molecule::getDistanceUsage() const
+{
+    return this->_distance_usage;
+}
+
+
+// Binning applies to the current and later distance tables.  It puts
+// the target distances on the grid of the table resolution and keeps
+// the bin means when switched off.
+
+void Molecule::setDistanceBinning(bool flag)
+{
+    if (flag == this->getDistanceBinning())     return;
+    if (flag && getDistReuse())
+    {
+        const char* emsg = "Binned cost requires distreuse is false.";
+        throw range_error(emsg);
+    }
+    if (!flag)
+    {
+        this->_distance_bins.reset();
+        this->_distance_bin_usage.clear();
+        return;
+    }
+    assert(this->_distance_usage.countUsed() == 0);
+    this->_distance_bins.reset(new DistanceHistogram);
+    DistanceTable dtbl = *(this->_distance_table);
+    this->setDistanceTable(dtbl);
+}
+
+
+bool Molecule::getDistanceBinning() const
+{
+    return this->_distance_bins.get();
+}
+
+
+const DistanceHistogram* Molecule::getDistanceBins() const
+{
+    return this->_distance_bins.get();
+}
+
+
+const vector<int>& Molecule::getDistanceBinUsage() const
+{
+    return this->_distance_bin_usage;
+}
+
+
 void Molecule::setDistReuse(bool flag)
 {
     this->_distreuse = flag;
@@ -189,7 +278,7 @@ bool Molecule::getDistReuse() const
 double Molecule::getMaxAtomRadius() const
 {
     double maxradius = 0.0;
-    list<Atom_t>::const_iterator ai;
+    vector<Atom_t>::const_iterator ai;
     for (ai = atoms_storage.begin(); ai != atoms_storage.end(); ++ai)
     {
         if (ai->radius > maxradius)  maxradius = ai->radius;
@@ -202,6 +291,7 @@ double Molecule::getMaxAtomRadius() const
 
 void Molecule::recalculate() const
 {
+    SECTION_TIMER("Molecule::recalculate");
     if (countAtoms() > getMaxAtomCount())
     {
         ostringstream emsg;
@@ -223,7 +313,7 @@ void Molecule::recalculate() const
         {
             int i0 = seq0.ptr()->pmxidx;
             int i1 = seq1.ptr()->pmxidx;
-            const double& paircost = pmx_partial_costs(i0,i1);
+            double paircost = partialCost(i0, i1);
             this->IncBadness(paircost);
             double paircosthalf = paircost / 2.0;
             seq0.ptr()->IncBadness(paircosthalf);
@@ -234,19 +324,44 @@ void Molecule::recalculate() const
 }
 
 
+void Molecule::cacheCost(WorkerPool& workers) const
+{
+    // pair costs of a molecule are updated with every change
+}
+
+
 AtomCost* Molecule::getAtomCostCalculator() const
 {
     static AtomCost the_acc(this);
-    the_acc.resetFor(this);
-    return &the_acc;
+    AtomCost* rv = &the_acc;
+    // worker threads use private calculators with the same penalty
+    if (WorkerPool::isWorkerThread())
+    {
+        static boost::thread_specific_ptr<AtomCost> worker_acc;
+        if (!worker_acc.get())  worker_acc.reset(new AtomCost(this));
+        rv = worker_acc.get();
+        rv->setScale(the_acc.getScale());
+        rv->setPenalty(the_acc.getPenaltyType(), the_acc.getPenaltyWidth());
+    }
+    rv->resetFor(this);
+    return rv;
 }
 
 
 AtomCost* Molecule::getAtomOverlapCalculator() const
 {
     static AtomOverlap the_overlap_calculator(this);
-    the_overlap_calculator.resetFor(this);
-    return &the_overlap_calculator;
+    AtomCost* rv = &the_overlap_calculator;
+    // worker threads use private calculators with the same scale
+    if (WorkerPool::isWorkerThread())
+    {
+        static boost::thread_specific_ptr<AtomOverlap> worker_aoc;
+        if (!worker_aoc.get())  worker_aoc.reset(new AtomOverlap(this));
+        rv = worker_aoc.get();
+        rv->setScale(the_overlap_calculator.getScale());
+    }
+    rv->resetFor(this);
+    return rv;
 }
 
 
@@ -263,6 +378,14 @@ void Molecule::setAtomOverlapScale(double sc)
     this->recalculate();
 }
 
+
+void Molecule::setAtomCostPenalty(const string& tp, double width)
+{
+    AtomCost::PenaltyType ptp = AtomCost::getPenaltyType(tp);
+    this->getAtomCostCalculator()->setPenalty(ptp, width);
+    this->recalculate();
+}
+
 // Local helpers for Molecule::reassignPairs()
 
 namespace {
@@ -291,8 +414,9 @@ void Molecule::reassignPairs()
     if (getDistReuse())  return;
     vector<PairMatrixElement> pmx_elements;
     pmx_elements.reserve(countPairs());
-    vector<double> used_distances;
-    used_distances.reserve(countPairs());
+    // table indices are sorted the same as the used distances
+    vector<boost::uint32_t> used_indices;
+    used_indices.reserve(countPairs());
     PairMatrixElement pme;
     for (AtomSequenceIndex seq0(this); !seq0.finished(); seq0.next())
     {
@@ -301,26 +425,28 @@ void Molecule::reassignPairs()
         {
             pme.i0 = seq0.ptr()->pmxidx;
             pme.i1 = seq1.ptr()->pmxidx;
+            boost::uint32_t uidx = usedIndex(pme.i0, pme.i1);
+            if (uidx == FROZEN_PAIR)    continue;
             pme.d01 = R3::distance(seq0.ptr()->r, seq1.ptr()->r);
             pmx_elements.push_back(pme);
-            assert(pmx_used_distances(pme.i0, pme.i1) >= 0.0);
-            used_distances.push_back(pmx_used_distances(pme.i0, pme.i1));
+            used_indices.push_back(uidx);
         }
     }
     double orgbadness = Badness();
     sort(pmx_elements.begin(), pmx_elements.end(),
             PairMatrixElement::compareDistance);
-    sort(used_distances.begin(), used_distances.end());
+    sort(used_indices.begin(), used_indices.end());
     vector<PairMatrixElement>::iterator pmii = pmx_elements.begin();
-    vector<double>::iterator udii = used_distances.begin();
-    assert(pmx_elements.size() == used_distances.size());
+    vector<boost::uint32_t>::iterator uii = used_indices.begin();
+    assert(pmx_elements.size() == used_indices.size());
     const AtomCost* atomcost = this->getAtomCostCalculator();
     const DistanceTable& dtgt = this->getDistanceTable();
-    for (; pmii != pmx_elements.end(); ++pmii, ++udii)
+    for (; pmii != pmx_elements.end(); ++pmii, ++uii)
     {
-        pmx_used_distances(pmii->i0, pmii->i1) = *udii;
-        double dd = *udii - pmii->d01;
-        double desd = dtgt.getesd(*udii);
+        pmx_used_indices(pmii->i0, pmii->i1) = *uii;
+        double udst = this->usedDistance(pmii->i0, pmii->i1);
+        double dd = udst - pmii->d01;
+        double desd = dtgt.getesd(udst);
         pmx_partial_costs(pmii->i0, pmii->i1) =
             atomcost->penaltyScaled(dd, desd);
     }
@@ -331,6 +457,26 @@ void Molecule::reassignPairs()
 }
 
 
+double Molecule::memoryUsage() const
+{
+    double rv = sizeof(Molecule);
+    rv += atoms_storage.capacity() * sizeof(Atom_t);
+    rv += (atoms.capacity() + atoms_bucket.capacity()) * sizeof(Atom_t*);
+    const PackedAtoms& pk = this->packed_atoms;
+    rv += (pk.rx.capacity() + pk.ry.capacity() + pk.rz.capacity() +
+            pk.radius.capacity()) * sizeof(double);
+    rv += (pk.fx.capacity() + pk.fy.capacity() + pk.fz.capacity()) *
+        sizeof(float);
+    rv += pk.element.capacity() * sizeof(int);
+    rv += pmx_partial_costs.storageBytes();
+    rv += pmx_used_indices.storageBytes();
+    rv += free_pmx_slots.capacity() * sizeof(int);
+    rv += _overlap_pairs.capacity() * sizeof(OverlapPair);
+    rv += _distance_usage.size() / 8.0;
+    return rv;
+}
+
+
 double Molecule::cost() const
 {
     double rv = this->costDistance() + this->costOverlap();
@@ -362,6 +508,7 @@ const double& Molecule::Badness() const
 
 void Molecule::IncBadness(const double& db) const
 {
+    this->uncacheAnchorGenerator();
     this->_badness += db;
     // Take care of round-offs, but only if they are very small.
     if (db < 0.0 && isNearZeroRoundOff(this->_badness))
@@ -379,6 +526,7 @@ void Molecule::DecBadness(const double& db) const
 
 void Molecule::ResetBadness(double b) const
 {
+    this->uncacheAnchorGenerator();
     this->_badness = b;
 }
 
@@ -486,17 +634,10 @@ void Molecule::setChemicalFormula(const ChemicalFormula& formula)
 {
     ChemicalFormula::const_iterator ec;
     vector<string> fmexpanded = formula.expand();
-    atoms_storage.resize(formula.countElements(), Atom_t("", 0.0, 0.0, 0.0));
-    set<const Atom_t*> set_storage;
-    set<const Atom_t*> set_existing;
-    set_existing.insert(atoms_bucket.begin(), atoms_bucket.end());
-    set_existing.insert(atoms.begin(), atoms.end());
+    this->resizeAtomsStorage(formula.countElements());
     vector<Atom_t*> replaced;
     BOOST_FOREACH (Atom_t& a, atoms_storage)
     {
-        set_storage.insert(&a);
-        // add any new atoms to the bucket
-        if (!set_existing.count(&a))  atoms_bucket.push_back(&a);
         // apply formula, store pointers to atoms that need to be updated
         vector<string>::iterator ei;
         ei = find(fmexpanded.begin(), fmexpanded.end(), a.element);
@@ -506,21 +647,11 @@ void Molecule::setChemicalFormula(const ChemicalFormula& formula)
     assert(fmexpanded.size() == replaced.size());
     BOOST_FOREACH (Atom_t* pa, replaced)
     {
-        pa->element = fmexpanded.front();
+        pa->setElement(fmexpanded.front());
         fmexpanded.erase(fmexpanded.begin());
     }
-    // remove any atom pointers that are not it the storage
-    vector<Atom_t*>::iterator ai, ag;
-    for (ai = ag = atoms_bucket.begin(); ai != atoms_bucket.end(); ++ai)
-    {
-        if (set_storage.count(*ai))   (*ag++) = *ai;
-    }
-    atoms_bucket.erase(ag, atoms_bucket.end());
-    for (ai = ag = atoms.begin(); ai != atoms.end(); ++ai)
-    {
-        if (set_storage.count(*ai))   (*ag++) = *ai;
-    }
-    atoms.erase(ag, atoms.end());
+    // new elements may change the same-pair contact radius
+    if (!replaced.empty() && countAtoms())  this->uncacheOverlapPairs();
     this->fetchAtomRadii();
     this->recalculate();
     this->CheckIntegrity();
@@ -572,6 +703,7 @@ const AtomRadiiTable& Molecule::getAtomRadiiTable() const
 void Molecule::setSamePairRadius(double samepairradius)
 {
     this->_samepairradius = samepairradius;
+    this->uncacheOverlapPairs();
 }
 
 
@@ -587,6 +719,12 @@ int Molecule::getMaxAtomCount() const
 }
 
 
+int Molecule::countCachedCandidates() const
+{
+    return this->candidate_cache.size();
+}
+
+
 void Molecule::Shift(const R3::Vector& drc)
 {
     for (AtomSequence seq(this); !seq.finished(); seq.next())
@@ -594,6 +732,8 @@ void Molecule::Shift(const R3::Vector& drc)
         Atom_t* pa = seq.ptr();
         pa->r += drc;
     }
+    this->packAtoms();
+    this->candidate_cache.clear();
 }
 
 
@@ -610,24 +750,117 @@ void Molecule::Center()
 }
 
 
+// Local helpers for structure fingerprints
+
+namespace {
+
+// pair distances are compared on a grid of this spacing
+const double FINGERPRINT_RESOLUTION = 1.0e-4;
+
+}   // namespace
+
+size_t Molecule::fingerprint() const
+{
+    // hash pair distances rounded to the grid together with
+    // the element types of both atoms
+    vector<size_t> pairkeys;
+    int n = this->countAtoms();
+    pairkeys.reserve(n * (n - 1) / 2 + n);
+    for (int i0 = 0; i0 != n; ++i0)
+    {
+        const Atom_t* pa0 = this->atoms[i0];
+        size_t atomkey = 0;
+        boost::hash_combine(atomkey, pa0->elementId());
+        pairkeys.push_back(atomkey);
+        for (int i1 = 0; i1 != i0; ++i1)
+        {
+            const Atom_t* pa1 = this->atoms[i1];
+            double d = this->fingerprintDistance(pa0, pa1);
+            size_t key = 0;
+            boost::hash_combine(key, min(pa0->elementId(), pa1->elementId()));
+            boost::hash_combine(key, max(pa0->elementId(), pa1->elementId()));
+            long dgrid = long(floor(d / FINGERPRINT_RESOLUTION + 0.5));
+            boost::hash_combine(key, dgrid);
+            pairkeys.push_back(key);
+        }
+    }
+    sort(pairkeys.begin(), pairkeys.end());
+    size_t rv = 0;
+    boost::hash_combine(rv, n);
+    boost::hash_range(rv, pairkeys.begin(), pairkeys.end());
+    return rv;
+}
+
+
+// Local helpers for spatial queries of atoms
+
+namespace {
+
+// minimum number of atoms for using the cell list
+const int MIN_CELL_LIST_ATOMS = 64;
+
+}   // namespace
+
 AtomPtr Molecule::getNearestAtom(const R3::Vector& rc) const
 {
     R3::Vector rij(0.0, 0.0, 0.0);
-    double mindistance = DOUBLE_MAX;
     int index = -1;
-    for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
-    {
-        rij = seq.ptr()->r - rc;
-        if (R3::norm(rij) >= mindistance)   continue;
-        mindistance = R3::norm(rij);
-        index = seq.idx();
+    if (this->atoms.empty())    return AtomPtr();
+    // expand the search until the nearest atom is within the radius
+    vector<int> near;
+    double rcut = 0.0;
+    if (this->countAtoms() >= MIN_CELL_LIST_ATOMS)
+    {
+        this->updateAtomCells();
+        rcut = this->atom_cells.getCellSize();
+    }
+    for (bool complete = false; !complete; rcut *= 2)
+    {
+        this->findNearAtoms(near, rc, rcut);
+        complete = (int(near.size()) == this->countAtoms());
+        double mindistance = DOUBLE_MAX;
+        vector<int>::const_iterator ii;
+        for (ii = near.begin(); ii != near.end(); ++ii)
+        {
+            rij = this->atoms[*ii]->r - rc;
+            if (R3::norm(rij) >= mindistance)   continue;
+            mindistance = R3::norm(rij);
+            index = *ii;
+        }
+        complete = complete || (index >= 0 && mindistance <= rcut);
     }
-    AtomPtr rv;
-    if (index >= 0)  rv.reset(new Atom_t(this->getAtom(index)));
+    AtomPtr rv(new Atom_t(this->getAtom(index)));
     return rv;
 }
 
 
+void Molecule::findNearAtoms(vector<int>& indices,
+        const R3::Vector& rc, double rcut) const
+{
+    // small molecules are faster to scan in full
+    if (this->countAtoms() < MIN_CELL_LIST_ATOMS)
+    {
+        indices.resize(this->countAtoms());
+        for (size_t i = 0; i != indices.size(); ++i)  indices[i] = i;
+        return;
+    }
+    this->updateAtomCells();
+    this->atom_cells.findNear(indices,
+            rc[0], rc[1], rc[2], rcut + eps_distance);
+}
+
+
+bool Molecule::hasNearAtoms(const R3::Vector& rc, double rcut) const
+{
+    // atom cells do not cover periodic images of crystal sites and
+    // small molecules are not sorted into cells
+    if (this->type() == CRYSTAL)    return true;
+    if (this->countAtoms() < MIN_CELL_LIST_ATOMS)  return true;
+    this->updateAtomCells();
+    return this->atom_cells.hasNear(rc[0], rc[1], rc[2], rcut + eps_distance);
+}
+
+
 void Molecule::Pop(const int aidx)
 {
     if (aidx < 0 || aidx >= countAtoms())
@@ -640,8 +873,11 @@ void Molecule::Pop(const int aidx)
     // Pop should never get called on fixed atom
     assert(!pa->fixed);
     removeAtomPairs(pa);
-    free_pmx_slots.insert(pa->pmxidx);
+    free_pmx_slots.push_back(pa->pmxidx);
     atoms.erase(atoms.begin() + aidx);
+    this->unpackAtom(aidx);
+    this->uncacheAnchorGenerator();
+    this->uncacheCandidates(pa);
     atoms_bucket.push_back(pa);
 }
 
@@ -650,8 +886,48 @@ void Molecule::Pop(const list<int>& cidx)
 {
     // create a sorted set of indices of atoms to be popped
     set<int> popped(cidx.begin(), cidx.end());
+    if (popped.size() < 2)
+    {
+        if (!popped.empty())    Pop(*popped.begin());
+        return;
+    }
+    if (*popped.begin() < 0 || *popped.rbegin() >= countAtoms())
+    {
+        int aidx = (*popped.begin() < 0) ? *popped.begin() : *popped.rbegin();
+        ostringstream emsg;
+        emsg << "Molecule::Pop(const list<int>&) invalid index " <<
+            aidx << '.';
+        throw range_error(emsg.str());
+    }
+    vector<char> popmask(countAtoms(), 0);
+    BOOST_FOREACH (int aidx, popped)
+    {
+        // Pop should never get called on fixed atom
+        assert(!atoms[aidx]->fixed);
+        popmask[aidx] = 1;
+    }
+    // remove all pair contributions while the atoms are still in place
+    removeAtomPairs(popmask);
+    // fill the bucket in the same order as the single-atom pops
     set<int>::reverse_iterator rii;
-    for (rii = popped.rbegin(); rii != popped.rend(); ++rii)  Pop(*rii);
+    for (rii = popped.rbegin(); rii != popped.rend(); ++rii)
+    {
+        Atom_t* pa = atoms[*rii];
+        free_pmx_slots.push_back(pa->pmxidx);
+        this->uncacheCandidates(pa);
+        atoms_bucket.push_back(pa);
+    }
+    // compact the remaining atoms once
+    vector<Atom_t*>::iterator adst = atoms.begin();
+    for (size_t i = 0; i != atoms.size(); ++i)
+    {
+        if (popmask[i])     continue;
+        *adst = atoms[i];
+        ++adst;
+    }
+    atoms.erase(adst, atoms.end());
+    this->packAtoms();
+    this->uncacheAnchorGenerator();
 }
 
 
@@ -662,19 +938,23 @@ void Molecule::Clear()
     atoms_bucket.insert(atoms_bucket.end(), atoms.begin(), atoms.end());
     assert(atoms_bucket.size() == atoms_storage.size());
     atoms.clear();
+    this->packAtoms();
     free_pmx_slots.clear();
+    this->candidate_cache.clear();
     ResetBadness();
     ResetOverlap();
+    this->_overlap_pairs.clear();
     CheckIntegrity();
 }
 
 
 void Molecule::AddAt(const string& smbl, double rx0, double ry0, double rz0)
 {
+    int eid = Atom_t::elementId(smbl);
     vector<Atom_t*>::iterator ai;
     for (ai = atoms_bucket.begin(); ai != atoms_bucket.end(); ++ai)
     {
-        if ((*ai)->element == smbl)  break;
+        if ((*ai)->elementId() == eid)  break;
     }
     if (ai == atoms_bucket.end())
     {
@@ -724,9 +1004,106 @@ int Molecule::NFixed() const
 }
 
 
-void Molecule::filter_good_atoms(AtomArray& vta,
+// Fixed atoms never move, hence the target distances used by their pairs
+// can be removed from the distance table for good.  Pair costs of fixed
+// atoms stay in the pair matrix and the used distances of other pairs are
+// marked again in the reduced table.  The free distances and their order
+// do not change, but the usage masks of all evaluations get smaller.
+
+void Molecule::freezeFixedPairs()
+{
+    if (getDistReuse())
+    {
+        const char* emsg = "Frozen pairs require distreuse is false.";
+        throw range_error(emsg);
+    }
+    if (getDistanceBinning())
+    {
+        const char* emsg = "Frozen pairs are not supported with binned cost.";
+        throw range_error(emsg);
+    }
+    vector<double> dfrozen;
+    vector<double> dkept;
+    for (AtomSequence seq0(this); !seq0.finished(); seq0.next())
+    {
+        AtomSequence seq1 = seq0;
+        for (seq1.next(); !seq1.finished(); seq1.next())
+        {
+            int i0 = seq0.ptr()->pmxidx;
+            int i1 = seq1.ptr()->pmxidx;
+            if (usedIndex(i0, i1) == FROZEN_PAIR)    continue;
+            bool isfrozen = seq0.ptr()->fixed && seq1.ptr()->fixed;
+            vector<double>& dst = isfrozen ? dfrozen : dkept;
+            dst.push_back(this->usedDistance(i0, i1));
+        }
+    }
+    if (dfrozen.empty())    return;
+    sort(dfrozen.begin(), dfrozen.end());
+    // both lists are sorted, skip one table entry per frozen distance
+    const DistanceTable& dtbl = *this->_distance_table;
+    vector<double> dreduced;
+    vector<double> esdreduced;
+    vector<double>::const_iterator dfi = dfrozen.begin();
+    for (size_t i = 0; i != dtbl.size(); ++i)
+    {
+        if (dfi != dfrozen.end() && *dfi == dtbl[i])
+        {
+            ++dfi;
+            continue;
+        }
+        dreduced.push_back(dtbl[i]);
+        esdreduced.push_back(dtbl.getesdAt(i));
+    }
+    assert(dfi == dfrozen.end());
+    boost::shared_ptr<DistanceTable> reduced(new DistanceTable(dreduced));
+    reduced->setResolution(dtbl.getResolution());
+    if (dtbl.hasESDs())     reduced->setESDs(esdreduced);
+    reduced->buildBucketIndex();
+    this->_distance_table = reduced;
+    this->_distance_usage.resize(reduced->size());
+    this->_distance_usage.clear();
+    // mark kept pairs in the reduced table in the order of collection
+    vector<double>::const_iterator dki = dkept.begin();
+    for (AtomSequence seq0(this); !seq0.finished(); seq0.next())
+    {
+        AtomSequence seq1 = seq0;
+        for (seq1.next(); !seq1.finished(); seq1.next())
+        {
+            boost::uint32_t& uidx = this->pmx_used_indices(
+                    seq0.ptr()->pmxidx, seq1.ptr()->pmxidx);
+            if (uidx == FROZEN_PAIR)    continue;
+            if (seq0.ptr()->fixed && seq1.ptr()->fixed)
+            {
+                uidx = FROZEN_PAIR;
+                continue;
+            }
+            double d = *(dki++);
+            size_t lo = lower_bound(reduced->begin(), reduced->end(), d) -
+                reduced->begin();
+            size_t didx = this->_distance_usage.nextFree(lo);
+            assert(reduced->at(didx) == d);
+            this->_distance_usage.setUsed(didx);
+            uidx = didx + 1;
+        }
+    }
+    assert(dki == dkept.end());
+}
+
+
+// Local helpers for screening of trial atoms
+
+namespace {
+
+// tolerance of single precision trial atom costs relative to the cost
+// limit and to the number of pair terms
+const double FLOAT_SCREEN_TOLERANCE = 1.0e-5;
+
+}   // namespace
+
+double Molecule::filter_good_atoms(AtomArray& vta,
         double evolve_range, double hi_abad)
 {
+    SECTION_TIMER("Molecule::filter_good_atoms");
     if (countAtoms() == getMaxAtomCount())
     {
         ostringstream emsg;
@@ -751,11 +1128,32 @@ void Molecule::filter_good_atoms(AtomArray& vta,
     // obtain badness of every test atom, do lazy evaluation when badness
     // is higher than (minimum + evolve_range)
     AtomCost* atomcost = getAtomCostCalculator();
+    if (floatscreen && this->type() != CRYSTAL)
+    {
+        // Screening costs are lower bounds of the exact costs and the
+        // screening cutoff is an upper bound of the exact cutoff.
+        // The exact evaluation below then ends with the same cutoff and
+        // the same good atoms.
+        atomcost->setCutoff(hi_abad);
+        atomcost->setCutoffRange(evolve_range);
+        const vector<double>& vtascreen = atomcost->screenBatch(vta);
+        double hi_screen = atomcost->cutoff();
+        hi_screen += FLOAT_SCREEN_TOLERANCE *
+            (hi_screen + this->countAtoms());
+        gai = vta.begin();
+        for (size_t i = 0; i != vta.size(); ++i)
+        {
+            if (vta[i].Badness() + vtascreen[i] > hi_screen)  continue;
+            *(gai++) = vta[i];
+        }
+        vta.erase(gai, vta.end());
+    }
     atomcost->setCutoff(hi_abad);
     atomcost->setCutoffRange(evolve_range);
-    for (VAit tai = vta.begin(); tai != vta.end(); ++tai)
+    const vector<double>& vtacost = atomcost->evalBatch(vta);
+    for (size_t i = 0; i != vta.size(); ++i)
     {
-        tai->IncBadness(atomcost->eval(*tai));
+        vta[i].IncBadness(vtacost[i]);
     }
     // atom cost cutoff is available here,
     // let us keep only good atoms
@@ -766,18 +1164,32 @@ void Molecule::filter_good_atoms(AtomArray& vta,
         *(gai++) = *tai;
     }
     vta.erase(gai, vta.end());
+    return atomcost->cutoff();
 }
 
 
 void Molecule::filter_bucket_atoms(AtomArray& vta)
 {
-    set<Atom_t*> bucket(atoms_bucket.begin(), atoms_bucket.end());
-    assert(bucket.size() == atoms_bucket.size());
+    // flag bucket atoms by their index in atoms_storage,
+    // the flags buffer is reused by each thread
+    static boost::thread_specific_ptr< vector<char> > tinbucket;
+    if (!tinbucket.get())   tinbucket.reset(new vector<char>);
+    vector<char>& inbucket = *tinbucket;
+    inbucket.assign(atoms_storage.size(), 0);
+    const Atom_t* a0 = atoms_storage.empty() ? NULL : &atoms_storage[0];
+    vector<Atom_t*>::const_iterator bi = atoms_bucket.begin();
+    for (; bi != atoms_bucket.end(); ++bi)
+    {
+        assert(size_t(*bi - a0) < atoms_storage.size());
+        inbucket[*bi - a0] = 1;
+    }
     AtomArray::iterator asrc = vta.begin();
     AtomArray::iterator adst = vta.begin();
     for (; asrc != vta.end(); ++asrc)
     {
-        if (bucket.count(asrc->mstorage_ptr))
+        size_t sidx = asrc->mstorage_ptr - a0;
+        assert(sidx < atoms_storage.size());
+        if (inbucket[sidx])
         {
             *adst = *asrc;
             ++adst;
@@ -789,6 +1201,14 @@ void Molecule::filter_bucket_atoms(AtomArray& vta)
 
 bool Molecule::check_atom_filters(Atom_t* pa)
 {
+    // adaptive pipeline of every thread learns its own filter order
+    if (adaptivefilters)
+    {
+        static boost::thread_specific_ptr<AtomFilterPipeline> tpipeline;
+        if (!tpipeline.get())   tpipeline.reset(new AtomFilterPipeline);
+        tpipeline->setFilters(atom_filters);
+        return tpipeline->Check(pa, this);
+    }
     bool isgood = true;
     vector<AtomFilter_t*>::iterator pafi = atom_filters.begin();
     for (; isgood && pafi != atom_filters.end(); ++pafi)
@@ -820,105 +1240,197 @@ template <class V> void copyGSLvector(const V& src, gsl_vector* dest)
 }
 
 
+// cost and gradient of the relaxed atom at some position
 struct rxa_fg
 {
     double f;
     R3::Vector g;
 };
 
-struct rxa_compare_R3Vector
+// Reusable relaxation engine owned by every thread.  It keeps the GSL
+// minimizer allocated between calls and remembers a few most recent
+// evaluations, because the minimizer often asks for the same point.
+class AtomRelaxer
 {
-    bool operator()(const R3::Vector& v0, const R3::Vector& v1) const
-    {
-        return lexicographical_compare(
-                v0.data(), v0.data() + R3::Ndim,
-                v1.data(), v1.data() + R3::Ndim);
-    }
-};
+    public:
+
+        // class methods
+        static AtomRelaxer* threadInstance()
+        {
+            static boost::thread_specific_ptr<AtomRelaxer> relaxer;
+            if (!relaxer.get())     relaxer.reset(new AtomRelaxer);
+            return relaxer.get();
+        }
 
-const Molecule* rxa_molecule = NULL;
-AtomCost* rxa_atomcost = NULL;
-AtomCost* rxa_atomoverlap = NULL;
+        // constructor and destructor
+        AtomRelaxer()
+        {
+            fdfmin.f = &AtomRelaxer::f;
+            fdfmin.df = &AtomRelaxer::df;
+            fdfmin.fdf = &AtomRelaxer::fdf;
+            fdfmin.n = R3::Ndim;
+            fdfmin.params = this;
+            minimizer = gsl_multimin_fdfminimizer_alloc(
+                    gsl_multimin_fdfminimizer_vector_bfgs2, fdfmin.n);
+            x = gsl_vector_alloc(fdfmin.n);
+            molecule = NULL;
+            atomcost = NULL;
+            atomoverlap = NULL;
+            atom = NULL;
+            this->clearCache();
+        }
 
-class rxa_CacheType : public map<R3::Vector,rxa_fg,rxa_compare_R3Vector>
-{
-    public:
 
-        const mapped_type* lookup(const R3::Vector& x)
+        ~AtomRelaxer()
+        {
+            gsl_multimin_fdfminimizer_free(minimizer);
+            gsl_vector_free(x);
+        }
+
+
+        // methods
+        void useMolecule(const Molecule* mol, Atom_t* pa)
+        {
+            molecule = mol;
+            atomcost = mol->getAtomCostCalculator();
+            atomoverlap = mol->getAtomOverlapCalculator();
+            atom = pa;
+            this->clearCache();
+        }
+
+
+        // fused cost and gradient of the atom at position rc
+        const rxa_fg& evalCostGradient(const R3::Vector& rc)
         {
-            const mapped_type* rv = NULL;
-            if (this->empty())  return rv;
-            const_iterator kv = this->lower_bound(x);
-            if (kv != this->end() &&
-                R3::norm(x - kv->first) < eps_distance)
+            Atom_t& ta = *atom;
+            ta.r = rc;
+            // try to get the result from the cache
+            for (int i = 0; i != cache_count; ++i)
             {
-                rv = &(kv->second);
+                if (R3::norm(rc - cache_r[i]) < eps_distance)
+                {
+                    return cache_fg[i];
+                }
             }
-            else if (kv != this->begin() &&
-                     R3::norm(x - (--kv)->first) < eps_distance)
+            // calculate and store in the cache
+            double ppa = molecule->pairsPerAtomInc();
+            rxa_fg& fg = cache_fg[cache_next];
+            cache_r[cache_next] = rc;
+            // non-periodic structures use one pass for both cost terms
+            if (molecule->type() == MOLECULE)
             {
-                rv = &(kv->second);
+                double overlap;
+                R3::Vector goverlap;
+                ta.ResetBadness(atomcost->evalWithOverlap(
+                            &ta, *atomoverlap, overlap, goverlap));
+                ta.ResetOverlap(overlap);
+                fg.f = ta.costShare(ppa);
+                fg.g = atomcost->gradient();
+                fg.g += ppa * goverlap;
             }
-            return rv;
+            else
+            {
+                ta.ResetBadness(atomcost->eval(ta, AtomCost::GRADIENT));
+                ta.ResetOverlap(atomoverlap->eval(ta, AtomCost::GRADIENT));
+                fg.f = ta.costShare(ppa);
+                fg.g = atomcost->gradient();
+                fg.g += ppa * atomoverlap->gradient();
+            }
+            cache_next = (cache_next + 1) % CACHE_SIZE;
+            if (cache_count < CACHE_SIZE)   ++cache_count;
+            return fg;
         }
-};
 
-rxa_CacheType rxa_cache;
 
-void rxa_fdf(const gsl_vector* x, void* params, double* f, gsl_vector* g);
+        // relax atom position, return true when its cost improved
+        bool relax(R3::Vector& rc)
+        {
+            const int maximum_iterations = 500;
+            const double minimizer_step = 1.0e-4;
+            const double minimizer_tol = 0.1;
+            // determine initial_cost before relaxation
+            double initial_cost = this->evalCostGradient(rc).f;
+            // iterate unless initial_cost is close to zero
+            if (isNearZeroRoundOff(initial_cost))   return false;
+            copyGSLvector(rc, x);
+            gsl_multimin_fdfminimizer_set(minimizer,
+                    &fdfmin, x, minimizer_step, minimizer_tol);
+            for (int iter = 0; iter < maximum_iterations; ++iter)
+            {
+                int status = gsl_multimin_fdfminimizer_iterate(minimizer);
+                if (status != GSL_SUCCESS)  break;
+                status = gsl_multifit_test_delta(minimizer->dx,
+                        minimizer->x, eps_distance, eps_distance);
+                if (status == GSL_SUCCESS)
+                {
+                    // one last iteration to improve the precision
+                    gsl_multimin_fdfminimizer_iterate(minimizer);
+                    break;
+                }
+                if (status != GSL_CONTINUE) break;
+            }
+            double relaxed_cost = minimizer->f;
+            bool improved = eps_lt(relaxed_cost, initial_cost);
+            if (improved)   copyGSLvector(minimizer->x, rc);
+            return improved;
+        }
 
-double rxa_f(const gsl_vector* x, void* params)
-{
-    double rv;
-    gsl_vector* g = NULL;
-    rxa_fdf(x, params, &rv, g);
-    return rv;
-}
+    private:
 
+        // class data
+        static const int CACHE_SIZE = 8;
 
-void rxa_df(const gsl_vector* x, void* params, gsl_vector* g)
-{
-    double f;
-    rxa_fdf(x, params, &f, g);
-}
+        // class methods - GSL callbacks
+        static void fdf(const gsl_vector* v, void* params,
+                double* pf, gsl_vector* g)
+        {
+            AtomRelaxer* rxa = static_cast<AtomRelaxer*>(params);
+            R3::Vector rc;
+            copyGSLvector(v, rc);
+            const rxa_fg& fg = rxa->evalCostGradient(rc);
+            *pf = fg.f;
+            if (g)  copyGSLvector(fg.g, g);
+        }
 
 
-void rxa_fdf(const gsl_vector* x, void* params, double* f, gsl_vector* g)
-{
-    Atom_t* pa = static_cast<Atom_t*>(params);
-    Atom_t& ta = *pa;
-    copyGSLvector(x, ta.r);
-    // try to get the result from the cache
-    const rxa_fg* pfg = rxa_cache.lookup(ta.r);
-    if (!pfg)
-    {
-        // calculate and store in the cache
-        ta.ResetBadness(rxa_atomcost->eval(ta, AtomCost::GRADIENT));
-        ta.ResetOverlap(rxa_atomoverlap->eval(ta, AtomCost::GRADIENT));
-        rxa_fg fg;
-        fg.f = ta.costShare(rxa_molecule->pairsPerAtomInc());
-        fg.g = 0.0, 0.0, 0.0;
-        fg.g += rxa_atomcost->gradient();
-        fg.g += rxa_molecule->pairsPerAtomInc() * rxa_atomoverlap->gradient();
-        rxa_cache[ta.r] = fg;
-        pfg = rxa_cache.lookup(ta.r);
-        assert(R3::norm(fg.g - pfg->g) == 0.0);
-        assert(fg.f == pfg->f);
-    }
-    // here pfg should be non NULL
-    assert(pfg);
-    *f = pfg->f;
-    if (g)  copyGSLvector(pfg->g, g);
-}
+        static double f(const gsl_vector* v, void* params)
+        {
+            double rv;
+            fdf(v, params, &rv, NULL);
+            return rv;
+        }
 
 
-void rxa_useMolecule(const Molecule* mol)
-{
-    rxa_molecule = mol;
-    rxa_atomcost = mol ? mol->getAtomCostCalculator() : NULL;
-    rxa_atomoverlap = mol ? mol->getAtomOverlapCalculator() : NULL;
-    rxa_cache.clear();
-}
+        static void df(const gsl_vector* v, void* params, gsl_vector* g)
+        {
+            double fv;
+            fdf(v, params, &fv, g);
+        }
+
+        // data
+        gsl_multimin_function_fdf fdfmin;
+        gsl_multimin_fdfminimizer* minimizer;
+        gsl_vector* x;
+        const Molecule* molecule;
+        AtomCost* atomcost;
+        AtomCost* atomoverlap;
+        Atom_t* atom;
+        R3::Vector cache_r[CACHE_SIZE];
+        rxa_fg cache_fg[CACHE_SIZE];
+        int cache_count;
+        int cache_next;
+
+        // methods
+        void clearCache()
+        {
+            cache_count = 0;
+            cache_next = 0;
+        }
+
+        // disable copying
+        AtomRelaxer(const AtomRelaxer&);
+        AtomRelaxer& operator=(const AtomRelaxer&);
+};
 
 }   // namespace
 
@@ -942,94 +1454,325 @@ void Molecule::RelaxAtom(const int cidx)
 
 void Molecule::RelaxExternalAtom(Atom_t* pa)
 {
-    // Configuration of the GSL multidimensional minimizer
-    // For details, see info pages
+    SECTION_TIMER("Molecule::RelaxExternalAtom");
+    // Configuration of the GSL multidimensional minimizer is in
+    // AtomRelaxer.  For details, see info pages
     //     '(gsl-ref)Multidimensional Minimization'
     //     '(gsl-ref)Initializing the Multidimensional Minimizer'
-    const int maximum_iterations = 500;
-    const gsl_multimin_fdfminimizer_type* minimizer_type;
-    minimizer_type = gsl_multimin_fdfminimizer_vector_bfgs2;
-    const double minimizer_step = 1.0e-4;
-    const double minimizer_tol = 0.1;
     // do relaxation on a copy of pa
     Atom_t rta(*pa);
-    // loop while badness is improved
-    gsl_multimin_function_fdf fdfmin;
-    rxa_useMolecule(this);
-    fdfmin.f = &rxa_f;
-    fdfmin.df = &rxa_df;
-    fdfmin.fdf = &rxa_fdf;
-    // FIXME handling of ndim
-    fdfmin.n = 3;
-    fdfmin.params = &rta;
-    // copy rta coordinates to vector x
-    gsl_vector* x = gsl_vector_alloc(3);
-    copyGSLvector(rta.r, x);
-    // determine initial_cost before relaxation
-    double initial_cost = rxa_f(x, fdfmin.params);
-    // allocate minimizer
-    gsl_multimin_fdfminimizer* minimizer;
-    minimizer = gsl_multimin_fdfminimizer_alloc(minimizer_type, fdfmin.n);
-    gsl_multimin_fdfminimizer_set(minimizer,
-            &fdfmin, x, minimizer_step, minimizer_tol);
-    // iterate unless initial_cost is close to zero
-    int iter, status;
-    bool skipiter = isNearZeroRoundOff(initial_cost);
-    for (iter = 0; iter < maximum_iterations && !skipiter; ++iter)
-    {
-        status = gsl_multimin_fdfminimizer_iterate(minimizer);
-        if (status != GSL_SUCCESS)  break;
-        status = gsl_multifit_test_delta(minimizer->dx,
-                minimizer->x, eps_distance, eps_distance);
-        if (status == GSL_SUCCESS)
-        {
-            // one last iteration to improve the precision
-            gsl_multimin_fdfminimizer_iterate(minimizer);
-            break;
-        }
-        if (status != GSL_CONTINUE) break;
-    }
-    // copy new coordinates to rta
+    AtomRelaxer* relaxer = AtomRelaxer::threadInstance();
+    relaxer->useMolecule(this, &rta);
+    R3::Vector rc = rta.r;
     // update relaxed atom if cost improved
-    double relaxed_cost = minimizer->f;
-    if (eps_lt(relaxed_cost, initial_cost))
-    {
-        copyGSLvector(minimizer->x, pa->r);
-    }
-    // release minimizer objects
-    gsl_multimin_fdfminimizer_free(minimizer);
-    gsl_vector_free(x);
-    rxa_useMolecule(NULL);
+    if (relaxer->relax(rc))     pa->r = rc;
 }
 
 
-void Molecule::AddInternalAt(Atom_t* pa, double rx0, double ry0, double rz0)
-{
-    pa->r = rx0, ry0, rz0;
-    AddInternal(pa);
-}
+// Local helpers for Molecule::RelaxAll()
 
+namespace {
 
-void Molecule::AddInternalAt(Atom_t* pa, const R3::Vector& rc)
+// Simultaneous relaxation of all free atoms.  Every pair with a free
+// atom keeps its target distance, the objective is the normalized sum
+// of the pair and overlap costs as in Molecule::cost().  Coordinates of
+// all atoms are packed in xyz, the minimizer varies free atoms only.
+class StructureRelaxer
 {
-    pa->r = rc;
-    AddInternal(pa);
-}
+    public:
 
+        // types
+        struct TargetPair
+        {
+            int i0;
+            int i1;
+            double target;
+            double esd;
+            double contact;
+        };
+
+        // constructor and destructor
+        StructureRelaxer(const Molecule* mol, const vector<int>& freeidx,
+                const vector<TargetPair>& pairs) :
+            free_indices(freeidx), target_pairs(pairs)
+        {
+            const int n = mol->countAtoms();
+            xyz.resize(R3::Ndim * n);
+            gxyz.resize(R3::Ndim * n);
+            for (int i = 0; i != n; ++i)
+            {
+                const R3::Vector& r = mol->getAtom(i).r;
+                copy(r.begin(), r.end(), xyz.begin() + R3::Ndim * i);
+            }
+            atomcost = mol->getAtomCostCalculator();
+            atomoverlap = mol->getAtomOverlapCalculator();
+            wdistance = 1.0 / mol->countPairs();
+            woverlap = 1.0 / n;
+            fdfmin.f = &StructureRelaxer::f;
+            fdfmin.df = &StructureRelaxer::df;
+            fdfmin.fdf = &StructureRelaxer::fdf;
+            fdfmin.n = R3::Ndim * freeidx.size();
+            fdfmin.params = this;
+            minimizer = gsl_multimin_fdfminimizer_alloc(
+                    gsl_multimin_fdfminimizer_vector_bfgs2, fdfmin.n);
+            x = gsl_vector_alloc(fdfmin.n);
+        }
 
-void Molecule::AddInternal(Atom_t* pa)
-{
-    vector<Atom_t*>::iterator ai;
-    ai = find(atoms_bucket.begin(), atoms_bucket.end(), pa);
-    assert(ai != atoms_bucket.end());
-    // reset cost related attributes
-    pa->ResetBadness();
-    pa->ResetOverlap();
-    pa->pmxidx = getPairMatrixIndex();
+
+        ~StructureRelaxer()
+        {
+            gsl_multimin_fdfminimizer_free(minimizer);
+            gsl_vector_free(x);
+        }
+
+
+        // relax free atoms, return true when the objective improved
+        bool relax()
+        {
+            const int maximum_iterations = 1000;
+            const double minimizer_step = 1.0e-4;
+            const double minimizer_tol = 0.1;
+            this->getFreeCoordinates(x);
+            double initial_cost = this->evalCostGradient(x, NULL);
+            if (isNearZeroRoundOff(initial_cost))   return false;
+            gsl_multimin_fdfminimizer_set(minimizer,
+                    &fdfmin, x, minimizer_step, minimizer_tol);
+            for (int iter = 0; iter < maximum_iterations; ++iter)
+            {
+                int status = gsl_multimin_fdfminimizer_iterate(minimizer);
+                if (status != GSL_SUCCESS)  break;
+                status = gsl_multifit_test_delta(minimizer->dx,
+                        minimizer->x, eps_distance, eps_distance);
+                if (status == GSL_SUCCESS)
+                {
+                    gsl_multimin_fdfminimizer_iterate(minimizer);
+                    break;
+                }
+                if (status != GSL_CONTINUE) break;
+            }
+            bool improved = eps_lt(minimizer->f, initial_cost);
+            this->setFreeCoordinates(improved ? minimizer->x : x);
+            return improved;
+        }
+
+
+        R3::Vector position(int idx) const
+        {
+            R3::Vector rv;
+            const double* pxyz = &(xyz[R3::Ndim * idx]);
+            rv = pxyz[0], pxyz[1], pxyz[2];
+            return rv;
+        }
+
+    private:
+
+        // class methods - GSL callbacks
+        static void fdf(const gsl_vector* v, void* params,
+                double* pf, gsl_vector* g)
+        {
+            StructureRelaxer* rxs = static_cast<StructureRelaxer*>(params);
+            *pf = rxs->evalCostGradient(v, g);
+        }
+
+
+        static double f(const gsl_vector* v, void* params)
+        {
+            double rv;
+            fdf(v, params, &rv, NULL);
+            return rv;
+        }
+
+
+        static void df(const gsl_vector* v, void* params, gsl_vector* g)
+        {
+            double fv;
+            fdf(v, params, &fv, g);
+        }
+
+        // data
+        const vector<int>& free_indices;
+        const vector<TargetPair>& target_pairs;
+        vector<double> xyz;
+        vector<double> gxyz;
+        const AtomCost* atomcost;
+        const AtomCost* atomoverlap;
+        double wdistance;
+        double woverlap;
+        gsl_multimin_function_fdf fdfmin;
+        gsl_multimin_fdfminimizer* minimizer;
+        gsl_vector* x;
+
+        // methods
+        void getFreeCoordinates(gsl_vector* v) const
+        {
+            for (size_t k = 0; k != free_indices.size(); ++k)
+            {
+                for (int c = 0; c != R3::Ndim; ++c)
+                {
+                    double xc = xyz[R3::Ndim * free_indices[k] + c];
+                    gsl_vector_set(v, R3::Ndim * k + c, xc);
+                }
+            }
+        }
+
+
+        void setFreeCoordinates(const gsl_vector* v)
+        {
+            for (size_t k = 0; k != free_indices.size(); ++k)
+            {
+                for (int c = 0; c != R3::Ndim; ++c)
+                {
+                    xyz[R3::Ndim * free_indices[k] + c] =
+                        gsl_vector_get(v, R3::Ndim * k + c);
+                }
+            }
+        }
+
+
+        // objective at free coordinates v and its gradient when g is set
+        double evalCostGradient(const gsl_vector* v, gsl_vector* g)
+        {
+            this->setFreeCoordinates(v);
+            fill(gxyz.begin(), gxyz.end(), 0.0);
+            double distcost = 0.0;
+            double overlap = 0.0;
+            vector<TargetPair>::const_iterator tp = target_pairs.begin();
+            for (; tp != target_pairs.end(); ++tp)
+            {
+                const double* r0 = &(xyz[R3::Ndim * tp->i0]);
+                const double* r1 = &(xyz[R3::Ndim * tp->i1]);
+                double dx = r0[0] - r1[0];
+                double dy = r0[1] - r1[1];
+                double dz = r0[2] - r1[2];
+                double d = sqrt(dx*dx + dy*dy + dz*dz);
+                double dd = tp->target - d;
+                double od = tp->contact - d;
+                distcost += atomcost->penaltyScaled(dd, tp->esd);
+                if (od > 0.0)   overlap += atomoverlap->penaltyScaled(od, 1.0);
+                if (!g || !(d > eps_distance))  continue;
+                // derivative of the objective with respect to d
+                double g_cost_d = -wdistance *
+                    atomcost->penaltyGradientScaled(dd, tp->esd);
+                if (od > 0.0)
+                {
+                    g_cost_d -= woverlap *
+                        atomoverlap->penaltyGradientScaled(od, 1.0);
+                }
+                double s = g_cost_d / d;
+                double* g0 = &(gxyz[R3::Ndim * tp->i0]);
+                double* g1 = &(gxyz[R3::Ndim * tp->i1]);
+                g0[0] += s * dx;  g0[1] += s * dy;  g0[2] += s * dz;
+                g1[0] -= s * dx;  g1[1] -= s * dy;  g1[2] -= s * dz;
+            }
+            for (size_t k = 0; g && k != free_indices.size(); ++k)
+            {
+                for (int c = 0; c != R3::Ndim; ++c)
+                {
+                    gsl_vector_set(g, R3::Ndim * k + c,
+                            gxyz[R3::Ndim * free_indices[k] + c]);
+                }
+            }
+            return wdistance * distcost + woverlap * overlap;
+        }
+
+        // disable copying
+        StructureRelaxer(const StructureRelaxer&);
+        StructureRelaxer& operator=(const StructureRelaxer&);
+};
+
+}   // namespace
+
+
+bool Molecule::RelaxAll()
+{
+    SECTION_TIMER("Molecule::RelaxAll");
+    // periodic structures have no all-pairs cost
+    if (this->type() != MOLECULE)   return false;
+    const int n = this->countAtoms();
+    const DistanceTable& dtgt = this->getDistanceTable();
+    vector<int> freeidx;
+    for (int i = 0; i != n; ++i)
+    {
+        if (!this->atoms[i]->fixed)     freeidx.push_back(i);
+    }
+    bool nothingtodo = freeidx.empty() || n < 2 || dtgt.empty() ||
+        isNearZeroRoundOff(this->cost());
+    if (nothingtodo)    return false;
+    // hold the current target distance of every pair
+    const bool useesd = dtgt.hasESDs();
+    vector<StructureRelaxer::TargetPair> pairs;
+    pairs.reserve(this->countPairs());
+    StructureRelaxer::TargetPair tp;
+    for (tp.i0 = 0; tp.i0 != n; ++tp.i0)
+    {
+        const Atom_t* pa0 = this->atoms[tp.i0];
+        for (tp.i1 = tp.i0 + 1; tp.i1 != n; ++tp.i1)
+        {
+            const Atom_t* pa1 = this->atoms[tp.i1];
+            if (pa0->fixed && pa1->fixed)   continue;
+            boost::uint32_t uidx = this->getDistReuse() ? 0 :
+                usedIndex(pa0->pmxidx, pa1->pmxidx);
+            size_t tidx = uidx - 1;
+            if (uidx == 0 || uidx == FROZEN_PAIR)
+            {
+                double d = R3::distance(pa0->r, pa1->r);
+                tidx = dtgt.find_nearest(d) - dtgt.begin();
+            }
+            tp.target = dtgt[tidx];
+            tp.esd = useesd ? dtgt.getesdAt(tidx) : 1.0;
+            tp.contact = this->getContactRadius(*pa0, *pa1);
+            pairs.push_back(tp);
+        }
+    }
+    StructureRelaxer relaxer(this, freeidx, pairs);
+    if (!relaxer.relax())   return false;
+    // add relaxed atoms to a copy, which evaluates the exact cost
+    auto_ptr<Molecule> relaxed(this->copy());
+    vector<Atom_t*> moved;
+    for (size_t k = 0; k != freeidx.size(); ++k)
+    {
+        moved.push_back(relaxed->atoms[freeidx[k]]);
+    }
+    relaxed->Pop(list<int>(freeidx.begin(), freeidx.end()));
+    for (size_t k = 0; k != freeidx.size(); ++k)
+    {
+        relaxed->AddInternalAt(moved[k], relaxer.position(freeidx[k]));
+    }
+    if (!eps_lt(relaxed->cost(), this->cost()))     return false;
+    *this = *relaxed;
+    return true;
+}
+
+
+void Molecule::AddInternalAt(Atom_t* pa, double rx0, double ry0, double rz0)
+{
+    pa->r = rx0, ry0, rz0;
+    AddInternal(pa);
+}
+
+
+void Molecule::AddInternalAt(Atom_t* pa, const R3::Vector& rc)
+{
+    pa->r = rc;
+    AddInternal(pa);
+}
+
+
+void Molecule::AddInternal(Atom_t* pa)
+{
+    vector<Atom_t*>::iterator ai;
+    ai = find(atoms_bucket.begin(), atoms_bucket.end(), pa);
+    assert(ai != atoms_bucket.end());
+    // reset cost related attributes
+    pa->ResetBadness();
+    pa->ResetOverlap();
+    pa->pmxidx = getPairMatrixIndex();
     // create new pairs while summing up the costs
     addNewAtomPairs(pa);
     atoms_bucket.erase(ai);
     atoms.push_back(pa);
+    this->packAtom(pa);
+    this->uncacheAnchorGenerator();
     if (full())     reassignPairs();
 }
 
@@ -1054,7 +1797,7 @@ void Molecule::addNewAtomPairs(Atom_t* pa)
     }
     this->IncBadness(atomcost->totalCost());
     if (isNearZeroRoundOff(this->Badness()))  this->ResetBadness();
-    // remember used distances in pmx_used_distances
+    // remember indices of used distances in pmx_used_indices
     if (!getDistReuse())
     {
         const vector<int>& didcs = atomcost->usedTargetDistanceIndices();
@@ -1066,15 +1809,14 @@ void Molecule::addNewAtomPairs(Atom_t* pa)
         {
             int idx0 = pa->pmxidx;
             int idx1 = atoms[*aii]->pmxidx;
-            pmx_used_distances(idx0,idx1) = this->_distance_table->at(*dii);
-        }
-        // remove used distances from target table
-        set<int> uidcs(didcs.begin(), didcs.end());
-        set<int>::reverse_iterator ii;
-        for (ii = uidcs.rbegin(); ii != uidcs.rend(); ++ii)
-        {
-            DistanceTable::iterator pos = this->_distance_table->begin() + *ii;
-            this->_distance_table->erase(pos);
+            // binned cost reports the first target of a bin with room
+            size_t didx = this->_distance_usage.nextFree(*dii);
+            pmx_used_indices(idx0,idx1) = didx + 1;
+            this->_distance_usage.setUsed(didx);
+            if (this->_distance_bins.get())
+            {
+                ++(this->_distance_bin_usage[_distance_bins->binAt(didx)]);
+            }
         }
     }
     // add overlap contributions
@@ -1091,7 +1833,7 @@ void Molecule::removeAtomPairs(Atom_t* pa)
         int idx0 = pa->pmxidx;
         int idx1 = seq.ptr()->pmxidx;
         // remove pair costs
-        double pairbadness = pmx_partial_costs(idx0,idx1);
+        double pairbadness = partialCost(idx0, idx1);
         double badnesshalf = pairbadness/2.0;
         pa->DecBadness(badnesshalf);
         seq.ptr()->DecBadness(badnesshalf);
@@ -1100,16 +1842,29 @@ void Molecule::removeAtomPairs(Atom_t* pa)
     // return any associated used distances
     if (!getDistReuse())
     {
+        const DistanceTable& dtbl = *this->_distance_table;
         for (AtomSequence seq(this); !seq.finished(); seq.next())
         {
             if (pa == seq.ptr())        continue;
             // return any used distances
             int idx0 = pa->pmxidx;
             int idx1 = seq.ptr()->pmxidx;
-            double& udst = pmx_used_distances(idx0, idx1);
-            if (udst > 0.0)     this->_distance_table->return_back(udst);
-            udst = 0.0;
+            double udst = this->usedDistance(idx0, idx1);
+            if (udst > 0.0)
+            {
+                // equal distances are interchangeable, free the first one
+                size_t lo = lower_bound(dtbl.begin(), dtbl.end(), udst) -
+                    dtbl.begin();
+                size_t didx = this->_distance_usage.nextUsed(lo);
+                assert(didx < dtbl.size() && dtbl[didx] == udst);
+                this->_distance_usage.setFree(didx);
+                if (this->_distance_bins.get())
+                {
+                    --(this->_distance_bin_usage[_distance_bins->binAt(didx)]);
+                }
+            }
         }
+        pmx_used_indices.fillRow(pa->pmxidx, 0);
     }
     if (isNearZeroRoundOff(this->Badness()))  this->ResetBadness();
     // remove overlap contributions
@@ -1117,6 +1872,64 @@ void Molecule::removeAtomPairs(Atom_t* pa)
 }
 
 
+// Remove pair costs, used distances and overlaps of all atoms flagged
+// in popmask.  The pairs are subtracted in the same order as by the
+// single-atom pops from the highest index, a pair of two popped atoms
+// goes with the higher one.
+
+void Molecule::removeAtomPairs(const vector<char>& popmask)
+{
+    assert(popmask.size() == atoms.size());
+    vector<double> udsts;
+    for (int ri = countAtoms() - 1; ri >= 0; --ri)
+    {
+        if (!popmask[ri])   continue;
+        int idx0 = atoms[ri]->pmxidx;
+        for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
+        {
+            int j = seq.idx();
+            if (j == ri || (j > ri && popmask[j]))  continue;
+            int idx1 = seq.ptr()->pmxidx;
+            double pairbadness = partialCost(idx0, idx1);
+            seq.ptr()->DecBadness(pairbadness/2.0);
+            this->DecBadness(pairbadness);
+            if (getDistReuse())     continue;
+            double udst = this->usedDistance(idx0, idx1);
+            if (udst > 0.0)     udsts.push_back(udst);
+        }
+    }
+    // return used distances in a single merge with the distance table
+    if (!getDistReuse())
+    {
+        const DistanceTable& dtbl = *this->_distance_table;
+        sort(udsts.begin(), udsts.end());
+        DistanceTable::const_iterator dlo = dtbl.begin();
+        BOOST_FOREACH (double udst, udsts)
+        {
+            // equal distances are interchangeable, free the first one
+            dlo = lower_bound(dlo, dtbl.end(), udst);
+            size_t didx = this->_distance_usage.nextUsed(dlo - dtbl.begin());
+            assert(didx < dtbl.size() && dtbl[didx] == udst);
+            this->_distance_usage.setFree(didx);
+            if (this->_distance_bins.get())
+            {
+                --(this->_distance_bin_usage[_distance_bins->binAt(didx)]);
+            }
+        }
+        for (int i = 0; i != countAtoms(); ++i)
+        {
+            if (popmask[i])  pmx_used_indices.fillRow(atoms[i]->pmxidx, 0);
+        }
+    }
+    for (int i = 0; i != countAtoms(); ++i)
+    {
+        if (popmask[i])     atoms[i]->ResetBadness();
+    }
+    if (isNearZeroRoundOff(this->Badness()))  this->ResetBadness();
+    this->removeOverlapContributions(popmask);
+}
+
+
 Atom_t* Molecule::pickAtomFromBucket() const
 {
     assert(!atoms_bucket.empty());
@@ -1125,11 +1938,36 @@ Atom_t* Molecule::pickAtomFromBucket() const
 }
 
 
+const RandomWeighedGenerator& Molecule::getAnchorGenerator() const
+{
+    if (this->_anchor_generator_cached)     return this->_anchor_generator;
+    // buffer of atom fitnesses keeps its capacity between calls
+    static boost::thread_specific_ptr< vector<double> > tvafit;
+    if (!tvafit.get())  tvafit.reset(new vector<double>);
+    vector<double>& vafit = *tvafit;
+    vafit.resize(countAtoms());
+    for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
+    {
+        vafit[seq.idx()] = convertCostToFitness(seq.ptr()->Badness());
+    }
+    this->_anchor_generator.setWeights(vafit.begin(), vafit.end());
+    this->_anchor_generator_cached = true;
+    return this->_anchor_generator;
+}
+
+
+void Molecule::uncacheAnchorGenerator() const
+{
+    this->_anchor_generator_cached = false;
+}
+
+
 int Molecule::push_good_distances(
         AtomArray& vta,
         const RandomWeighedGenerator& rwg,
         int ntrials)
 {
+    SECTION_TIMER("Molecule::push_good_distances");
     using NS_LIGA::eps_distance;
     if (!ntrials)   return 0;
     // add new atom in direction defined by 2 atoms
@@ -1167,8 +2005,9 @@ int Molecule::push_good_distances(
         }
         // pick free distance
         const DistanceTable& dtbl = *this->_distance_table;
-        int didx = randomInt(dtbl.size());
-        double radius = dtbl[didx];
+        const UsageMask& dusage = this->_distance_usage;
+        int didx = randomInt(dusage.countFree());
+        double radius = dtbl[dusage.selectFree(didx)];
         // add front atom
         R3::Vector nr;
         nr = anch.B0 + direction*radius;
@@ -1197,6 +2036,7 @@ int Molecule::push_good_triangles(
         const RandomWeighedGenerator& rwg,
         int ntrials)
 {
+    SECTION_TIMER("Molecule::push_good_triangles");
     using NS_LIGA::eps_distance;
     if (!ntrials)   return 0;
     // generate randomly oriented triangles
@@ -1211,12 +2051,13 @@ int Molecule::push_good_triangles(
     {
         const TriangulationAnchor& anch = getPlaneAnchor(rwg);
         const DistanceTable& dtbl = *this->_distance_table;
+        const UsageMask& dusage = this->_distance_usage;
         // pick 2 vertex distances
         const PickType& didx = getDistReuse() ?
             randomPickWithRepeat(2, dtbl.size()) :
-            randomPickFew(2, dtbl.size());
-        double r02 = dtbl[didx[0]];
-        double r12 = dtbl[didx[1]];
+            randomPickFew(2, dusage.countFree());
+        double r02 = dtbl[dusage.selectFree(didx[0])];
+        double r12 = dtbl[dusage.selectFree(didx[1])];
         double r01 = R3::distance(anch.B0, anch.B1);
         // is triangle base reasonably large?
         if (r01 < eps_distance)    continue;
@@ -1289,6 +2130,7 @@ int Molecule::push_good_pyramids(
         const RandomWeighedGenerator& rwg,
         int ntrials)
 {
+    SECTION_TIMER("Molecule::push_good_pyramids");
     using NS_LIGA::eps_distance;
     if (!ntrials)   return 0;
     if (countAtoms() == getMaxAtomCount())
@@ -1303,10 +2145,15 @@ int Molecule::push_good_pyramids(
         // pick 3 base atoms
         const TriangulationAnchor& anch = getPyramidAnchor(rwg);
         const DistanceTable& dtbl = *this->_distance_table;
+        const UsageMask& dusage = this->_distance_usage;
         // pick 3 vertex distances
         PickType didx = getDistReuse() ?
             randomPickWithRepeat(3, dtbl.size()) :
-            randomPickFew(3, dtbl.size());
+            randomPickFew(3, dusage.countFree());
+        for (PickType::iterator ii = didx.begin(); ii != didx.end(); ++ii)
+        {
+            *ii = dusage.selectFree(*ii);
+        }
         // loop over all permutations of selected distances
         sort(didx.begin(), didx.end());
         do
@@ -1401,11 +2248,11 @@ int Molecule::push_good_pyramids(
 }
 
 
-const Molecule::TriangulationAnchor&
+Molecule::TriangulationAnchor
 Molecule::getLineAnchor(const RandomWeighedGenerator& rwg)
 {
     assert(countAtoms() >= 1);
-    static TriangulationAnchor anch;
+    TriangulationAnchor anch;
     anch.count = min(countAtoms(),2);
     const PickType& aidx = rwg.weighedPick(anch.count);
     anch.B0 = this->atoms[aidx[0]]->r;
@@ -1417,11 +2264,11 @@ Molecule::getLineAnchor(const RandomWeighedGenerator& rwg)
 }
 
 
-const Molecule::TriangulationAnchor&
+Molecule::TriangulationAnchor
 Molecule::getPlaneAnchor(const RandomWeighedGenerator& rwg)
 {
     assert(countAtoms() >= 2);
-    static TriangulationAnchor anch;
+    TriangulationAnchor anch;
     // pick 2 atoms for base and 3rd for plane orientation
     anch.count = min(countAtoms(), 3);
     const PickType& aidx = rwg.weighedPick(anch.count);
@@ -1432,11 +2279,11 @@ Molecule::getPlaneAnchor(const RandomWeighedGenerator& rwg)
 }
 
 
-const Molecule::TriangulationAnchor&
+Molecule::TriangulationAnchor
 Molecule::getPyramidAnchor(const RandomWeighedGenerator& rwg)
 {
     assert(countAtoms() >= 3);
-    static TriangulationAnchor anch;
+    TriangulationAnchor anch;
     // pick 3 base atoms
     const PickType& aidx = rwg.weighedPick(3);
     anch.count = 3;
@@ -1447,22 +2294,275 @@ Molecule::getPyramidAnchor(const RandomWeighedGenerator& rwg)
 }
 
 
-const pair<int*,int*>& Molecule::Evolve(const int* est_triang)
+// Local helpers for concurrent trial atoms in Molecule::Evolve()
+
+namespace {
+
+// pool of threads for trial atoms, serial evolution when NULL
+auto_ptr<WorkerPool> trial_workers;
+
+// number of triangulation attempts in one task of trial atoms
+const int TRIAL_CHUNK_SIZE = 128;
+
+// seconds spent on each triangulation type in the last Evolve of a thread
+__thread double triangulation_seconds[NTGTYPES];
+
+}   // namespace
+
+
+// Job which generates, filters and scores trial atoms in fixed chunks.
+// Every chunk draws from its own random stream so that the merged
+// trials do not depend on the number of threads or task order.
+
+class Molecule::TrialJob : public WorkerPool::Job
+{
+    public:
+
+        // constructor
+        TrialJob(Molecule* m, const RandomWeighedGenerator& rwg,
+                double evolve_range, double hi_abad) :
+            mol(m), anchor_generator(rwg), range(evolve_range),
+            max_abad(hi_abad), seed(randomStreamSeed())
+        { }
+
+        // methods
+        void addChunks(int ttp, int ntrials)
+        {
+            for (; ntrials > 0; ntrials -= TRIAL_CHUNK_SIZE)
+            {
+                chunk_types.push_back(ttp);
+                chunk_trials.push_back(min(ntrials, TRIAL_CHUNK_SIZE));
+            }
+            trials.resize(chunk_types.size());
+            generated.resize(chunk_types.size(), 0);
+            cutoffs.resize(chunk_types.size(), DOUBLE_MAX);
+            seconds.resize(chunk_types.size(), 0.0);
+        }
+
+
+        void run(size_t task)
+        {
+            double t0 = Counter::PreciseWallTime();
+            RandomStreamScope randomstream(this->seed, task);
+            // weighed picks modify generator buffers, use a private copy
+            RandomWeighedGenerator rwg(this->anchor_generator);
+            AtomArray& vta = this->trials[task];
+            int ntrials = this->chunk_trials[task];
+            switch (this->chunk_types[task])
+            {
+                case LINEAR:
+                    mol->push_good_distances(vta, rwg, ntrials);
+                    break;
+                case PLANAR:
+                    mol->push_good_triangles(vta, rwg, ntrials);
+                    break;
+                case SPATIAL:
+                    mol->push_good_pyramids(vta, rwg, ntrials);
+                    break;
+            }
+            this->generated[task] = vta.size();
+            mol->filter_bucket_atoms(vta);
+            this->cutoffs[task] =
+                mol->filter_good_atoms(vta, this->range, this->max_abad);
+            this->seconds[task] = Counter::PreciseWallTime() - t0;
+        }
+
+        // data
+        Molecule* mol;
+        const RandomWeighedGenerator& anchor_generator;
+        double range;
+        double max_abad;
+        unsigned long int seed;
+        vector<int> chunk_types;
+        vector<int> chunk_trials;
+        vector<AtomArray> trials;
+        vector<int> generated;
+        vector<double> cutoffs;
+        vector<double> seconds;
+};
+
+
+void Molecule::push_scored_trials(AtomArray& vta, const int* est_triang,
+        double evolve_range, double hi_abad, int* tot)
+{
+    SECTION_TIMER("Molecule::push_scored_trials");
+    TrialJob job(this, this->getAnchorGenerator(), evolve_range, hi_abad);
+    for (int ttp = LINEAR; ttp < NTGTYPES; ++ttp)
+    {
+        job.addChunks(ttp, est_triang[ttp]);
+    }
+    // shared neighbor cells must be ready before the tasks use them
+    if (this->countAtoms() >= MIN_CELL_LIST_ATOMS)  this->updateAtomCells();
+    // the pool is not reentrant, run nested tasks in this thread
+    if (WorkerPool::isWorkerThread())
+    {
+        for (size_t task = 0; task != job.trials.size(); ++task)
+        {
+            job.run(task);
+        }
+    }
+    else
+    {
+        trial_workers->execute(job, job.trials.size());
+    }
+    // merge the chunks in task order with their common cost cutoff
+    double cutoff = job.cutoffs.empty() ? hi_abad :
+        *min_element(job.cutoffs.begin(), job.cutoffs.end());
+    for (size_t task = 0; task != job.trials.size(); ++task)
+    {
+        tot[job.chunk_types[task]] += job.generated[task];
+        triangulation_seconds[job.chunk_types[task]] += job.seconds[task];
+        BOOST_FOREACH (const Atom_t& a, job.trials[task])
+        {
+            if (a.Badness() > cutoff)   continue;
+            vta.push_back(a);
+        }
+    }
+}
+
+
+void Molecule::cacheCandidates(const AtomArray& vta, int picked)
+{
+    using NS_LIGA::eps_distance;
+    this->candidate_cache.clear();
+    // anchors at target distances are not tracked for periodic images
+    if (candidatecache <= 0 || this->type() != MOLECULE)    return;
+    const DistanceTable& dtbl = *this->_distance_table;
+    if (dtbl.empty())   return;
+    // rank the rejected trial atoms by their cost
+    vector< pair<double,int> > ranked;
+    for (int i = 0; i != int(vta.size()); ++i)
+    {
+        if (i == picked)    continue;
+        ranked.push_back(make_pair(vta[i].Badness(), i));
+    }
+    int ncache = min(int(ranked.size()), candidatecache);
+    partial_sort(ranked.begin(), ranked.begin() + ncache, ranked.end());
+    for (int k = 0; k != ncache; ++k)
+    {
+        const Atom_t& a = vta[ranked[k].second];
+        CachedCandidate cc;
+        cc.r = a.r;
+        cc.ttp = a.ttp;
+        cc.source = this->storageIndex(a.mstorage_ptr);
+        // triangulated atoms are placed at exact distances from anchors
+        BOOST_FOREACH (const Atom_t* pa, this->atoms)
+        {
+            double d = R3::distance(a.r, pa->r);
+            double dnear = *dtbl.find_nearest(d);
+            if (fabs(dnear - d) > eps_distance)     continue;
+            cc.anchors.push_back(this->storageIndex(pa));
+        }
+        if (cc.anchors.empty())     continue;
+        this->candidate_cache.push_back(cc);
+    }
+}
+
+
+void Molecule::uncacheCandidates(const Atom_t* pa)
+{
+    if (this->candidate_cache.empty())  return;
+    int sidx = this->storageIndex(pa);
+    vector<CachedCandidate>::iterator ccsrc = this->candidate_cache.begin();
+    vector<CachedCandidate>::iterator ccdst = this->candidate_cache.begin();
+    for (; ccsrc != this->candidate_cache.end(); ++ccsrc)
+    {
+        const vector<int>& anchors = ccsrc->anchors;
+        if (count(anchors.begin(), anchors.end(), sidx))   continue;
+        if (ccdst != ccsrc)     *ccdst = *ccsrc;
+        ++ccdst;
+    }
+    this->candidate_cache.erase(ccdst, this->candidate_cache.end());
+}
+
+
+void Molecule::push_cached_candidates(AtomArray& vta, bool prescored,
+        double evolve_range, double hi_abad, int* tot)
+{
+    static boost::thread_specific_ptr<AtomArray> tvca;
+    if (!tvca.get())    tvca.reset(new AtomArray);
+    AtomArray& vca = *tvca;
+    vca.clear();
+    BOOST_FOREACH (const CachedCandidate& cc, this->candidate_cache)
+    {
+        Atom_t a(&this->atoms_storage[cc.source], cc.r);
+        a.ttp = cc.ttp;
+        vca.push_back(a);
+        ++tot[cc.ttp];
+    }
+    this->candidate_cache.clear();
+    // score cached atoms and apply the common cutoff with the
+    // concurrent trials, as done for their chunks in push_scored_trials
+    if (prescored)
+    {
+        filter_bucket_atoms(vca);
+        if (!vca.empty())   filter_good_atoms(vca, evolve_range, hi_abad);
+        double lowest = DOUBLE_MAX;
+        AtomArray* arrays[2] = { &vta, &vca };
+        for (int k = 0; k != 2; ++k)
+        {
+            BOOST_FOREACH (const Atom_t& a, *arrays[k])
+            {
+                lowest = min(lowest, a.Badness());
+            }
+        }
+        double cutoff = min(hi_abad, lowest + evolve_range);
+        for (int k = 0; k != 2; ++k)
+        {
+            AtomArray& va = *arrays[k];
+            AtomArray::iterator gai = va.begin();
+            for (AtomArray::iterator tai = va.begin(); tai != va.end(); ++tai)
+            {
+                if (tai->Badness() > cutoff)    continue;
+                *(gai++) = *tai;
+            }
+            va.erase(gai, va.end());
+        }
+    }
+    // cached atoms are scored first
+    vta.insert(vta.begin(), vca.begin(), vca.end());
+}
+
+
+double Molecule::badnessLimit(const double* max_costs) const
+{
+    // cost at the next level is at least the distance cost of a new atom,
+    // only molecules have a simple pair count of the next level
+    if (!max_costs || this->type() != MOLECULE)     return DOUBLE_MAX;
+    int n = this->countAtoms();
+    double max_cost = max_costs[n + 1];
+    if (max_cost == DOUBLE_MAX)     return DOUBLE_MAX;
+    double rv = max_cost * (n + 1) * n / 2 - this->Badness();
+    return rv;
+}
+
+
+pair<int*,int*> Molecule::Evolve(const int* est_triang,
+        const double* max_costs)
 {
+    SECTION_TIMER("Molecule::Evolve");
     // aliases for input arguments
     const int& nlinear = est_triang[LINEAR];
     const int& nplanar = est_triang[PLANAR];
     const int& nspatial = est_triang[SPATIAL];
-    // static result arrays
-    static int acc[NTGTYPES];
-    static int tot[NTGTYPES];
-    static pair<int*,int*> acc_tot(acc, tot);
+    // static result arrays, private to each thread
+    static __thread int acc[NTGTYPES];
+    static __thread int tot[NTGTYPES];
+    pair<int*,int*> acc_tot(acc, tot);
     // reset result arrays
     fill(acc, acc + NTGTYPES, 0);
     fill(tot, tot + NTGTYPES, 0);
+    fill(triangulation_seconds, triangulation_seconds + NTGTYPES, 0.0);
     assert(!atoms_bucket.empty());
-    // containter for test atoms
-    AtomArray vta;
+    // containers for test atoms and their fitness, which keep their
+    // capacity between calls in the same thread
+    static boost::thread_specific_ptr<AtomArray> tvta;
+    static boost::thread_specific_ptr< vector<double> > tvtafit;
+    if (!tvta.get())    tvta.reset(new AtomArray);
+    if (!tvtafit.get())     tvtafit.reset(new vector<double>);
+    AtomArray& vta = *tvta;
+    vector<double>& vtafit = *tvtafit;
+    vta.clear();
     // evolution is trivial for empty or 1-atom molecule
     switch (countAtoms())
     {
@@ -1472,59 +2572,76 @@ const pair<int*,int*>& Molecule::Evolve(const int* est_triang)
             tot[LINEAR] = 1;
             return acc_tot;
         default:
-            // create random generator weighed with atom fitnesses
-            // calculate array of atom fitnesses
-            vector<double> vacost(countAtoms());
-            vector<double> vafit(countAtoms());
-            // first fill the cost array
-            for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
-            {
-                vacost[seq.idx()] = seq.ptr()->Badness();
-            }
-            // then convert to fitness
-            vafit = costToFitness(vacost);
-            // finally create RandomWeighedGenerator
-            RandomWeighedGenerator rwg(vafit.begin(), vafit.end());
-            push_good_distances(vta, rwg, nlinear);
-            push_good_triangles(vta, rwg, nplanar);
-            push_good_pyramids(vta, rwg, nspatial);
+            break;
     }
     typedef AtomArray::iterator VAit;
-    // count total triangulation attempts
-    for (VAit ai = vta.begin(); ai != vta.end(); ++ai)
-    {
-        ++tot[ai->ttp];
-    }
     // set badness range from desired badness
     double evolve_range = countAtoms()*tol_nbad*promotefrac;
-    double hi_abad = DOUBLE_MAX;
+    // trial atoms must not raise the cost over max_costs of the next level
+    double hi_abad = this->badnessLimit(max_costs);
+    // skip trials of a hopeless match
+    if (hi_abad < 0.0)  return acc_tot;
+    // concurrent trials come already filtered and scored
+    bool prescored = trial_workers.get() != NULL;
+    if (prescored)
+    {
+        this->push_scored_trials(vta, est_triang, evolve_range, hi_abad, tot);
+    }
+    else
+    {
+        // random generator weighed with atom fitnesses
+        const RandomWeighedGenerator& rwg = this->getAnchorGenerator();
+        double t0 = Counter::PreciseWallTime();
+        push_good_distances(vta, rwg, nlinear);
+        double t1 = Counter::PreciseWallTime();
+        push_good_triangles(vta, rwg, nplanar);
+        double t2 = Counter::PreciseWallTime();
+        push_good_pyramids(vta, rwg, nspatial);
+        double t3 = Counter::PreciseWallTime();
+        triangulation_seconds[LINEAR] += t1 - t0;
+        triangulation_seconds[PLANAR] += t2 - t1;
+        triangulation_seconds[SPATIAL] += t3 - t2;
+        // count total triangulation attempts
+        for (VAit ai = vta.begin(); ai != vta.end(); ++ai)
+        {
+            ++tot[ai->ttp];
+        }
+    }
+    double tscore = Counter::PreciseWallTime();
+    // rejected trial atoms of the previous call are tried again
+    if (!this->candidate_cache.empty())
+    {
+        this->push_cached_candidates(vta, prescored,
+                evolve_range, hi_abad, tot);
+    }
     // try to add as many atoms as possible
     while (true)
     {
-        filter_bucket_atoms(vta);
-        filter_good_atoms(vta, evolve_range, hi_abad);
+        if (!prescored)
+        {
+            hi_abad = min(hi_abad, this->badnessLimit(max_costs));
+            filter_bucket_atoms(vta);
+            filter_good_atoms(vta, evolve_range, hi_abad);
+        }
+        prescored = false;
         // finished when no test atoms left
         if (vta.empty())   break;
-        // calculate fitness of test atoms
-        valarray<double> vtafit(vta.size());
-        // calculate fitness as reciprocal value of badness
-        // fill the vtafit array with badness
-        double* pfit = &vtafit[0];
+        // calculate fitness of test atoms as reciprocal value of badness
+        vtafit.resize(vta.size());
+        vector<double>::iterator pfit = vtafit.begin();
         double ppa = this->pairsPerAtomInc();
         for (VAit ai = vta.begin(); ai != vta.end(); ++ai, ++pfit)
         {
-            *pfit = ai->costShare(ppa);
+            *pfit = convertCostToFitness(ai->costShare(ppa));
         }
-        // then get the reciprocal value
-        double* ftnfirst = &(vtafit[0]);
-        double* ftnlast = &(vtafit[vtafit.size()]);
-        transform(ftnfirst, ftnlast, ftnfirst, convertCostToFitness);
         // vtafit is ready here
         int idx = randomWeighedInt(vtafit.size(), &vtafit[0]);
+        if (candidatecache > 0)     this->cacheCandidates(vta, idx);
         AddInternalAt(vta[idx].mstorage_ptr, vta[idx].r);
         acc[vta[idx].ttp]++;
         hi_abad = vta[idx].Badness() + evolve_range;
-        vta.erase(vta.begin()+idx);
+        // the added atom has left the bucket, filter_bucket_atoms
+        // drops it together with other test atoms of the same source
         if (true)
         {
             int worst_overlap_idx = max_element(atoms.begin(), atoms.end(),
@@ -1547,12 +2664,33 @@ const pair<int*,int*>& Molecule::Evolve(const int* est_triang)
             pai->ResetBadness();
         }
     }
+    // scoring time is shared by the trial atoms of all types
+    double shared = Counter::PreciseWallTime() - tscore;
+    int ntot = accumulate(tot, tot + NTGTYPES, 0);
+    for (int i = 0; ntot && i != NTGTYPES; ++i)
+    {
+        triangulation_seconds[i] += shared * tot[i] / ntot;
+    }
     return acc_tot;
 }
 
 
+const double* Molecule::triangulationSeconds()
+{
+    return triangulation_seconds;
+}
+
+
+int Molecule::countTriangulationTypes(int natoms) const
+{
+    // every triangulation type needs its number of anchor atoms
+    return min(natoms, int(NTGTYPES));
+}
+
+
 void Molecule::Degenerate(int Npop, DegenerateFlags flags)
 {
+    SECTION_TIMER("Molecule::Degenerate");
     Npop = min(countAtoms(), Npop);
     if (Npop == 0)  return;
     // build array of atom badnesses
@@ -1601,17 +2739,30 @@ void Molecule::Degenerate(int Npop, DegenerateFlags flags)
 double Molecule::getContactRadius(const Atom_t& a0, const Atom_t& a1) const
 {
     double rv = (a0.radius < 0 || a1.radius < 0) ? 0.0 :
-        (this->getSamePairRadius() >= 0 && a0.element == a1.element) ?
+        (this->getSamePairRadius() >= 0 &&
+         a0.elementId() == a1.elementId()) ?
         (2 * this->getSamePairRadius()) : (a0.radius + a1.radius);
     return rv;
 }
 
 
-void Molecule::FlipSites(int idx0, int idx1)
+double Molecule::getMaxContactRadius(const Atom_t& a) const
 {
-    this->checkAtomIndex(idx0);
-    this->checkAtomIndex(idx1);
-    Atom_t* pa0 = this->atoms[idx0];
+    if (a.radius < 0)   return 0.0;
+    double rv = a.radius + this->_packed_max_radius;
+    if (this->getSamePairRadius() >= 0)
+    {
+        rv = max(rv, 2 * this->getSamePairRadius());
+    }
+    return rv;
+}
+
+
+void Molecule::FlipSites(int idx0, int idx1)
+{
+    this->checkAtomIndex(idx0);
+    this->checkAtomIndex(idx1);
+    Atom_t* pa0 = this->atoms[idx0];
     Atom_t* pa1 = this->atoms[idx1];
     // short circuit when overlap cost does not change
     if (pa0->radius == pa1->radius)  return;
@@ -1621,44 +2772,153 @@ void Molecule::FlipSites(int idx0, int idx1)
     pa0->radius = -DOUBLE_MAX;
     this->applyOverlapContributions(pa1, REMOVE);
     swap(pa0->element, pa1->element);
+    swap(pa0->_element_id, pa1->_element_id);
     pa1->radius = radius0;
     this->applyOverlapContributions(pa1, ADD);
     pa0->radius = radius1;
     this->applyOverlapContributions(pa0, ADD);
+    swap(packed_atoms.radius[idx0], packed_atoms.radius[idx1]);
+    swap(packed_atoms.element[idx0], packed_atoms.element[idx1]);
+}
+
+
+// Local helpers for the overlap change of flipped sites
+
+namespace {
+
+// Overlap of some atom kind placed at a site of the molecule.
+// total holds the self and pair overlap with all other atoms and
+// contacts the non-zero pair overlaps sorted by atom index.
+class SiteOverlap
+{
+    public:
+
+        // data
+        double total;
+        vector< pair<int,double> > contacts;
+
+        // methods
+        void eval(const Molecule& mol, int idx, int eid, double radius)
+        {
+            Atom_t a = mol.getAtom(idx);
+            a.setElement(eid);
+            a.radius = radius;
+            AtomCost* atomoverlap = mol.getAtomOverlapCalculator();
+            this->total = atomoverlap->eval(&a, AtomCost::SELFCOST);
+            atomoverlap->eval(&a);
+            const vector<double>& pcs = atomoverlap->partialCosts();
+            this->contacts.clear();
+            for (int i = 0; i != int(pcs.size()); ++i)
+            {
+                if (i == idx || pcs[i] == 0.0)  continue;
+                this->total += pcs[i];
+                this->contacts.push_back(make_pair(i, pcs[i]));
+            }
+        }
+
+
+        // overlap excluding the pair with atom idx
+        double totalWithout(int idx) const
+        {
+            vector< pair<int,double> >::const_iterator ci;
+            ci = lower_bound(contacts.begin(), contacts.end(),
+                    make_pair(idx, -DOUBLE_MAX));
+            bool hascontact = (ci != contacts.end() && ci->first == idx);
+            return hascontact ? (this->total - ci->second) : this->total;
+        }
+};
+
+
+// overlap change when the atoms at sites i and j exchange their kinds
+double flippedOverlapDelta(int i, int j,
+        const SiteOverlap& i_as_i, const SiteOverlap& i_as_j,
+        const SiteOverlap& j_as_i, const SiteOverlap& j_as_j)
+{
+    // overlap of the i, j pair stays the same
+    double rv = i_as_j.totalWithout(j) + j_as_i.totalWithout(i) -
+        i_as_i.totalWithout(j) - j_as_j.totalWithout(i);
+    return rv;
+}
+
+}   // namespace
+
+
+double Molecule::getFlipSitesOverlapDelta(int idx0, int idx1) const
+{
+    const Atom_t& a0 = this->getAtom(idx0);
+    const Atom_t& a1 = this->getAtom(idx1);
+    if (idx0 == idx1 || a0.radius == a1.radius)     return 0.0;
+    SiteOverlap s00, s01, s10, s11;
+    s00.eval(*this, idx0, a0.elementId(), a0.radius);
+    s01.eval(*this, idx0, a1.elementId(), a1.radius);
+    s10.eval(*this, idx1, a0.elementId(), a0.radius);
+    s11.eval(*this, idx1, a1.elementId(), a1.radius);
+    return flippedOverlapDelta(idx0, idx1, s00, s01, s10, s11);
 }
 
 
 void Molecule::DownhillOverlapMinimization()
 {
     if (this->getMaxAtomRadius() <= 0.0)  return;
-    auto_ptr<Molecule> m1(this->copy());
+    const int N = this->countAtoms();
     while (true)
     {
-        struct { double overlap; int i, j; } best = {this->Overlap(), 0, 0};
-        for (int i = 0; i < this->countAtoms(); ++i)
+        // distinct kinds of atoms and the kind index at every site
+        vector< pair<int,double> > kinds;
+        vector<int> sitekind(N);
+        for (int i = 0; i < N; ++i)
+        {
+            const Atom_t& a = this->getAtom(i);
+            pair<int,double> k(a.elementId(), a.radius);
+            sitekind[i] = find(kinds.begin(), kinds.end(), k) - kinds.begin();
+            if (sitekind[i] == int(kinds.size()))   kinds.push_back(k);
+        }
+        if (kinds.size() < 2)   break;
+        // overlaps of every kind of atom at every site
+        const int K = kinds.size();
+        vector<SiteOverlap> sites(N * K);
+        for (int i = 0; i < N; ++i)
+        {
+            for (int k = 0; k < K; ++k)
+            {
+                sites[i * K + k].eval(*this, i,
+                        kinds[k].first, kinds[k].second);
+            }
+        }
+        struct { double delta; int i, j; } best = {0.0, 0, 0};
+        for (int i = 0; i < N; ++i)
         {
-            for (int j = i + 1; j < this->countAtoms(); ++j)
+            const SiteOverlap* si = &(sites[i * K]);
+            for (int j = i + 1; j < N; ++j)
             {
-                m1->FlipSites(i, j);
-                if (m1->Overlap() < best.overlap)
+                if (this->getAtom(i).radius == this->getAtom(j).radius)
                 {
-                    best.overlap = m1->Overlap();
+                    continue;
+                }
+                const SiteOverlap* sj = &(sites[j * K]);
+                int ki = sitekind[i];
+                int kj = sitekind[j];
+                double delta = flippedOverlapDelta(i, j,
+                        si[ki], si[kj], sj[ki], sj[kj]);
+                if (delta < best.delta)
+                {
+                    best.delta = delta;
                     best.i = i;
                     best.j = j;
                 }
-                m1->FlipSites(i, j);
-                assert(eps_eq(this->Overlap(), m1->Overlap()));
             }
         }
         // get out if overlap did not improve
-        if (!eps_lt(best.overlap, this->Overlap()))    break;
+        double overlap0 = this->Overlap();
+        if (!eps_lt(overlap0 + best.delta, overlap0))   break;
         assert(best.i != best.j);
         // perform this flip
         this->FlipSites(best.i, best.j);
-        m1->FlipSites(best.i, best.j);
+        assert(eps_eq(overlap0 + best.delta, this->Overlap()));
 #ifndef NDEBUG
+        double overlap1 = this->Overlap();
         this->recalculateOverlap();
-        assert(eps_eq(this->Overlap(), m1->Overlap()));
+        assert(eps_eq(overlap1, this->Overlap()));
 #endif
     }
 }
@@ -1667,22 +2927,42 @@ void Molecule::DownhillOverlapMinimization()
 void Molecule::MinimizeSiteOverlap(int idx0)
 {
     if (this->getMaxAtomRadius() <= 0.0)  return;
-    // no need to check atom index, it will be checked in FlipSites
+    this->checkAtomIndex(idx0);
+    // find the best flip from overlap changes of tentative flips,
+    // site idx0 is evaluated once for every kind of flipped atom
+    const Atom_t& a0 = this->getAtom(idx0);
+    vector< pair<int,double> > kinds;
+    kinds.push_back(make_pair(a0.elementId(), a0.radius));
+    vector<SiteOverlap> sites0(1);
+    sites0[0].eval(*this, idx0, a0.elementId(), a0.radius);
+    SiteOverlap s10, s11;
     double initial_overlap = this->Overlap();
     struct { double overlap; int idx1; } best = {initial_overlap, idx0};
     for (int idx1 = 0; idx1 < this->countAtoms(); ++idx1)
     {
-        this->FlipSites(idx0, idx1);
-        if (this->Overlap() < best.overlap)
+        const Atom_t& a1 = this->getAtom(idx1);
+        if (a0.radius == a1.radius)     continue;
+        pair<int,double> k1(a1.elementId(), a1.radius);
+        int k = find(kinds.begin(), kinds.end(), k1) - kinds.begin();
+        if (k == int(kinds.size()))
+        {
+            kinds.push_back(k1);
+            sites0.push_back(SiteOverlap());
+            sites0.back().eval(*this, idx0, k1.first, k1.second);
+        }
+        s10.eval(*this, idx1, a0.elementId(), a0.radius);
+        s11.eval(*this, idx1, a1.elementId(), a1.radius);
+        double overlap = initial_overlap + flippedOverlapDelta(
+                idx0, idx1, sites0[0], sites0[k], s10, s11);
+        if (overlap < best.overlap)
         {
-            best.overlap = this->Overlap();
+            best.overlap = overlap;
             best.idx1 = idx1;
         }
-        this->FlipSites(idx0, idx1);
     }
-    assert(eps_eq(initial_overlap, this->Overlap()));
     // perform the best flip
     this->FlipSites(idx0, best.idx1);
+    assert(eps_eq(best.overlap, this->Overlap()));
     assert(!eps_gt(this->Overlap(), initial_overlap));
 }
 
@@ -1699,9 +2979,8 @@ int Molecule::getPairMatrixIndex()
     int idx;
     if (!free_pmx_slots.empty())
     {
-        set<int>::iterator firstfree = free_pmx_slots.begin();
-        idx = *firstfree;
-        free_pmx_slots.erase(firstfree);
+        idx = free_pmx_slots.back();
+        free_pmx_slots.pop_back();
     }
     else
     {
@@ -1714,6 +2993,14 @@ int Molecule::getPairMatrixIndex()
 }
 
 
+double Molecule::usedDistance(int i0, int i1) const
+{
+    boost::uint32_t uidx = this->usedIndex(i0, i1);
+    if (uidx == 0 || uidx == FROZEN_PAIR)   return 0.0;
+    return this->_distance_table->at(uidx - 1);
+}
+
+
 void Molecule::resizePairMatrices(int sz)
 {
     int szcur = this->pmx_partial_costs.rows();
@@ -1722,10 +3009,10 @@ void Molecule::resizePairMatrices(int sz)
     int sznew2 = min(2*szcur, getMaxAtomCount());
     int sznew = max(sznew1, sznew2);
     assert(sznew <= getMaxAtomCount());
-    this->pmx_partial_costs.resize(sznew, sznew, 0.0);
+    this->pmx_partial_costs.resize(sznew, 0.0);
     if (!getDistReuse())
     {
-        this->pmx_used_distances.resize(sznew, sznew, 0.0);
+        this->pmx_used_indices.resize(sznew, 0);
     }
 }
 
@@ -1734,29 +3021,87 @@ void Molecule::returnUsedDistances()
 {
     if (getDistReuse() || !this->_distance_table.get())
     {
-        assert(this->pmx_used_distances.rows() == 0);
+        assert(this->pmx_used_indices.rows() == 0);
         return;
     }
-    // return used distances
-    for (AtomSequence seq0(this); !seq0.finished(); seq0.next())
+    // return used distances, pairs with free slots are already zero
+    this->pmx_used_indices.fill(0);
+    this->_distance_usage.clear();
+    fill(_distance_bin_usage.begin(), _distance_bin_usage.end(), 0);
+}
+
+// Local helpers for Molecule IO functions
+
+namespace {
+
+vector<Atom_t> extractDiffPyAtoms(boost::python::object stru)
+{
+    namespace python = boost::python;
+    int num_atoms = python::len(stru);
+    vector<Atom_t> rv;
+    rv.reserve(num_atoms);
+    for (int i = 0; i != num_atoms; ++i)
     {
-        AtomSequence seq1 = seq0;
-        for (seq1.next(); !seq1.finished(); seq1.next())
-        {
-            int i0 = seq0.ptr()->pmxidx;
-            int i1 = seq1.ptr()->pmxidx;
-            double& udst = pmx_used_distances(i0, i1);
-            if (udst > 0.0)     this->_distance_table->push_back(udst);
-            udst = 0.0;
-        }
+        python::object ai;
+        python::object xyz_cartn;
+        double x, y, z;
+        ai = stru[i];
+        xyz_cartn = ai.attr("xyz_cartn");
+        x = python::extract<double>(xyz_cartn[0]);
+        y = python::extract<double>(xyz_cartn[1]);
+        z = python::extract<double>(xyz_cartn[2]);
+        string smbl = python::extract<string>(ai.attr("element"));
+        rv.push_back(Atom_t(smbl, x, y, z));
     }
-    sort(this->_distance_table->begin(), this->_distance_table->end());
+    return rv;
 }
 
+
+// atoms saved in checkpoints by their storage indices
+void write_atom_indices(ostream& out, const vector<Atom_t*>& atoms,
+        const vector<Atom_t>& storage)
+{
+    write_binary(out, atoms.size());
+    BOOST_FOREACH (const Atom_t* pa, atoms)
+    {
+        int idx = pa - &storage[0];
+        write_binary(out, idx);
+    }
+}
+
+
+bool read_atom_indices(istream& in, vector<Atom_t*>& atoms,
+        vector<Atom_t>& storage)
+{
+    size_t sz;
+    if (!read_binary(in, sz) || sz > storage.size())  return false;
+    atoms.resize(sz);
+    BOOST_FOREACH (Atom_t*& pa, atoms)
+    {
+        int idx;
+        bool isread = read_binary(in, idx) &&
+            0 <= idx && size_t(idx) < storage.size();
+        if (!isread)    return false;
+        pa = &storage[idx];
+    }
+    return true;
+}
+
+}   // namespace
+
 // Molecule IO Functions -----------------------------------------------------
 
 void Molecule::ReadFile(const string& filename)
 {
+    SECTION_TIMER("Molecule::ReadFile");
+    // simple molecule formats are parsed without Python
+    vector<Atom_t> atoms;
+    if (this->type() == MOLECULE && readNativeStructure(filename, atoms))
+    {
+        this->setAtoms(atoms);
+        this->CheckIntegrity();
+        return;
+    }
     namespace python = boost::python;
     try {
         initializePython();
@@ -1773,27 +3118,48 @@ void Molecule::ReadFile(const string& filename)
 }
 
 
+// Read atoms from a structure file with no change of this Molecule.
+// Formats other than xyz and rawxyz need Python and must not be read
+// concurrently with other threads that use it.  Use setAtoms to
+// evaluate the structure cost.
+
+vector<Atom_t> Molecule::ReadFileAtoms(const string& filename) const
+{
+    vector<Atom_t> rv;
+    if (this->type() == MOLECULE && readNativeStructure(filename, rv))
+    {
+        return rv;
+    }
+    namespace python = boost::python;
+    try {
+        initializePython();
+        python::object stru = this->newDiffPyStructure();
+        python::call_method<void>(stru.ptr(), "read", filename);
+        rv = extractDiffPyAtoms(stru);
+    }
+    catch (python::error_already_set) {
+        if (PyErr_Occurred())   PyErr_Print();
+        const char* emsg = "Cannot read structure.";
+        throw IOError(emsg);
+    }
+    return rv;
+}
+
+
 void Molecule::WriteFile(const string& filename, string title)
 {
     // invalid structure format can throw exception,
     // check if write operator works first
     ostringstream output;
     this->WriteStream(output, title);
-    // test if filename is writeable
-    ofstream fid(filename.c_str(), ios_base::out|ios_base::ate);
-    if (!fid)
-    {
+    try {
+        replace_file(filename, output.str());
+    }
+    catch (IOError(e)) {
         ostringstream emsg;
-        emsg << "WriteFile(): unable to write to '" << filename << "'";
+        emsg << "WriteFile(): " << e.what();
         throw IOError(emsg.str());
     }
-    fid.close();
-    // write via temporary file
-    string writefile = filename + "XXXXXX";
-    mktempofstream(fid, writefile);
-    fid << output.str();
-    fid.close();
-    rename(writefile.c_str(), filename.c_str());
 }
 
 
@@ -1803,8 +3169,27 @@ void Molecule::setOutputFormat(const std::string& format)
 }
 
 
+void Molecule::setTrialThreads(int nthreads)
+{
+    trial_workers.reset(nthreads > 1 ? new WorkerPool(nthreads) : NULL);
+}
+
+
 void Molecule::WriteStream(ostream& fid, string title) const
 {
+    SECTION_TIMER("Molecule::WriteStream");
+    // simple formats are written without Python
+    const string& fmt = Molecule::output_format;
+    if (isNativeStructureFormat(fmt, this->type() == CRYSTAL))
+    {
+        vector<const Atom_t*> atoms;
+        for (AtomSequence seq(this); !seq.finished(); seq.next())
+        {
+            atoms.push_back(seq.ptr());
+        }
+        writeNativeStructure(fid, fmt, atoms, title);
+        return;
+    }
     namespace python = boost::python;
     try {
         python::object stru = this->convertToDiffPyStructure();
@@ -1825,12 +3210,27 @@ void Molecule::WriteStream(ostream& fid, string title) const
 boost::python::object Molecule::newDiffPyStructure() const
 {
     namespace python = boost::python;
-    python::object mstru = python::import("diffpy.structure");
-    python::object stru = mstru.attr("Structure")();
+    // import diffpy.structure on the first use only, the class object
+    // is never released as Python is not finalized before exit
+    static python::object* structure_class = NULL;
+    if (!structure_class)
+    {
+        initializePython();
+        python::object mstru = python::import("diffpy.structure");
+        structure_class = new python::object(mstru.attr("Structure"));
+    }
+    python::object stru = (*structure_class)();
     return stru;
 }
 
 
+double Molecule::fingerprintDistance(
+        const Atom_t* pa0, const Atom_t* pa1) const
+{
+    return R3::distance(pa0->r, pa1->r);
+}
+
+
 boost::python::object Molecule::convertToDiffPyStructure() const
 {
     namespace python = boost::python;
@@ -1861,28 +3261,28 @@ boost::python::object Molecule::convertToDiffPyStructure() const
 
 void Molecule::setFromDiffPyStructure(boost::python::object stru)
 {
-    namespace python = boost::python;
-    int num_atoms = python::len(stru);
+    this->setAtoms(extractDiffPyAtoms(stru));
+}
+
+
+// Replace all atoms with the specified elements and positions.
+
+void Molecule::setAtoms(const vector<Atom_t>& atoms)
+{
     this->Clear();
     atoms_storage.clear();
     atoms_bucket.clear();
-    for (int i = 0; i != num_atoms; ++i)
+    // avoid reallocation that would invalidate pointers in the bucket
+    atoms_storage.reserve(atoms.size());
+    vector<Atom_t>::const_iterator ii = atoms.begin();
+    for (; ii != atoms.end(); ++ii)
     {
-        python::object ai;
-        python::object xyz_cartn;
-        double x, y, z;
-        ai = stru[i];
-        xyz_cartn = ai.attr("xyz_cartn");
-        x = python::extract<double>(xyz_cartn[0]);
-        y = python::extract<double>(xyz_cartn[1]);
-        z = python::extract<double>(xyz_cartn[2]);
-        string smbl = python::extract<string>(ai.attr("element"));
-        atoms_storage.push_back(Atom_t(smbl, x, y, z));
+        atoms_storage.push_back(Atom_t(ii->element, ii->r));
         Atom_t* pa = &(atoms_storage.back());
         atoms_bucket.push_back(pa);
     }
     this->fetchAtomRadii();
-    list<Atom_t>::iterator ai = atoms_storage.begin();
+    vector<Atom_t>::iterator ai = atoms_storage.begin();
     for (; ai != atoms_storage.end(); ++ai)
     {
         Atom_t* pa = &(*ai);
@@ -1891,16 +3291,209 @@ void Molecule::setFromDiffPyStructure(boost::python::object stru)
 }
 
 
+// Complete team state for checkpoints.  Atoms are saved by their storage
+// slots together with the pair matrices and cached evaluations, so that
+// a team read into a copy of a team with the same storage continues
+// exactly as the saved one.  Distance usage is marked again from the
+// used indices of the pairs.
+
+void Molecule::writeCheckpoint(ostream& out) const
+{
+    write_binary(out, this->atoms_storage.size());
+    BOOST_FOREACH (const Atom_t& a, this->atoms_storage)
+    {
+        write_binary(out, a.element);
+        write_binary(out, a.r[0]);
+        write_binary(out, a.r[1]);
+        write_binary(out, a.r[2]);
+        write_binary(out, a.fixed);
+        write_binary(out, a.ttp);
+        write_binary(out, a._badness);
+        write_binary(out, a._overlap);
+        write_binary(out, a.pmxidx);
+    }
+    write_atom_indices(out, this->atoms, this->atoms_storage);
+    write_atom_indices(out, this->atoms_bucket, this->atoms_storage);
+    // const references keep the matrix storage shared with other copies
+    const SymmetricMatrix<double>& costs = this->pmx_partial_costs;
+    write_binary(out, costs.rows());
+    for (size_t i = 0; i != costs.rows(); ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)     write_binary(out, costs(i, j));
+    }
+    const SymmetricMatrix<boost::uint32_t>& used = this->pmx_used_indices;
+    write_binary(out, used.rows());
+    for (size_t i = 0; i != used.rows(); ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)     write_binary(out, used(i, j));
+    }
+    write_binary(out, this->free_pmx_slots.size());
+    BOOST_FOREACH (int idx, this->free_pmx_slots)  write_binary(out, idx);
+    write_binary(out, this->_distance_bin_usage.size());
+    BOOST_FOREACH (int cnt, this->_distance_bin_usage)  write_binary(out, cnt);
+    write_binary(out, this->_badness);
+    write_binary(out, this->_overlap);
+    write_binary(out, this->_overlap_pairs.size());
+    BOOST_FOREACH (const OverlapPair& op, this->_overlap_pairs)
+    {
+        write_binary(out, op);
+    }
+    write_binary(out, this->_overlap_pairs_cached);
+    write_binary(out, this->_overlap_pairs_scale);
+    write_binary(out, this->candidate_cache.size());
+    BOOST_FOREACH (const CachedCandidate& cc, this->candidate_cache)
+    {
+        write_binary(out, cc.r[0]);
+        write_binary(out, cc.r[1]);
+        write_binary(out, cc.r[2]);
+        write_binary(out, cc.ttp);
+        write_binary(out, cc.source);
+        write_binary(out, cc.anchors.size());
+        BOOST_FOREACH (int idx, cc.anchors)    write_binary(out, idx);
+    }
+}
+
+
+bool Molecule::readCheckpoint(istream& in)
+{
+    const size_t nstorage = this->atoms_storage.size();
+    size_t sz;
+    if (!read_binary(in, sz) || sz != nstorage)     return false;
+    BOOST_FOREACH (Atom_t& a, this->atoms_storage)
+    {
+        string smbl;
+        bool isread = read_binary(in, smbl) && smbl == a.element &&
+            read_binary(in, a.r[0]) && read_binary(in, a.r[1]) &&
+            read_binary(in, a.r[2]) && read_binary(in, a.fixed) &&
+            read_binary(in, a.ttp) && read_binary(in, a._badness) &&
+            read_binary(in, a._overlap) && read_binary(in, a.pmxidx);
+        if (!isread)    return false;
+    }
+    bool isread = read_atom_indices(in, this->atoms, this->atoms_storage) &&
+        read_atom_indices(in, this->atoms_bucket, this->atoms_storage) &&
+        this->atoms.size() + this->atoms_bucket.size() == nstorage;
+    if (!isread)    return false;
+    if (!read_binary(in, sz) || sz > size_t(getMaxAtomCount()))  return false;
+    this->pmx_partial_costs.resize(sz, 0.0);
+    for (size_t i = 0; i != sz; ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)
+        {
+            if (!read_binary(in, this->pmx_partial_costs(i, j)))  return false;
+        }
+    }
+    if (!read_binary(in, sz) || sz > size_t(getMaxAtomCount()))  return false;
+    this->pmx_used_indices.resize(sz, 0);
+    for (size_t i = 0; i != sz; ++i)
+    {
+        for (size_t j = 0; j <= i; ++j)
+        {
+            if (!read_binary(in, this->pmx_used_indices(i, j)))   return false;
+        }
+    }
+    BOOST_FOREACH (const Atom_t* pa, this->atoms)
+    {
+        isread = 0 <= pa->pmxidx &&
+            size_t(pa->pmxidx) < this->pmx_partial_costs.rows();
+        if (!isread)    return false;
+    }
+    if (!read_binary(in, sz) || sz > nstorage)  return false;
+    this->free_pmx_slots.resize(sz);
+    BOOST_FOREACH (int& idx, this->free_pmx_slots)
+    {
+        isread = read_binary(in, idx) &&
+            0 <= idx && size_t(idx) < this->pmx_partial_costs.rows();
+        if (!isread)    return false;
+    }
+    if (!read_binary(in, sz) || sz != this->_distance_bin_usage.size())
+    {
+        return false;
+    }
+    BOOST_FOREACH (int& cnt, this->_distance_bin_usage)
+    {
+        if (!read_binary(in, cnt))  return false;
+    }
+    isread = read_binary(in, this->_badness) &&
+        read_binary(in, this->_overlap) &&
+        read_binary(in, sz) && sz <= nstorage * nstorage;
+    if (!isread)    return false;
+    this->_overlap_pairs.resize(sz);
+    BOOST_FOREACH (OverlapPair& op, this->_overlap_pairs)
+    {
+        isread = read_binary(in, op) && 0 <= op.i && size_t(op.i) < nstorage &&
+            0 <= op.j && size_t(op.j) < nstorage;
+        if (!isread)    return false;
+    }
+    isread = read_binary(in, this->_overlap_pairs_cached) &&
+        read_binary(in, this->_overlap_pairs_scale) &&
+        read_binary(in, sz) && sz <= size_t(max(candidatecache, 0));
+    if (!isread)    return false;
+    this->candidate_cache.resize(sz);
+    BOOST_FOREACH (CachedCandidate& cc, this->candidate_cache)
+    {
+        isread = read_binary(in, cc.r[0]) && read_binary(in, cc.r[1]) &&
+            read_binary(in, cc.r[2]) && read_binary(in, cc.ttp) &&
+            read_binary(in, cc.source) && 0 <= cc.source &&
+            size_t(cc.source) < nstorage && read_binary(in, sz) &&
+            sz <= nstorage;
+        if (!isread)    return false;
+        cc.anchors.resize(sz);
+        BOOST_FOREACH (int& idx, cc.anchors)
+        {
+            isread = read_binary(in, idx) &&
+                0 <= idx && size_t(idx) < nstorage;
+            if (!isread)    return false;
+        }
+    }
+    // mark the distances used by the saved pairs
+    this->_distance_usage.clear();
+    if (this->pmx_used_indices.rows())
+    {
+        for (AtomSequence seq0(this); !seq0.finished(); seq0.next())
+        {
+            AtomSequence seq1 = seq0;
+            for (seq1.next(); !seq1.finished(); seq1.next())
+            {
+                int i0 = seq0.ptr()->pmxidx;
+                int i1 = seq1.ptr()->pmxidx;
+                if (size_t(max(i0, i1)) >= this->pmx_used_indices.rows())
+                {
+                    return false;
+                }
+                boost::uint32_t uidx = this->usedIndex(i0, i1);
+                if (uidx == 0 || uidx == FROZEN_PAIR)   continue;
+                if (uidx > this->_distance_usage.size())    return false;
+                this->_distance_usage.setUsed(uidx - 1);
+            }
+        }
+    }
+    this->packAtoms();
+    this->uncacheAnchorGenerator();
+    return true;
+}
+
+
 void Molecule::recalculateOverlap() const
 {
-    this->ResetOverlap();
     AtomCost* atomoverlap = this->getAtomOverlapCalculator();
+    if (!this->_overlap_pairs_cached ||
+            this->_overlap_pairs_scale != atomoverlap->getScale())
+    {
+        this->evaluateOverlapPairs();
+    }
+    // sum the molecule and atom overlaps from the overlap pairs
+    vector<double> aoverlaps(atoms_storage.size(), 0.0);
+    this->ResetOverlap();
+    BOOST_FOREACH (const OverlapPair& op, this->_overlap_pairs)
+    {
+        double aohalf = (op.i == op.j) ? op.overlap : (op.overlap / 2.0);
+        aoverlaps[op.i] += aohalf;
+        if (op.i != op.j)   aoverlaps[op.j] += aohalf;
+        this->IncOverlap(op.overlap);
+    }
     BOOST_FOREACH (Atom_t* pa, this->atoms)
     {
-        double aoself = atomoverlap->eval(pa, AtomCost::SELFCOST);
-        double aohalf = atomoverlap->eval(pa) / 2.0;
-        pa->ResetOverlap(aoself + aohalf);
-        this->IncOverlap(aoself + aohalf);
+        pa->ResetOverlap(aoverlaps[this->storageIndex(pa)]);
     }
     BOOST_FOREACH (Atom_t* pa, this->atoms_bucket)
     {
@@ -1909,26 +3502,110 @@ void Molecule::recalculateOverlap() const
 }
 
 
+void Molecule::evaluateOverlapPairs() const
+{
+    this->_overlap_pairs.clear();
+    AtomCost* atomoverlap = this->getAtomOverlapCalculator();
+    OverlapPair op;
+    for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
+    {
+        op.i = this->storageIndex(seq.ptr());
+        op.j = op.i;
+        op.overlap = atomoverlap->eval(seq.ptr(), AtomCost::SELFCOST);
+        if (op.overlap != 0.0)  this->_overlap_pairs.push_back(op);
+        if (atomoverlap->eval(seq.ptr()) == 0.0)    continue;
+        // every pair is stored once with the lower atom index
+        const vector<double>& ptcs = atomoverlap->partialCosts();
+        for (int k = seq.idx() + 1; k < countAtoms(); ++k)
+        {
+            if (ptcs[k] == 0.0)     continue;
+            op.j = this->storageIndex(this->atoms[k]);
+            op.overlap = ptcs[k];
+            this->_overlap_pairs.push_back(op);
+        }
+    }
+    this->_overlap_pairs_cached = true;
+    this->_overlap_pairs_scale = atomoverlap->getScale();
+}
+
+
+void Molecule::uncacheOverlapPairs() const
+{
+    this->_overlap_pairs_cached = false;
+}
+
+
+int Molecule::storageIndex(const Atom_t* pa) const
+{
+    int rv = pa - &(this->atoms_storage[0]);
+    assert(0 <= rv && rv < int(this->atoms_storage.size()));
+    return rv;
+}
+
+
+// Overlap contributions of a new atom are evaluated and saved as overlap
+// pairs.  Removal subtracts the saved pairs without any evaluation.
+
 void Molecule::applyOverlapContributions(Atom_t* pa, AddRemove sign)
 {
-    // add overlap contributions
+    int pidx = this->storageIndex(pa);
+    if (sign == REMOVE)
+    {
+        vector<OverlapPair>::iterator opdst = this->_overlap_pairs.begin();
+        vector<OverlapPair>::iterator op = this->_overlap_pairs.begin();
+        for (; op != this->_overlap_pairs.end(); ++op)
+        {
+            if (op->i != pidx && op->j != pidx)
+            {
+                *opdst = *op;
+                ++opdst;
+                continue;
+            }
+            int k = (op->i == pidx) ? op->j : op->i;
+            if (k != pidx)  atoms_storage[k].DecOverlap(op->overlap / 2.0);
+            this->DecOverlap(op->overlap);
+        }
+        this->_overlap_pairs.erase(opdst, this->_overlap_pairs.end());
+        pa->ResetOverlap();
+        if (isNearZeroRoundOff(this->Overlap()))    this->ResetOverlap();
+        return;
+    }
     AtomCost* atomoverlap = getAtomOverlapCalculator();
+    OverlapPair op;
+    op.i = pidx;
+    op.j = pidx;
     // self contribution
-    double aoself = atomoverlap->eval(pa, AtomCost::SELFCOST);
-    pa->IncOverlap(sign * aoself);
-    this->IncOverlap(sign * aoself);
-    // cross contributions
-    atomoverlap->eval(pa);
+    op.overlap = atomoverlap->eval(pa, AtomCost::SELFCOST);
+    if (op.overlap != 0.0)
+    {
+        this->_overlap_pairs.push_back(op);
+        pa->IncOverlap(op.overlap);
+        this->IncOverlap(op.overlap);
+    }
+    // cross contributions, nothing to do for an atom without contacts
+    double aotot = atomoverlap->eval(pa);
+    if (aotot == 0.0)   return;
+    const vector<double>& ptcs = atomoverlap->partialCosts();
     for (AtomSequenceIndex seq(this); !seq.finished(); seq.next())
     {
-        double aohalf = sign * atomoverlap->partialCosts()[seq.idx()] / 2.0;
+        op.overlap = ptcs[seq.idx()];
+        if (op.overlap == 0.0 || seq.ptr() == pa)   continue;
+        op.j = this->storageIndex(seq.ptr());
+        this->_overlap_pairs.push_back(op);
+        double aohalf = op.overlap / 2.0;
         seq.ptr()->IncOverlap(aohalf);
         pa->IncOverlap(aohalf);
     }
-    this->IncOverlap(sign * atomoverlap->totalCost());
-    if (sign == REMOVE && isNearZeroRoundOff(this->Overlap()))
+    this->IncOverlap(aotot);
+}
+
+
+void Molecule::removeOverlapContributions(const vector<char>& popmask)
+{
+    assert(popmask.size() == atoms.size());
+    for (int ri = countAtoms() - 1; ri >= 0; --ri)
     {
-        this->ResetOverlap();
+        if (popmask[ri])    this->applyOverlapContributions(atoms[ri], REMOVE);
     }
 }
 
@@ -1936,11 +3613,107 @@ void Molecule::applyOverlapContributions(Atom_t* pa, AddRemove sign)
 void Molecule::fetchAtomRadii()
 {
     const AtomRadiiTable& radiitable = this->getAtomRadiiTable();
-    BOOST_FOREACH (Atom_t& a, atoms_storage)
+    vector<double> radii(atoms_storage.size());
+    for (size_t i = 0; i != atoms_storage.size(); ++i)
     {
-        a.radius = (radiitable.empty() || a.element.empty()) ?
+        const Atom_t& a = atoms_storage[i];
+        radii[i] = (radiitable.empty() || a.element.empty()) ?
             0.0 : radiitable.lookup(a.element);
     }
+    // overlaps are updated only for the atoms with a new radius
+    vector<Atom_t*> changed;
+    BOOST_FOREACH (Atom_t* pa, this->atoms)
+    {
+        if (pa->radius != radii[this->storageIndex(pa)])  changed.push_back(pa);
+    }
+    bool incremental = this->_overlap_pairs_cached && !changed.empty();
+    if (incremental)
+    {
+        BOOST_FOREACH (Atom_t* pa, changed)  applyOverlapContributions(pa, REMOVE);
+    }
+    for (size_t i = 0; i != atoms_storage.size(); ++i)
+    {
+        atoms_storage[i].radius = radii[i];
+    }
+    this->packAtoms();
+    if (!incremental)   return;
+    // changed atoms that are not added yet must not overlap
+    BOOST_FOREACH (Atom_t* pa, changed)  pa->radius = -DOUBLE_MAX;
+    BOOST_FOREACH (Atom_t* pa, changed)
+    {
+        pa->radius = radii[this->storageIndex(pa)];
+        applyOverlapContributions(pa, ADD);
+    }
+}
+
+
+void Molecule::packAtoms()
+{
+    PackedAtoms& pk = this->packed_atoms;
+    pk.rx.clear();
+    pk.ry.clear();
+    pk.rz.clear();
+    pk.fx.clear();
+    pk.fy.clear();
+    pk.fz.clear();
+    pk.radius.clear();
+    pk.element.clear();
+    this->_packed_max_radius = 0.0;
+    BOOST_FOREACH (const Atom_t* pa, this->atoms)  this->packAtom(pa);
+    this->atom_cells.clear();
+}
+
+
+void Molecule::packAtom(const Atom_t* pa)
+{
+    PackedAtoms& pk = this->packed_atoms;
+    pk.rx.push_back(pa->r[0]);
+    pk.ry.push_back(pa->r[1]);
+    pk.rz.push_back(pa->r[2]);
+    pk.fx.push_back(pa->r[0]);
+    pk.fy.push_back(pa->r[1]);
+    pk.fz.push_back(pa->r[2]);
+    pk.radius.push_back(pa->radius);
+    this->_packed_max_radius = max(this->_packed_max_radius, pa->radius);
+    pk.element.push_back(pa->elementId());
+    this->atom_cells.clear();
+}
+
+
+void Molecule::unpackAtom(int idx)
+{
+    PackedAtoms& pk = this->packed_atoms;
+    pk.rx.erase(pk.rx.begin() + idx);
+    pk.ry.erase(pk.ry.begin() + idx);
+    pk.rz.erase(pk.rz.begin() + idx);
+    pk.fx.erase(pk.fx.begin() + idx);
+    pk.fy.erase(pk.fy.begin() + idx);
+    pk.fz.erase(pk.fz.begin() + idx);
+    bool ismaxradius = (pk.radius[idx] == this->_packed_max_radius);
+    pk.radius.erase(pk.radius.begin() + idx);
+    pk.element.erase(pk.element.begin() + idx);
+    if (ismaxradius)
+    {
+        this->_packed_max_radius = 0.0;
+        BOOST_FOREACH (double r, pk.radius)
+        {
+            this->_packed_max_radius = max(this->_packed_max_radius, r);
+        }
+    }
+    this->atom_cells.clear();
+}
+
+
+void Molecule::updateAtomCells() const
+{
+    if (this->atom_cells.isBuilt())     return;
+    const PackedAtoms& pk = this->packed_atoms;
+    // cells about the size of the largest contact distance
+    double cellsize = max(2 * this->_packed_max_radius,
+            2 * this->getSamePairRadius());
+    const DistanceTable& dtbl = *(this->_distance_table);
+    if (!(cellsize > 0.0) && !dtbl.empty())  cellsize = dtbl.front();
+    this->atom_cells.build(pk.rx, pk.ry, pk.rz, cellsize);
 }
 
 
@@ -1955,6 +3728,52 @@ void Molecule::checkAtomIndex(int idx)
 }
 
 
+// Resize atoms storage and keep atom pointers valid.  Atoms that do not
+// fit in the new storage are dropped, the new ones are added to the bucket.
+
+void Molecule::resizeAtomsStorage(size_t sz)
+{
+    size_t szold = atoms_storage.size();
+    const Atom_t* a0 = atoms_storage.empty() ? NULL : &atoms_storage[0];
+    vector<size_t> atoms_idx, bucket_idx;
+    BOOST_FOREACH (const Atom_t* pa, atoms)  atoms_idx.push_back(pa - a0);
+    BOOST_FOREACH (const Atom_t* pa, atoms_bucket)
+    {
+        bucket_idx.push_back(pa - a0);
+    }
+    atoms_storage.resize(sz, Atom_t("", 0.0, 0.0, 0.0));
+    this->candidate_cache.clear();
+    atoms.clear();
+    atoms_bucket.clear();
+    BOOST_FOREACH (size_t idx, atoms_idx)
+    {
+        if (idx < sz)   atoms.push_back(&atoms_storage[idx]);
+    }
+    BOOST_FOREACH (size_t idx, bucket_idx)
+    {
+        if (idx < sz)   atoms_bucket.push_back(&atoms_storage[idx]);
+    }
+    for (size_t idx = szold; idx < sz; ++idx)
+    {
+        atoms_bucket.push_back(&atoms_storage[idx]);
+    }
+    // drop overlap pairs of the removed atoms
+    if (sz < szold)
+    {
+        vector<OverlapPair>::iterator opdst = this->_overlap_pairs.begin();
+        vector<OverlapPair>::iterator op = this->_overlap_pairs.begin();
+        for (; op != this->_overlap_pairs.end(); ++op)
+        {
+            if (op->i >= int(sz) || op->j >= int(sz))  continue;
+            *opdst = *op;
+            ++opdst;
+        }
+        this->_overlap_pairs.erase(opdst, this->_overlap_pairs.end());
+        this->uncacheOverlapPairs();
+    }
+}
+
+
 void Molecule::PrintBadness() const
 {
     if (!countAtoms())  return;
@@ -2024,6 +3843,23 @@ void Molecule::CheckIntegrity() const
     {
         assert(set_storage.count(pa));
     }
+    const PackedAtoms& pk = this->packed_atoms;
+    assert(pk.rx.size() == atoms.size());
+    for (size_t i = 0; i != atoms.size(); ++i)
+    {
+        assert(pk.rx[i] == atoms[i]->r[0]);
+        assert(pk.ry[i] == atoms[i]->r[1]);
+        assert(pk.rz[i] == atoms[i]->r[2]);
+        assert(pk.fx[i] == float(atoms[i]->r[0]));
+        assert(pk.radius[i] == atoms[i]->radius);
+        assert(pk.element[i] == atoms[i]->elementId());
+    }
+    assert(!_anchor_generator_cached ||
+            _anchor_generator.numChoices() == atoms.size());
+    int binusage = 0;
+    BOOST_FOREACH (int cnt, _distance_bin_usage)     binusage += cnt;
+    assert(!_distance_bins.get() ||
+            size_t(binusage) == _distance_usage.countUsed());
 #endif  // NDEBUG
 }
 
@@ -2049,21 +3885,13 @@ double Molecule::rxaCheckCost(const Atom_t* pa) const
 void Molecule::rxaCheckEval(const Atom_t* pa,
         double* pcost, R3::Vector* pg) const
 {
-    rxa_useMolecule(this);
     Atom_t rta = *pa;
-    void* params = &rta;
-    // copy rta coordinates to vector x
-    gsl_vector* x = gsl_vector_alloc(3);
-    gsl_vector_set(x, 0, rta.r[0]);
-    gsl_vector_set(x, 1, rta.r[1]);
-    gsl_vector_set(x, 2, rta.r[2]);
-    gsl_vector* g = gsl_vector_alloc(3);
+    AtomRelaxer* relaxer = AtomRelaxer::threadInstance();
+    relaxer->useMolecule(this, &rta);
     // calculate both cost and gradient
-    rxa_fdf(x, params, pcost, g);
-    copyGSLvector(g, *pg);
-    gsl_vector_free(g);
-    gsl_vector_free(x);
-    rxa_useMolecule(NULL);
+    const rxa_fg& fg = relaxer->evalCostGradient(rta.r);
+    *pcost = fg.f;
+    *pg = fg.g;
 }
 
 // Non-member Operators ------------------------------------------------------
@@ -15,19 +15,24 @@
 #include <valarray>
 #include <list>
 #include <set>
+#include <boost/cstdint.hpp>
 #include <boost/shared_ptr.hpp>
 #include "Atom_t.hpp"
 #include "DistanceTable.hpp"
+#include "DistanceHistogram.hpp"
 #include "Matrix.hpp"
 #include "Random.hpp"
-#include "TraceId_t.hpp"
+#include "TraceHistory.hpp"
 #include "EmbedPython.hpp"
 #include "ChemicalFormula.hpp"
 #include "AtomRadiiTable.hpp"
+#include "UsageMask.hpp"
+#include "CellList.hpp"
 
 class AtomFilter_t;
 class AtomCost;
 class AtomOverlap;
+class WorkerPool;
 using NS_LIGA::RandomWeighedGenerator;
 
 enum StructureType { MOLECULE, CRYSTAL };
@@ -43,6 +48,22 @@ class Molecule
         friend class BondAngleFilter_t;
         friend class LoneAtomFilter_t;
 
+        // types
+        // contiguous copies of atom data in the order of atoms,
+        // element holds ids from Atom_t::elementId, fx, fy, fz are
+        // single precision coordinates for screening of trial atoms
+        struct PackedAtoms
+        {
+            std::vector<double> rx;
+            std::vector<double> ry;
+            std::vector<double> rz;
+            std::vector<float> fx;
+            std::vector<float> fy;
+            std::vector<float> fz;
+            std::vector<double> radius;
+            std::vector<int> element;
+        };
+
         // class data
         // fit parameters
         static double tol_nbad; // tolerance of normalized badness
@@ -50,16 +71,22 @@ class Molecule
         static bool promotejump;
         static bool promoterelax;
         static bool demoterelax;
+        static bool floatscreen;
+        static bool adaptivefilters;
         static double promotefrac;
+        static int candidatecache;  // rejected trial atoms kept by Evolve
         static std::vector<AtomFilter_t*> atom_filters;
 
         // class methods
         static void setOutputFormat(const std::string& format);
+        static void setTrialThreads(int nthreads);
+        // seconds per triangulation type in the last Evolve of this thread
+        static const double* triangulationSeconds();
 
         // data
         // unique identifier
         const long id;
-        std::list<TraceId_t> trace;
+        TraceHistory trace;
 
         // constructors
         Molecule();
@@ -81,11 +108,20 @@ class Molecule
         void setDistanceTable(const std::vector<double>&);
         const DistanceTable& getDistanceTable() const;
         DistanceTable getDistanceTable();
+        const UsageMask& getDistanceUsage() const;
+        // binned cost matches pairs to histogram bins of the targets
+        void setDistanceBinning(bool);
+        bool getDistanceBinning() const;
+        const DistanceHistogram* getDistanceBins() const;
+        const std::vector<int>& getDistanceBinUsage() const;
 
         virtual void setDistReuse(bool);
         bool getDistReuse() const;
 
         double getMaxAtomRadius() const;
+        // approximate bytes of this molecule, shared pair matrices
+        // count as a fraction for each of their copies
+        double memoryUsage() const;
 
         // methods - fitness/badness evaluation
         virtual double cost() const;    // total normalized cost
@@ -105,6 +141,7 @@ class Molecule
         double pairsPerAtom() const;
         double pairsPerAtomInc() const;
         int getMaxAtomCount() const;
+        int countCachedCandidates() const;  // trial atoms kept by Evolve
         void setChemicalFormula(const std::string&);
         void setChemicalFormula(const ChemicalFormula& formula);
         ChemicalFormula getChemicalFormula() const;
@@ -115,18 +152,30 @@ class Molecule
         const double& getSamePairRadius() const;
         void reassignPairs();       // improve assignment of distances
         virtual void recalculate() const;   // recalculate everything
+        // evaluate stale cost data ahead of cost() with a pool of workers
+        virtual void cacheCost(WorkerPool& workers) const;
         virtual AtomCost* getAtomCostCalculator() const;
         virtual AtomCost* getAtomOverlapCalculator() const;
         void setAtomCostScale(double sc);
         void setAtomOverlapScale(double sc);
+        void setAtomCostPenalty(const std::string& tp, double width);
 
         // methods - molecule operations
         virtual void Shift(const R3::Vector& drc);  // cartesian shift
         void Center();    // center w/r to the center of mass
+        // hash of sorted pair distances, same for translated or
+        // permuted structures
+        size_t fingerprint() const;
 
         // atom operations
         const Atom_t& getAtom(const int cidx) const  { return *atoms[cidx]; }
+        const PackedAtoms& getPackedAtoms() const  { return packed_atoms; }
         virtual AtomPtr getNearestAtom(const R3::Vector& rc) const;
+        // indices of atoms that may be within rcut from rc, ascending
+        void findNearAtoms(std::vector<int>& indices,
+                const R3::Vector& rc, double rcut) const;
+        // false only when no atom is within rcut from rc
+        bool hasNearAtoms(const R3::Vector& rc, double rcut) const;
         void Pop(const int cidx);
         void Pop(const std::list<int>& cidx);
         virtual void Clear();           // remove all atoms
@@ -135,13 +184,21 @@ class Molecule
         void Add(const Atom_t& a);      // add single external atom
         void Fix(const int cidx);       // mark atom as fixed
         int NFixed() const;             // count fixed atoms
+        void freezeFixedPairs();        // drop fixed pair distances
         void RelaxAtom(const int cidx); // relax internal atom
         void RelaxExternalAtom(Atom_t* pa);
-        virtual const std::pair<int*,int*>& Evolve(const int* est_triang);
+        // relax all free atoms together, true when cost improved
+        bool RelaxAll();
+        virtual std::pair<int*,int*> Evolve(const int* est_triang,
+                const double* max_costs=NULL);
+        // triangulation types usable for structures with natoms atoms
+        virtual int countTriangulationTypes(int natoms) const;
         enum DegenerateFlags { NONE=0, FAST=1 };
         virtual void Degenerate(int Npop, DegenerateFlags=NONE);
         double getContactRadius(const Atom_t& a0, const Atom_t& a1) const;
+        double getMaxContactRadius(const Atom_t& a) const;
         void FlipSites(int idx0, int idx1);
+        double getFlipSitesOverlapDelta(int idx0, int idx1) const;
         void DownhillOverlapMinimization();
         void MinimizeSiteOverlap(int idx);
         std::string PickElementFromBucket() const;
@@ -149,9 +206,15 @@ class Molecule
         // IO functions
         boost::python::object convertToDiffPyStructure() const;
         virtual void setFromDiffPyStructure(boost::python::object);
+        void setAtoms(const std::vector<Atom_t>&);  // replace all atoms
         void ReadFile(const std::string&);  // read from existing file
+        std::vector<Atom_t> ReadFileAtoms(const std::string&) const;
         void WriteFile(const std::string&, std::string title="");
         void WriteStream(std::ostream&, std::string title="") const;
+        // complete state of a team, read into a copy of a team
+        // with the same atom storage
+        virtual void writeCheckpoint(std::ostream& out) const;
+        virtual bool readCheckpoint(std::istream& in);
         void PrintBadness() const;      // total and per-atomic badness
         void PrintFitness();            // total and per-atomic fitness
         void CheckIntegrity() const;
@@ -170,21 +233,64 @@ class Molecule
             R3::Vector B2;
             int count;
         };
+        // job which generates and scores trial atoms in chunks
+        class TrialJob;
+        friend class TrialJob;
 
         // class data
         static std::string output_format;
 
         // data
+        // sorted target distances, immutable and shared between copies
         boost::shared_ptr<DistanceTable> _distance_table;
+        // target distances consumed by atom pairs when not reused
+        UsageMask _distance_usage;
+        // target histogram and counts of its used distances per bin,
+        // set only for the binned cost
+        boost::shared_ptr<const DistanceHistogram> _distance_bins;
+        std::vector<int> _distance_bin_usage;
         boost::shared_ptr<AtomRadiiTable> _atom_radii_table;
         std::vector<Atom_t*> atoms;         // atoms in the Molecule
         std::vector<Atom_t*> atoms_bucket;  // available free atoms
-        std::list<Atom_t> atoms_storage;    // all atom instances
+        std::vector<Atom_t> atoms_storage;  // all atom instances
+        PackedAtoms packed_atoms;           // atoms data for cost kernels
+        double _packed_max_radius;          // largest packed atom radius
+        mutable CellList atom_cells;        // cells of packed atoms
         mutable SymmetricMatrix<double> pmx_partial_costs;
-        mutable SymmetricMatrix<double> pmx_used_distances;
-        mutable std::set<int> free_pmx_slots;
+        // 1 + index of the target distance used by a pair, zero when
+        // the pair has none, FROZEN_PAIR after removal by freezeFixedPairs
+        mutable SymmetricMatrix<boost::uint32_t> pmx_used_indices;
+        std::vector<int> free_pmx_slots;    // stack of unused pmx rows
         mutable double _badness;        // molecular badness
         mutable double _overlap;        // total atom overlap
+        // atom pairs in contact by their indices in atoms_storage,
+        // self overlaps with periodic images are stored with i == j
+        struct OverlapPair
+        {
+            int i;
+            int j;
+            double overlap;
+        };
+        mutable std::vector<OverlapPair> _overlap_pairs;
+        // overlap pairs are evaluated again after a change of scale,
+        // lattice or contact radii
+        mutable bool _overlap_pairs_cached;
+        mutable double _overlap_pairs_scale;
+        // generator of anchor atoms weighed with atom fitnesses,
+        // rebuilt by getAnchorGenerator after changes of badness
+        mutable RandomWeighedGenerator _anchor_generator;
+        mutable bool _anchor_generator_cached;
+        // best rejected trial atoms of the last Evolve, which are scored
+        // again in the next one.  Anchors are storage indices of atoms at
+        // target distances, candidates are dropped when anchors are popped.
+        struct CachedCandidate
+        {
+            R3::Vector r;
+            triangulation_type ttp;
+            int source;
+            std::vector<int> anchors;
+        };
+        std::vector<CachedCandidate> candidate_cache;
 
         // methods
         void AddInternalAt(Atom_t* pa, double rx0, double ry0, double rz0);
@@ -192,30 +298,62 @@ class Molecule
         virtual void AddInternal(Atom_t* pa);   // add atom from the storage
         virtual void addNewAtomPairs(Atom_t* pa);
         virtual void removeAtomPairs(Atom_t* pa);
+        virtual void removeAtomPairs(const std::vector<char>& popmask);
         Atom_t* pickAtomFromBucket() const;
+        const RandomWeighedGenerator& getAnchorGenerator() const;
+        void uncacheAnchorGenerator() const;
         int push_good_distances(AtomArray& vta,
                 const RandomWeighedGenerator& rwg, int ntrials);
         int push_good_triangles(AtomArray& vta,
                 const RandomWeighedGenerator& rwg, int ntrials);
         int push_good_pyramids(AtomArray& vta,
                 const RandomWeighedGenerator& rwg, int ntrials);
-        virtual const TriangulationAnchor&
+        virtual TriangulationAnchor
             getLineAnchor(const RandomWeighedGenerator& rwg);
-        virtual const TriangulationAnchor&
+        virtual TriangulationAnchor
             getPlaneAnchor(const RandomWeighedGenerator& rwg);
-        virtual const TriangulationAnchor&
+        virtual TriangulationAnchor
             getPyramidAnchor(const RandomWeighedGenerator& rwg);
-        void filter_good_atoms(AtomArray& vta,
+        void push_scored_trials(AtomArray& vta, const int* est_triang,
+                double evolve_range, double hi_abad, int* tot);
+        void cacheCandidates(const AtomArray& vta, int picked);
+        void uncacheCandidates(const Atom_t* pa);
+        void push_cached_candidates(AtomArray& vta, bool prescored,
+                double evolve_range, double hi_abad, int* tot);
+        double badnessLimit(const double* max_costs) const;
+        double filter_good_atoms(AtomArray& vta,
                 double evolve_range, double hi_abad);
         void filter_bucket_atoms(AtomArray& vta);
         bool check_atom_filters(Atom_t*);
         virtual void resizePairMatrices(int sz);
         virtual boost::python::object newDiffPyStructure() const;
+        virtual double fingerprintDistance(
+                const Atom_t* pa0, const Atom_t* pa1) const;
         void recalculateOverlap() const;
         enum AddRemove { ADD = 1, REMOVE = -1 };
         void applyOverlapContributions(Atom_t* pa, AddRemove sign);
+        void removeOverlapContributions(const std::vector<char>& popmask);
+        void uncacheOverlapPairs() const;
+        void evaluateOverlapPairs() const;
+        int storageIndex(const Atom_t* pa) const;
         void fetchAtomRadii();
         void checkAtomIndex(int idx);
+        void resizeAtomsStorage(size_t sz);
+        void packAtoms();
+        void packAtom(const Atom_t* pa);
+        void unpackAtom(int idx);
+        void updateAtomCells() const;
+        // read pair matrices without detaching the storage shared by copies
+        inline double partialCost(int i0, int i1) const
+        {
+            const SymmetricMatrix<double>& pmx = pmx_partial_costs;
+            return pmx(i0, i1);
+        }
+        inline boost::uint32_t usedIndex(int i0, int i1) const
+        {
+            const SymmetricMatrix<boost::uint32_t>& pmx = pmx_used_indices;
+            return pmx(i0, i1);
+        }
 
     private:
 
@@ -230,6 +368,7 @@ class Molecule
         // constructor helper
         void init();
         int getPairMatrixIndex();
+        double usedDistance(int i0, int i1) const;
         void returnUsedDistances();
         void rxaCheckEval(const Atom_t*, double*, R3::Vector*) const;
 };
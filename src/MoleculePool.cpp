@@ -0,0 +1,93 @@
+/***********************************************************************
+* Short Title: pool of spare molecules recycled for team copies
+*
+* Comments: implementation of MoleculePool
+*
+* <license text>
+***********************************************************************/
+
+#include "MoleculePool.hpp"
+#include "Molecule.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////
+// class MoleculePool
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor and destructor ------------------------------------------------
+
+MoleculePool::MoleculePool() : _capacity(0)
+{ }
+
+
+MoleculePool::~MoleculePool()
+{
+    this->clear();
+}
+
+// Public Methods ------------------------------------------------------------
+
+// keep at most capacity spare molecules and fill the pool with copies
+// of prototype, which are resized later by assignment if necessary
+
+void MoleculePool::reserve(const Molecule& prototype, size_t capacity)
+{
+    _capacity = capacity;
+    while (_spares.size() > _capacity)
+    {
+        delete _spares.back();
+        _spares.pop_back();
+    }
+    _spares.reserve(_capacity);
+    while (_spares.size() < _capacity)  _spares.push_back(prototype.copy());
+}
+
+
+Molecule* MoleculePool::copy(const Molecule& src)
+{
+    Molecule* mol = this->take();
+    if (!mol)   return src.copy();
+    *mol = src;
+    return mol;
+}
+
+
+// spare molecule with undefined content or NULL when the pool is empty
+
+Molecule* MoleculePool::take()
+{
+    if (_spares.empty())    return NULL;
+    Molecule* mol = _spares.back();
+    _spares.pop_back();
+    return mol;
+}
+
+
+void MoleculePool::recycle(Molecule* mol)
+{
+    if (mol && _spares.size() < _capacity)  _spares.push_back(mol);
+    else    delete mol;
+}
+
+
+void MoleculePool::clear()
+{
+    vector<Molecule*>::iterator mi;
+    for (mi = _spares.begin(); mi != _spares.end(); ++mi)   delete *mi;
+    _spares.clear();
+}
+
+
+size_t MoleculePool::size() const
+{
+    return _spares.size();
+}
+
+
+size_t MoleculePool::capacity() const
+{
+    return _capacity;
+}
+
+// End of file
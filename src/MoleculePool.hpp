@@ -0,0 +1,49 @@
+/***********************************************************************
+* Short Title: pool of spare molecules recycled for team copies
+*
+* Comments: MoleculePool holds preallocated molecules of the run's
+*     formula.  copy fills a spare molecule by assignment, which reuses
+*     its atom storage, and allocates only when the pool is empty.
+*     Discarded molecules are recycled into the pool up to its capacity.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef MOLECULEPOOL_HPP_INCLUDED
+#define MOLECULEPOOL_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+class Molecule;
+
+class MoleculePool
+{
+    public:
+
+        // constructor and destructor
+        MoleculePool();
+        ~MoleculePool();
+
+        // methods
+        void reserve(const Molecule& prototype, size_t capacity);
+        Molecule* copy(const Molecule& src);
+        Molecule* take();
+        void recycle(Molecule* mol);
+        void clear();
+        size_t size() const;
+        size_t capacity() const;
+
+    private:
+
+        // data
+        std::vector<Molecule*> _spares;
+        size_t _capacity;
+
+        // disable copying
+        MoleculePool(const MoleculePool&);
+        MoleculePool& operator=(const MoleculePool&);
+
+};
+
+#endif  // MOLECULEPOOL_HPP_INCLUDED
@@ -293,6 +293,8 @@ void ParseArgs::init()
 
 void ParseArgs::do_getopt()
 {
+    // restart the scan when arguments are parsed more than once
+    optind = 0;
     while (true)
     {
         int c = getopt(argc, argv, optstring);
@@ -311,6 +313,8 @@ void ParseArgs::do_getopt()
 
 void ParseArgs::do_getopt_long()
 {
+    // restart the scan when arguments are parsed more than once
+    optind = 0;
     while (true)
     {
         int option_index = 0;
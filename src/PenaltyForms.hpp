@@ -0,0 +1,90 @@
+/***********************************************************************
+* Short Title: penalty forms for the pair distance cost
+*
+* Comments: Penalty classes return cost of a normalized deviation
+*     w = dd / desd of a pair distance from its target and the cost
+*     derivative with respect to w.  They are plugged into the cost
+*     kernels of AtomCost as template arguments, a new form needs
+*     the value and derivative methods and a PenaltyType entry.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef PENALTYFORMS_HPP_INCLUDED
+#define PENALTYFORMS_HPP_INCLUDED
+
+#include <cmath>
+
+// square deviation, the default least squares cost
+
+class SquarePenalty
+{
+    public:
+
+        SquarePenalty(double=1.0)  { }
+
+        double value(const double& w) const
+        {
+            return w * w;
+        }
+
+        double derivative(const double& w) const
+        {
+            return 2 * w;
+        }
+};
+
+
+// square deviation up to width and linear beyond, less sensitive
+// to outlier distances
+
+class HuberPenalty
+{
+    public:
+
+        HuberPenalty(double width=1.0) : mwidth(width)  { }
+
+        double value(const double& w) const
+        {
+            double aw = fabs(w);
+            return (aw <= mwidth) ? (w * w) : (mwidth * (2 * aw - mwidth));
+        }
+
+        double derivative(const double& w) const
+        {
+            if (fabs(w) <= mwidth)  return 2 * w;
+            return (w < 0) ? (-2 * mwidth) : (2 * mwidth);
+        }
+
+    private:
+
+        double mwidth;
+};
+
+
+// zero within width, square of the excess deviation beyond
+
+class FlatBottomPenalty
+{
+    public:
+
+        FlatBottomPenalty(double width=1.0) : mwidth(width)  { }
+
+        double value(const double& w) const
+        {
+            double ew = fabs(w) - mwidth;
+            return (ew > 0) ? (ew * ew) : 0.0;
+        }
+
+        double derivative(const double& w) const
+        {
+            if (fabs(w) <= mwidth)  return 0.0;
+            return (w < 0) ? (2 * (w + mwidth)) : (2 * (w - mwidth));
+        }
+
+    private:
+
+        double mwidth;
+};
+
+#endif  // PENALTYFORMS_HPP_INCLUDED
@@ -35,13 +35,13 @@ typedef blitz::TinyVector<double,Ndim> Vector;
 double determinant(const Matrix& A);
 Matrix inverse(const Matrix& A);
 Matrix transpose(const Matrix& A);
-const Matrix& product(const Matrix&, const Matrix&);
+Matrix product(const Matrix&, const Matrix&);
 
 template <class V> double norm(const V&);
 template <class V> double distance(const V& u, const V& v);
 template <class V> double dot(const V& u, const V& v);
 template <class V> Vector cross(const V& u, const V& v);
-const Vector& product(const Vector&, const Matrix&);
+Vector product(const Vector&, const Matrix&);
 
 template <class M>
     bool MatricesAlmostEqual(const M& A, const M& B, double precision=0.0);
@@ -70,7 +70,7 @@ inline double distance(const V& u, const V& v)
     static Counter* R3_distance_calls =
         Counter::getCounter("R3_distance_calls");
     R3_distance_calls->count();
-    static R3::Vector duv;
+    R3::Vector duv;
     duv[0] = u[0] - v[0];
     duv[1] = u[1] - v[1];
     duv[2] = u[2] - v[2];
@@ -96,9 +96,9 @@ inline Vector cross(const V& u, const V& v)
 }
 
 
-inline const Vector& product(const Vector& u, const Matrix& M)
+inline Vector product(const Vector& u, const Matrix& M)
 {
-    static Vector res;
+    Vector res;
     res[0] = u[0]*M(0,0) + u[1]*M(1,0)+ u[2]*M(2,0);
     res[1] = u[0]*M(0,1) + u[1]*M(1,1)+ u[2]*M(2,1);
     res[2] = u[0]*M(0,2) + u[1]*M(1,2)+ u[2]*M(2,2);
@@ -8,8 +8,9 @@
 
 #include <cassert>
 #include <map>
-#include <memory>
 #include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/thread/tss.hpp>
 #include "Random.hpp"
 
 using namespace std;
@@ -23,6 +24,19 @@ namespace NS_LIGA {
 
 // RNG type and state
 gsl_rng* rng = gsl_rng_alloc(gsl_rng_default);
+__thread gsl_rng* thread_rng = NULL;
+
+namespace {
+
+// return per-thread instance of T, create it when needed
+template <class T>
+T& threadInstance(boost::thread_specific_ptr<T>& tsp)
+{
+    if (!tsp.get())     tsp.reset(new T);
+    return *tsp;
+}
+
+}   // namespace
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -38,6 +52,40 @@ R3::Vector randomDir()
     return rdir;
 }
 
+// raw state of the main generator rng for saving and restoring
+
+string randomState()
+{
+    const char* pstate = static_cast<const char*>(gsl_rng_state(rng));
+    return string(pstate, gsl_rng_size(rng));
+}
+
+void setRandomState(const string& state)
+{
+    if (state.size() != gsl_rng_size(rng))
+    {
+        const char* emsg = "setRandomState(): invalid size of generator state";
+        throw invalid_argument(emsg);
+    }
+    char* pstate = static_cast<char*>(gsl_rng_state(rng));
+    copy(state.begin(), state.end(), pstate);
+}
+
+// Seed of an independent random stream derived from the seed value and
+// the stream counter.  The result depends only on the arguments and not
+// on the state of any generator.  Uses the SplitMix64 mixing function.
+unsigned long int randomStreamSeed(unsigned long int seed,
+        unsigned long int stream)
+{
+    using boost::uint64_t;
+    uint64_t z = uint64_t(seed) +
+        (uint64_t(stream) + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= (z >> 31);
+    return (unsigned long int)(z);
+}
+
 const PickType& randomPickFew(size_t k, size_t N)
 {
     // cannot pick more items than available
@@ -45,7 +93,8 @@ const PickType& randomPickFew(size_t k, size_t N)
     {
         throw out_of_range("randomPickFew(): too many items to pick");
     }
-    static PickType pick;
+    static boost::thread_specific_ptr<PickType> tpick;
+    PickType& pick = threadInstance(tpick);
     pick.resize(k);
     // check trivial case
     if (k == 0)
@@ -71,7 +120,8 @@ const PickType& randomPickFew(size_t k, size_t N)
 
 const PickType& randomPickWithRepeat(size_t k, size_t N)
 {
-    static PickType pick;
+    static boost::thread_specific_ptr<PickType> tpick;
+    PickType& pick = threadInstance(tpick);
     pick.resize(k);
     for (PickType::iterator vi = pick.begin(); vi != pick.end(); ++vi)
     {
@@ -88,8 +138,8 @@ const PickType& randomPickWithRepeat(size_t k, size_t N)
 
 RandomWeighedGenerator* RandomWeighedGenerator::instance()
 {
-    static auto_ptr<RandomWeighedGenerator> the_rwg(new RandomWeighedGenerator);
-    return the_rwg.get();
+    static boost::thread_specific_ptr<RandomWeighedGenerator> the_rwg;
+    return &threadInstance(the_rwg);
 }
 
 // constructors
@@ -102,6 +152,23 @@ RandomWeighedGenerator::RandomWeighedGenerator()
 
 // public methods
 
+// change weight of one choice in O(log N) by updating the sum tree
+
+void RandomWeighedGenerator::setWeight(size_t idx, double w)
+{
+    if (w < 0.0)
+    {
+        const char* emsg = "setWeight(): negative choice probability";
+        throw out_of_range(emsg);
+    }
+    assert(idx < numChoices());
+    if (this->_sum_tree.empty())    this->buildSumTree();
+    this->_weight[idx] = w;
+    this->setTreeWeight(idx, w);
+    this->_cumul_weight.clear();
+    this->_total_weight = this->_sum_tree[1];
+}
+
 const PickType& RandomWeighedGenerator::weighedPick(size_t k) const
 {
     size_t N = numChoices();
@@ -117,47 +184,26 @@ const PickType& RandomWeighedGenerator::weighedPick(size_t k) const
     {
         return this->_pick;
     }
-    // here we can do some real work
-    // create working copies of _cumul_weight and _total_weight
-    double cwts[N];
-    copy(this->_cumul_weight.begin(), this->_cumul_weight.end(), cwts);
-    double totwts = this->_total_weight;
-    // save original indices
-    this->_pick_index.resize(N);
-    for (size_t i = 0; i != N; ++i)
-    {
-        this->_pick_index[i] = i;
-    }
-    // main loop
-    PickType::iterator vi = this->_pick.begin();
-    for (size_t i = 0, Nrem = N; i != k; ++i, --Nrem, ++vi)
+    // picked items get zero weight in the sum tree until all are picked,
+    // tree sums are recomputed from the leaves so that they do not
+    // accumulate round-off errors
+    if (this->_sum_tree.empty())    this->buildSumTree();
+    const double& totwts = this->_sum_tree[1];
+    for (size_t i = 0, Nrem = N; i != k; ++i, --Nrem)
     {
         assert(Nrem > 0);
         // probabilities are uniform when totwts == 0.0
-        if (totwts == 0.0)
-        {
-            size_t isel = randomInt(Nrem);
-            *vi = this->_pick_index[isel];
-            // overwrite this element with the last number
-            this->_pick_index[isel] = this->_pick_index[Nrem-1];
-        }
-        // otherwise we need to do binary search on cwts
-        else
-        {
-            double* p;
-            p = lower_bound(cwts, cwts + Nrem, totwts*randomFloat());
-            size_t isel = p - cwts;
-            *vi = this->_pick_index[isel];
-            // overwrite this element with the last number
-            this->_pick_index[isel] = this->_pick_index[Nrem-1];
-            // and update cwts
-            totwts = (p == cwts) ? 0.0 : *(p-1);
-            for (size_t j = isel; j != Nrem - 1; ++j, ++p)
-            {
-                totwts += this->_weight[this->_pick_index[j]];
-                *p = totwts;
-            }
-        }
+        size_t isel = (totwts == 0.0) ?
+            this->nthUnpicked(randomInt(Nrem), i) :
+            this->findTreeWeight(totwts*randomFloat());
+        this->_pick[i] = isel;
+        this->setTreeWeight(isel, 0.0);
+    }
+    // restore weights of the picked items
+    PickType::const_iterator vi;
+    for (vi = this->_pick.begin(); vi != this->_pick.end(); ++vi)
+    {
+        this->setTreeWeight(*vi, this->_weight[*vi]);
     }
     return this->_pick;
 }
@@ -171,17 +217,103 @@ size_t RandomWeighedGenerator::weighedInt() const
     }
     // here this->_total_weight > 0.0
     double ranval = this->_total_weight*randomFloat();
+    if (this->_cumul_weight.empty())    return this->findTreeWeight(ranval);
     size_t idx;
     idx = lower_bound(this->_cumul_weight.begin(), this->_cumul_weight.end(),
             ranval) - this->_cumul_weight.begin();
     return idx;
 }
 
+// private methods
+
+void RandomWeighedGenerator::buildSumTree() const
+{
+    size_t N = numChoices();
+    size_t leaf = 1;
+    while (leaf < N)    leaf *= 2;
+    this->_sum_tree_leaf = leaf;
+    this->_sum_tree.assign(2 * leaf, 0.0);
+    copy(this->_weight.begin(), this->_weight.end(),
+            this->_sum_tree.begin() + leaf);
+    for (size_t i = leaf - 1; i > 0; --i)
+    {
+        this->_sum_tree[i] = this->_sum_tree[2*i] + this->_sum_tree[2*i + 1];
+    }
+}
+
+void RandomWeighedGenerator::setTreeWeight(size_t idx, double w) const
+{
+    vector<double>& st = this->_sum_tree;
+    size_t i = this->_sum_tree_leaf + idx;
+    st[i] = w;
+    for (i /= 2; i > 0; i /= 2)     st[i] = st[2*i] + st[2*i + 1];
+}
+
+// index of the item where cumulative weight of the tree leaves reaches w
+
+size_t RandomWeighedGenerator::findTreeWeight(double w) const
+{
+    const vector<double>& st = this->_sum_tree;
+    size_t i = 1;
+    while (i < this->_sum_tree_leaf)
+    {
+        const double& wleft = st[2*i];
+        const double& wright = st[2*i + 1];
+        // never descend to branches of zero weight
+        if (wright == 0.0 || (wleft != 0.0 && w < wleft))
+        {
+            i = 2*i;
+        }
+        else
+        {
+            w -= wleft;
+            i = 2*i + 1;
+        }
+    }
+    return i - this->_sum_tree_leaf;
+}
+
+// index of the n-th item that is not among the first npicked picks
+
+size_t RandomWeighedGenerator::nthUnpicked(size_t n, size_t npicked) const
+{
+    PickType picked(this->_pick.begin(), this->_pick.begin() + npicked);
+    sort(picked.begin(), picked.end());
+    PickType::const_iterator pi;
+    for (pi = picked.begin(); pi != picked.end() && *pi <= n; ++pi)  ++n;
+    return n;
+}
+
 
 ////////////////////////////////////////////////////////////////////////
-// Function definitions
+// class RandomStreamScope  -  definitions
 ////////////////////////////////////////////////////////////////////////
 
+RandomStreamScope::RandomStreamScope(unsigned long int seed)
+{
+    _rng = gsl_rng_alloc(gsl_rng_default);
+    gsl_rng_set(_rng, seed);
+    _saved_rng = thread_rng;
+    thread_rng = _rng;
+}
+
+
+RandomStreamScope::RandomStreamScope(unsigned long int seed,
+        unsigned long int stream)
+{
+    _rng = gsl_rng_alloc(gsl_rng_default);
+    gsl_rng_set(_rng, randomStreamSeed(seed, stream));
+    _saved_rng = thread_rng;
+    thread_rng = _rng;
+}
+
+
+RandomStreamScope::~RandomStreamScope()
+{
+    thread_rng = _saved_rng;
+    gsl_rng_free(_rng);
+}
+
 
 }   // namespace NS_LIGA
 
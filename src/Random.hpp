@@ -12,6 +12,7 @@
 #include <numeric>
 #include <vector>
 #include <stdexcept>
+#include <string>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 #include "R3linalg.hpp"
@@ -26,12 +27,20 @@ typedef std::vector<size_t> PickType;
 
 // random number generator state
 extern gsl_rng* rng;
+// optional generator of the current thread, overrides rng when set
+extern __thread gsl_rng* thread_rng;
 
 ////////////////////////////////////////////////////////////////////////
 // Function declarations
 ////////////////////////////////////////////////////////////////////////
 
+inline gsl_rng* currentRNG();
 inline void randomSeed(unsigned long int seed);
+std::string randomState();
+void setRandomState(const std::string& state);
+inline unsigned long int randomStreamSeed();
+unsigned long int randomStreamSeed(unsigned long int seed,
+        unsigned long int stream);
 inline double randomFloat();
 inline size_t randomInt(size_t N);
 inline int plusminus();
@@ -62,6 +71,7 @@ class RandomWeighedGenerator
 
         // methods
         template <class Iter> void setWeights(Iter first, Iter last);
+        void setWeight(size_t idx, double w);
         inline size_t numChoices() const;
         const PickType& weighedPick(size_t k) const;
         size_t weighedInt() const;
@@ -70,29 +80,74 @@ class RandomWeighedGenerator
 
         // data
         std::vector<double> _weight;
+        // cumulative weights, empty after setWeight when the sum tree
+        // is used for selection
         std::vector<double> _cumul_weight;
         double _total_weight;
-        mutable PickType _pick_index;
+        // binary tree of weight sums for picks without repetition,
+        // leaves start at _sum_tree_leaf, built when first needed
+        mutable std::vector<double> _sum_tree;
+        mutable size_t _sum_tree_leaf;
         mutable PickType _pick;
+
+        // methods
+        void buildSumTree() const;
+        void setTreeWeight(size_t idx, double w) const;
+        size_t findTreeWeight(double w) const;
+        size_t nthUnpicked(size_t n, size_t npicked) const;
+};
+
+
+// Use private random generator in the current thread while in scope.
+// The generator is seeded either directly or as the stream-th stream
+// split from the seed value.
+class RandomStreamScope
+{
+    public:
+
+        // constructors and destructor
+        RandomStreamScope(unsigned long int seed);
+        RandomStreamScope(unsigned long int seed, unsigned long int stream);
+        ~RandomStreamScope();
+
+    private:
+
+        // data
+        gsl_rng* _rng;
+        gsl_rng* _saved_rng;
+
+        // disable copying
+        RandomStreamScope(const RandomStreamScope&);
+        RandomStreamScope& operator=(const RandomStreamScope&);
 };
 
 ////////////////////////////////////////////////////////////////////////
 // Definitions of inline functions
 ////////////////////////////////////////////////////////////////////////
 
+inline gsl_rng* currentRNG()
+{
+    return thread_rng ? thread_rng : rng;
+}
+
 inline void randomSeed(unsigned long int seed)
 {
-    gsl_rng_set(rng, seed);
+    gsl_rng_set(currentRNG(), seed);
+}
+
+inline unsigned long int randomStreamSeed()
+{
+    return gsl_rng_get(currentRNG());
 }
 
 inline double randomFloat()
 {
-    return gsl_rng_uniform(rng);
+    return gsl_rng_uniform(currentRNG());
 }
 
 inline size_t randomInt(size_t N)
 {
-    return gsl_rng_uniform_int(rng, N);
+    return gsl_rng_uniform_int(currentRNG(), N);
 }
 
 inline int plusminus()
@@ -102,7 +157,7 @@ inline int plusminus()
 
 inline double randomBeta(const double& a, const double& b)
 {
-    return gsl_ran_beta(rng, a, b);
+    return gsl_ran_beta(currentRNG(), a, b);
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -168,6 +223,7 @@ void RandomWeighedGenerator::setWeights(Iter first, Iter last)
     partial_sum(this->_weight.begin(), this->_weight.end(),
             this->_cumul_weight.begin());
     this->_total_weight = this->_cumul_weight.back();
+    this->_sum_tree.clear();
 }
 
 inline size_t RandomWeighedGenerator::numChoices() const
@@ -9,6 +9,8 @@
 #include <cstdlib>
 #include <csignal>
 #include <fstream>
+#include <limits>
+#include <sys/stat.h>
 
 #include "RunPar_t.hpp"
 #include "EmbedPython.hpp"
@@ -17,12 +19,17 @@
 #include "StringUtils.hpp"
 #include "Molecule.hpp"
 #include "Crystal.hpp"
+#include "DistanceKernels.hpp"
+#include "AtomCost.hpp"
 #include "Lattice.hpp"
 #include "Liga_t.hpp"
+#include "LatticeSweep.hpp"
+#include "SymmetryOperation.hpp"
 #include "AtomFilter_t.hpp"
 #include "LigaUtils.hpp"
 #include "Exceptions.hpp"
 #include "Counter.hpp"
+#include "SectionTimer.hpp"
 #include "Version.hpp"
 
 using namespace std;
@@ -44,6 +51,57 @@ void SIGABRT_handler(int signum)
     sleep(1);
 }
 
+
+// file status that changes with every update of the file, the inode and
+// mtime nanoseconds catch files replaced or rewritten within a second
+
+bool same_file_version(const struct stat& st0, const struct stat& st1)
+{
+    bool rv = st0.st_dev == st1.st_dev && st0.st_ino == st1.st_ino &&
+        st0.st_size == st1.st_size &&
+        st0.st_mtim.tv_sec == st1.st_mtim.tv_sec &&
+        st0.st_mtim.tv_nsec == st1.st_mtim.tv_nsec;
+    return rv;
+}
+
+
+// Parsed table of the last distfile is reused by subsequent jobs
+// of a server process until the file changes.
+
+const DistanceTable& read_distance_table(const string& distfile)
+{
+    static DistanceTable cached_dtab;
+    static string cached_path;
+    static struct stat cached_st;
+    struct stat st;
+    bool hasstat = (0 == stat(distfile.c_str(), &st));
+    if (hasstat && distfile == cached_path &&
+            same_file_version(st, cached_st))
+    {
+        return cached_dtab;
+    }
+    DistanceTable dtab;
+    if (DistanceTable::isBinaryFile(distfile))
+    {
+        dtab.readBinary(distfile);
+    }
+    else
+    {
+        ifstream dstfid(distfile.c_str());
+        if (!dstfid)
+        {
+            ostringstream emsg;
+            emsg << "Unable to read '" << distfile << "'";
+            throw IOError(emsg.str());
+        }
+        dstfid >> dtab;
+    }
+    cached_dtab = dtab;
+    cached_path = hasstat ? distfile : string();
+    if (hasstat)    cached_st = st;
+    return cached_dtab;
+}
+
 }   // namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -54,6 +112,15 @@ void SIGABRT_handler(int signum)
 
 void RunPar_t::processArguments(int argc, char* const argv[])
 {
+    // run time limits apply to this job only
+    start_cputime = Counter::CPUTime();
+    start_walltime = Counter::WallTime();
+    // discard atom filters from a previous job in this process
+    for (size_t i = 0; i != Molecule::atom_filters.size(); ++i)
+    {
+        delete Molecule::atom_filters[i];
+    }
+    Molecule::atom_filters.clear();
     const char* short_options = "p:hV";
     // parameters and options
     option long_options[] = {
@@ -100,15 +167,7 @@ void RunPar_t::processArguments(int argc, char* const argv[])
         throw ParseArgsError(emsg);
     }
     distfile = args->pars["distfile"];
-    DistanceTable dtab;
-    ifstream dstfid(distfile.c_str());
-    if (!dstfid)
-    {
-        ostringstream emsg;
-        emsg << "Unable to read '" << distfile << "'";
-        throw IOError(emsg.str());
-    }
-    dstfid >> dtab;
+    const DistanceTable& dtab = read_distance_table(distfile);
     // figure out if we have Molecule or Crystal
     // crystal
     crystal = args->GetPar<bool>("crystal", true);
@@ -126,6 +185,25 @@ void RunPar_t::processArguments(int argc, char* const argv[])
     // distreuse
     distreuse = args->GetPar<bool>("distreuse", this->crystal);
     mol->setDistReuse(distreuse);
+    // distbins
+    distbins = args->GetPar<double>("distbins", 0.0);
+    if (distbins < 0.0)
+    {
+        const char* emsg = "distbins must be non-negative.";
+        throw ParseArgsError(emsg);
+    }
+    if (distbins > 0.0 && distreuse)
+    {
+        const char* emsg = "distbins requires distreuse=false.";
+        throw ParseArgsError(emsg);
+    }
+    if (distbins > 0.0)
+    {
+        DistanceTable dbinned = mol->getDistanceTable();
+        dbinned.setResolution(distbins);
+        mol->setDistanceTable(dbinned);
+        mol->setDistanceBinning(true);
+    }
     // inistru
     if (args->ispar("inistru"))
     {
@@ -181,6 +259,18 @@ void RunPar_t::processArguments(int argc, char* const argv[])
         Crystal& crst = dynamic_cast<Crystal&>(*mol);
         this->rmax = crst.getRmax();
     }
+    // symmetry
+    if (args->ispar("symmetry"))
+    {
+        if (!this->crystal)
+        {
+            const char* emsg = "symmetry requires crystal=true.";
+            throw ParseArgsError(emsg);
+        }
+        this->symmetry = args->pars["symmetry"];
+        Crystal& crst = dynamic_cast<Crystal&>(*mol);
+        crst.setSymmetry(SymmetryOperation::readSymmetryFile(symmetry));
+    }
     // outstru
     if (args->ispar("outstru"))
     {
@@ -240,6 +330,58 @@ void RunPar_t::processArguments(int argc, char* const argv[])
     }
     // trace
     trace = args->GetPar<bool>("trace", false);
+    // timersfile
+    if (args->ispar("timersfile"))
+    {
+        if (!SectionTimer::isEnabled())
+        {
+            const char* emsg = "timersfile requires build with timers=true.";
+            throw ParseArgsError(emsg);
+        }
+        this->timersfile = args->pars["timersfile"];
+    }
+    // telemetry
+    if (args->ispar("telemetry"))
+    {
+        this->telemetry = args->pars["telemetry"];
+    }
+    // checkpoint, checkpointrate
+    if (args->ispar("checkpoint"))
+    {
+        this->checkpoint = args->pars["checkpoint"];
+        this->checkpointrate = args->GetPar<double>("checkpointrate", 300.0);
+        if (this->checkpointrate < 0.0)
+        {
+            const char* emsg = "checkpointrate must be non-negative.";
+            throw ParseArgsError(emsg);
+        }
+    }
+    // restart
+    if (args->ispar("restart"))
+    {
+        this->restart = args->pars["restart"];
+    }
+    // eventlog, replay
+    if (args->ispar("eventlog"))
+    {
+        this->eventlog = args->pars["eventlog"];
+    }
+    if (args->ispar("replay"))
+    {
+        this->replay = args->pars["replay"];
+    }
+    if (!this->eventlog.empty() && !this->replay.empty())
+    {
+        const char* emsg = "eventlog and replay cannot be used together.";
+        throw ParseArgsError(emsg);
+    }
+    // lastseason
+    this->lastseason = args->GetPar<int>("lastseason", 0);
+    if (this->lastseason < 0)
+    {
+        const char* emsg = "lastseason must be non-negative.";
+        throw ParseArgsError(emsg);
+    }
     // scoopfunction
     if (args->ispar("scoopfunction"))
     {
@@ -289,6 +431,23 @@ void RunPar_t::processArguments(int argc, char* const argv[])
     }
     mol->setAtomCostScale(this->costweights[0]);
     mol->setAtomOverlapScale(this->costweights[1]);
+    // penalty
+    this->penalty = args->GetPar<string>("penalty", "square");
+    if (!AtomCost::isPenaltyType(this->penalty))
+    {
+        ostringstream emsg;
+        emsg << "penalty must be one of (";
+        emsg << join(", ", AtomCost::getPenaltyTypes()) << ").";
+        throw ParseArgsError(emsg.str());
+    }
+    // penaltywidth
+    this->penaltywidth = args->GetPar<double>("penaltywidth", 1.0);
+    if (!(this->penaltywidth > 0.0))
+    {
+        const char* emsg = "penaltywidth must be positive.";
+        throw ParseArgsError(emsg);
+    }
+    mol->setAtomCostPenalty(this->penalty, this->penaltywidth);
     // tolcost
     tolcost = args->GetPar<double>("tolcost", 1.0e-4);
     Molecule::tol_nbad = tolcost;
@@ -339,10 +498,32 @@ void RunPar_t::processArguments(int argc, char* const argv[])
         }
     }
     base_level = mol->NFixed();
+    // frozencore
+    frozencore = args->GetPar<bool>("frozencore", false);
+    if (frozencore && distreuse)
+    {
+        const char* emsg = "frozencore requires distreuse=false.";
+        throw ParseArgsError(emsg);
+    }
+    if (frozencore && distbins > 0.0)
+    {
+        const char* emsg = "frozencore is not supported with distbins.";
+        throw ParseArgsError(emsg);
+    }
+    if (frozencore)     mol->freezeFixedPairs();
     // maxcputime
     maxcputime = args->GetPar<double>("maxcputime", 0.0);
     // maxwalltime
     maxwalltime = args->GetPar<double>("maxwalltime", 0.0);
+    // deadlinemargin
+    deadlinemargin = args->GetPar<double>("deadlinemargin", 0.0);
+    if (deadlinemargin < 0.0)
+    {
+        const char* emsg = "deadlinemargin must be at least 0.";
+        throw ParseArgsError(emsg);
+    }
+    // fitseasons
+    fitseasons = args->GetPar<bool>("fitseasons", false);
     // rngseed
     rngseed = args->GetPar<int>("rngseed", 0);
     if (rngseed)
@@ -358,10 +539,32 @@ void RunPar_t::processArguments(int argc, char* const argv[])
     // demoterelax
     demoterelax = args->GetPar<bool>("demoterelax", false);
     Molecule::demoterelax = demoterelax;
+    // champrelax
+    champrelax = args->GetPar<bool>("champrelax", false);
+    // floatscreen
+    floatscreen = args->GetPar<bool>("floatscreen", false);
+    Molecule::floatscreen = floatscreen;
+    // candidatecache
+    candidatecache = args->GetPar<int>("candidatecache", 0);
+    if (candidatecache < 0)
+    {
+        const char* emsg = "candidatecache must be non-negative.";
+        throw ParseArgsError(emsg);
+    }
+    Molecule::candidatecache = candidatecache;
     // ligasize
     ligasize = args->GetPar<int>("ligasize", 10);
     // stopgame
     stopgame = args->GetPar<double>("stopgame", 0.0025);
+    // matchcutoff
+    matchcutoff = args->GetPar<double>("matchcutoff", 0.0);
+    if (matchcutoff < 0.0)
+    {
+        const char* emsg = "matchcutoff must be non-negative.";
+        throw ParseArgsError(emsg);
+    }
+    // uniqueteams
+    uniqueteams = args->GetPar<bool>("uniqueteams", false);
     // seasontrials
     seasontrials = int( args->GetPar<double>("seasontrials", 16384.0) );
     // trialsharing
@@ -373,6 +576,108 @@ void RunPar_t::processArguments(int argc, char* const argv[])
         emsg << join(", ", TrialDistributor::getTypes()) << ").";
         throw ParseArgsError(emsg.str());
     }
+    // triangsharing
+    triangsharing = args->GetPar<string>("triangsharing", "success");
+    if (triangsharing != "success" && triangsharing != "efficiency")
+    {
+        const char* emsg =
+            "triangsharing must be one of (success, efficiency).";
+        throw ParseArgsError(emsg);
+    }
+    // nthreads
+    nthreads = args->GetPar<int>("nthreads", 1);
+    if (nthreads < 1)
+    {
+        const char* emsg = "nthreads must be at least 1.";
+        throw ParseArgsError(emsg);
+    }
+    // numa
+    numa = args->GetPar<bool>("numa", false);
+    // kernels
+    kernels = args->GetPar<string>("kernels", "auto");
+    try {
+        DistanceKernels::setISA(kernels);
+    }
+    catch (invalid_argument& e) {
+        ostringstream emsg;
+        emsg << e.what() << "  kernels must be one of (auto, ";
+        emsg << join(", ", DistanceKernels::getSupportedISAs()) << ").";
+        throw ParseArgsError(emsg.str());
+    }
+    // trialthreads
+    trialthreads = args->GetPar<int>("trialthreads", 1);
+    if (trialthreads < 1)
+    {
+        const char* emsg = "trialthreads must be at least 1.";
+        throw ParseArgsError(emsg);
+    }
+    Molecule::setTrialThreads(trialthreads);
+    // islands, migrationrate
+    islands = args->GetPar<int>("islands", 1);
+    if (islands < 1)
+    {
+        const char* emsg = "islands must be at least 1.";
+        throw ParseArgsError(emsg);
+    }
+    migrationrate = args->GetPar<int>("migrationrate", 10);
+    if (migrationrate < 1)
+    {
+        const char* emsg = "migrationrate must be at least 1.";
+        throw ParseArgsError(emsg);
+    }
+    if (islands > 1 && (!checkpoint.empty() || !restart.empty()))
+    {
+        const char* emsg = "checkpoint and restart are not supported "
+            "with islands > 1.";
+        throw ParseArgsError(emsg);
+    }
+    // migrants arrive at any time, trial and triangulation shares
+    // follow timings
+    bool replayable = islands < 2 && trialsharing != "efficiency" &&
+        triangsharing != "efficiency" && !fitseasons;
+    if (!replayable && (!eventlog.empty() || !replay.empty()))
+    {
+        const char* emsg = "eventlog and replay are not supported with "
+            "islands > 1, trialsharing=efficiency, "
+            "triangsharing=efficiency or fitseasons.";
+        throw ParseArgsError(emsg);
+    }
+    // sweep, sweepjobs, sweeptime
+    if (args->ispar("sweep"))
+    {
+        if (!this->crystal)
+        {
+            const char* emsg = "sweep requires crystal=true.";
+            throw ParseArgsError(emsg);
+        }
+        if (islands > 1 || !checkpoint.empty() || !restart.empty())
+        {
+            const char* emsg = "islands, checkpoint and restart are not "
+                "supported with sweep.";
+            throw ParseArgsError(emsg);
+        }
+        this->sweep = args->pars["sweep"];
+        this->sweeplatpars = LatticeSweep::readLatticeFile(this->sweep);
+    }
+    sweepjobs = args->GetPar<int>("sweepjobs", 1);
+    if (sweepjobs < 1)
+    {
+        const char* emsg = "sweepjobs must be at least 1.";
+        throw ParseArgsError(emsg);
+    }
+    sweeptime = args->GetPar<double>("sweeptime", 10.0);
+    if (!(sweeptime > 0.0))
+    {
+        const char* emsg = "sweeptime must be positive.";
+        throw ParseArgsError(emsg);
+    }
+    // championboard
+    championboard = args->GetPar<bool>("championboard", false);
+    if (championboard && islands < 2 && sweep.empty())
+    {
+        const char* emsg = "championboard requires islands > 1 or sweep.";
+        throw ParseArgsError(emsg);
+    }
     // bangle_range
     if (args->ispar("bangle_range"))
     {
@@ -395,6 +700,9 @@ void RunPar_t::processArguments(int argc, char* const argv[])
         LoneAtomFilter_t* plaf = new LoneAtomFilter_t(maxbondlength);
         Molecule::atom_filters.push_back(plaf);
     }
+    // adaptivefilters
+    adaptivefilters = args->GetPar<bool>("adaptivefilters", false);
+    Molecule::adaptivefilters = adaptivefilters;
     // Final Checks
     this->mol->CheckIntegrity();
     // done
@@ -411,49 +719,47 @@ const string& RunPar_t::getAppName() const
 
 bool RunPar_t::outOfCPUTime() const
 {
-    bool rv = (maxcputime > 0.0 && Counter::CPUTime() > maxcputime);
+    bool rv = (maxcputime > 0.0 && cpuTimeLeft() < 0.0);
     return rv;
 }
 
 
 bool RunPar_t::outOfWallTime() const
 {
-    bool rv = (maxwalltime > 0.0 && Counter::WallTime() > maxwalltime);
+    bool rv = (maxwalltime > 0.0 && wallTimeLeft() < 0.0);
     return rv;
 }
 
 
-boost::python::object RunPar_t::importMapFunction()
+double RunPar_t::cpuTimeLeft() const
 {
-    namespace python = boost::python;
-    // short circuit when already imported
-    if (mmapfunctionobj.get())  return *mmapfunctionobj;
-    // performap import
-    initializePython();
-    mmapfunctionobj.reset(new python::object());
-    python::object py_main = python::import("__main__");
-    python::object py_globals = py_main.attr("__dict__");
-    python::dict py_locals;
-    python::object sysmod = python::import("sys");
-    int hexversion = python::extract<int>(sysmod.attr("hexversion"));
-    if (hexversion >= 0x02060000 && this->ncpu > 1)
-    {
-        python::object mpmod = python::import("multiprocessing");
-        python::object pool = mpmod.attr("Pool")(this->ncpu);
-        *mmapfunctionobj = pool.attr("map");
-    }
-    else
-    {
-        // print warning on attempt to use several CPUs with Python 2.5
-        if (this->ncpu > 1)
-        {
-            cout << "Warning ncpu=" << this->ncpu <<
-                " ignored, it needs Python 2.6 or later.\n";
-            this->ncpu = 1;
-        }
-        *mmapfunctionobj = python::eval("map", py_globals, py_locals);
-    }
-    return *mmapfunctionobj;
+    if (!(maxcputime > 0.0))    return numeric_limits<double>::max();
+    double used = Counter::CPUTime() - start_cputime;
+    return maxcputime - deadlinemargin - used;
+}
+
+
+double RunPar_t::wallTimeLeft() const
+{
+    if (!(maxwalltime > 0.0))   return numeric_limits<double>::max();
+    double used = Counter::WallTime() - start_walltime;
+    return maxwalltime - deadlinemargin - used;
+}
+
+
+void RunPar_t::resetClocks()
+{
+    start_cputime = Counter::CPUTime();
+    start_walltime = Counter::WallTime();
+}
+
+
+void RunPar_t::clearIslandOutputs()
+{
+    outstru.clear();
+    frames.clear();
+    timersfile.clear();
+    telemetry.clear();
 }
 
 
@@ -530,8 +836,9 @@ void RunPar_t::print_help()
 "  -h, --help            display this message\n"
 "  -V, --version         show program version\n"
 "  --db-abortstop        stop process on SIGABRT, allows to attach gdb\n"
+"  --server              run jobs read from standard input, one per line\n"
 "IO parameters:\n"
-"  distfile=FILE         target distance table\n"
+"  distfile=FILE         target distance table, text or binary dtbl\n"
 "  inistru=FILE          [empty] initial structure in Cartesian coordinates\n"
 "  outstru=FILE          where to save the best full molecule\n"
 "  outfmt=string         [rawxyz], cif, discus,... - outstru file format\n"
@@ -541,10 +848,25 @@ void RunPar_t::print_help()
 "  framesrate=int        [0] number of iterations between frame saves\n"
 "  framestrace=array     [] triplets of (season, level, id)\n"
 "  trace=bool            [false] keep and show trace of the best structure\n"
+"  timersfile=FILE       write section timings as JSON lines per season,\n"
+"                        available only when built with timers=true\n"
+"  telemetry=FILE        write season statistics as JSON lines to FILE\n"
+"                        or to a Unix socket given as unix:PATH\n"
+"  checkpoint=FILE       periodically save the liga state to FILE\n"
+"  checkpointrate=double [300] wall time in seconds between checkpoints\n"
+"  restart=FILE          continue from liga state saved in a checkpoint\n"
+"  eventlog=FILE         write match decisions to binary event log FILE\n"
+"  replay=FILE           compare match decisions with event log FILE from\n"
+"                        the restart season and stop when they differ,\n"
+"                        FILE must be recorded by a run with eventlog\n"
+"                        which played through the restart season\n"
+"  lastseason=int        [0] stop after this season, 0 for no limit\n"
 "  scoopfunction=string  (python.module:function) top-level structure scooping\n"
 "                        scoopfunction must return a (cost, stru) tuple.\n"
 "  scooprate=int         [0] rate of top-level structure scooping\n"
-"  ncpu=int              [1] number of CPUs used for structure scooping\n"
+"  ncpu=int              [1] number of CPUs used for structure scooping,\n"
+"                        when > 1 scooping runs in the background and\n"
+"                        its results are used at the next scooping\n"
 "  verbose=array         [ad,wc,bc,sc] output flags from\n"
 "                        (" << joined_verbose_flags() << ")\n" <<
 "Liga parameters:\n"
@@ -552,28 +874,73 @@ void RunPar_t::print_help()
 "  crystal=bool          [true] assume periodic crystal structure\n"
 "  latpar=array          [1,1,1,90,90,90] crystal lattice parameters\n"
 "  rmax=double           [dmax] distance cutoff when crystal=true\n"
+"  symmetry=string       file of symmetry operations in x,y,z notation,\n"
+"                        atoms are then the asymmetric unit of the crystal\n"
 "  distreuse=bool        [false] keep used distances in distance table\n"
+"  distbins=double       [0] bin width of target distances for the binned\n"
+"                        cost, 0 to match every target distance\n"
 "  costweights=array     [1,1] weights for distance and overlap components\n"
+"  penalty=string        [square] distance penalty form from (" <<
+        join(",", AtomCost::getPenaltyTypes()) << ")\n" <<
+"  penaltywidth=double   [1] normalized deviation where penalty changes\n"
 "  tolcost=double        [1E-4] target normalized molecule cost\n"
 "  natoms=int            obsolete, equivalent to formula=Cn\n"
 "  formula=string        chemical formula, use inistru when not specified\n"
 "  radii=string          define atomic radii in (A1:r1, A2:r2,...) format\n"
 "  samepairradius=double [-1] optional radius for a pair of equal atoms\n"
 "  fixed_atoms=ranges    [] indices of fixed atoms in inistru (start at 0)\n"
+"  frozencore=bool       [false] remove distances of fixed atom pairs from\n"
+"                        the distance table, requires distreuse=false\n"
 "  maxcputime=double     [0] when set, maximum CPU time in seconds\n"
 "  maxwalltime=double    [0] when set, maximum wall time in seconds\n"
+"  deadlinemargin=double [0] seconds before maxcputime or maxwalltime kept\n"
+"                        for the final checkpoint and output\n"
+"  fitseasons=bool       [false] cut season trials to finish before the\n"
+"                        deadline, the lowest levels are cut first\n"
 "  rngseed=int           seed of random number generator\n"
 "  promotefrac=double    [0.1] fraction of tolcost threshold of tested atoms\n"
 "  promoterelax=bool     [false] relax the worst atom after addition\n"
 "  demoterelax=bool      [false] relax the worst atom after removal\n"
+"  champrelax=bool       [false] relax all free atoms of new champions and\n"
+"                        saved structures with fixed pair distances\n"
+"  floatscreen=bool      [false] screen trial atoms in single precision\n"
+"                        before exact scoring, ignored for crystals\n"
+"  candidatecache=int    [0] number of rejected trial atoms scored again in\n"
+"                        the next molecule evolution, ignored for crystals\n"
 "  ligasize=int          [10] number of teams per division\n"
 "  stopgame=double       [0.0025] skip division when winner is worse\n"
+"  matchcutoff=double    [0] stop advancing above matchcutoff times the\n"
+"                        worst cost of a full division, 0 to disable\n"
+"  uniqueteams=bool      [false] drop teams with the same structure as\n"
+"                        another team of their division\n"
 "  seasontrials=int      [16384] number of atom placements in one season\n"
 "  trialsharing=string   [success] sharing method from (" <<
         join(",", TrialDistributor::getTypes()) << ")\n" <<
+"  triangsharing=string  [success] share triangulation types by success rate\n"
+"                        or by accepted atoms per second (efficiency)\n"
+"  nthreads=int          [1] number of threads for concurrent matches\n"
+"  numa=bool             [false] play contiguous levels on every match thread,\n"
+"                        pin threads to NUMA nodes and keep their own\n"
+"                        spare teams\n"
+"  kernels=string        [auto] instruction set of distance kernels from (auto," <<
+        join(",", DistanceKernels::getCompiledISAs()) << ")\n" <<
+"                        auto selects the best one for the CPU\n"
+"  trialthreads=int      [1] number of threads for trial atoms in a match\n"
+"  islands=int           [1] number of island processes sharing champions\n"
+"  migrationrate=int     [10] number of seasons between champion migrations\n"
+"  sweep=string          file of lattice parameters to rank in short runs,\n"
+"                        one \"a b c alpha beta gamma\" per line, values\n"
+"                        can be lo:hi:step ranges\n"
+"  sweepjobs=int         [1] number of concurrent sweep processes\n"
+"  sweeptime=double      [10] maxcputime per lattice in the first sweep\n"
+"                        round, doubled for the better half kept\n"
+"  championboard=bool    [false] share best champions of island or sweep\n"
+"                        processes in memory, sweeps stop once solved\n"
 "Constrains (applied only when set):\n"
 "  bangle_range=array    (max_blen, low[, high]) bond angle constraint\n"
 "  maxbondlength=double  distance limit for rejecting lone atoms\n"
+"  adaptivefilters=bool  [false] precheck trial atoms and order constraint\n"
+"                        checks by their measured rejections per time\n"
 ;
 }
 
@@ -667,6 +1034,39 @@ void RunPar_t::print_pars()
     }
     // trace
     cout << "trace=" << trace << '\n';
+    // timersfile
+    if (args->ispar("timersfile"))
+    {
+        cout << "timersfile=" << this->timersfile << '\n';
+    }
+    // telemetry
+    if (args->ispar("telemetry"))
+    {
+        cout << "telemetry=" << this->telemetry << '\n';
+    }
+    // checkpoint, checkpointrate, restart
+    if (args->ispar("checkpoint"))
+    {
+        cout << "checkpoint=" << this->checkpoint << '\n';
+        cout << "checkpointrate=" << this->checkpointrate << '\n';
+    }
+    if (args->ispar("restart"))
+    {
+        cout << "restart=" << this->restart << '\n';
+    }
+    // eventlog, replay, lastseason
+    if (!this->eventlog.empty())
+    {
+        cout << "eventlog=" << this->eventlog << '\n';
+    }
+    if (!this->replay.empty())
+    {
+        cout << "replay=" << this->replay << '\n';
+    }
+    if (this->lastseason)
+    {
+        cout << "lastseason=" << this->lastseason << '\n';
+    }
     // scoopfunction, scooprate, ncpu
     if (args->ispar("scoopfunction"))
     {
@@ -698,8 +1098,18 @@ void RunPar_t::print_pars()
             this->latpar[4] << ',' << this->latpar[5] << '\n';
         cout << "rmax=" << this->rmax << '\n';
     }
+    // symmetry
+    if (!symmetry.empty())
+    {
+        cout << "symmetry=" << symmetry << '\n';
+    }
     // distreuse
     cout << "distreuse=" << distreuse << '\n';
+    // distbins
+    if (distbins > 0.0)
+    {
+        cout << "distbins=" << distbins << '\n';
+    }
     // costweights
     cout << "costweights=";
     for (size_t i = 0; i != this->costweights.size(); ++i)
@@ -707,6 +1117,12 @@ void RunPar_t::print_pars()
         cout << (i ? "," : "") << costweights[i];
     }
     cout << '\n';
+    // penalty
+    if (this->penalty != "square")
+    {
+        cout << "penalty=" << this->penalty << '\n';
+        cout << "penaltywidth=" << this->penaltywidth << '\n';
+    }
     // tolcost
     cout << "tolcost=" << tolcost << '\n';
     // formula
@@ -739,6 +1155,11 @@ void RunPar_t::print_pars()
         }
         cout << '\n';
     }
+    // frozencore
+    if (frozencore)
+    {
+        cout << "frozencore=" << frozencore << '\n';
+    }
     // maxcputime
     if (maxcputime > 0.0)
     {
@@ -749,6 +1170,16 @@ void RunPar_t::print_pars()
     {
         cout << "maxwalltime=" << maxwalltime << '\n';
     }
+    // deadlinemargin
+    if (deadlinemargin > 0.0)
+    {
+        cout << "deadlinemargin=" << deadlinemargin << '\n';
+    }
+    // fitseasons
+    if (fitseasons)
+    {
+        cout << "fitseasons=" << fitseasons << '\n';
+    }
     // rngseed
     if (rngseed)
     {
@@ -758,11 +1189,74 @@ void RunPar_t::print_pars()
     cout << "promotefrac=" << promotefrac << '\n';
     cout << "promoterelax=" << promoterelax << '\n';
     cout << "demoterelax=" << demoterelax << '\n';
+    // champrelax
+    if (champrelax)
+    {
+        cout << "champrelax=" << champrelax << '\n';
+    }
+    if (floatscreen)
+    {
+        cout << "floatscreen=" << floatscreen << '\n';
+    }
+    if (candidatecache)
+    {
+        cout << "candidatecache=" << candidatecache << '\n';
+    }
     // ligasize, stopgame, seasontrials, trialsharing
     cout << "ligasize=" << ligasize << '\n';
     cout << "stopgame=" << stopgame << '\n';
+    if (matchcutoff > 0.0)
+    {
+        cout << "matchcutoff=" << matchcutoff << '\n';
+    }
+    if (uniqueteams)
+    {
+        cout << "uniqueteams=" << uniqueteams << '\n';
+    }
     cout << "seasontrials=" << seasontrials << '\n';
     cout << "trialsharing=" << trialsharing << '\n';
+    if (triangsharing != "success")
+    {
+        cout << "triangsharing=" << triangsharing << '\n';
+    }
+    // nthreads
+    if (nthreads > 1)
+    {
+        cout << "nthreads=" << nthreads << '\n';
+    }
+    // numa
+    if (numa)
+    {
+        cout << "numa=" << numa << '\n';
+    }
+    // kernels
+    if (kernels != "auto")
+    {
+        cout << "kernels=" << kernels << '\n';
+    }
+    // trialthreads
+    if (trialthreads > 1)
+    {
+        cout << "trialthreads=" << trialthreads << '\n';
+    }
+    // islands, migrationrate
+    if (islands > 1)
+    {
+        cout << "islands=" << islands << '\n';
+        cout << "migrationrate=" << migrationrate << '\n';
+    }
+    // sweep, sweepjobs, sweeptime
+    if (!sweep.empty())
+    {
+        cout << "sweep=" << sweep << '\n';
+        cout << "sweepjobs=" << sweepjobs << '\n';
+        cout << "sweeptime=" << sweeptime << '\n';
+    }
+    // championboard
+    if (championboard)
+    {
+        cout << "championboard=" << championboard << '\n';
+    }
     // constraints
     // bangle_range
     if (args->ispar("bangle_range"))
@@ -779,6 +1273,11 @@ void RunPar_t::print_pars()
     {
         cout << "maxbondlength=" << maxbondlength << '\n';
     }
+    // adaptivefilters
+    if (adaptivefilters)
+    {
+        cout << "adaptivefilters=" << adaptivefilters << '\n';
+    }
     // finish done
     cout << hashsep << '\n' << endl;
 }
@@ -796,6 +1295,14 @@ const list<string>& RunPar_t::validpars() const
         "frames",
         "framesrate",
         "framestrace",
+        "timersfile",
+        "telemetry",
+        "checkpoint",
+        "checkpointrate",
+        "restart",
+        "eventlog",
+        "replay",
+        "lastseason",
         "scoopfunction",
         "scooprate",
         "ncpu",
@@ -804,27 +1311,51 @@ const list<string>& RunPar_t::validpars() const
         "crystal",
         "latpar",
         "rmax",
+        "symmetry",
         "distreuse",
+        "distbins",
         "costweights",
+        "penalty",
+        "penaltywidth",
         "tolcost",
         "natoms",
         "formula",
         "radii",
         "samepairradius",
         "fixed_atoms",
+        "frozencore",
         "maxcputime",
         "maxwalltime",
+        "deadlinemargin",
+        "fitseasons",
         "rngseed",
         "promotefrac",
         "promoterelax",
         "demoterelax",
+        "champrelax",
+        "floatscreen",
+        "candidatecache",
         "ligasize",
         "stopgame",
+        "matchcutoff",
+        "uniqueteams",
         "seasontrials",
         "trace",
         "trialsharing",
+        "triangsharing",
+        "nthreads",
+        "numa",
+        "kernels",
+        "trialthreads",
+        "islands",
+        "migrationrate",
+        "sweep",
+        "sweepjobs",
+        "sweeptime",
+        "championboard",
         "bangle_range",
         "maxbondlength",
+        "adaptivefilters",
         // obsolete ignored parameters
         "seed_clusters",
         "lookout_prob",
@@ -24,13 +24,19 @@ class RunPar_t
     public:
 
         // constructor
+        RunPar_t() : start_cputime(0.0), start_walltime(0.0)  { }
         virtual ~RunPar_t()  { }
         // methods
         void processArguments(int argc, char* const argv[]);
         virtual const std::string& getAppName() const;
         bool outOfCPUTime() const;
         bool outOfWallTime() const;
-        boost::python::object importMapFunction();
+        // seconds left before the deadline less deadlinemargin
+        double cpuTimeLeft() const;
+        double wallTimeLeft() const;
+        void resetClocks();
+        // drop the output files that only the main island writes
+        void clearIslandOutputs();
         boost::python::object importScoopFunction() const;
         double applyScoopFunction(Molecule* mol) const;
         void checkScoopFunction(const Molecule&) const;
@@ -48,6 +54,14 @@ class RunPar_t
         std::string frames;
         int framesrate;
         std::deque<TraceId_t> framestrace;
+        std::string timersfile;
+        std::string telemetry;
+        std::string checkpoint;
+        double checkpointrate;
+        std::string restart;
+        std::string eventlog;
+        std::string replay;
+        int lastseason;
         std::string scoopfunction;
         int scooprate;
         mutable int ncpu;
@@ -57,44 +71,70 @@ class RunPar_t
         bool crystal;
         std::vector<double> latpar;
         double rmax;
+        std::string symmetry;
         bool distreuse;
+        double distbins;
         double tolcost;
         std::vector<double> costweights;
+        std::string penalty;
+        double penaltywidth;
         int natoms;
         ChemicalFormula formula;
         AtomRadiiTable radii;
         double samepairradius;
         std::vector<int> fixed_atoms;
+        bool frozencore;
         double maxcputime;
         double maxwalltime;
+        double deadlinemargin;
+        bool fitseasons;
         int rngseed;
         double promotefrac;
         bool promoterelax;
         bool demoterelax;
+        bool champrelax;
+        bool floatscreen;
+        int candidatecache;
         int ligasize;
         double stopgame;
+        double matchcutoff;
+        bool uniqueteams;
         int seasontrials;
         std::string trialsharing;
+        std::string triangsharing;
+        int nthreads;
+        bool numa;
+        std::string kernels;
+        int trialthreads;
+        int islands;
+        int migrationrate;
+        std::string sweep;
+        std::vector< std::vector<double> > sweeplatpars;
+        int sweepjobs;
+        double sweeptime;
+        bool championboard;
         // generated data
         std::auto_ptr<Molecule> mol;
         int base_level;
         // Constrains
         std::vector<double> bangle_range;
         double maxbondlength;
+        bool adaptivefilters;
 
     protected:
 
         virtual void process_cmdline_args();
         std::string version_string(std::string quote="");
-        const std::list<std::string>& validpars() const;
+        virtual const std::list<std::string>& validpars() const;
         const std::string& joined_verbose_flags() const;
         virtual void print_help();
         virtual void print_pars();
 
     private:
 
-        mutable std::auto_ptr<boost::python::object> mmapfunctionobj;
         mutable std::auto_ptr<boost::python::object> mscoopfunctionobj;
+        double start_cputime;
+        double start_walltime;
 
 };
 
@@ -0,0 +1,235 @@
+/***********************************************************************
+* Short Title: evaluation of scoopfunction for top level structures
+*
+* Comments: implementation of ScoopExecutor
+*
+* <license text>
+***********************************************************************/
+
+#include <sstream>
+#include <stdexcept>
+
+#include "ScoopExecutor.hpp"
+#include "Molecule.hpp"
+#include "Crystal.hpp"
+#include "Lattice.hpp"
+#include "AtomSequence.hpp"
+#include "EmbedPython.hpp"
+
+using namespace std;
+
+// Local helpers for the Python side of scooping ----------------------------
+
+namespace {
+
+// worker processes are forked, so that they can find the helper module
+// and the functions are pickled only by their names
+
+const char* helper_module_name = "_liga_scoop";
+
+const char* helper_source =
+"import array\n"
+"import multiprocessing\n"
+"\n"
+"_scoopfunctions = {}\n"
+"\n"
+"def _getscoopfunction(name):\n"
+"    fnc = _scoopfunctions.get(name)\n"
+"    if fnc is None:\n"
+"        modname, fncname = name.split(':', 1)\n"
+"        mod = __import__(modname, fromlist=[fncname])\n"
+"        fnc = _scoopfunctions[name] = getattr(mod, fncname)\n"
+"    return fnc\n"
+"\n"
+"def pack(stru):\n"
+"    L = stru.lattice\n"
+"    latpar = (L.a, L.b, L.c, L.alpha, L.beta, L.gamma)\n"
+"    xyz = array.array('d')\n"
+"    for a in stru:\n"
+"        xyz.extend(a.xyz_cartn)\n"
+"    return (latpar, [a.element for a in stru], xyz.tobytes())\n"
+"\n"
+"def unpack(packed):\n"
+"    from diffpy.structure import Structure\n"
+"    latpar, elements, xyzbytes = packed\n"
+"    xyz = array.array('d')\n"
+"    xyz.frombytes(xyzbytes)\n"
+"    stru = Structure()\n"
+"    stru.lattice.setLatPar(*latpar)\n"
+"    for i, smbl in enumerate(elements):\n"
+"        stru.addNewAtom(smbl)\n"
+"        stru.getLastAtom().xyz_cartn = tuple(xyz[3 * i:3 * i + 3])\n"
+"    return stru\n"
+"\n"
+"def scoop(args):\n"
+"    name, packed = args\n"
+"    coststru = _getscoopfunction(name)(unpack(packed))\n"
+"    return (float(coststru[0]), pack(coststru[1]))\n"
+"\n"
+"def createPool(ncpu):\n"
+"    ctx = multiprocessing\n"
+"    if hasattr(multiprocessing, 'get_context'):\n"
+"        ctx = multiprocessing.get_context('fork')\n"
+"    return ctx.Pool(ncpu)\n"
+;
+
+boost::python::object importHelperModule()
+{
+    namespace python = boost::python;
+    python::object sysmodules = python::import("sys").attr("modules");
+    if (sysmodules.contains(helper_module_name))
+    {
+        return sysmodules[helper_module_name];
+    }
+    python::object types = python::import("types");
+    python::object helper = types.attr("ModuleType")(helper_module_name);
+    python::object ns = helper.attr("__dict__");
+    python::exec(helper_source, ns, ns);
+    sysmodules[helper_module_name] = helper;
+    return helper;
+}
+
+
+void raiseScoopError(const string& scoopfunction)
+{
+    if (PyErr_Occurred())   PyErr_Print();
+    ostringstream emsg;
+    emsg << "Error executing scoopfunction '" << scoopfunction << "'\n" <<
+        "scoopfunction must return a (cost, stru) tuple.";
+    throw runtime_error(emsg.str());
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class ScoopExecutor
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+ScoopExecutor::ScoopExecutor(const string& scoopfunction, int ncpu) :
+    mscoopfunction(scoopfunction), mpending(false)
+{
+    namespace python = boost::python;
+    initializePython();
+    try {
+        mhelper = importHelperModule();
+        if (ncpu > 1)   mpool = mhelper.attr("createPool")(ncpu);
+    }
+    catch (python::error_already_set) {
+        if (PyErr_Occurred())   PyErr_Print();
+        const char* emsg = "Cannot start worker processes for scooping.";
+        throw runtime_error(emsg);
+    }
+}
+
+// Public Methods ------------------------------------------------------------
+
+bool ScoopExecutor::isAsync() const
+{
+    return !mpool.is_none();
+}
+
+
+bool ScoopExecutor::pending() const
+{
+    return mpending;
+}
+
+
+void ScoopExecutor::submit(const vector<Molecule*>& teams)
+{
+    namespace python = boost::python;
+    if (mpending)
+    {
+        const char* emsg = "ScoopExecutor: collect results before submit.";
+        throw logic_error(emsg);
+    }
+    try {
+        python::list args;
+        vector<Molecule*>::const_iterator tt;
+        for (tt = teams.begin(); tt != teams.end(); ++tt)
+        {
+            args.append(python::make_tuple(mscoopfunction,
+                        this->packStructure(**tt)));
+        }
+        python::object scoop = mhelper.attr("scoop");
+        if (this->isAsync())
+        {
+            mresult = mpool.attr("map_async")(scoop, args);
+        }
+        else
+        {
+            python::list res;
+            for (int i = 0; i < python::len(args); ++i)
+            {
+                res.append(scoop(python::object(args[i])));
+            }
+            mresult = res;
+        }
+    }
+    catch (python::error_already_set) {
+        raiseScoopError(mscoopfunction);
+    }
+    mpending = true;
+}
+
+
+boost::python::list ScoopExecutor::collect()
+{
+    namespace python = boost::python;
+    python::list rv;
+    if (!mpending)  return rv;
+    mpending = false;
+    try {
+        python::object res = mresult;
+        mresult = python::object();
+        if (this->isAsync())    res = res.attr("get")();
+        python::object unpack = mhelper.attr("unpack");
+        for (int i = 0; i < python::len(res); ++i)
+        {
+            python::object cost = res[i][0];
+            python::object packed = res[i][1];
+            rv.append(python::make_tuple(cost, unpack(packed)));
+        }
+    }
+    catch (python::error_already_set) {
+        raiseScoopError(mscoopfunction);
+    }
+    return rv;
+}
+
+// Private Methods -----------------------------------------------------------
+
+boost::python::object
+ScoopExecutor::packStructure(const Molecule& mol) const
+{
+    namespace python = boost::python;
+    python::tuple latpar = python::make_tuple(1.0, 1.0, 1.0, 90.0, 90.0, 90.0);
+    if (mol.type() == CRYSTAL)
+    {
+        const Lattice& L = static_cast<const Crystal&>(mol).getLattice();
+        latpar = python::make_tuple(L.a(), L.b(), L.c(),
+                L.alpha(), L.beta(), L.gamma());
+    }
+    python::list elements;
+    vector<double> xyz;
+    xyz.reserve(3 * mol.countAtoms());
+    for (AtomSequence seq(&mol); !seq.finished(); seq.next())
+    {
+        const Atom_t& ai = seq.ref();
+        elements.append(ai.element);
+        xyz.push_back(ai.r[0]);
+        xyz.push_back(ai.r[1]);
+        xyz.push_back(ai.r[2]);
+    }
+    const char* pxyz = reinterpret_cast<const char*>(
+            xyz.empty() ? NULL : &xyz[0]);
+    PyObject* xyzbytes = PyBytes_FromStringAndSize(pxyz,
+            xyz.size() * sizeof(double));
+    python::object packed = python::make_tuple(latpar, elements,
+            python::object(python::handle<>(xyzbytes)));
+    return packed;
+}
+
+// End of file
@@ -0,0 +1,48 @@
+/***********************************************************************
+* Short Title: evaluation of scoopfunction for top level structures
+*
+* Comments: ScoopExecutor sends elements, lattice parameters and packed
+*     Cartesian coordinates of structures to a persistent pool of
+*     Python worker processes, which rebuild the diffpy structure and
+*     apply the scoopfunction.  With more than one CPU the evaluation
+*     runs in the background until the results are collected.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef SCOOPEXECUTOR_HPP_INCLUDED
+#define SCOOPEXECUTOR_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <boost/python.hpp>
+
+class Molecule;
+
+class ScoopExecutor
+{
+    public:
+
+        // constructor
+        ScoopExecutor(const std::string& scoopfunction, int ncpu);
+
+        // methods
+        bool isAsync() const;
+        bool pending() const;
+        void submit(const std::vector<Molecule*>& teams);
+        boost::python::list collect();
+
+    private:
+
+        // data
+        std::string mscoopfunction;
+        boost::python::object mhelper;
+        boost::python::object mpool;
+        boost::python::object mresult;
+        bool mpending;
+
+        // methods
+        boost::python::object packStructure(const Molecule& mol) const;
+};
+
+#endif  // SCOOPEXECUTOR_HPP_INCLUDED
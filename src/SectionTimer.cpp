@@ -0,0 +1,244 @@
+/***********************************************************************
+* Short Title: scoped timers of nested code sections
+*
+* Comments: Sections are timed only in the main thread and in worker
+*     threads that own a ThreadTree.  The section tree of the main
+*     thread collects per-season tallies, which are reset by
+*     printSeason.
+*
+* <license text>
+***********************************************************************/
+
+#include <ctime>
+#include <map>
+#include <ostream>
+#include <pthread.h>
+#include <boost/thread/mutex.hpp>
+
+#include "SectionTimer.hpp"
+
+using namespace std;
+
+// Local helpers for the section tree ---------------------------------------
+
+namespace {
+
+typedef SectionTimer::Node Node;
+typedef SectionTimer::ValueType ValueType;
+
+boost::mutex section_lock;
+const pthread_t main_thread = pthread_self();
+__thread Node* current_node = NULL;
+
+
+class SectionStorage : public map<string, SectionTimer*>
+{
+    public:
+
+        ~SectionStorage()
+        {
+            for (iterator ii = begin(); ii != end(); ++ii)  delete ii->second;
+        }
+};
+
+
+SectionStorage& section_storage()
+{
+    static SectionStorage the_storage;
+    return the_storage;
+}
+
+
+Node* newNode(const SectionTimer* section, Node* parent)
+{
+    Node* nd = new Node;
+    nd->section = section;
+    nd->parent = parent;
+    nd->calls = 0;
+    nd->nanoseconds = 0;
+    nd->child_nanoseconds = 0;
+    return nd;
+}
+
+
+void deleteChildren(Node* nd)
+{
+    vector<Node*>::iterator ci;
+    for (ci = nd->children.begin(); ci != nd->children.end(); ++ci)
+    {
+        deleteChildren(*ci);
+        delete *ci;
+    }
+    nd->children.clear();
+}
+
+
+Node& main_root()
+{
+    static Node* the_root = newNode(NULL, NULL);
+    return *the_root;
+}
+
+
+inline ValueType nanoseconds_now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ValueType(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+inline Node* child_node(Node* parent, const SectionTimer* section)
+{
+    vector<Node*>::iterator ci = parent->children.begin();
+    for (; ci != parent->children.end(); ++ci)
+    {
+        if ((*ci)->section == section)  return *ci;
+    }
+    parent->children.push_back(newNode(section, parent));
+    return parent->children.back();
+}
+
+
+void mergeChildren(Node* dst, const Node* src)
+{
+    vector<Node*>::const_iterator ci = src->children.begin();
+    for (; ci != src->children.end(); ++ci)
+    {
+        Node* nd = child_node(dst, (*ci)->section);
+        nd->calls += (*ci)->calls;
+        nd->nanoseconds += (*ci)->nanoseconds;
+        nd->child_nanoseconds += (*ci)->child_nanoseconds;
+        mergeChildren(nd, *ci);
+    }
+}
+
+
+// write JSON objects of all nodes with calls and reset their tallies
+
+void printNode(ostream& os, Node* nd, const string& path, bool& first)
+{
+    vector<Node*>::iterator ci = nd->children.begin();
+    for (; ci != nd->children.end(); ++ci)
+    {
+        Node* c = *ci;
+        string cpath = path + c->section->name();
+        if (c->calls)
+        {
+            double t = 1e-9 * c->nanoseconds;
+            // worker threads may add more child time than elapsed
+            double tchild = 1e-9 * c->child_nanoseconds;
+            double tself = (t > tchild) ? (t - tchild) : 0.0;
+            os << (first ? "" : ", ") << "{\"path\": \"" << cpath <<
+                "\", \"calls\": " << c->calls << ", \"seconds\": " << t <<
+                ", \"self\": " << tself << "}";
+            first = false;
+        }
+        c->calls = 0;
+        c->nanoseconds = 0;
+        c->child_nanoseconds = 0;
+        printNode(os, c, cpath + "/", first);
+    }
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class SectionTimer
+//////////////////////////////////////////////////////////////////////////////
+
+// class methods
+
+bool SectionTimer::isEnabled()
+{
+#ifdef LIGA_TIMERS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+SectionTimer* SectionTimer::getSection(const string& name)
+{
+    boost::mutex::scoped_lock lock(section_lock);
+    SectionStorage& storage = section_storage();
+    if (!storage.count(name))   storage[name] = new SectionTimer(name);
+    return storage[name];
+}
+
+
+SectionTimer::Node* SectionTimer::currentNode()
+{
+    return current_node;
+}
+
+
+void SectionTimer::printSeason(ostream& os, int season)
+{
+    bool first = true;
+    os << "{\"season\": " << season << ", \"sections\": [";
+    printNode(os, &main_root(), "", first);
+    os << "]}\n";
+    os.flush();
+}
+
+// constructor
+
+SectionTimer::SectionTimer(const string& name) : _name(name)
+{ }
+
+////////////////////////////////////////////////////////////////////////
+// definitions for SectionTimer::Scope
+////////////////////////////////////////////////////////////////////////
+
+SectionTimer::Scope::Scope(const SectionTimer* section) : _node(NULL)
+{
+    Node* parent = current_node;
+    if (!parent)
+    {
+        // threads without ThreadTree are not timed
+        if (!pthread_equal(pthread_self(), main_thread))    return;
+        parent = &main_root();
+    }
+    _node = child_node(parent, section);
+    current_node = _node;
+    _start = nanoseconds_now();
+}
+
+
+SectionTimer::Scope::~Scope()
+{
+    if (!_node)     return;
+    ValueType elapsed = nanoseconds_now() - _start;
+    _node->calls += 1;
+    _node->nanoseconds += elapsed;
+    _node->parent->child_nanoseconds += elapsed;
+    current_node = _node->parent;
+}
+
+////////////////////////////////////////////////////////////////////////
+// definitions for SectionTimer::ThreadTree
+////////////////////////////////////////////////////////////////////////
+
+SectionTimer::ThreadTree::ThreadTree(Node* parent) :
+    _parent(parent), _root(NULL)
+{
+#ifdef LIGA_TIMERS
+    _root = newNode(NULL, NULL);
+    current_node = _root;
+#endif
+}
+
+
+SectionTimer::ThreadTree::~ThreadTree()
+{
+    if (!_root)     return;
+    current_node = NULL;
+    boost::mutex::scoped_lock lock(section_lock);
+    mergeChildren(_parent ? _parent : &main_root(), _root);
+    deleteChildren(_root);
+    delete _root;
+}
+
+// End of file
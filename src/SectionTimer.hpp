@@ -0,0 +1,94 @@
+/***********************************************************************
+* Short Title: scoped timers of nested code sections
+*
+* Comments: SECTION_TIMER("name") measures the time spent in the rest
+*     of the enclosing block and counts its calls.  Timed sections form
+*     a tree of enclosing sections, which is written as a JSON line per
+*     season.  Timers are compiled only with the LIGA_TIMERS macro,
+*     otherwise SECTION_TIMER expands to nothing.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef SECTIONTIMER_HPP_INCLUDED
+#define SECTIONTIMER_HPP_INCLUDED
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#ifdef LIGA_TIMERS
+#define SECTION_TIMER(name) \
+    static SectionTimer* const _section_timer = \
+        SectionTimer::getSection(name); \
+    SectionTimer::Scope _section_timer_scope(_section_timer)
+#else
+#define SECTION_TIMER(name)
+#endif
+
+class SectionTimer
+{
+    public:
+
+        // types
+        typedef unsigned long long ValueType;
+
+        // node in the tree of nested sections
+        struct Node
+        {
+            const SectionTimer* section;
+            Node* parent;
+            std::vector<Node*> children;
+            ValueType calls;
+            ValueType nanoseconds;
+            ValueType child_nanoseconds;
+        };
+
+        // timed block, use through the SECTION_TIMER macro
+        class Scope
+        {
+            public:
+
+                Scope(const SectionTimer* section);
+                ~Scope();
+
+            private:
+
+                Node* _node;
+                ValueType _start;
+        };
+
+        // private section tree of a worker thread, which is merged
+        // below the launching section when ThreadTree goes out of scope
+        class ThreadTree
+        {
+            public:
+
+                ThreadTree(Node* parent);
+                ~ThreadTree();
+
+            private:
+
+                Node* _parent;
+                Node* _root;
+        };
+
+        // class methods
+        static bool isEnabled();
+        static SectionTimer* getSection(const std::string& name);
+        static Node* currentNode();
+        static void printSeason(std::ostream& os, int season);
+
+        // methods
+        const std::string& name() const  { return _name; }
+
+    private:
+
+        // constructor
+        SectionTimer(const std::string& name);
+
+        // data
+        const std::string _name;
+};
+
+#endif  // SECTIONTIMER_HPP_INCLUDED
@@ -0,0 +1,280 @@
+/***********************************************************************
+* Short Title: native readers and writers of simple structure formats
+*
+* Comments: Output in rawxyz, xyz and pdb formats and input of rawxyz
+*     and xyz files without the embedded diffpy.structure package.
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+
+#include "StructureIO.hpp"
+#include "Atom_t.hpp"
+#include "Exceptions.hpp"
+#include "StringUtils.hpp"
+
+using namespace std;
+
+// Local helpers for formatting and parsing --------------------------------
+
+namespace {
+
+void writeRawXYZ(ostream& fid, const vector<const Atom_t*>& atoms)
+{
+    char buf[128];
+    BOOST_FOREACH (const Atom_t* pa, atoms)
+    {
+        const R3::Vector& rc = pa->r;
+        snprintf(buf, sizeof(buf), "%s %g %g %g",
+                pa->element.c_str(), rc[0], rc[1], rc[2]);
+        string s(buf);
+        // diffpy strips leading blanks when element is empty
+        fid << s.substr(min(s.size(), s.find_first_not_of(' '))) << '\n';
+    }
+}
+
+
+void writeXYZ(ostream& fid, const vector<const Atom_t*>& atoms,
+        const string& title)
+{
+    fid << atoms.size() << '\n' << title << '\n';
+    char buf[128];
+    BOOST_FOREACH (const Atom_t* pa, atoms)
+    {
+        const R3::Vector& rc = pa->r;
+        snprintf(buf, sizeof(buf), "%-3s %g %g %g",
+                pa->element.c_str(), rc[0], rc[1], rc[2]);
+        fid << buf << '\n';
+    }
+}
+
+
+// PDB records have 80 columns, TITLE is split into 60 character pieces
+
+void writePDB(ostream& fid, const vector<const Atom_t*>& atoms,
+        const string& title)
+{
+    char buf[128];
+    string t = title;
+    for (int nlines = 0; !t.empty(); ++nlines)
+    {
+        size_t stop = t.size();
+        if (stop > 60)
+        {
+            size_t p = t.rfind(' ', 59);
+            stop = (p != string::npos && p >= 10) ? p : 60;
+        }
+        string cont = "  ";
+        if (nlines)
+        {
+            snprintf(buf, sizeof(buf), "%2i", nlines + 1);
+            cont = buf;
+        }
+        string line = "TITLE   " + cont + t.substr(0, stop);
+        snprintf(buf, sizeof(buf), "%-80s", line.c_str());
+        fid << buf << '\n';
+        t = t.substr(stop);
+    }
+    int serial = 0;
+    BOOST_FOREACH (const Atom_t* pa, atoms)
+    {
+        const R3::Vector& rc = pa->r;
+        const char* el = pa->element.c_str();
+        snprintf(buf, sizeof(buf),
+                "ATOM  %5i %-4s%c%-3s %c%4i%c   "
+                "%8.3f%8.3f%8.3f%6.2f%6.2f      %-4s%2s%-2s",
+                ++serial, el, ' ', "", ' ', 1, ' ',
+                rc[0], rc[1], rc[2], 1.0, 0.0, "", el, "");
+        fid << buf << '\n';
+    }
+    snprintf(buf, sizeof(buf), "TER   %5i      %-3s %c%4i%c%53s",
+            serial + 1, "", ' ', 1, ' ', " ");
+    fid << buf << '\n';
+    snprintf(buf, sizeof(buf), "%-80s", "END");
+    fid << buf << '\n';
+}
+
+
+bool parseDouble(const string& s, double& value)
+{
+    const char* p = s.c_str();
+    char* pend;
+    value = strtod(p, &pend);
+    return pend != p && *pend == '\0';
+}
+
+
+// parse "element x y z" line, return false for any other content
+
+bool parseAtomLine(const string& line, vector<Atom_t>& atoms)
+{
+    vector<string> words;
+    split(line, words);
+    if (words.size() != 4)  return false;
+    double xyz[4];
+    if (parseDouble(words[0], xyz[0]))  return false;
+    for (int i = 1; i != 4; ++i)
+    {
+        if (!parseDouble(words[i], xyz[i]))  return false;
+    }
+    atoms.push_back(Atom_t(words[0], xyz[1], xyz[2], xyz[3]));
+    return true;
+}
+
+
+bool isBlank(const string& line)
+{
+    return line.find_first_not_of(" \t\r") == string::npos;
+}
+
+
+bool parseXYZ(const vector<string>& lines, vector<Atom_t>& atoms)
+{
+    atoms.clear();
+    if (lines.size() < 2)  return false;
+    vector<string> words;
+    split(lines[0], words);
+    double natoms;
+    if (words.size() != 1 || !parseDouble(words[0], natoms))  return false;
+    for (size_t i = 2; i < lines.size(); ++i)
+    {
+        if (isBlank(lines[i]))  continue;
+        if (!parseAtomLine(lines[i], atoms))  return false;
+    }
+    return natoms == atoms.size();
+}
+
+
+bool parseRawXYZ(const vector<string>& lines, vector<Atom_t>& atoms)
+{
+    atoms.clear();
+    BOOST_FOREACH (const string& line, lines)
+    {
+        if (isBlank(line))  continue;
+        if (!parseAtomLine(line, atoms))  return false;
+    }
+    return !atoms.empty();
+}
+
+}   // namespace
+
+// Functions -----------------------------------------------------------------
+
+bool isNativeStructureFormat(const string& fmt, bool periodic)
+{
+    // pdb output of a periodic structure needs the CRYST1 record
+    bool rv = (fmt == "rawxyz" || fmt == "xyz" || (fmt == "pdb" && !periodic));
+    return rv;
+}
+
+
+void writeNativeStructure(ostream& fid, const string& fmt,
+        const vector<const Atom_t*>& atoms, const string& title)
+{
+    if (fmt == "rawxyz")    writeRawXYZ(fid, atoms);
+    else if (fmt == "xyz")  writeXYZ(fid, atoms, title);
+    else if (fmt == "pdb")  writePDB(fid, atoms, title);
+    else
+    {
+        ostringstream emsg;
+        emsg << "Unsupported native structure format '" << fmt << "'.";
+        throw invalid_argument(emsg.str());
+    }
+}
+
+
+bool readNativeStructure(const string& filename, vector<Atom_t>& atoms)
+{
+    ifstream fid(filename.c_str());
+    if (!fid)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    vector<string> lines;
+    string line;
+    while (getline(fid, line))  lines.push_back(line);
+    bool rv = parseXYZ(lines, atoms) || parseRawXYZ(lines, atoms);
+    if (!rv)  atoms.clear();
+    return rv;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// class XYZFrameReader
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+XYZFrameReader::XYZFrameReader(const string& filename) :
+    mfilename(filename), mfid(filename.c_str()), mlineno(0), mframes(0)
+{
+    if (!mfid)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+}
+
+// Public Methods ------------------------------------------------------------
+
+bool XYZFrameReader::next(vector<Atom_t>& atoms)
+{
+    atoms.clear();
+    string line;
+    // skip blank lines between frames
+    bool hasline = false;
+    while (!hasline && getline(mfid, line))
+    {
+        ++mlineno;
+        hasline = !isBlank(line);
+    }
+    if (!hasline)   return false;
+    vector<string> words;
+    split(line, words);
+    double natoms;
+    if (words.size() != 1 || !parseDouble(words[0], natoms) ||
+            natoms < 0 || natoms != int(natoms))
+    {
+        this->throwInvalidFrame("invalid atom count");
+    }
+    // title line
+    if (!getline(mfid, line))   this->throwInvalidFrame("missing title");
+    ++mlineno;
+    while (int(atoms.size()) < natoms)
+    {
+        if (!getline(mfid, line))   this->throwInvalidFrame("missing atoms");
+        ++mlineno;
+        if (!parseAtomLine(line, atoms))
+        {
+            this->throwInvalidFrame("invalid atom record");
+        }
+    }
+    ++mframes;
+    return true;
+}
+
+
+int XYZFrameReader::countFrames() const
+{
+    return mframes;
+}
+
+// Private Methods -----------------------------------------------------------
+
+void XYZFrameReader::throwInvalidFrame(const string& reason) const
+{
+    ostringstream emsg;
+    emsg << mfilename << ':' << mlineno << ": " << reason <<
+        " in xyz frame " << mframes << '.';
+    throw IOError(emsg.str());
+}
+
+// End of file
@@ -0,0 +1,62 @@
+/***********************************************************************
+* Short Title: native readers and writers of simple structure formats
+*
+* Comments: Output in rawxyz, xyz and pdb formats and input of rawxyz
+*     and xyz files without the embedded diffpy.structure package.
+*     The output is the same as from the diffpy.structure writers.
+*     Other formats and files that do not parse are left to diffpy.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef STRUCTUREIO_HPP_INCLUDED
+#define STRUCTUREIO_HPP_INCLUDED
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class Atom_t;
+
+// true if format is written by writeNativeStructure
+bool isNativeStructureFormat(const std::string& fmt, bool periodic);
+
+// write atoms in a native format, throws invalid_argument for others
+void writeNativeStructure(std::ostream& fid, const std::string& fmt,
+        const std::vector<const Atom_t*>& atoms, const std::string& title);
+
+// read atoms from xyz or rawxyz file, return false if file does not
+// have either format.  Throws IOError for unreadable file.
+bool readNativeStructure(const std::string& filename,
+        std::vector<Atom_t>& atoms);
+
+// Streaming reader of concatenated xyz frames, such as MD trajectories.
+// Frames are parsed one at a time, the file is never loaded in full.
+
+class XYZFrameReader
+{
+    public:
+
+        // constructor, throws IOError for unreadable file
+        XYZFrameReader(const std::string& filename);
+
+        // methods
+        // read the next frame, return false at the end of file.
+        // Throws IOError for a frame that is not in xyz format.
+        bool next(std::vector<Atom_t>& atoms);
+        // number of frames read so far
+        int countFrames() const;
+
+    private:
+
+        // data
+        std::string mfilename;
+        std::ifstream mfid;
+        int mlineno;
+        int mframes;
+
+        // methods
+        void throwInvalidFrame(const std::string& reason) const;
+};
+
+#endif  // STRUCTUREIO_HPP_INCLUDED
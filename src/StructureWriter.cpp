@@ -0,0 +1,140 @@
+/***********************************************************************
+* Short Title: background writer of structure files
+*
+* Comments: implementation of StructureWriter
+*
+* <license text>
+***********************************************************************/
+
+#include <sstream>
+#include <boost/bind.hpp>
+
+#include "StructureWriter.hpp"
+#include "Molecule.hpp"
+#include "LigaUtils.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////
+// class StructureWriter
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+StructureWriter::StructureWriter(size_t maxpending) :
+    _maxpending(max(size_t(1), maxpending)),
+    _busy(false), _stopped(false), _written(0)
+{ }
+
+
+StructureWriter::~StructureWriter()
+{
+    if (!_thread.get())  return;
+    {
+        boost::mutex::scoped_lock lock(_lock);
+        _stopped = true;
+    }
+    // the writer thread finishes pending files before it exits
+    _has_pending.notify_all();
+    _thread->join();
+}
+
+// Public Methods ------------------------------------------------------------
+
+void StructureWriter::write(const string& filename, const Molecule& mol)
+{
+    // structure format errors are raised here in the calling thread
+    ostringstream output;
+    mol.WriteStream(output);
+    this->write(filename, output.str());
+}
+
+
+void StructureWriter::write(const string& filename, const string& content)
+{
+    boost::mutex::scoped_lock lock(_lock);
+    this->raiseError();
+    map<string, string>::iterator pi = _pending.find(filename);
+    // replace older content that has not been written yet
+    if (pi != _pending.end())
+    {
+        pi->second = content;
+        return;
+    }
+    while (_pending.size() >= _maxpending && _error_message.empty())
+    {
+        _has_room.wait(lock);
+    }
+    this->raiseError();
+    _pending[filename] = content;
+    _order.push_back(filename);
+    if (!_thread.get())
+    {
+        _thread.reset(new boost::thread(
+                    boost::bind(&StructureWriter::writerLoop, this)));
+    }
+    _has_pending.notify_one();
+}
+
+
+void StructureWriter::flush()
+{
+    boost::mutex::scoped_lock lock(_lock);
+    while ((_busy || !_pending.empty()) && _error_message.empty())
+    {
+        _has_room.wait(lock);
+    }
+    this->raiseError();
+}
+
+
+size_t StructureWriter::countWritten() const
+{
+    boost::mutex::scoped_lock lock(_lock);
+    return _written;
+}
+
+// Private Methods -----------------------------------------------------------
+
+void StructureWriter::writerLoop()
+{
+    boost::mutex::scoped_lock lock(_lock);
+    while (true)
+    {
+        while (_order.empty() && !_stopped)  _has_pending.wait(lock);
+        if (_order.empty())  break;
+        string filename = _order.front();
+        _order.pop_front();
+        string content;
+        content.swap(_pending[filename]);
+        _pending.erase(filename);
+        _busy = true;
+        lock.unlock();
+        string emsg;
+        try {
+            replace_file(filename, content);
+        }
+        catch (exception& e) {
+            emsg = e.what();
+        }
+        lock.lock();
+        _busy = false;
+        if (emsg.empty())  ++_written;
+        else if (_error_message.empty())  _error_message = emsg;
+        _has_room.notify_all();
+    }
+}
+
+
+// called with _lock held
+
+void StructureWriter::raiseError()
+{
+    if (_error_message.empty())  return;
+    string emsg;
+    emsg.swap(_error_message);
+    throw IOError(emsg);
+}
+
+// End of file
@@ -0,0 +1,61 @@
+/***********************************************************************
+* Short Title: background writer of structure files
+*
+* Comments: StructureWriter renders a structure to text in the calling
+*     thread and writes the file in a background thread.  Only the
+*     latest content is kept for a pending file name.  write blocks
+*     when too many files are pending, flush waits until all files are
+*     written.  Write errors are raised in the calling thread by the
+*     next write or flush.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef STRUCTUREWRITER_HPP_INCLUDED
+#define STRUCTUREWRITER_HPP_INCLUDED
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class Molecule;
+
+class StructureWriter
+{
+    public:
+
+        // constructor and destructor
+        StructureWriter(size_t maxpending=32);
+        ~StructureWriter();
+
+        // methods
+        void write(const std::string& filename, const Molecule& mol);
+        void write(const std::string& filename, const std::string& content);
+        void flush();
+        size_t countWritten() const;
+
+    private:
+
+        // data
+        size_t _maxpending;
+        std::map<std::string, std::string> _pending;
+        std::deque<std::string> _order;
+        bool _busy;
+        bool _stopped;
+        size_t _written;
+        std::string _error_message;
+        mutable boost::mutex _lock;
+        boost::condition_variable _has_pending;
+        boost::condition_variable _has_room;
+        std::auto_ptr<boost::thread> _thread;
+
+        // methods
+        void writerLoop();
+        void raiseError();
+};
+
+#endif  // STRUCTUREWRITER_HPP_INCLUDED
@@ -0,0 +1,245 @@
+/***********************************************************************
+* Short Title: symmetry operation in fractional coordinates
+*
+* Comments: implementation of SymmetryOperation
+*
+* <license text>
+***********************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "SymmetryOperation.hpp"
+#include "Exceptions.hpp"
+#include "ParseArgs.hpp"
+
+using namespace std;
+
+// Local helpers for the x,y,z notation --------------------------------------
+
+namespace {
+
+const double eps_symop = 1.0e-6;
+
+// parse number or fraction such as "1/2", return false when invalid
+
+bool parseFraction(const string& word, double& value)
+{
+    if (word.empty())   return false;
+    size_t slash = word.find('/');
+    string num = word.substr(0, slash);
+    char* endp;
+    value = strtod(num.c_str(), &endp);
+    if (num.empty() || *endp != '\0')   return false;
+    if (slash == string::npos)  return true;
+    string den = word.substr(slash + 1);
+    double d = strtod(den.c_str(), &endp);
+    if (den.empty() || *endp != '\0' || d == 0.0)   return false;
+    value /= d;
+    return true;
+}
+
+
+// parse one coordinate such as "x-y+1/3" into the row of R and t,
+// return false when invalid
+
+bool parseCoordinate(const string& s, R3::Matrix& R, R3::Vector& t, int row)
+{
+    size_t pos = 0;
+    bool hasterm = false;
+    while (pos < s.size())
+    {
+        double sign = 1.0;
+        if (s[pos] == '+' || s[pos] == '-')
+        {
+            sign = (s[pos] == '-') ? -1.0 : 1.0;
+            ++pos;
+        }
+        size_t numend = s.find_first_not_of("0123456789./", pos);
+        if (numend == string::npos)     numend = s.size();
+        string num = s.substr(pos, numend - pos);
+        pos = numend;
+        double value = 1.0;
+        if (!num.empty() && !parseFraction(num, value))     return false;
+        if (!num.empty() && pos < s.size() && s[pos] == '*')    ++pos;
+        int col = (pos < s.size()) ?
+            (tolower(s[pos]) - 'x') : -1;
+        if (0 <= col && col < R3::Ndim)
+        {
+            R(row, col) += sign * value;
+            ++pos;
+        }
+        else if (!num.empty())
+        {
+            t[row] += sign * value;
+        }
+        else    return false;
+        hasterm = true;
+    }
+    return hasterm;
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class SymmetryOperation
+//////////////////////////////////////////////////////////////////////////////
+
+// Class Methods -------------------------------------------------------------
+
+SymmetryOperation SymmetryOperation::fromXYZ(const string& xyz)
+{
+    string s;
+    for (string::const_iterator c = xyz.begin(); c != xyz.end(); ++c)
+    {
+        if (!isspace(*c) && *c != '\'' && *c != '"')     s += *c;
+    }
+    SymmetryOperation rv;
+    rv.R = 0.0;
+    rv.t = 0.0;
+    istringstream coords(s);
+    string w;
+    int row = 0;
+    for (; getline(coords, w, ','); ++row)
+    {
+        if (row < R3::Ndim && parseCoordinate(w, rv.R, rv.t, row))  continue;
+        row = -1;
+        break;
+    }
+    if (row != R3::Ndim || s.empty() || *(s.end() - 1) == ',')
+    {
+        ostringstream emsg;
+        emsg << "Invalid symmetry operation '" << xyz << "'.";
+        throw invalid_argument(emsg.str());
+    }
+    return rv;
+}
+
+
+vector<SymmetryOperation>
+SymmetryOperation::readSymmetryFile(const string& filename)
+{
+    ifstream fid(filename.c_str());
+    if (!fid)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    vector<SymmetryOperation> rv;
+    string line;
+    for (int lineno = 1; getline(fid, line); ++lineno)
+    {
+        line = line.substr(0, line.find('#'));
+        // skip the leading index in lines copied from CIF loops
+        istringstream words(line);
+        string w0, w1;
+        words >> w0;
+        if (w0.empty())     continue;
+        bool isindex = (words >> w1) &&
+            w0.find_first_not_of("0123456789") == string::npos;
+        if (isindex)    line = line.substr(line.find(w0) + w0.size());
+        try {
+            rv.push_back(SymmetryOperation::fromXYZ(line));
+        }
+        catch (invalid_argument& e) {
+            ostringstream emsg;
+            emsg << filename << ':' << lineno << ": " << e.what();
+            throw ParseArgsError(emsg.str());
+        }
+    }
+    if (!SymmetryOperation::isGroup(rv))
+    {
+        ostringstream emsg;
+        emsg << "Symmetry operations in '" << filename <<
+            "' do not form a group.";
+        throw ParseArgsError(emsg.str());
+    }
+    return rv;
+}
+
+
+bool SymmetryOperation::isGroup(const vector<SymmetryOperation>& ops)
+{
+    vector<SymmetryOperation>::const_iterator op0, op1, op2;
+    bool hasidentity = false;
+    for (op0 = ops.begin(); op0 != ops.end(); ++op0)
+    {
+        hasidentity = hasidentity || op0->isEquivalent(SymmetryOperation());
+    }
+    if (!hasidentity)   return false;
+    for (op0 = ops.begin(); op0 != ops.end(); ++op0)
+    {
+        for (op1 = ops.begin(); op1 != ops.end(); ++op1)
+        {
+            SymmetryOperation op01 = (*op0) * (*op1);
+            for (op2 = ops.begin(); op2 != ops.end(); ++op2)
+            {
+                if (op2->isEquivalent(op01))    break;
+            }
+            if (op2 == ops.end())   return false;
+        }
+    }
+    return true;
+}
+
+// Constructor ---------------------------------------------------------------
+
+SymmetryOperation::SymmetryOperation()
+{
+    this->R = 1.0, 0.0, 0.0,
+              0.0, 1.0, 0.0,
+              0.0, 0.0, 1.0;
+    this->t = 0.0;
+}
+
+// Public Methods ------------------------------------------------------------
+
+R3::Vector SymmetryOperation::operator()(const R3::Vector& lv) const
+{
+    R3::Vector rv;
+    for (int i = 0; i != R3::Ndim; ++i)
+    {
+        rv[i] = R(i,0) * lv[0] + R(i,1) * lv[1] + R(i,2) * lv[2] + t[i];
+    }
+    return rv;
+}
+
+
+SymmetryOperation
+SymmetryOperation::operator*(const SymmetryOperation& other) const
+{
+    SymmetryOperation rv;
+    rv.R = R3::product(this->R, other.R);
+    rv.t = (*this)(other.t);
+    return rv;
+}
+
+
+bool SymmetryOperation::isIdentity() const
+{
+    const SymmetryOperation identity;
+    return R3::MatricesAlmostEqual(this->R, identity.R) &&
+        R3::VectorsAlmostEqual(this->t, identity.t);
+}
+
+
+// operations are equivalent when they differ by a lattice translation
+
+bool SymmetryOperation::isEquivalent(const SymmetryOperation& other) const
+{
+    if (!R3::MatricesAlmostEqual(this->R, other.R, eps_symop))  return false;
+    for (int i = 0; i != R3::Ndim; ++i)
+    {
+        double dt = this->t[i] - other.t[i];
+        if (fabs(dt - floor(dt + 0.5)) > eps_symop)     return false;
+    }
+    return true;
+}
+
+// End of file
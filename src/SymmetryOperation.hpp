@@ -0,0 +1,46 @@
+/***********************************************************************
+* Short Title: symmetry operation in fractional coordinates
+*
+* Comments: SymmetryOperation maps fractional coordinates xyz to
+*     R * xyz + t.  Operations are read from the x,y,z notation used
+*     for symmetry equivalent positions in CIF files.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef SYMMETRYOPERATION_HPP_INCLUDED
+#define SYMMETRYOPERATION_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include "R3linalg.hpp"
+
+class SymmetryOperation
+{
+    public:
+
+        // class methods
+        // parse operation such as "-y,x-y,z+1/3"
+        static SymmetryOperation fromXYZ(const std::string& xyz);
+        // one operation per line, '#' starts a comment
+        static std::vector<SymmetryOperation>
+            readSymmetryFile(const std::string& filename);
+        // true when ops contain identity and are closed under product
+        // up to lattice translations
+        static bool isGroup(const std::vector<SymmetryOperation>& ops);
+
+        // data
+        R3::Matrix R;
+        R3::Vector t;
+
+        // constructor
+        SymmetryOperation();    // identity
+
+        // methods
+        R3::Vector operator()(const R3::Vector& lv) const;
+        SymmetryOperation operator*(const SymmetryOperation& other) const;
+        bool isIdentity() const;
+        bool isEquivalent(const SymmetryOperation& other) const;
+};
+
+#endif  // SYMMETRYOPERATION_HPP_INCLUDED
@@ -0,0 +1,205 @@
+/***********************************************************************
+* Short Title: background sink of telemetry records
+*
+* Comments: implementation of TelemetrySink
+*
+* <license text>
+***********************************************************************/
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <boost/bind.hpp>
+
+#include "TelemetrySink.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+// Local helpers for opening telemetry targets -------------------------------
+
+namespace {
+
+const string UNIX_SOCKET_PREFIX = "unix:";
+
+
+int open_unix_socket(const string& path)
+{
+    sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        ostringstream emsg;
+        emsg << "Socket path '" << path << "' is too long.";
+        throw IOError(emsg.str());
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool connected = (fd >= 0) &&
+        (0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+    if (!connected)
+    {
+        ostringstream emsg;
+        emsg << "Unable to connect to socket '" << path << "', " <<
+            strerror(errno);
+        if (fd >= 0)    close(fd);
+        throw IOError(emsg.str());
+    }
+    return fd;
+}
+
+
+int open_file(const string& filename)
+{
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        ostringstream emsg;
+        emsg << "Unable to write to '" << filename << "'";
+        throw IOError(emsg.str());
+    }
+    return fd;
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class TelemetrySink
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+TelemetrySink::TelemetrySink(const string& target, size_t maxpending) :
+    _target(target), _fd(-1), _socket(false),
+    _maxpending(max(size_t(1), maxpending)),
+    _busy(false), _stopped(false)
+{
+    _socket = (0 == target.compare(0, UNIX_SOCKET_PREFIX.size(),
+                UNIX_SOCKET_PREFIX));
+    _fd = _socket ?
+        open_unix_socket(target.substr(UNIX_SOCKET_PREFIX.size())) :
+        open_file(target);
+    _thread.reset(new boost::thread(
+                boost::bind(&TelemetrySink::senderLoop, this)));
+}
+
+
+TelemetrySink::~TelemetrySink()
+{
+    {
+        boost::mutex::scoped_lock lock(_lock);
+        _stopped = true;
+    }
+    // the sender thread finishes pending records before it exits
+    _has_pending.notify_all();
+    _thread->join();
+    close(_fd);
+}
+
+// Public Methods ------------------------------------------------------------
+
+void TelemetrySink::send(const string& record)
+{
+    boost::mutex::scoped_lock lock(_lock);
+    this->raiseError();
+    while (_pending.size() >= _maxpending && _error_message.empty())
+    {
+        _has_room.wait(lock);
+    }
+    this->raiseError();
+    _pending.push_back(record);
+    _pending.back() += '\n';
+    _has_pending.notify_one();
+}
+
+
+void TelemetrySink::flush()
+{
+    boost::mutex::scoped_lock lock(_lock);
+    while ((_busy || !_pending.empty()) && _error_message.empty())
+    {
+        _has_room.wait(lock);
+    }
+    this->raiseError();
+}
+
+
+const string& TelemetrySink::target() const
+{
+    return _target;
+}
+
+// Private Methods -----------------------------------------------------------
+
+void TelemetrySink::senderLoop()
+{
+    boost::mutex::scoped_lock lock(_lock);
+    while (true)
+    {
+        while (_pending.empty() && !_stopped)  _has_pending.wait(lock);
+        if (_pending.empty())  break;
+        // write all queued records at once
+        string data;
+        for (; !_pending.empty(); _pending.pop_front())
+        {
+            data += _pending.front();
+        }
+        _busy = true;
+        _has_room.notify_all();
+        lock.unlock();
+        string emsg;
+        try {
+            this->writeAll(data);
+        }
+        catch (exception& e) {
+            emsg = e.what();
+        }
+        lock.lock();
+        _busy = false;
+        if (!emsg.empty() && _error_message.empty())  _error_message = emsg;
+        _has_room.notify_all();
+        // drop further records after a failure
+        if (!_error_message.empty())    _pending.clear();
+    }
+}
+
+
+void TelemetrySink::writeAll(const string& data)
+{
+    const char* p = data.data();
+    size_t n = data.size();
+    while (n > 0)
+    {
+        // closed socket readers must not raise SIGPIPE
+        ssize_t cnt = _socket ? ::send(_fd, p, n, MSG_NOSIGNAL) :
+            ::write(_fd, p, n);
+        if (cnt < 0 && errno == EINTR)  continue;
+        if (cnt <= 0)
+        {
+            ostringstream emsg;
+            emsg << "Unable to write telemetry to '" << _target << "', " <<
+                strerror(errno);
+            throw IOError(emsg.str());
+        }
+        p += cnt;
+        n -= cnt;
+    }
+}
+
+
+// called with _lock held
+
+void TelemetrySink::raiseError()
+{
+    if (_error_message.empty())  return;
+    string emsg;
+    emsg.swap(_error_message);
+    throw IOError(emsg);
+}
+
+// End of file
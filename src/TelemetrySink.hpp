@@ -0,0 +1,59 @@
+/***********************************************************************
+* Short Title: background sink of telemetry records
+*
+* Comments: TelemetrySink sends text records, one per line, to a file
+*     or to a Unix socket given as "unix:PATH".  Records are queued in
+*     the calling thread and written by a background thread.  send
+*     blocks when too many records are pending, flush waits until all
+*     records are written.  Write errors are raised in the calling
+*     thread by the next send or flush.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef TELEMETRYSINK_HPP_INCLUDED
+#define TELEMETRYSINK_HPP_INCLUDED
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+class TelemetrySink
+{
+    public:
+
+        // constructor and destructor
+        TelemetrySink(const std::string& target, size_t maxpending=1024);
+        ~TelemetrySink();
+
+        // methods
+        void send(const std::string& record);
+        void flush();
+        const std::string& target() const;
+
+    private:
+
+        // data
+        std::string _target;
+        int _fd;
+        bool _socket;
+        size_t _maxpending;
+        std::deque<std::string> _pending;
+        bool _busy;
+        bool _stopped;
+        std::string _error_message;
+        boost::mutex _lock;
+        boost::condition_variable _has_pending;
+        boost::condition_variable _has_room;
+        std::auto_ptr<boost::thread> _thread;
+
+        // methods
+        void senderLoop();
+        void writeAll(const std::string& data);
+        void raiseError();
+};
+
+#endif  // TELEMETRYSINK_HPP_INCLUDED
@@ -0,0 +1,178 @@
+/***********************************************************************
+*
+* Liga Algorithm    for structure determination from pair distances
+*                   Pavol Juhas
+*                   (c) 2009 Trustees of the Columbia University
+*                   in the City of New York.  All rights reserved.
+*
+* See AUTHORS.txt for a list of people who contributed.
+* See LICENSE.txt for license information.
+*
+************************************************************************
+*
+* class TestAtomCost
+*
+* Comments: unit tests for AtomCost class
+*
+***********************************************************************/
+
+#include <cmath>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+
+#include "AtomCost.hpp"
+#include "DistanceTable.hpp"
+#include "Molecule.hpp"
+
+using namespace std;
+
+class TestAtomCost : public CxxTest::TestSuite
+{
+    private:
+
+        DistanceTable dst;
+        Molecule mtriangle;
+        vector<Atom_t> vta;
+
+    public:
+
+        void setUp()
+        {
+            double dst_data[6] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+            dst = DistanceTable(dst_data, 6);
+            mtriangle.setDistanceTable(dst);
+            mtriangle.setChemicalFormula("C4");
+            mtriangle.Clear();
+            mtriangle.AddAt("C", 0.0, 0.0, 0.0);
+            mtriangle.AddAt("C", 1.0, 0.0, 0.0);
+            mtriangle.AddAt("C", 0.5, sqrt(0.75), 0.0);
+            vta.clear();
+            vta.push_back(Atom_t("C", 0.5, sqrt(3.0)/6, sqrt(2.0/3)));
+            vta.push_back(Atom_t("C", 0.5, sqrt(3.0)/6, 0.5));
+            vta.push_back(Atom_t("C", 3.0, 2.0, 1.0));
+            vta.push_back(Atom_t("C", 0.5, sqrt(3.0)/6, -0.7));
+            vta.push_back(Atom_t("C", -0.5, 0.5, 0.2));
+        }
+
+
+        void test_evalBatch()
+        {
+            AtomCost ac0(&mtriangle);
+            AtomCost ac1(&mtriangle);
+            const double eps = 1e-12;
+            // without cutoff
+            const vector<double>& costs = ac1.evalBatch(vta);
+            TS_ASSERT_EQUALS(vta.size(), costs.size());
+            TS_ASSERT_DELTA(0.0, costs[0], eps);
+            for (size_t i = 0; i != vta.size(); ++i)
+            {
+                TS_ASSERT_DELTA(ac0.eval(vta[i]), costs[i], eps);
+            }
+            // with cutoff, lowest cost and cutoff must update the same way
+            ac0.setCutoff(0.5);
+            ac0.setCutoffRange(0.01);
+            ac1.setCutoff(0.5);
+            ac1.setCutoffRange(0.01);
+            ac1.evalBatch(vta);
+            for (size_t i = 0; i != vta.size(); ++i)
+            {
+                TS_ASSERT_DELTA(ac0.eval(vta[i]), costs[i], eps);
+            }
+            TS_ASSERT_EQUALS(ac0.lowest(), ac1.lowest());
+            TS_ASSERT_EQUALS(ac0.cutoff(), ac1.cutoff());
+            TS_ASSERT(ac1.cutoff() < 0.5);
+        }
+
+
+        void test_evalWithOverlap()
+        {
+            mtriangle.setAtomRadiiTable("C:0.6");
+            mtriangle.setAtomOverlapScale(2.0);
+            AtomCost ac0(&mtriangle);
+            AtomCost ac1(&mtriangle);
+            AtomCost* aoc = mtriangle.getAtomOverlapCalculator();
+            const double eps = 1e-12;
+            for (size_t i = 0; i != vta.size(); ++i)
+            {
+                Atom_t& ta = vta[i];
+                ta.radius = (i == 4) ? -1.0 : 0.6;
+                double c0 = ac0.eval(ta, AtomCost::GRADIENT);
+                R3::Vector g0 = ac0.gradient();
+                double o0 = aoc->eval(ta, AtomCost::GRADIENT);
+                R3::Vector go0 = aoc->gradient();
+                double o1;
+                R3::Vector go1;
+                double c1 = ac1.evalWithOverlap(&ta, *aoc, o1, go1);
+                TS_ASSERT_DELTA(c0, c1, eps);
+                TS_ASSERT_DELTA(o0, o1, eps);
+                for (int k = 0; k != R3::Ndim; ++k)
+                {
+                    TS_ASSERT_DELTA(g0[k], ac1.gradient()[k], eps);
+                    TS_ASSERT_DELTA(go0[k], go1[k], eps);
+                }
+            }
+            // the test atoms should overlap with the triangle
+            TS_ASSERT(aoc->eval(vta[1]) > 0.0);
+            TS_ASSERT_EQUALS(0.0, aoc->eval(vta[4]));
+        }
+
+
+        void test_penalty_forms()
+        {
+            AtomCost ac(&mtriangle);
+            const double eps = 1e-6;
+            const double h = 1e-6;
+            list<string> ptypes = AtomCost::getPenaltyTypes();
+            TS_ASSERT_EQUALS(3u, ptypes.size());
+            TS_ASSERT(AtomCost::isPenaltyType("huber"));
+            TS_ASSERT(!AtomCost::isPenaltyType("cubic"));
+            TS_ASSERT_THROWS(AtomCost::getPenaltyType("cubic"),
+                    invalid_argument);
+            list<string>::const_iterator tp;
+            for (tp = ptypes.begin(); tp != ptypes.end(); ++tp)
+            {
+                ac.setPenalty(AtomCost::getPenaltyType(*tp), 0.2);
+                for (size_t i = 0; i != vta.size(); ++i)
+                {
+                    Atom_t ta = vta[i];
+                    double c = ac.eval(ta, AtomCost::GRADIENT);
+                    R3::Vector g = ac.gradient();
+                    // cost is the sum of penalties for target distances
+                    double csum = 0.0;
+                    for (int j = 0; j != mtriangle.countAtoms(); ++j)
+                    {
+                        double d = R3::distance(ta.r, mtriangle.getAtom(j).r);
+                        double dd = ac.targetDistances()[j] - d;
+                        csum += ac.penaltyScaled(dd, 1.0);
+                    }
+                    TS_ASSERT_DELTA(csum, c, 1e-12);
+                    // gradient agrees with numerical derivative
+                    for (int k = 0; k != R3::Ndim; ++k)
+                    {
+                        Atom_t ta1 = ta;
+                        ta1.r[k] += h;
+                        double c1 = ac.eval(ta1);
+                        TS_ASSERT_DELTA(g[k], (c1 - c) / h, eps * 1e3);
+                    }
+                }
+            }
+            // huber and flat bottom forms differ from square
+            Atom_t ta = vta[2];
+            ac.setPenalty(AtomCost::SQUARE);
+            double csquare = ac.eval(ta);
+            ac.setPenalty(AtomCost::HUBER, 0.2);
+            double chuber = ac.eval(ta);
+            ac.setPenalty(AtomCost::FLATBOTTOM, 0.2);
+            double cflat = ac.eval(ta);
+            TS_ASSERT(chuber < csquare);
+            TS_ASSERT(cflat < csquare);
+            ac.setPenalty(AtomCost::FLATBOTTOM, 100.0);
+            TS_ASSERT_EQUALS(0.0, ac.eval(ta));
+        }
+
+};  // class TestAtomCost
+
+// End of file
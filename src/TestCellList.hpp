@@ -0,0 +1,153 @@
+/***********************************************************************
+* Short Title: unit tests for CellList class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+
+#include "CellList.hpp"
+#include "Molecule.hpp"
+#include "Random.hpp"
+
+using namespace std;
+using namespace NS_LIGA;
+
+class TestCellList : public CxxTest::TestSuite
+{
+    private:
+
+        vector<double> rx, ry, rz;
+
+        vector<int> bruteNear(double x, double y, double z, double rcut)
+        {
+            vector<int> rv;
+            for (size_t k = 0; k != rx.size(); ++k)
+            {
+                double dx = rx[k] - x, dy = ry[k] - y, dz = rz[k] - z;
+                if (sqrt(dx*dx + dy*dy + dz*dz) <= rcut)  rv.push_back(k);
+            }
+            return rv;
+        }
+
+    public:
+
+        void setUp()
+        {
+            RandomStreamScope stream(11, 0);
+            rx.clear(); ry.clear(); rz.clear();
+            for (int k = 0; k != 200; ++k)
+            {
+                rx.push_back(10 * randomFloat());
+                ry.push_back(10 * randomFloat());
+                rz.push_back(2 * randomFloat());
+            }
+        }
+
+
+        void test_findNear()
+        {
+            CellList cells;
+            TS_ASSERT(!cells.isBuilt());
+            cells.build(rx, ry, rz, 1.0);
+            TS_ASSERT(cells.isBuilt());
+            TS_ASSERT_EQUALS(200u, cells.countPoints());
+            double queries[4][4] = {
+                {5.0, 5.0, 1.0, 1.0},
+                {0.0, 0.0, 0.0, 2.5},
+                {-3.0, 5.0, 1.0, 3.5},
+                {5.0, 5.0, 1.0, 100.0},
+            };
+            vector<int> near;
+            for (int i = 0; i != 4; ++i)
+            {
+                double* q = queries[i];
+                cells.findNear(near, q[0], q[1], q[2], q[3]);
+                vector<int> exact = bruteNear(q[0], q[1], q[2], q[3]);
+                // near holds a sorted superset of the exact neighbors
+                for (size_t k = 1; k < near.size(); ++k)
+                {
+                    TS_ASSERT(near[k - 1] < near[k]);
+                }
+                TS_ASSERT(includes(near.begin(), near.end(),
+                            exact.begin(), exact.end()));
+            }
+            TS_ASSERT_EQUALS(200u, near.size());
+            cells.findNear(near, 50.0, 5.0, 1.0, 1.0);
+            TS_ASSERT(near.empty());
+        }
+
+
+        void test_cell_count()
+        {
+            CellList cells;
+            // tiny cells are enlarged to limit the count of cells
+            cells.build(rx, ry, rz, 1.0e-6);
+            TS_ASSERT(cells.getCellSize() > 0.1);
+            cells.build(rx, ry, rz, 0.0);
+            vector<int> near;
+            cells.findNear(near, 5.0, 5.0, 1.0, 0.0);
+            TS_ASSERT_EQUALS(200u, near.size());
+            vector<double> empty;
+            cells.build(empty, empty, empty, 1.0);
+            cells.findNear(near, 0.0, 0.0, 0.0, 1.0);
+            TS_ASSERT(near.empty());
+        }
+
+
+        void test_hasNear()
+        {
+            CellList cells;
+            cells.build(rx, ry, rz, 1.0);
+            vector<int> near;
+            RandomStreamScope stream(13, 0);
+            for (int i = 0; i != 100; ++i)
+            {
+                double x = 14 * randomFloat() - 2;
+                double y = 14 * randomFloat() - 2;
+                double z = 6 * randomFloat() - 2;
+                double rcut = randomFloat();
+                cells.findNear(near, x, y, z, rcut);
+                TS_ASSERT_EQUALS(!near.empty(), cells.hasNear(x, y, z, rcut));
+            }
+            TS_ASSERT(!cells.hasNear(50.0, 5.0, 1.0, 1.0));
+            TS_ASSERT(cells.hasNear(50.0, 5.0, 1.0, 100.0));
+        }
+
+
+        void test_Molecule_getNearestAtom()
+        {
+            Molecule mol;
+            vector<double> dst(1, 1.0);
+            mol.setDistanceTable(dst);
+            mol.setDistReuse(true);
+            mol.setChemicalFormula("C200");
+            mol.Clear();
+            for (size_t k = 0; k != rx.size(); ++k)
+            {
+                mol.AddAt("C", rx[k], ry[k], rz[k]);
+            }
+            double queries[3][3] = {
+                {5.0, 5.0, 1.0}, {-20.0, 3.0, 0.0}, {rx[7], ry[7], rz[7]},
+            };
+            for (int i = 0; i != 3; ++i)
+            {
+                R3::Vector rc(queries[i][0], queries[i][1], queries[i][2]);
+                double dmin = 1.0e99;
+                for (int k = 0; k != mol.countAtoms(); ++k)
+                {
+                    dmin = min(dmin, R3::distance(rc, mol.getAtom(k).r));
+                }
+                AtomPtr ap = mol.getNearestAtom(rc);
+                TS_ASSERT_EQUALS(dmin, R3::distance(rc, ap->r));
+            }
+        }
+
+};  // class TestCellList
+
+// End of file
@@ -0,0 +1,71 @@
+/***********************************************************************
+* Short Title: unit tests for ChampionBoard
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cxxtest/TestSuite.h>
+
+#include "ChampionBoard.hpp"
+
+using namespace std;
+
+class TestChampionBoard : public CxxTest::TestSuite
+{
+    public:
+
+        void test_publish()
+        {
+            ChampionBoard board(10);
+            int natoms = -1;
+            double cost = -1.0;
+            TS_ASSERT(!board.best(natoms, cost));
+            TS_ASSERT_EQUALS(0ul, board.epoch());
+            TS_ASSERT(board.publish(5, 0.5));
+            TS_ASSERT(!board.publish(5, 0.75));
+            TS_ASSERT(board.publish(5, 0.25));
+            TS_ASSERT(board.publish(3, 0.125));
+            TS_ASSERT(board.best(natoms, cost));
+            TS_ASSERT_EQUALS(5, natoms);
+            TS_ASSERT_EQUALS(0.25, cost);
+            TS_ASSERT(board.publish(6, 0.0));
+            TS_ASSERT(!board.publish(6, -0.0));
+            TS_ASSERT(board.best(natoms, cost));
+            TS_ASSERT_EQUALS(6, natoms);
+            TS_ASSERT_EQUALS(0.0, cost);
+            TS_ASSERT_EQUALS(4ul, board.epoch());
+            // invalid entries are ignored
+            TS_ASSERT(!board.publish(11, 0.0));
+            TS_ASSERT(!board.publish(-1, 0.0));
+            TS_ASSERT(!board.publish(8, -1.0));
+            TS_ASSERT_EQUALS(4ul, board.epoch());
+        }
+
+
+        void test_forked()
+        {
+            ChampionBoard board(4);
+            pid_t pid = fork();
+            TS_ASSERT(pid >= 0);
+            if (pid == 0)
+            {
+                board.publish(4, 0.5);
+                _exit(EXIT_SUCCESS);
+            }
+            int status;
+            TS_ASSERT_EQUALS(pid, waitpid(pid, &status, 0));
+            int natoms;
+            double cost;
+            TS_ASSERT(board.best(natoms, cost));
+            TS_ASSERT_EQUALS(4, natoms);
+            TS_ASSERT_EQUALS(0.5, cost);
+            TS_ASSERT_EQUALS(1ul, board.epoch());
+        }
+};  // class TestChampionBoard
+
+// End of file
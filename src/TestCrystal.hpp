@@ -12,7 +12,9 @@
 #include "Crystal.hpp"
 #include "LigaUtils.hpp"
 #include "AtomCost.hpp"
+#include "SymmetryOperation.hpp"
 #include "tests_dir.hpp"
+#include "WorkerPool.hpp"
 
 using namespace std;
 
@@ -122,6 +124,35 @@ class TestCrystal : public CxxTest::TestSuite
         }
 
 
+        void test_fcc_Pop_list()
+        {
+            crst.setLattice(*cubic);
+            crst.setDistanceTable(dst_fcc);
+            crst.AddAt("C", 0.0, 0.0, 0.0);
+            crst.AddAt("C", 0.5, 0.5, 0.1);
+            crst.AddAt("C", 0.5, 0.1, 0.5);
+            crst.AddAt("C", 0.0, 0.5, 0.5);
+            Crystal crst1 = crst;
+            list<int> ipop;
+            ipop.push_back(1);
+            ipop.push_back(2);
+            crst.Pop(ipop);
+            crst1.Pop(2);
+            crst1.Pop(1);
+            TS_ASSERT_EQUALS(2, crst.countAtoms());
+            TS_ASSERT_DELTA(crst1.cost(), crst.cost(), double_eps);
+            TS_ASSERT_EQUALS(crst1.countPairs(), crst.countPairs());
+            double cost0 = crst.cost();
+            int pcnt0 = crst.countPairs();
+            crst.recalculate();
+            TS_ASSERT_DELTA(cost0, crst.cost(), double_eps);
+            TS_ASSERT_EQUALS(pcnt0, crst.countPairs());
+            crst.AddAt("C", 0.5, 0.5, 0.0);
+            crst.AddAt("C", 0.5, 0.0, 0.5);
+            TS_ASSERT_DELTA(0.0, crst.cost(), double_eps);
+        }
+
+
         void test_fcc_rhomb()
         {
             crst.setLattice(*rhombohedral);
@@ -137,6 +168,66 @@ class TestCrystal : public CxxTest::TestSuite
         }
 
 
+        void test_orthorhombic_rotated()
+        {
+            // orthogonal cell and its rotation about z by 90 degrees
+            // must give the same cost and pair count
+            Lattice ortho(1.0, 1.3, 1.7, 90, 90, 90);
+            R3::Vector va(0.0, 1.0, 0.0);
+            R3::Vector vb(-1.3, 0.0, 0.0);
+            R3::Vector vc(0.0, 0.0, 1.7);
+            Lattice rotated(va, vb, vc);
+            double xyz[3][3] = {
+                {0.0, 0.0, 0.0}, {0.1, 0.2, 0.3}, {0.6, 0.45, 0.8} };
+            Crystal crst1 = crst;
+            crst.setLattice(ortho);
+            crst.setDistanceTable(dst_cube);
+            crst1.setLattice(rotated);
+            crst1.setDistanceTable(dst_cube);
+            for (int i = 0; i != 3; ++i)
+            {
+                crst.AddAt("C", ortho.cartesian(xyz[i]));
+                crst1.AddAt("C", rotated.cartesian(xyz[i]));
+            }
+            TS_ASSERT(crst.cost() > 0.0);
+            TS_ASSERT_DELTA(crst.cost(), crst1.cost(), 1e-8);
+            TS_ASSERT_EQUALS(crst.countPairs(), crst1.countPairs());
+        }
+
+
+        void test_evalBatch()
+        {
+            vector<Atom_t> vta;
+            vta.push_back(Atom_t("C", 0.5, 0.5, 0.5));
+            vta.push_back(Atom_t("C", 0.3, -0.7, 2.2));
+            vta.push_back(Atom_t("C", 0.9, 0.05, 0.45));
+            vta.push_back(Atom_t("C", 0.0, 0.0, 0.0));
+            Lattice* lattices[2] = {cubic.get(), rhombohedral.get()};
+            for (int i = 0; i != 2; ++i)
+            {
+                crst.Clear();
+                crst.setLattice(*lattices[i]);
+                crst.setDistanceTable(dst_fcc);
+                crst.AddAt("C", 0.0, 0.0, 0.0);
+                crst.AddAt("C", 0.1, 0.2, 0.3);
+                AtomCost* atomcost = crst.getAtomCostCalculator();
+                vector<double> costs;
+                for (size_t j = 0; j != vta.size(); ++j)
+                {
+                    costs.push_back(atomcost->eval(vta[j]));
+                }
+                atomcost = crst.getAtomCostCalculator();
+                const vector<double>& bcosts = atomcost->evalBatch(vta);
+                TS_ASSERT_EQUALS(vta.size(), bcosts.size());
+                for (size_t j = 0; j != vta.size(); ++j)
+                {
+                    TS_ASSERT_DELTA(costs[j], bcosts[j], 1e-8);
+                }
+                TS_ASSERT(bcosts[1] > 0.0);
+            }
+        }
+
+
         R3::Vector analytical_gradient(const Atom_t& a0, AtomCost* atomcost)
         {
             atomcost->eval(a0, AtomCost::GRADIENT);
@@ -317,6 +408,192 @@ class TestCrystal : public CxxTest::TestSuite
         }
 
 
+        void test_recalculate()
+        {
+            crst.setLattice(*cubic);
+            crst.setDistanceTable(dst_fcc);
+            crst.AddAt("C", 0.0, 0.0, 0.0);
+            crst.AddAt("C", 0.5, 0.5, 0.1);
+            crst.AddAt("C", 0.5, 0.0, 0.5);
+            crst.AddAt("C", 0.1, 0.5, 0.5);
+            double totalcost = crst.Badness();
+            double acost[4];
+            for (int i = 0; i != 4; ++i)  acost[i] = crst.getAtom(i).Badness();
+            TS_ASSERT(totalcost > 0.0);
+            // nothing changed, pair rows are reused
+            crst.recalculate();
+            TS_ASSERT_DELTA(totalcost, crst.Badness(), double_eps);
+            // full rebuild after lattice change
+            crst.setLattice(*rhombohedral);
+            crst.setLattice(*cubic);
+            TS_ASSERT_DELTA(totalcost / crst.countPairs(), crst.cost(),
+                    double_eps);
+            for (int i = 0; i != 4; ++i)
+            {
+                TS_ASSERT_DELTA(acost[i], crst.getAtom(i).Badness(), double_eps);
+            }
+        }
+
+
+        void test_cacheCost()
+        {
+            crst.setLattice(*cubic);
+            crst.setDistanceTable(dst_fcc);
+            crst.AddAt("C", 0.0, 0.0, 0.0);
+            crst.AddAt("C", 0.5, 0.5, 0.1);
+            crst.AddAt("C", 0.5, 0.0, 0.5);
+            crst.AddAt("C", 0.1, 0.5, 0.5);
+            double totalcost = crst.cost();
+            double acost[4];
+            for (int i = 0; i != 4; ++i)  acost[i] = crst.getAtom(i).Badness();
+            // pair rows evaluated by workers give the same costs
+            WorkerPool workers(3);
+            crst.setLattice(*rhombohedral);
+            crst.setLattice(*cubic);
+            crst.cacheCost(workers);
+            TS_ASSERT_EQUALS(totalcost, crst.cost());
+            for (int i = 0; i != 4; ++i)
+            {
+                TS_ASSERT_EQUALS(acost[i], crst.getAtom(i).Badness());
+            }
+        }
+
+
+        void test_getFlipSitesOverlapDelta()
+        {
+            crst.setLattice(*cubic);
+            crst.setDistanceTable(dst_bcc);
+            crst.setChemicalFormula("A2B2");
+            crst.setAtomRadiiTable("A:0.2, B:0.45");
+            crst.AddAt("A", 0.0, 0.0, 0.0);
+            crst.AddAt("B", 0.5, 0.5, 0.0);
+            crst.AddAt("B", 0.5, 0.0, 0.3);
+            crst.AddAt("A", 0.0, 0.5, 0.5);
+            for (int i = 0; i != 4; ++i)
+            {
+                for (int j = i + 1; j != 4; ++j)
+                {
+                    double overlap0 = crst.Overlap();
+                    double delta = crst.getFlipSitesOverlapDelta(i, j);
+                    crst.FlipSites(i, j);
+                    TS_ASSERT_DELTA(overlap0 + delta, crst.Overlap(), 1e-12);
+                    crst.FlipSites(i, j);
+                }
+            }
+        }
+
+
+        void test_fingerprint()
+        {
+            crst.setLattice(*cubic);
+            crst.setDistanceTable(dst_bcc);
+            crst.AddAt("C", 0.0, 0.0, 0.0);
+            crst.AddAt("C", 0.5, 0.5, 0.5);
+            Crystal crst1 = crst;
+            crst1.Clear();
+            crst1.AddAt("C", 0.7, 0.8, 0.9);
+            crst1.AddAt("C", 0.2, 0.3, 0.4);
+            TS_ASSERT_EQUALS(crst.fingerprint(), crst1.fingerprint());
+            crst1.Pop(1);
+            crst1.AddAt("C", 0.2, 0.3, 0.5);
+            TS_ASSERT_DIFFERS(crst.fingerprint(), crst1.fingerprint());
+        }
+
+
+
+        void test_symmetry_fcc()
+        {
+            const char* xyz[] = { "x,y,z", "x+1/2,y+1/2,z",
+                "x+1/2,y,z+1/2", "x,y+1/2,z+1/2" };
+            vector<SymmetryOperation> ops;
+            for (int i = 0; i != 4; ++i)
+            {
+                ops.push_back(SymmetryOperation::fromXYZ(xyz[i]));
+            }
+            Crystal crst1 = crst;
+            crst1.setChemicalFormula("C8");
+            crst1.setLattice(*cubic);
+            crst1.setDistanceTable(dst_fcc);
+            crst.setLattice(*cubic);
+            crst.setDistanceTable(dst_fcc);
+            crst.setSymmetry(ops);
+            TS_ASSERT(crst.hasSymmetry());
+            crst.AddAt("C", 0.0, 0.0, 0.0);
+            TS_ASSERT_DELTA(0.0, crst.cost(), double_eps);
+            // asymmetric unit of 2 sites against the full cell
+            crst.AddAt("C", 0.5, 0.5, 0.5);
+            R3::Vector rc[2] = {
+                R3::Vector(0.0, 0.0, 0.0), R3::Vector(0.5, 0.5, 0.5) };
+            for (int i = 0; i != 2; ++i)
+            {
+                for (size_t k = 0; k != ops.size(); ++k)
+                {
+                    crst1.AddAt("C", ops[k](rc[i]));
+                }
+            }
+            TS_ASSERT(crst.cost() > 0.0);
+            TS_ASSERT_EQUALS(crst1.countPairs(), crst.countPairs());
+            TS_ASSERT_DELTA(crst1.cost(), crst.cost(), 1e-8);
+            // centering images of any site are distinct
+            vector<R3::Vector> images;
+            crst.siteImages(R3::Vector(0.5, 0.5, 0.5), images);
+            TS_ASSERT_EQUALS(4u, images.size());
+            ops.push_back(SymmetryOperation::fromXYZ("-x,-y,-z"));
+            TS_ASSERT_THROWS(crst.setSymmetry(ops), invalid_argument);
+        }
+
+
+        void test_symmetry_general()
+        {
+            vector<SymmetryOperation> ops;
+            ops.push_back(SymmetryOperation::fromXYZ("x,y,z"));
+            ops.push_back(SymmetryOperation::fromXYZ("-x,-y,-z"));
+            crst.setLattice(*rhombohedral);
+            crst.setDistanceTable(dst_fcc);
+            Crystal crst1 = crst;
+            crst.setSymmetry(ops);
+            const Lattice& L = crst.getLattice();
+            R3::Vector xyz[2] = {
+                R3::Vector(0.1, 0.2, 0.3), R3::Vector(0.35, 0.1, 0.7) };
+            for (int i = 0; i != 2; ++i)
+            {
+                crst.AddAt("C", L.cartesian(xyz[i]));
+                crst1.AddAt("C", L.cartesian(ops[0](xyz[i])));
+                crst1.AddAt("C", L.cartesian(ops[1](xyz[i])));
+            }
+            TS_ASSERT_EQUALS(crst1.countPairs(), crst.countPairs());
+            TS_ASSERT_DELTA(crst1.cost(), crst.cost(), 1e-8);
+            // incremental cost agrees with recalculation
+            double cost0 = crst.cost();
+            crst.setLattice(crst.getLattice());
+            TS_ASSERT_DELTA(cost0, crst.cost(), 1e-8);
+            crst.Pop(1);
+            crst1.Pop(3);
+            crst1.Pop(2);
+            TS_ASSERT_EQUALS(crst1.countPairs(), crst.countPairs());
+            TS_ASSERT_DELTA(crst1.cost(), crst.cost(), 1e-8);
+            // batch evaluation and gradient of the image terms
+            vector<Atom_t> vta;
+            vta.push_back(Atom_t("C", 0.3, -0.7, 2.2));
+            vta.push_back(Atom_t("C", 0.9, 0.05, 0.45));
+            AtomCost* atomcost = crst.getAtomCostCalculator();
+            vector<double> costs;
+            for (size_t j = 0; j != vta.size(); ++j)
+            {
+                costs.push_back(atomcost->eval(vta[j]));
+            }
+            const vector<double>& bcosts = atomcost->evalBatch(vta);
+            for (size_t j = 0; j != vta.size(); ++j)
+            {
+                TS_ASSERT_DELTA(costs[j], bcosts[j], 1e-8);
+            }
+            R3::Vector ga, gn;
+            ga = analytical_gradient(vta[1], atomcost);
+            gn = numerical_gradient(vta[1], atomcost);
+            double gdiff = R3::distance(gn, ga) / R3::norm(ga);
+            TS_ASSERT_DELTA(0.0, gdiff, gradient_eps);
+        }
+
 };  // class TestCrystal
 
 // End of file
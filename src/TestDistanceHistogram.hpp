@@ -0,0 +1,67 @@
+/***********************************************************************
+* Short Title: unit tests for DistanceHistogram class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cxxtest/TestSuite.h>
+
+#include "DistanceHistogram.hpp"
+
+using namespace std;
+
+class TestDistanceHistogram : public CxxTest::TestSuite
+{
+    private:
+
+        DistanceTable dtbl;
+
+    public:
+
+        void setUp()
+        {
+            double dst_data[6] = { 1.0, 1.02, 1.04, 1.5, 2.0, 2.0 };
+            dtbl = DistanceTable(dst_data, 6);
+            dtbl.setResolution(0.1);
+        }
+
+
+        void test_bins()
+        {
+            DistanceHistogram hist(dtbl);
+            TS_ASSERT_EQUALS(3u, hist.size());
+            TS_ASSERT_EQUALS(0.1, hist.binWidth());
+            TS_ASSERT_EQUALS(3, hist.binCount(0));
+            TS_ASSERT_EQUALS(1, hist.binCount(1));
+            TS_ASSERT_EQUALS(2, hist.binCount(2));
+            TS_ASSERT_DELTA(1.02, hist.binDistance(0), 1e-12);
+            TS_ASSERT_EQUALS(1.5, hist.binDistance(1));
+            TS_ASSERT_EQUALS(4u, hist.binStart(2));
+            TS_ASSERT_EQUALS(0u, hist.binAt(2));
+            TS_ASSERT_EQUALS(2u, hist.binAt(5));
+        }
+
+
+        void test_binnedTable()
+        {
+            vector<double> esds(6, 0.1);
+            esds[0] = 0.4;
+            dtbl.setESDs(esds);
+            DistanceTable dbinned = DistanceHistogram(dtbl).binnedTable();
+            TS_ASSERT_EQUALS(6u, dbinned.size());
+            TS_ASSERT_EQUALS(dbinned[0], dbinned[2]);
+            TS_ASSERT_EQUALS(1.5, dbinned[3]);
+            TS_ASSERT_DELTA(0.2, dbinned.getesdAt(1), 1e-12);
+            TS_ASSERT_DELTA(0.1, dbinned.getesdAt(5), 1e-12);
+            // zero resolution bins only equal distances
+            dtbl.setResolution(0.0);
+            DistanceHistogram hist0(dtbl);
+            TS_ASSERT_EQUALS(5u, hist0.size());
+            TS_ASSERT_EQUALS(2, hist0.binCount(4));
+        }
+
+};  // class TestDistanceHistogram
+
+// End of file
@@ -0,0 +1,143 @@
+/***********************************************************************
+* Short Title: unit tests for DistanceKernels functions
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <cxxtest/TestSuite.h>
+
+#include "DistanceKernels.hpp"
+#include "Random.hpp"
+
+using namespace std;
+
+class TestDistanceKernels : public CxxTest::TestSuite
+{
+    private:
+
+        // odd count exercises the remainder of vectorized loops
+        static const int npts = 37;
+        vector<double> rx, ry, rz;
+        vector<float> fx, fy, fz;
+
+    public:
+
+        void setUp()
+        {
+            rx.resize(npts);  ry.resize(npts);  rz.resize(npts);
+            fx.resize(npts);  fy.resize(npts);  fz.resize(npts);
+            for (int j = 0; j != npts; ++j)
+            {
+                rx[j] = 10 * randomFloat() - 5;
+                ry[j] = 10 * randomFloat() - 5;
+                rz[j] = 10 * randomFloat() - 5;
+                fx[j] = rx[j];  fy[j] = ry[j];  fz[j] = rz[j];
+            }
+        }
+
+
+        void tearDown()
+        {
+            DistanceKernels::setISA("auto");
+        }
+
+
+        void test_variants()
+        {
+            using namespace DistanceKernels;
+            const double x = 0.3, y = -1.7, z = 2.9;
+            vector<double> d0(npts), f0(npts), dd0(npts);
+            setISA("generic");
+            TS_ASSERT_EQUALS("generic", getISA());
+            distances(&d0[0], &rx[0], &ry[0], &rz[0], npts, x, y, z);
+            distancesFloat(&f0[0], &fx[0], &fy[0], &fz[0], npts, x, y, z);
+            squaredDistances(&dd0[0], &rx[0], &ry[0], &rz[0], npts, x, y, z);
+            TS_ASSERT_DELTA(sqrt(dd0[5]), d0[5], 1e-12);
+            TS_ASSERT_DELTA(d0[5], f0[5], 1e-5);
+            vector<string> isas = getSupportedISAs();
+            TS_ASSERT_EQUALS("generic", isas.front());
+            vector<string>::iterator isa;
+            for (isa = isas.begin(); isa != isas.end(); ++isa)
+            {
+                vector<double> d1(npts), f1(npts), dd1(npts);
+                setISA(*isa);
+                TS_ASSERT_EQUALS(*isa, getISA());
+                distances(&d1[0], &rx[0], &ry[0], &rz[0], npts, x, y, z);
+                distancesFloat(&f1[0], &fx[0], &fy[0], &fz[0],
+                        npts, x, y, z);
+                squaredDistances(&dd1[0], &rx[0], &ry[0], &rz[0],
+                        npts, x, y, z);
+                TS_ASSERT(d0 == d1);
+                TS_ASSERT(f0 == f1);
+                TS_ASSERT(dd0 == dd1);
+            }
+            setISA("auto");
+            TS_ASSERT_EQUALS(isas.back(), getISA());
+        }
+
+
+        void test_float_variants()
+        {
+            using namespace DistanceKernels;
+            // long arrays exercise the vector loops of every variant
+            const int nlong = 1000 + npts;
+            vector<double> rxl, ryl, rzl;
+            vector<float> fxl, fyl, fzl;
+            for (int k = 0; k != nlong / npts + 1; ++k)
+            {
+                for (int j = 0; j != npts; ++j)
+                {
+                    double s = 1.0 + k / 10.0;
+                    rxl.push_back(s * rx[j]);
+                    ryl.push_back(s * ry[j]);
+                    rzl.push_back(s * rz[j]);
+                    fxl.push_back(rxl.back());
+                    fyl.push_back(ryl.back());
+                    fzl.push_back(rzl.back());
+                }
+            }
+            const float x = 0.3f, y = -1.7f, z = 2.9f;
+            vector<double> d0(nlong), f0(nlong);
+            setISA("generic");
+            distances(&d0[0], &rxl[0], &ryl[0], &rzl[0], nlong, x, y, z);
+            distancesFloat(&f0[0], &fxl[0], &fyl[0], &fzl[0],
+                    nlong, x, y, z);
+            for (int j = 0; j != nlong; ++j)
+            {
+                TS_ASSERT_DELTA(d0[j], f0[j], 1e-6 * d0[j]);
+            }
+            vector<string> isas = getSupportedISAs();
+            vector<string>::iterator isa;
+            for (isa = isas.begin(); isa != isas.end(); ++isa)
+            {
+                vector<double> f1(nlong);
+                setISA(*isa);
+                distancesFloat(&f1[0], &fxl[0], &fyl[0], &fzl[0],
+                        nlong, x, y, z);
+                TS_ASSERT(f0 == f1);
+                // the remainder after the vector loop
+                vector<double> f2(nlong - 3);
+                distancesFloat(&f2[0], &fxl[3], &fyl[3], &fzl[3],
+                        nlong - 3, x, y, z);
+                TS_ASSERT(equal(f2.begin(), f2.end(), f0.begin() + 3));
+            }
+        }
+
+
+        void test_setISA_errors()
+        {
+            TS_ASSERT_THROWS(DistanceKernels::setISA("mmx"),
+                    invalid_argument);
+            TS_ASSERT_THROWS(DistanceKernels::setISA(""), invalid_argument);
+            TS_ASSERT(DistanceKernels::getSupportedISAs().size() <=
+                    DistanceKernels::getCompiledISAs().size());
+        }
+
+};  // class TestDistanceKernels
+
+// End of file
@@ -0,0 +1,61 @@
+/***********************************************************************
+* Short Title: unit tests for Division_t
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cxxtest/TestSuite.h>
+
+#include "Division_t.hpp"
+#include "Molecule.hpp"
+#include "LigaUtils.hpp"
+
+using namespace std;
+
+class TestDivision_t : public CxxTest::TestSuite
+{
+    private:
+
+        // line molecule with atoms at the specified distance
+        Molecule* newLine(double d)
+        {
+            Molecule* mol = new Molecule;
+            mol->setDistanceTable(vector<double>(1, 1.0));
+            mol->AddAt("", 0.0, 0.0, 0.0);
+            mol->AddAt("", d, 0.0, 0.0);
+            return mol;
+        }
+
+    public:
+
+        void test_worstCost()
+        {
+            Division_t dv(4, 2);
+            TS_ASSERT_EQUALS(DOUBLE_MAX, dv.worstCost());
+            dv.push_back(newLine(1.0));
+            TS_ASSERT_EQUALS(0.0, dv.worstCost());
+            dv.push_back(newLine(1.2));
+            dv.push_back(newLine(1.1));
+            double c12 = dv[1]->cost();
+            TS_ASSERT(c12 > dv[2]->cost());
+            TS_ASSERT_EQUALS(c12, dv.worstCost());
+            // cached costs follow noted modified teams
+            dv[1]->Pop(1);
+            dv[1]->AddAt("", 1.0, 0.0, 0.0);
+            dv.noteTeamChanged(1);
+            TS_ASSERT_EQUALS(dv[2]->cost(), dv.worstCost());
+            TS_ASSERT_DELTA(dv[2]->cost() / 3, dv.averageCost(), 1e-12);
+            // the modified team is never selected as a looser
+            for (int i = 0; i != 100; ++i)
+            {
+                TS_ASSERT_EQUALS(2, dv.find_looser());
+            }
+            delete dv[1];
+            dv.erase(dv.begin() + 1);
+            TS_ASSERT_EQUALS(dv[1]->cost(), dv.worstCost());
+        }
+};  // class TestDivision_t
+
+// End of file
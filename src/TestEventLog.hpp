@@ -0,0 +1,108 @@
+/***********************************************************************
+* Short Title: unit tests for EventLog
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdlib>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "EventLog.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+class TestEventLog : public CxxTest::TestSuite
+{
+    private:
+
+        string filename;
+
+        void recordSeasons()
+        {
+            EventLog log(filename, EventLog::RECORD);
+            for (int season = 1; season <= 3; ++season)
+            {
+                log.note(EventLog::SEASON, 0, season);
+                log.note(EventLog::WINNER, 2, season);
+                log.note(EventLog::EVOLVE, 3, 4, 0.25 * season);
+                log.note(EventLog::LOOSER, 3, 1);
+            }
+            log.flush();
+            TS_ASSERT_EQUALS(12u, log.countEvents());
+        }
+
+    public:
+
+        void setUp()
+        {
+            char tmpname[] = "/tmp/TestEventLog-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            filename = tmpname;
+        }
+
+
+        void tearDown()
+        {
+            unlink(filename.c_str());
+        }
+
+
+        void test_replay()
+        {
+            recordSeasons();
+            EventLog log(filename, EventLog::REPLAY);
+            TS_ASSERT_EQUALS(EventLog::REPLAY, log.mode());
+            for (int season = 1; season <= 3; ++season)
+            {
+                TS_ASSERT(!log.exhausted());
+                log.note(EventLog::SEASON, 0, season);
+                log.note(EventLog::WINNER, 2, season);
+                log.note(EventLog::EVOLVE, 3, 4, 0.25 * season);
+                log.note(EventLog::LOOSER, 3, 1);
+            }
+            TS_ASSERT(log.exhausted());
+            // events after the end of log are not compared
+            log.note(EventLog::WINNER, 7, 7);
+        }
+
+
+        void test_replay_difference()
+        {
+            recordSeasons();
+            EventLog log(filename, EventLog::REPLAY);
+            log.note(EventLog::SEASON, 0, 1);
+            log.note(EventLog::WINNER, 2, 1);
+            TS_ASSERT_THROWS(log.note(EventLog::EVOLVE, 3, 4, 0.2),
+                    ReplayError);
+        }
+
+
+        void test_seekSeason()
+        {
+            recordSeasons();
+            EventLog log(filename, EventLog::REPLAY);
+            log.seekSeason(2);
+            log.note(EventLog::SEASON, 0, 3);
+            log.note(EventLog::WINNER, 2, 3);
+            TS_ASSERT_THROWS(log.note(EventLog::LOOSER, 3, 1), ReplayError);
+            EventLog log1(filename, EventLog::REPLAY);
+            TS_ASSERT_THROWS(log1.seekSeason(3), IOError);
+        }
+
+
+        void test_invalid_file()
+        {
+            TS_ASSERT_THROWS(EventLog(filename, EventLog::REPLAY), IOError);
+            TS_ASSERT_THROWS(
+                    EventLog("/nonexistent/dir/events", EventLog::RECORD),
+                    IOError);
+        }
+};  // class TestEventLog
+
+// End of file
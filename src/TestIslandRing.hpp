@@ -0,0 +1,195 @@
+/***********************************************************************
+* Short Title: unit tests for IslandRing and migrant messages
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "IslandRing.hpp"
+#include "Liga_t.hpp"
+#include "Molecule.hpp"
+#include "RunPar_t.hpp"
+#include "tests_dir.hpp"
+
+using namespace std;
+
+class TestIslandRing : public CxxTest::TestSuite
+{
+    private:
+
+        Molecule square;
+
+        // wait for a message of the preceding island
+        bool waitMessage(IslandRing& ring, string& msg)
+        {
+            for (int i = 0; i != 5000; ++i)
+            {
+                if (ring.receive(msg))  return true;
+                usleep(1000);
+            }
+            return false;
+        }
+
+
+        // play seasons of a C60 liga with telemetry written to filename
+        void playC60(int seasons, const string& filename, bool ismain)
+        {
+            string distfile = prepend_tests_dir("solids/bucky.dst");
+            string telemetry = "telemetry=" + filename;
+            const char* argv[] = { "TestIslandRing", distfile.c_str(),
+                "crystal=false", "formula=C60", "seasontrials=4096",
+                "verbose=", telemetry.c_str(), NULL };
+            int argc = sizeof(argv) / sizeof(char*) - 1;
+            ostringstream out;
+            streambuf* coutbuf = cout.rdbuf(out.rdbuf());
+            RunPar_t rp;
+            rp.processArguments(argc, const_cast<char**>(argv));
+            if (!ismain)    rp.clearIslandOutputs();
+            {
+                Liga_t liga(&rp);
+                liga.prepare();
+                for (int i = 0; i < seasons && !liga.finished(); ++i)
+                {
+                    liga.playSeason();
+                }
+            }
+            cout.rdbuf(coutbuf);
+        }
+
+    public:
+
+        void setUp()
+        {
+            double square_data[6] =
+                { 1.0, 1.0, 1.0, 1.0, sqrt(2.0), sqrt(2.0) };
+            square = Molecule();
+            square.setDistanceTable(
+                    vector<double>(square_data, square_data + 6));
+        }
+
+
+        void test_single_island()
+        {
+            IslandRing ring(1);
+            TS_ASSERT(ring.isMain());
+            string msg;
+            TS_ASSERT(!ring.receive(msg));
+            ring.send("hello");
+            TS_ASSERT(ring.receive(msg));
+            TS_ASSERT_EQUALS("hello", msg);
+        }
+
+
+        void test_exchange_migrant()
+        {
+            square.AddAt("", 0.0, 0.0, 0.0);
+            square.AddAt("", 1.0, 0.0, 0.0);
+            square.AddAt("", 1.0, 1.0, 0.0);
+            square.Fix(0);
+            IslandRing ring(2);
+            if (!ring.isMain())
+            {
+                ring.send(Liga_t::migrantMessage(square, true));
+                _exit(EXIT_SUCCESS);
+            }
+            TS_ASSERT_EQUALS(2, ring.size());
+            string msg;
+            TS_ASSERT(waitMessage(ring, msg));
+            // the migrant joins the fixed atoms of the receiving island
+            Molecule migrant;
+            migrant.setDistanceTable(square.getDistanceTable());
+            migrant.AddAt("", 0.0, 0.0, 0.0);
+            migrant.Fix(0);
+            TS_ASSERT(Liga_t::readMigrant(msg, migrant));
+            TS_ASSERT_EQUALS(3, migrant.countAtoms());
+            TS_ASSERT_EQUALS(1, migrant.NFixed());
+            for (int i = 0; i != 3; ++i)
+            {
+                const R3::Vector& r0 = square.getAtom(i).r;
+                const R3::Vector& r1 = migrant.getAtom(i).r;
+                TS_ASSERT_EQUALS(0.0, R3::distance(r0, r1));
+            }
+            TS_ASSERT_EQUALS(square.cost(), migrant.cost());
+        }
+
+
+        void test_island_telemetry()
+        {
+            char tmpname[] = "/tmp/TestIslandRing-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            IslandRing ring(2);
+            string msg;
+            // the second island plays after the main island is done
+            if (!ring.isMain())
+            {
+                try {
+                    if (waitMessage(ring, msg)) playC60(5, tmpname, false);
+                }
+                catch (...) {
+                    _exit(EXIT_FAILURE);
+                }
+                ring.send("done");
+                _exit(EXIT_SUCCESS);
+            }
+            playC60(3, tmpname, true);
+            ring.send("go");
+            TS_ASSERT(waitMessage(ring, msg));
+            TS_ASSERT_EQUALS("done", msg);
+            ifstream fid(tmpname);
+            string line;
+            int nrecords = 0;
+            while (getline(fid, line))
+            {
+                ++nrecords;
+                ostringstream season;
+                season << "{\"season\": " << nrecords << ',';
+                TS_ASSERT_EQUALS(0u, line.find(season.str()));
+            }
+            TS_ASSERT_EQUALS(3, nrecords);
+            unlink(tmpname);
+        }
+
+
+        void test_readMigrant()
+        {
+            Molecule mol = square;
+            TS_ASSERT(!Liga_t::readMigrant("0 2 : 0 0 0 : 1 0 0", mol));
+            TS_ASSERT_EQUALS(2, mol.countAtoms());
+            const char* invalid[] = {
+                "",
+                "1",
+                "x 1 : 0 0 0",
+                "2 1 : 0 0 0",
+                "0 -1",
+                "0 3 : 0 0 0",
+                "0 1 C 0 0 0",
+                "0 1 : 0 0",
+                "0 1 : 0 0 nan",
+                "0 1 : 0 0 0 : 1 0 0",
+                "0 1 :C 0 0 0",
+                "0 5 : 0 0 0 : 1 0 0 : 1 1 0 : 0 1 0 : 2 2 2",
+            };
+            int ninvalid = sizeof(invalid) / sizeof(char*);
+            for (int i = 0; i != ninvalid; ++i)
+            {
+                mol = square;
+                mol.AddAt("", 0.0, 0.0, 0.0);
+                TS_ASSERT_THROWS(Liga_t::readMigrant(invalid[i], mol),
+                        runtime_error);
+            }
+        }
+};  // class TestIslandRing
+
+// End of file
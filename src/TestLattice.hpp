@@ -199,6 +199,28 @@ class TestLattice : public CxxTest::TestSuite
                         lattice->nearZeroCartesian(uca), precision));
         }
 
+
+        void test_batchConversion()
+        {
+            lattice->setLatPar(13, 17, 19, 37, 41, 47);
+            double xyz[6] = {0.1, 0.2, 0.3, -1.5, 2.0, 7.25};
+            double cxyz[6];
+            lattice->cartesian(xyz, cxyz, 2);
+            for (int i = 0; i != 2; ++i)
+            {
+                R3::Vector lv(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]);
+                R3::Vector cv(cxyz[3 * i], cxyz[3 * i + 1], cxyz[3 * i + 2]);
+                TS_ASSERT(VectorsAlmostEqual(lattice->cartesian(lv), cv,
+                            precision));
+            }
+            // in-place conversion back to fractional coordinates
+            lattice->fractional(cxyz, cxyz, 2);
+            for (int i = 0; i != 6; ++i)
+            {
+                TS_ASSERT_DELTA(xyz[i], cxyz[i], precision);
+            }
+        }
+
 };  // class TestLattice
 
 // End of file
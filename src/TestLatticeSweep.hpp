@@ -0,0 +1,87 @@
+/***********************************************************************
+* Short Title: unit tests for LatticeSweep class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "LatticeSweep.hpp"
+#include "Exceptions.hpp"
+#include "ParseArgs.hpp"
+
+using namespace std;
+
+class TestLatticeSweep : public CxxTest::TestSuite
+{
+    private:
+
+        string filename;
+
+        void writeLatticeFile(const char* content)
+        {
+            ofstream fid(filename.c_str());
+            fid << content;
+        }
+
+    public:
+
+        void setUp()
+        {
+            char tmpname[] = "/tmp/TestLatticeSweep-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            filename = tmpname;
+        }
+
+
+        void tearDown()
+        {
+            unlink(filename.c_str());
+        }
+
+
+        void test_readLatticeFile()
+        {
+            writeLatticeFile(
+                    "# a b c alpha beta gamma\n"
+                    "3.52, 3.52, 3.52, 90, 90, 90\n"
+                    "\n"
+                    "2.4:2.5:0.05 2.4 6.7:6.8:0.1 90 90 120  # grid\n");
+            vector< vector<double> > lattices =
+                LatticeSweep::readLatticeFile(filename);
+            TS_ASSERT_EQUALS(7u, lattices.size());
+            TS_ASSERT_EQUALS(6u, lattices[0].size());
+            TS_ASSERT_EQUALS(3.52, lattices[0][2]);
+            TS_ASSERT_EQUALS(2.4, lattices[1][0]);
+            TS_ASSERT_DELTA(6.8, lattices[2][2], 1e-12);
+            TS_ASSERT_DELTA(2.5, lattices[6][0], 1e-12);
+            TS_ASSERT_EQUALS(120.0, lattices[6][5]);
+        }
+
+
+        void test_readLatticeFile_errors()
+        {
+            writeLatticeFile("3.52 3.52 3.52 90 90\n");
+            TS_ASSERT_THROWS(LatticeSweep::readLatticeFile(filename),
+                    ParseArgsError);
+            writeLatticeFile("3.52 3.52 3.6:3.5:0.1 90 90 90\n");
+            TS_ASSERT_THROWS(LatticeSweep::readLatticeFile(filename),
+                    ParseArgsError);
+            writeLatticeFile("# no lattices\n");
+            TS_ASSERT_THROWS(LatticeSweep::readLatticeFile(filename),
+                    ParseArgsError);
+            TS_ASSERT_THROWS(
+                    LatticeSweep::readLatticeFile("/nonexistent/file.lat"),
+                    IOError);
+        }
+
+};  // class TestLatticeSweep
+
+// End of file
@@ -0,0 +1,76 @@
+/***********************************************************************
+* Short Title: unit tests for LatticeTranslations class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cxxtest/TestSuite.h>
+
+#include "LatticeTranslations.hpp"
+#include "PointsInSphere.hpp"
+#include "Lattice.hpp"
+
+using namespace std;
+
+class TestLatticeTranslations : public CxxTest::TestSuite
+{
+    private:
+
+        Lattice cubic;
+        Lattice hexagonal;
+        pair<double,double> rext;
+
+    public:
+
+        void setUp()
+        {
+            cubic = Lattice(3, 3, 3, 90, 90, 90);
+            hexagonal = Lattice(2, 2, 5, 90, 90, 120);
+            rext = make_pair(0.0, 10.0);
+        }
+
+
+        void test_get()
+        {
+            boost::shared_ptr<const LatticeTranslations> lt0, lt1, lt2;
+            lt0 = LatticeTranslations::get(cubic, rext);
+            lt1 = LatticeTranslations::get(Lattice(3, 3, 3, 90, 90, 90), rext);
+            TS_ASSERT_EQUALS(lt0.get(), lt1.get());
+            lt2 = LatticeTranslations::get(cubic, make_pair(0.0, 8.0));
+            TS_ASSERT_DIFFERS(lt0.get(), lt2.get());
+            TS_ASSERT(lt2->size() < lt0->size());
+            lt2 = LatticeTranslations::get(hexagonal, rext);
+            TS_ASSERT_DIFFERS(lt0.get(), lt2.get());
+            TS_ASSERT(lt2->matches(hexagonal, rext));
+            TS_ASSERT(!lt2->matches(cubic, rext));
+        }
+
+
+        void test_translations()
+        {
+            boost::shared_ptr<const LatticeTranslations> lt;
+            lt = LatticeTranslations::get(hexagonal, rext);
+            size_t cnt = 0;
+            PointsInSphere sph(rext.first, rext.second, hexagonal);
+            for (sph.rewind(); !sph.finished(); sph.next())  ++cnt;
+            TS_ASSERT_EQUALS(cnt, lt->size());
+            TS_ASSERT_EQUALS(3 * cnt, lt->mno().size());
+            TS_ASSERT_EQUALS(0.0, lt->tlen()[0]);
+            for (size_t i = 0; i != lt->size(); ++i)
+            {
+                const int* mno = &(lt->mno()[3 * i]);
+                R3::Vector hkl(mno[0], mno[1], mno[2]);
+                R3::Vector xyz = hexagonal.cartesian(hkl);
+                TS_ASSERT_DELTA(xyz[0], lt->tx()[i], 1e-12);
+                TS_ASSERT_DELTA(xyz[1], lt->ty()[i], 1e-12);
+                TS_ASSERT_DELTA(xyz[2], lt->tz()[i], 1e-12);
+                TS_ASSERT_DELTA(R3::norm(xyz), lt->tlen()[i], 1e-12);
+                if (i)  TS_ASSERT(lt->tlen()[i - 1] <= lt->tlen()[i]);
+            }
+        }
+
+};  // class TestLatticeTranslations
+
+// End of file
@@ -0,0 +1,157 @@
+/***********************************************************************
+* Short Title: unit tests for Liga_t seasons
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "Liga_t.hpp"
+#include "RunPar_t.hpp"
+#include "Molecule.hpp"
+#include "tests_dir.hpp"
+
+using namespace std;
+
+class TestLiga_t : public CxxTest::TestSuite
+{
+    private:
+
+        // play seasons of a liga and return its best champion
+        void playLiga(const vector<string>& args, int seasons,
+                int& natoms, double& cost)
+        {
+            vector<const char*> argv(1, "TestLiga_t");
+            for (size_t i = 0; i != args.size(); ++i)
+            {
+                argv.push_back(args[i].c_str());
+            }
+            int argc = argv.size();
+            argv.push_back(NULL);
+            // keep the parameter and season reports out of test output
+            ostringstream out;
+            streambuf* coutbuf = cout.rdbuf(out.rdbuf());
+            RunPar_t rp;
+            rp.processArguments(argc, const_cast<char**>(&argv[0]));
+            Liga_t liga(&rp);
+            liga.prepare();
+            for (int i = 0; i < seasons && !liga.finished(); ++i)
+            {
+                liga.playSeason();
+            }
+            cout.rdbuf(coutbuf);
+            Molecule::setTrialThreads(1);
+            const Molecule* champ = liga.bestChamp();
+            natoms = champ->countAtoms();
+            cost = champ->cost();
+        }
+
+
+        // play seasons of a C60 liga and return its best champion
+        void playC60(const string& nthreads, int seasons,
+                int& natoms, double& cost)
+        {
+            const char* args[] = { "crystal=false", "formula=C60",
+                "rngseed=7", "seasontrials=4096", "verbose=" };
+            vector<string> a(args, args + sizeof(args) / sizeof(char*));
+            a.insert(a.begin(), prepend_tests_dir("solids/bucky.dst"));
+            a.push_back(nthreads);
+            playLiga(a, seasons, natoms, cost);
+        }
+
+
+        // play seasons of a liga of 8 atoms in 2 fcc unit cells
+        void playFCC(const string& threads, int seasons,
+                int& natoms, double& cost)
+        {
+            const char* args[] = { "crystal=true", "formula=C8",
+                "latpar=1,1,2,90,90,90", "rmax=3.05", "rngseed=7",
+                "seasontrials=4096", "verbose=" };
+            vector<string> a(args, args + sizeof(args) / sizeof(char*));
+            a.insert(a.begin(), prepend_tests_dir("solids/fcc.dst"));
+            a.push_back(threads);
+            playLiga(a, seasons, natoms, cost);
+        }
+
+
+        // name of a new empty temporary file
+        string tempFile()
+        {
+            char tmpname[] = "/tmp/TestLiga_t-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            return tmpname;
+        }
+
+    public:
+
+        void test_nthreads_reproducible()
+        {
+            int natoms0, natoms1;
+            double cost0, cost1;
+            playC60("nthreads=2", 10, natoms0, cost0);
+            playC60("nthreads=2", 10, natoms1, cost1);
+            TS_ASSERT(natoms0 > 0);
+            TS_ASSERT_EQUALS(natoms0, natoms1);
+            TS_ASSERT_EQUALS(cost0, cost1);
+        }
+
+
+        void test_nthreads_crystal_reproducible()
+        {
+            int natoms0, natoms1, natoms2;
+            double cost0, cost1, cost2;
+            playFCC("nthreads=2", 10, natoms0, cost0);
+            playFCC("nthreads=2", 10, natoms1, cost1);
+            TS_ASSERT(natoms0 > 0);
+            TS_ASSERT_EQUALS(natoms0, natoms1);
+            TS_ASSERT_EQUALS(cost0, cost1);
+            // concurrent trial atoms do not depend on the thread count
+            playFCC("trialthreads=2", 10, natoms1, cost1);
+            playFCC("trialthreads=3", 10, natoms2, cost2);
+            TS_ASSERT(natoms1 > 0);
+            TS_ASSERT_EQUALS(natoms1, natoms2);
+            TS_ASSERT_EQUALS(cost1, cost2);
+        }
+
+
+        void test_replay_from_checkpoint()
+        {
+            const char* args[] = { "crystal=false", "formula=C60",
+                "rngseed=7", "seasontrials=4096", "checkpointrate=0",
+                "verbose=" };
+            vector<string> a(args, args + sizeof(args) / sizeof(char*));
+            a.insert(a.begin(), prepend_tests_dir("solids/bucky.dst"));
+            string ckfile = tempFile();
+            string logfile = tempFile();
+            int natoms0, natoms1;
+            double cost0, cost1;
+            // checkpoint of the recorded run after 4 seasons
+            vector<string> a0 = a;
+            a0.push_back("checkpoint=" + ckfile);
+            playLiga(a0, 4, natoms0, cost0);
+            vector<string> a1 = a;
+            a1.push_back("eventlog=" + logfile);
+            playLiga(a1, 8, natoms0, cost0);
+            // replay differences would throw ReplayError
+            vector<string> a2 = a;
+            a2.push_back("restart=" + ckfile);
+            a2.push_back("replay=" + logfile);
+            playLiga(a2, 4, natoms1, cost1);
+            TS_ASSERT(natoms0 > 0);
+            TS_ASSERT_EQUALS(natoms0, natoms1);
+            TS_ASSERT_EQUALS(cost0, cost1);
+            unlink(ckfile.c_str());
+            unlink(logfile.c_str());
+        }
+};  // class TestLiga_t
+
+// End of file
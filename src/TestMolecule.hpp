@@ -6,10 +6,19 @@
 * <license text>
 ***********************************************************************/
 
+#include <algorithm>
+#include <numeric>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
 #include <valarray>
 #include <cxxtest/TestSuite.h>
 
 #include "Molecule.hpp"
+#include "AtomFilter_t.hpp"
+#include "Exceptions.hpp"
+#include "Random.hpp"
 
 using namespace std;
 
@@ -139,6 +148,718 @@ class TestMolecule : public CxxTest::TestSuite
             TS_ASSERT_EQUALS(square.getAtom(2), *ap);
         }
 
+
+        void test_getPackedAtoms()
+        {
+            Molecule square;
+            square.setDistanceTable(dst_square);
+            square.setChemicalFormula("C2O2");
+            square.setAtomRadiiTable("C:0.5, O:0.6");
+            square.Clear();
+            square.AddAt("C", -0.5, -0.5, 0.0);
+            square.AddAt("O", +0.5, -0.5, 0.0);
+            square.AddAt("C", +0.5, +0.5, 0.0);
+            const Molecule::PackedAtoms& pk = square.getPackedAtoms();
+            TS_ASSERT_EQUALS(3u, pk.rx.size());
+            TS_ASSERT_EQUALS(+0.5, pk.rx[1]);
+            TS_ASSERT_EQUALS(-0.5, pk.ry[1]);
+            TS_ASSERT_EQUALS(0.6, pk.radius[1]);
+            TS_ASSERT_EQUALS(pk.element[0], pk.element[2]);
+            TS_ASSERT_EQUALS("O", Atom_t::elementSymbol(pk.element[1]));
+            square.Pop(0);
+            TS_ASSERT_EQUALS(2u, pk.rx.size());
+            TS_ASSERT_EQUALS(+0.5, pk.ry[1]);
+            square.FlipSites(0, 1);
+            TS_ASSERT_EQUALS("O", Atom_t::elementSymbol(pk.element[1]));
+            TS_ASSERT_EQUALS(0.6, pk.radius[1]);
+            square.Shift(R3::Vector(1.0, 0.0, 0.0));
+            TS_ASSERT_EQUALS(1.5, pk.rx[0]);
+            Molecule square1 = square;
+            const Molecule::PackedAtoms& pk1 = square1.getPackedAtoms();
+            TS_ASSERT(pk.rx == pk1.rx);
+            TS_ASSERT(pk.element == pk1.element);
+            square.CheckIntegrity();
+            square1.CheckIntegrity();
+        }
+
+
+        void test_distance_usage()
+        {
+            Molecule square;
+            square.setDistanceTable(dst_square);
+            square.AddAt("", -0.5, -0.5, 0.0);
+            square.AddAt("", +0.5, -0.5, 0.0);
+            square.AddAt("", +0.5, +0.5, 0.0);
+            const UsageMask& usage = square.getDistanceUsage();
+            TS_ASSERT_EQUALS(6u, square.getDistanceTable().size());
+            TS_ASSERT_EQUALS(3u, usage.countUsed());
+            TS_ASSERT_EQUALS(2u, usage.nextFree(0));
+            Molecule square1 = square;
+            const Molecule& csquare = square;
+            const Molecule& csquare1 = square1;
+            TS_ASSERT_EQUALS(&csquare.getDistanceTable(),
+                    &csquare1.getDistanceTable());
+            square1.Pop(2);
+            TS_ASSERT_EQUALS(1u, square1.getDistanceUsage().countUsed());
+            TS_ASSERT_EQUALS(3u, usage.countUsed());
+            square1.AddAt("", -0.5, +0.5, 0.0);
+            square1.AddAt("", +0.5, +0.5, 0.0);
+            TS_ASSERT_EQUALS(6u, square1.getDistanceUsage().countUsed());
+            TS_ASSERT_DELTA(0.0, square1.cost(), double_eps);
+            square1.Clear();
+            TS_ASSERT_EQUALS(0u, square1.getDistanceUsage().countUsed());
+        }
+
+
+        void test_copy()
+        {
+            Molecule bad_square;
+            bad_square.setDistanceTable(dst_square);
+            bad_square.AddAt("", -0.5, -0.5, 0.0);
+            bad_square.AddAt("", +0.5, -0.5, 0.0);
+            bad_square.AddAt("", +0.5, +0.5, 0.0);
+            bad_square.AddAt("", +0.0, +0.0, 0.0);
+            double totalcost = bad_square.Badness();
+            Molecule square1 = bad_square;
+            TS_ASSERT_EQUALS(totalcost, square1.Badness());
+            square1.Pop(3);
+            square1.AddAt("", -0.5, +0.5, 0.0);
+            TS_ASSERT_DELTA(0.0, square1.Badness(), double_eps);
+            square1.CheckIntegrity();
+            // the source molecule must be intact
+            bad_square.CheckIntegrity();
+            TS_ASSERT_EQUALS(totalcost, bad_square.Badness());
+            bad_square.Pop(3);
+            bad_square.AddAt("", +0.0, +0.0, 0.0);
+            TS_ASSERT_DELTA(totalcost, bad_square.Badness(), double_eps);
+        }
+
+
+        void test_memoryUsage()
+        {
+            Molecule square;
+            square.setDistanceTable(dst_square);
+            square.AddAt("", -0.5, -0.5, 0.0);
+            square.AddAt("", +0.5, -0.5, 0.0);
+            square.AddAt("", +0.5, +0.5, 0.0);
+            double mu0 = square.memoryUsage();
+            TS_ASSERT(mu0 > sizeof(Molecule));
+            // copies share the pair matrices until they are modified
+            Molecule square1 = square;
+            double mushared = square.memoryUsage();
+            TS_ASSERT(mushared < mu0);
+            // reading the pair costs keeps them shared
+            square1.recalculate();
+            TS_ASSERT_EQUALS(mushared, square.memoryUsage());
+            square1.AddAt("", -0.5, +0.5, 0.0);
+            TS_ASSERT_DELTA(0.0, square1.Badness(), double_eps);
+            TS_ASSERT_EQUALS(mu0, square.memoryUsage());
+        }
+
+
+        void test_Pop_list()
+        {
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            mol.setChemicalFormula("C2O2");
+            mol.setAtomRadiiTable("C:0.3, O:0.8");
+            mol.Clear();
+            mol.AddAt("O", 0.0, 0.0, 0.0);
+            mol.AddAt("C", 1.0, 0.1, 0.0);
+            mol.AddAt("O", 1.1, 1.0, 0.0);
+            mol.AddAt("C", 0.0, 0.9, 0.0);
+            // bulk removal must agree with the single-atom pops
+            Molecule mol1 = mol;
+            list<int> ipop;
+            ipop.push_back(2);
+            ipop.push_back(0);
+            ipop.push_back(2);
+            mol.Pop(ipop);
+            mol1.Pop(2);
+            mol1.Pop(0);
+            mol.CheckIntegrity();
+            TS_ASSERT_EQUALS(2, mol.countAtoms());
+            TS_ASSERT_EQUALS("C", mol.getAtom(0).element);
+            TS_ASSERT_EQUALS(1.0, mol.getAtom(0).r[0]);
+            TS_ASSERT_EQUALS(0.0, mol.getAtom(1).r[0]);
+            TS_ASSERT_DELTA(mol1.Badness(), mol.Badness(), double_eps);
+            TS_ASSERT_DELTA(mol1.Overlap(), mol.Overlap(), double_eps);
+            TS_ASSERT_DELTA(mol1.getAtom(0).Badness(),
+                    mol.getAtom(0).Badness(), double_eps);
+            TS_ASSERT_DELTA(mol1.getAtom(1).Overlap(),
+                    mol.getAtom(1).Overlap(), double_eps);
+            TS_ASSERT_EQUALS(mol1.getDistanceUsage().countUsed(),
+                    mol.getDistanceUsage().countUsed());
+            double cost0 = mol.cost();
+            mol.recalculate();
+            TS_ASSERT_DELTA(cost0, mol.cost(), double_eps);
+            // removed atoms can be added again
+            mol.AddAt("O", 0.0, 0.0, 0.0);
+            mol.AddAt("O", 1.1, 1.0, 0.0);
+            TS_ASSERT_EQUALS(6u, mol.getDistanceUsage().countUsed());
+            ipop.clear();
+            ipop.push_back(1);
+            ipop.push_back(4);
+            TS_ASSERT_THROWS(mol.Pop(ipop), range_error);
+        }
+
+
+        void test_find_nearest()
+        {
+            double data[6] = { 1.0, 1.1, 1.1, 2.0, 4.0, 4.5 };
+            DistanceTable dst(data, 6);
+            TS_ASSERT_EQUALS(0, dst.find_nearest(-3.0) - dst.begin());
+            TS_ASSERT_EQUALS(1, dst.find_nearest(1.1) - dst.begin());
+            TS_ASSERT_EQUALS(3, dst.find_nearest(1.8) - dst.begin());
+            TS_ASSERT_EQUALS(3, dst.find_nearest(2.9) - dst.begin());
+            TS_ASSERT_EQUALS(4, dst.find_nearest(3.1) - dst.begin());
+            TS_ASSERT_EQUALS(5, dst.find_nearest(9.0) - dst.begin());
+            dst.erase(dst.begin() + 3);
+            TS_ASSERT_EQUALS(2, dst.find_nearest(2.0) - dst.begin());
+            dst.return_back(3.0);
+            TS_ASSERT_EQUALS(3, dst.find_nearest(2.9) - dst.begin());
+            DistanceTable dst0;
+            TS_ASSERT(dst0.end() == dst0.find_nearest(1.0));
+        }
+
+
+        void test_DistanceTable_esds()
+        {
+            istringstream fid(
+                    "#L position esd\n"
+                    "2.0 0.2\n"
+                    "1.0 0.1\n"
+                    "1.5 0.3\n"
+                    "1.0 0.4\n");
+            DistanceTable dst;
+            fid >> dst;
+            TS_ASSERT_EQUALS(4u, dst.size());
+            TS_ASSERT(dst.hasESDs());
+            // ESDs stay with their distances, equal distances share
+            // the last ESD
+            TS_ASSERT_EQUALS(0.4, dst.getesdAt(0));
+            TS_ASSERT_EQUALS(0.4, dst.getesdAt(1));
+            TS_ASSERT_EQUALS(0.3, dst.getesdAt(2));
+            TS_ASSERT_EQUALS(0.2, dst.getesdAt(3));
+            TS_ASSERT_EQUALS(0.3, dst.getesd(1.5));
+            TS_ASSERT_THROWS(dst.getesd(1.6), out_of_range);
+            size_t idx = dst.find_nearest(1.9) - dst.begin();
+            TS_ASSERT_EQUALS(0.2, dst.getesdAt(idx));
+            // ESDs follow erase and return_back
+            dst.erase(dst.begin() + 2);
+            TS_ASSERT_EQUALS(0.2, dst.getesdAt(2));
+            dst.return_back(1.0);
+            TS_ASSERT_EQUALS(4u, dst.size());
+            TS_ASSERT_EQUALS(0.2, dst.getesdAt(3));
+            TS_ASSERT_THROWS(dst.return_back(1.6), out_of_range);
+            DistanceTable dtu = dst.unique();
+            TS_ASSERT_EQUALS(2u, dtu.size());
+            TS_ASSERT_EQUALS(0.4, dtu.getesdAt(0));
+            TS_ASSERT_EQUALS(0.2, dtu.getesdAt(1));
+            dst.clearESDs();
+            TS_ASSERT_EQUALS(1.0, dst.getesdAt(1));
+        }
+
+
+        void test_DistanceTable_binary()
+        {
+            istringstream fid(
+                    "#L position esd\n"
+                    "2.0 0.2\n"
+                    "1.0 0.1\n"
+                    "1.5 0.3\n");
+            DistanceTable dst;
+            fid >> dst;
+            char filename[] = "/tmp/TestMolecule-XXXXXX";
+            int fd = mkstemp(filename);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            TS_ASSERT(!DistanceTable::isBinaryFile(filename));
+            dst.writeBinary(filename);
+            TS_ASSERT(DistanceTable::isBinaryFile(filename));
+            DistanceTable dst1;
+            dst1.readBinary(filename);
+            unlink(filename);
+            TS_ASSERT_EQUALS(dst.size(), dst1.size());
+            TS_ASSERT(equal(dst.begin(), dst.end(), dst1.begin()));
+            TS_ASSERT(dst1.hasESDs());
+            for (size_t i = 0; i != dst.size(); ++i)
+            {
+                TS_ASSERT_EQUALS(dst.getesdAt(i), dst1.getesdAt(i));
+            }
+            TS_ASSERT_EQUALS(dst.getResolution(), dst1.getResolution());
+            double probes[4] = {-1.0, 1.2, 1.8, 7.0};
+            for (int i = 0; i != 4; ++i)
+            {
+                TS_ASSERT_EQUALS(dst.find_nearest(probes[i]) - dst.begin(),
+                        dst1.find_nearest(probes[i]) - dst1.begin());
+            }
+            TS_ASSERT_THROWS(dst1.readBinary("/nonexistent/file.dtbl"),
+                    IOError);
+        }
+
+
+        void test_native_structure_io()
+        {
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            mol.setChemicalFormula("CO");
+            mol.AddAt("C", 0.0, 0.0, 0.0);
+            mol.AddAt("O", 1.0, 0.5, -0.25);
+            ostringstream out;
+            Molecule::setOutputFormat("xyz");
+            mol.WriteStream(out, "square");
+            TS_ASSERT_EQUALS(string("2\nsquare\n"
+                        "C   0 0 0\nO   1 0.5 -0.25\n"), out.str());
+            char filename[] = "/tmp/TestMolecule-XXXXXX";
+            int fd = mkstemp(filename);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            Molecule::setOutputFormat("rawxyz");
+            mol.WriteFile(filename);
+            Molecule mol1;
+            mol1.setDistanceTable(dst_square);
+            mol1.ReadFile(filename);
+            unlink(filename);
+            TS_ASSERT_EQUALS(2, mol1.countAtoms());
+            TS_ASSERT_EQUALS("O", mol1.getAtom(1).element);
+            TS_ASSERT_EQUALS(0.5, mol1.getAtom(1).r[1]);
+            TS_ASSERT_EQUALS(-0.25, mol1.getAtom(1).r[2]);
+            Molecule::setOutputFormat("pdb");
+            out.str("");
+            mol.WriteStream(out);
+            Molecule::setOutputFormat("rawxyz");
+            TS_ASSERT_EQUALS(string::npos, out.str().find("TITLE"));
+            TS_ASSERT_EQUALS(4 * 81, int(out.str().size()));
+        }
+
+
+        void test_getFlipSitesOverlapDelta()
+        {
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            mol.setChemicalFormula("C2O2");
+            mol.setAtomRadiiTable("C:0.3, O:0.8");
+            mol.Clear();
+            mol.AddAt("O", 0.0, 0.0, 0.0);
+            mol.AddAt("O", 1.0, 0.0, 0.0);
+            mol.AddAt("C", 1.0, 1.0, 0.0);
+            mol.AddAt("C", 0.0, 1.2, 0.0);
+            for (int i = 0; i != 4; ++i)
+            {
+                for (int j = 0; j != 4; ++j)
+                {
+                    double overlap0 = mol.Overlap();
+                    double delta = mol.getFlipSitesOverlapDelta(i, j);
+                    mol.FlipSites(i, j);
+                    TS_ASSERT_DELTA(overlap0 + delta, mol.Overlap(),
+                            double_eps);
+                    mol.FlipSites(i, j);
+                }
+            }
+            // the O atoms should be flipped to the longest diagonal
+            TS_ASSERT(mol.Overlap() > 0.0);
+            mol.DownhillOverlapMinimization();
+            double overlap1 = mol.Overlap();
+            mol.recalculate();
+            TS_ASSERT_DELTA(overlap1, mol.Overlap(), double_eps);
+            TS_ASSERT_EQUALS("O", mol.getAtom(1).element);
+            TS_ASSERT_EQUALS("O", mol.getAtom(3).element);
+            for (int i = 0; i != 4; ++i)
+            {
+                for (int j = 0; j != 4; ++j)
+                {
+                    TS_ASSERT(mol.getFlipSitesOverlapDelta(i, j) > -double_eps);
+                }
+            }
+        }
+
+        void test_MinimizeSiteOverlap()
+        {
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            mol.setChemicalFormula("C2O2");
+            mol.setAtomRadiiTable("C:0.3, O:0.8");
+            mol.Clear();
+            mol.AddAt("O", 0.0, 0.0, 0.0);
+            mol.AddAt("O", 1.0, 0.0, 0.0);
+            mol.AddAt("C", 1.0, 1.0, 0.0);
+            mol.AddAt("C", 0.0, 1.2, 0.0);
+            // find the lowest overlap from flips of site 1
+            double overlap0 = mol.Overlap();
+            double lowest = overlap0;
+            for (int j = 0; j != 4; ++j)
+            {
+                mol.FlipSites(1, j);
+                lowest = min(lowest, mol.Overlap());
+                mol.FlipSites(1, j);
+            }
+            TS_ASSERT(lowest < overlap0);
+            mol.MinimizeSiteOverlap(1);
+            TS_ASSERT_DELTA(lowest, mol.Overlap(), double_eps);
+            double overlap1 = mol.Overlap();
+            mol.recalculate();
+            TS_ASSERT_DELTA(overlap1, mol.Overlap(), double_eps);
+            TS_ASSERT_EQUALS("C", mol.getAtom(1).element);
+            TS_ASSERT_THROWS(mol.MinimizeSiteOverlap(4), range_error);
+        }
+
+
+        void test_setAtomRadiiTable_overlap()
+        {
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            mol.setChemicalFormula("C2O2");
+            mol.setAtomRadiiTable("C:0.3, O:0.8");
+            mol.AddAt("O", 0.0, 0.0, 0.0);
+            mol.AddAt("C", 1.0, 0.0, 0.0);
+            mol.AddAt("O", 1.0, 1.0, 0.0);
+            mol.AddAt("C", 0.0, 0.9, 0.0);
+            double overlap0 = mol.Overlap();
+            TS_ASSERT(overlap0 > 0.0);
+            // overlaps of changed atoms are updated in place
+            mol.setAtomRadiiTable("C:0.6, O:0.8");
+            Molecule mol1;
+            mol1.setDistanceTable(dst_square);
+            mol1.setChemicalFormula("C2O2");
+            mol1.setAtomRadiiTable("C:0.6, O:0.8");
+            for (int i = 0; i != mol.countAtoms(); ++i)
+            {
+                mol1.Add(mol.getAtom(i));
+            }
+            TS_ASSERT(mol.Overlap() > overlap0);
+            TS_ASSERT_DELTA(mol1.Overlap(), mol.Overlap(), double_eps);
+            for (int i = 0; i != mol.countAtoms(); ++i)
+            {
+                TS_ASSERT_DELTA(mol1.getAtom(i).Overlap(),
+                        mol.getAtom(i).Overlap(), double_eps);
+            }
+            mol.setAtomRadiiTable("C:0.3, O:0.8");
+            TS_ASSERT_DELTA(overlap0, mol.Overlap(), double_eps);
+            mol.Pop(1);
+            mol.setAtomRadiiTable("C:0.1, O:0.1");
+            TS_ASSERT_EQUALS(0.0, mol.Overlap());
+        }
+
+
+        void test_Evolve_trialthreads()
+        {
+            // concurrent trials do not depend on the number of threads
+            vector<double> xyz[2];
+            for (int i = 0; i != 2; ++i)
+            {
+                Molecule::setTrialThreads(i + 2);
+                NS_LIGA::randomSeed(7);
+                Molecule mol;
+                mol.setDistanceTable(dst_square);
+                while (!mol.full())
+                {
+                    int n = mol.countAtoms();
+                    int est_triang[3] = { 300, n > 1 ? 300 : 0, n > 2 ? 300 : 0 };
+                    mol.Evolve(est_triang);
+                }
+                for (int j = 0; j != mol.countAtoms(); ++j)
+                {
+                    const R3::Vector& r = mol.getAtom(j).r;
+                    xyz[i].insert(xyz[i].end(), r.begin(), r.end());
+                }
+            }
+            Molecule::setTrialThreads(1);
+            TS_ASSERT_EQUALS(12u, xyz[0].size());
+            TS_ASSERT(xyz[0] == xyz[1]);
+        }
+
+
+        void test_Evolve_floatscreen()
+        {
+            // screening of trial atoms does not change the results
+            vector<double> xyz[2];
+            for (int i = 0; i != 2; ++i)
+            {
+                Molecule::floatscreen = (i == 1);
+                NS_LIGA::randomSeed(7);
+                Molecule mol;
+                mol.setDistanceTable(dst_square);
+                while (!mol.full())
+                {
+                    int n = mol.countAtoms();
+                    int est_triang[3] = { 300, n > 1 ? 300 : 0, n > 2 ? 300 : 0 };
+                    mol.Evolve(est_triang);
+                }
+                for (int j = 0; j != mol.countAtoms(); ++j)
+                {
+                    const R3::Vector& r = mol.getAtom(j).r;
+                    xyz[i].insert(xyz[i].end(), r.begin(), r.end());
+                }
+            }
+            Molecule::floatscreen = false;
+            TS_ASSERT_EQUALS(12u, xyz[0].size());
+            TS_ASSERT(xyz[0] == xyz[1]);
+        }
+
+
+        void test_Evolve_candidatecache()
+        {
+            // rejected trial atoms are kept until their anchors are popped
+            Molecule::candidatecache = 8;
+            NS_LIGA::randomSeed(7);
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            int est_linear[3] = { 300, 0, 0 };
+            int est_none[3] = { 0, 0, 0 };
+            mol.Evolve(est_linear);
+            TS_ASSERT_EQUALS(0, mol.countCachedCandidates());
+            mol.Evolve(est_linear);
+            TS_ASSERT_EQUALS(8, mol.countCachedCandidates());
+            int n = mol.countAtoms();
+            Molecule mcopy(mol);
+            TS_ASSERT_EQUALS(8, mcopy.countCachedCandidates());
+            // all candidates are anchored at the first atom
+            mcopy.Pop(0);
+            TS_ASSERT_EQUALS(0, mcopy.countCachedCandidates());
+            // cached atoms are scored without any new triangulations
+            pair<int*,int*> acc_tot = mol.Evolve(est_none);
+            Molecule::candidatecache = 0;
+            TS_ASSERT_EQUALS(8, accumulate(acc_tot.second,
+                        acc_tot.second + NTGTYPES, 0));
+            TS_ASSERT_EQUALS(n + 1, mol.countAtoms());
+            mol.Clear();
+            TS_ASSERT_EQUALS(0, mol.countCachedCandidates());
+        }
+
+
+        void test_Evolve_max_costs()
+        {
+            // hopeless cost limit of the next level skips all trials
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            mol.AddAt("", 0.0, 0.0, 0.0);
+            mol.AddAt("", 1.1, 0.0, 0.0);
+            TS_ASSERT(mol.Badness() > 0.0);
+            double hopeless[5] = { DOUBLE_MAX, DOUBLE_MAX, DOUBLE_MAX,
+                0.0, DOUBLE_MAX };
+            int est_triang[3] = { 300, 300, 300 };
+            pair<int*,int*> acc_tot = mol.Evolve(est_triang, hopeless);
+            TS_ASSERT_EQUALS(0, accumulate(acc_tot.second,
+                        acc_tot.second + NTGTYPES, 0));
+            TS_ASSERT_EQUALS(2, mol.countAtoms());
+            // unlimited costs give the same results as no limits
+            double nolimits[5] = { DOUBLE_MAX, DOUBLE_MAX, DOUBLE_MAX,
+                DOUBLE_MAX, DOUBLE_MAX };
+            vector<double> xyz[2];
+            for (int i = 0; i != 2; ++i)
+            {
+                NS_LIGA::randomSeed(7);
+                Molecule mol1;
+                mol1.setDistanceTable(dst_square);
+                while (!mol1.full())
+                {
+                    int n = mol1.countAtoms();
+                    int est[3] = { 300, n > 1 ? 300 : 0, n > 2 ? 300 : 0 };
+                    mol1.Evolve(est, i ? nolimits : NULL);
+                }
+                for (int j = 0; j != mol1.countAtoms(); ++j)
+                {
+                    const R3::Vector& r = mol1.getAtom(j).r;
+                    xyz[i].insert(xyz[i].end(), r.begin(), r.end());
+                }
+            }
+            TS_ASSERT_EQUALS(12u, xyz[0].size());
+            TS_ASSERT(xyz[0] == xyz[1]);
+        }
+
+
+        void test_triangulationSeconds()
+        {
+            // every triangulation type needs its anchor atoms
+            Molecule mol;
+            mol.setDistanceTable(dst_square);
+            TS_ASSERT_EQUALS(0, mol.countTriangulationTypes(0));
+            TS_ASSERT_EQUALS(2, mol.countTriangulationTypes(2));
+            TS_ASSERT_EQUALS(3, mol.countTriangulationTypes(4));
+            int est_linear[3] = { 100, 0, 0 };
+            int est_triang[3] = { 100, 100, 0 };
+            while (mol.countAtoms() < 2)    mol.Evolve(est_linear);
+            mol.Evolve(est_triang);
+            const double* tsec = Molecule::triangulationSeconds();
+            TS_ASSERT(tsec[LINEAR] > 0.0);
+            TS_ASSERT(tsec[PLANAR] >= 0.0);
+            TS_ASSERT(tsec[SPATIAL] >= 0.0);
+        }
+
+
+        void test_AtomFilterPipeline()
+        {
+            // adaptive order and prechecks do not change the results
+            NS_LIGA::randomSeed(11);
+            Molecule mol;
+            vector<double> dst(1, 1.0);
+            mol.setDistanceTable(dst);
+            mol.setDistReuse(true);
+            mol.setChemicalFormula("C100");
+            for (int k = 0; k != 100; ++k)
+            {
+                mol.AddAt("C", 8 * NS_LIGA::randomFloat(),
+                        8 * NS_LIGA::randomFloat(), NS_LIGA::randomFloat());
+            }
+            BondAngleFilter_t baf(1.5);
+            baf.setBondAngleRange(50.0, 150.0);
+            LoneAtomFilter_t laf(0.8);
+            vector<AtomFilter_t*> filters;
+            filters.push_back(&baf);
+            filters.push_back(&laf);
+            AtomFilterPipeline pipeline;
+            pipeline.setFilters(filters);
+            int nprechecked = 0;
+            for (int i = 0; i != 1000; ++i)
+            {
+                Atom_t a("C", 12 * NS_LIGA::randomFloat() - 2,
+                        12 * NS_LIGA::randomFloat() - 2,
+                        4 * NS_LIGA::randomFloat() - 1.5);
+                bool isgood = baf.Check(&a, &mol) && laf.Check(&a, &mol);
+                TS_ASSERT_EQUALS(isgood, pipeline.Check(&a, &mol));
+                nprechecked += !laf.Precheck(&a, &mol);
+            }
+            TS_ASSERT(nprechecked > 0);
+            // the order depends on timing, but keeps all filters
+            vector<AtomFilter_t*> order = pipeline.getOrder();
+            TS_ASSERT_EQUALS(2u, order.size());
+            TS_ASSERT(count(order.begin(), order.end(), &laf));
+            TS_ASSERT(count(order.begin(), order.end(), &baf));
+            // same filters keep their statistics and order
+            pipeline.setFilters(filters);
+            TS_ASSERT(order == pipeline.getOrder());
+        }
+
+
+        void test_distance_binning()
+        {
+            Molecule square;
+            square.setDistanceTable(dst_square);
+            square.setDistanceBinning(true);
+            TS_ASSERT_EQUALS(2u, square.getDistanceBins()->size());
+            square.AddAt("", -0.5, -0.5, 0.0);
+            square.AddAt("", +0.5, -0.5, 0.0);
+            square.AddAt("", +0.5, +0.5, 0.0);
+            TS_ASSERT_EQUALS(2, square.getDistanceBinUsage()[0]);
+            TS_ASSERT_EQUALS(1, square.getDistanceBinUsage()[1]);
+            Molecule square1 = square;
+            square1.Pop(1);
+            TS_ASSERT_EQUALS(0, square1.getDistanceBinUsage()[0]);
+            TS_ASSERT_EQUALS(1, square1.getDistanceBinUsage()[1]);
+            square1.AddAt("", +0.5, -0.5, 0.0);
+            square1.AddAt("", -0.5, +0.5, 0.0);
+            TS_ASSERT_DELTA(0.0, square1.cost(), double_eps);
+            TS_ASSERT_EQUALS(4, square1.getDistanceBinUsage()[0]);
+            square1.CheckIntegrity();
+            // coarse bins match pairs to the mean of their targets
+            Molecule line;
+            double dst_data[3] = { 1.0, 1.1, 2.1 };
+            DistanceTable dtbl(dst_data, 3);
+            dtbl.setResolution(0.5);
+            line.setDistanceTable(dtbl);
+            line.setDistanceBinning(true);
+            TS_ASSERT_DELTA(1.05, line.getDistanceTable()[1], double_eps);
+            line.AddAt("", 0.0, 0.0, 0.0);
+            line.AddAt("", 1.05, 0.0, 0.0);
+            line.AddAt("", 2.1, 0.0, 0.0);
+            TS_ASSERT_DELTA(0.0, line.cost(), double_eps);
+            line.setDistReuse(true);
+            TS_ASSERT(line.getDistanceBinning());
+            Molecule reused;
+            reused.setDistReuse(true);
+            TS_ASSERT_THROWS(reused.setDistanceBinning(true), range_error);
+        }
+
+
+        void test_Evolve_distance_binning()
+        {
+            // equal target distances give the same results when binned
+            vector<double> xyz[2];
+            for (int i = 0; i != 2; ++i)
+            {
+                NS_LIGA::randomSeed(7);
+                Molecule mol;
+                mol.setDistanceTable(dst_square);
+                mol.setDistanceBinning(i == 1);
+                while (!mol.full())
+                {
+                    int n = mol.countAtoms();
+                    int est_triang[3] = { 300, n > 1 ? 300 : 0, n > 2 ? 300 : 0 };
+                    mol.Evolve(est_triang);
+                }
+                for (int j = 0; j != mol.countAtoms(); ++j)
+                {
+                    const R3::Vector& r = mol.getAtom(j).r;
+                    xyz[i].insert(xyz[i].end(), r.begin(), r.end());
+                }
+            }
+            TS_ASSERT_EQUALS(12u, xyz[0].size());
+            TS_ASSERT(xyz[0] == xyz[1]);
+        }
+
+
+        void test_freezeFixedPairs()
+        {
+            // frozen pairs give the same Evolve results
+            vector<double> xyz[2];
+            for (int i = 0; i != 2; ++i)
+            {
+                NS_LIGA::randomSeed(7);
+                Molecule mol;
+                mol.setDistanceTable(dst_square);
+                mol.AddAt("", 0.0, 0.0, 0.0);
+                mol.AddAt("", 1.0, 0.0, 0.0);
+                mol.AddAt("", 1.0, 1.0, 0.0);
+                mol.Fix(0);
+                mol.Fix(1);
+                if (i == 1)
+                {
+                    mol.freezeFixedPairs();
+                    TS_ASSERT_EQUALS(5u, mol.getDistanceTable().size());
+                    TS_ASSERT_EQUALS(2u, mol.getDistanceUsage().countUsed());
+                }
+                TS_ASSERT_DELTA(0.0, mol.cost(), double_eps);
+                mol.Pop(2);
+                while (!mol.full())
+                {
+                    int n = mol.countAtoms();
+                    int est_triang[3] = { 300, 300, n > 2 ? 300 : 0 };
+                    mol.Evolve(est_triang);
+                }
+                TS_ASSERT_DELTA(0.0, mol.cost(), double_eps);
+                for (int j = 0; j != mol.countAtoms(); ++j)
+                {
+                    const R3::Vector& r = mol.getAtom(j).r;
+                    xyz[i].insert(xyz[i].end(), r.begin(), r.end());
+                }
+            }
+            TS_ASSERT_EQUALS(12u, xyz[0].size());
+            TS_ASSERT(xyz[0] == xyz[1]);
+            Molecule reused;
+            reused.setDistReuse(true);
+            TS_ASSERT_THROWS(reused.freezeFixedPairs(), range_error);
+        }
+
+
+        void test_fingerprint()
+        {
+            Molecule m0, m1;
+            m0.setDistanceTable(dst_square);
+            m1.setDistanceTable(dst_square);
+            m0.AddAt("", 0.0, 0.0, 0.0);
+            m0.AddAt("", 1.0, 0.0, 0.0);
+            m0.AddAt("", 1.0, 1.0, 0.0);
+            // shifted and permuted structure
+            m1.AddAt("", 3.0, 1.0, 2.0);
+            m1.AddAt("", 2.0, 0.0, 2.0);
+            m1.AddAt("", 3.0, 0.0, 2.0);
+            TS_ASSERT_EQUALS(m0.fingerprint(), m1.fingerprint());
+            m1.Pop(0);
+            m1.AddAt("", 3.0, 1.1, 2.0);
+            TS_ASSERT_DIFFERS(m0.fingerprint(), m1.fingerprint());
+        }
+
 };  // class TestMolecule
 
 // End of file
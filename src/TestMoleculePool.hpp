@@ -0,0 +1,105 @@
+/***********************************************************************
+* Short Title: unit tests for MoleculePool class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <memory>
+#include <cxxtest/TestSuite.h>
+
+#include "MoleculePool.hpp"
+#include "Molecule.hpp"
+#include "Crystal.hpp"
+
+using namespace std;
+
+class TestMoleculePool : public CxxTest::TestSuite
+{
+    private:
+
+        double double_eps;
+        DistanceTable dst_square;
+
+    public:
+
+        void setUp()
+        {
+            double_eps = 1.0e-6;
+            double square_data[6] = { 1.0, 1.0, 1.0, 1.0, sqrt(2.0), sqrt(2.0) };
+            dst_square = DistanceTable(square_data, 6);
+        }
+
+
+        void test_reserve()
+        {
+            Molecule proto;
+            proto.setDistanceTable(dst_square);
+            MoleculePool pool;
+            TS_ASSERT_EQUALS(0u, pool.size());
+            TS_ASSERT(!pool.take());
+            pool.reserve(proto, 3);
+            TS_ASSERT_EQUALS(3u, pool.size());
+            TS_ASSERT_EQUALS(3u, pool.capacity());
+            pool.reserve(proto, 1);
+            TS_ASSERT_EQUALS(1u, pool.size());
+            pool.clear();
+            TS_ASSERT_EQUALS(0u, pool.size());
+            TS_ASSERT_EQUALS(1u, pool.capacity());
+        }
+
+
+        void test_copy()
+        {
+            Molecule square;
+            square.setDistanceTable(dst_square);
+            square.AddAt("", 0.0, 0.0, 0.0);
+            square.AddAt("", 0.0, 1.0, 0.0);
+            square.AddAt("", 1.0, 1.0, 0.0);
+            square.AddAt("", 1.2, 0.0, 0.0);
+            MoleculePool pool;
+            pool.reserve(square, 1);
+            Molecule* spare = pool.take();
+            pool.recycle(spare);
+            // copy fills the spare molecule
+            auto_ptr<Molecule> m1(pool.copy(square));
+            TS_ASSERT_EQUALS(spare, m1.get());
+            TS_ASSERT_EQUALS(0u, pool.size());
+            TS_ASSERT_EQUALS(4, m1->countAtoms());
+            TS_ASSERT_DELTA(square.cost(), m1->cost(), double_eps);
+            // empty pool allocates a new molecule
+            auto_ptr<Molecule> m2(pool.copy(square));
+            TS_ASSERT(m2.get() != m1.get());
+            TS_ASSERT_DELTA(square.cost(), m2->cost(), double_eps);
+            // molecules beyond capacity are deleted when recycled
+            pool.recycle(m1.release());
+            pool.recycle(m2.release());
+            TS_ASSERT_EQUALS(1u, pool.size());
+            pool.recycle(NULL);
+            TS_ASSERT_EQUALS(1u, pool.size());
+        }
+
+
+        void test_copy_crystal()
+        {
+            Crystal fcc;
+            fcc.setChemicalFormula("C4");
+            fcc.setRmax(3.05);
+            fcc.setLattice(Lattice(1, 1, 1, 90, 90, 90));
+            double fcc_data[1] = { sqrt(0.5) };
+            fcc.setDistanceTable(DistanceTable(fcc_data, 1));
+            fcc.AddAt("C", 0.0, 0.0, 0.0);
+            fcc.AddAt("C", 0.5, 0.5, 0.0);
+            MoleculePool pool;
+            pool.reserve(Crystal(), 1);
+            auto_ptr<Molecule> c1(pool.copy(fcc));
+            TS_ASSERT_EQUALS(0u, pool.size());
+            TS_ASSERT(dynamic_cast<Crystal*>(c1.get()));
+            TS_ASSERT_EQUALS(2, c1->countAtoms());
+            TS_ASSERT_DELTA(fcc.cost(), c1->cost(), double_eps);
+        }
+
+};  // class TestMoleculePool
+
+// End of file
@@ -97,6 +97,30 @@ class TestRandom : public CxxTest::TestSuite
         }
 
 
+        void test_RGW_weighedPickZeros()
+        {
+            // items of zero weight come only after all others
+            double wts[5] = {0, 1e10, 0, 1e-5, 2e-5};
+            rwg.setWeights(wts, wts + 5);
+            size_t cntsecond3 = 0;
+            size_t attempts = 10000;
+            for (size_t i = 0; i < attempts; ++i)
+            {
+                const PickType& sel = rwg.weighedPick(5);
+                TS_ASSERT_EQUALS(1u, sel[0]);
+                TS_ASSERT(sel[1] == 3 || sel[1] == 4);
+                TS_ASSERT_EQUALS(7u, sel[1] + sel[2]);
+                TS_ASSERT_EQUALS(2u, sel[3] + sel[4]);
+                if (sel[1] == 3)    cntsecond3++;
+            }
+            double psecond3 = 1.0/3;
+            double avgsecond3 = psecond3*attempts;
+            double sigsecond3 = sqrt(psecond3*attempts*(1 - psecond3));
+            TS_ASSERT(cntsecond3 < avgsecond3 + 6*sigsecond3);
+            TS_ASSERT(cntsecond3 > avgsecond3 - 6*sigsecond3);
+        }
+
+
         void test_RGW_weighedInt()
         {
             double wts[2] = {3, 1};
@@ -114,6 +138,77 @@ class TestRandom : public CxxTest::TestSuite
             TS_ASSERT(cnt0 > avgcnt0 - 6*sigcnt0);
         }
 
+
+        void test_RGW_setWeight()
+        {
+            double wts[3] = {3, 0, 1};
+            rwg.setWeights(wts, wts + 3);
+            rwg.setWeight(0, 0.0);
+            for (size_t i = 0; i < 100; ++i)
+            {
+                TS_ASSERT_EQUALS(2u, rwg.weighedInt());
+            }
+            rwg.setWeight(1, 3.0);
+            size_t cnt1 = 0;
+            size_t attempts = 10000;
+            for (size_t i = 0; i < attempts; ++i)
+            {
+                size_t idx = rwg.weighedInt();
+                TS_ASSERT(idx == 1 || idx == 2);
+                if (idx == 1)   cnt1++;
+            }
+            double p1 = 3.0/4;
+            double avgcnt1 = p1 * attempts;
+            double sigcnt1 = sqrt(p1*attempts*(1 - p1));
+            TS_ASSERT(cnt1 < avgcnt1 + 6*sigcnt1);
+            TS_ASSERT(cnt1 > avgcnt1 - 6*sigcnt1);
+            TS_ASSERT_THROWS(rwg.setWeight(2, -1.0), out_of_range);
+        }
+
+
+        void test_randomStreamSeed()
+        {
+            TS_ASSERT_EQUALS(randomStreamSeed(7, 3), randomStreamSeed(7, 3));
+            TS_ASSERT(randomStreamSeed(7, 3) != randomStreamSeed(7, 4));
+            TS_ASSERT(randomStreamSeed(7, 3) != randomStreamSeed(8, 3));
+            TS_ASSERT(randomStreamSeed(0, 0) != randomStreamSeed(0, 1));
+        }
+
+
+        void test_RandomStreamScope()
+        {
+            gsl_rng* rng0 = currentRNG();
+            double x0, x1, x2;
+            {
+                RandomStreamScope stream(7, 3);
+                TS_ASSERT(rng0 != currentRNG());
+                x0 = randomFloat();
+            }
+            TS_ASSERT_EQUALS(rng0, currentRNG());
+            {
+                RandomStreamScope stream(7, 3);
+                x1 = randomFloat();
+            }
+            {
+                RandomStreamScope stream(7, 4);
+                x2 = randomFloat();
+            }
+            TS_ASSERT_EQUALS(x0, x1);
+            TS_ASSERT(x0 != x2);
+        }
+
+
+        void test_randomState()
+        {
+            string state = randomState();
+            double x0 = randomFloat();
+            double x1 = randomFloat();
+            setRandomState(state);
+            TS_ASSERT_EQUALS(x0, randomFloat());
+            TS_ASSERT_EQUALS(x1, randomFloat());
+            TS_ASSERT_THROWS(setRandomState("short"), invalid_argument);
+        }
+
 };  // class TestRandom
 
 
@@ -54,6 +54,32 @@ class TestRelaxExternalAtom : public CxxTest::TestSuite
             TS_ASSERT_DELTA(0.0, dvtx, double_eps);
         }
 
+
+
+        void test_RelaxAll()
+        {
+            Molecule& mol = *mol_tetrahedron;
+            mol.Add(*vtx_tetrahedron);
+            TS_ASSERT(!mol.RelaxAll());
+            // distort the free atoms of the tetrahedron
+            Molecule distorted;
+            distorted.setDistanceTable(dtgt);
+            distorted.setChemicalFormula(ChemicalFormula("C4"));
+            distorted.Add(mol.getAtom(0));
+            distorted.Fix(0);
+            distorted.AddAt("C", +0.6, -0.3, 0.1);
+            distorted.AddAt("C", -0.1, +0.7, -0.1);
+            distorted.AddAt("C", 0.1, 0.0, 0.9);
+            R3::Vector r0 = distorted.getAtom(0).r;
+            double cost0 = distorted.cost();
+            TS_ASSERT(cost0 > double_eps);
+            TS_ASSERT(distorted.RelaxAll());
+            TS_ASSERT(distorted.cost() < cost0);
+            TS_ASSERT_EQUALS(4, distorted.countAtoms());
+            TS_ASSERT_EQUALS(1, distorted.NFixed());
+            TS_ASSERT_EQUALS(0.0, R3::distance(r0, distorted.getAtom(0).r));
+        }
+
 };  // class TestRelaxExternalAtom
 
 // End of file
@@ -0,0 +1,102 @@
+/***********************************************************************
+* Short Title: unit tests for RunPar_t
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include <cxxtest/TestSuite.h>
+
+#include "RunPar_t.hpp"
+#include "ParseArgs.hpp"
+#include "tests_dir.hpp"
+
+using namespace std;
+
+class TestRunPar_t : public CxxTest::TestSuite
+{
+    private:
+
+        // process C60 arguments with the specified time limits
+        void processTimes(RunPar_t& rp, const char* maxtime,
+                const char* margin)
+        {
+            string distfile = prepend_tests_dir("solids/bucky.dst");
+            const char* argv[] = { "TestRunPar_t", distfile.c_str(),
+                "crystal=false", "verbose=", maxtime, margin, NULL };
+            int argc = sizeof(argv) / sizeof(char*) - 1;
+            ostringstream out;
+            streambuf* coutbuf = cout.rdbuf(out.rdbuf());
+            try {
+                rp.processArguments(argc, const_cast<char**>(argv));
+            }
+            catch (...) {
+                cout.rdbuf(coutbuf);
+                throw;
+            }
+            cout.rdbuf(coutbuf);
+        }
+
+    public:
+
+        void test_cpuTimeLeft()
+        {
+            RunPar_t rp;
+            processTimes(rp, "maxcputime=100", "deadlinemargin=30");
+            TS_ASSERT(rp.cpuTimeLeft() <= 70.0);
+            TS_ASSERT(rp.cpuTimeLeft() > 60.0);
+            TS_ASSERT(!rp.outOfCPUTime());
+            TS_ASSERT_EQUALS(numeric_limits<double>::max(),
+                    rp.wallTimeLeft());
+            RunPar_t rp1;
+            processTimes(rp1, "maxcputime=100", "deadlinemargin=150");
+            TS_ASSERT(rp1.cpuTimeLeft() <= -50.0);
+            TS_ASSERT(rp1.outOfCPUTime());
+        }
+
+
+        void test_wallTimeLeft()
+        {
+            RunPar_t rp;
+            processTimes(rp, "maxwalltime=100", "deadlinemargin=30");
+            TS_ASSERT(rp.wallTimeLeft() <= 70.0);
+            TS_ASSERT(rp.wallTimeLeft() > 60.0);
+            TS_ASSERT(!rp.outOfWallTime());
+            TS_ASSERT_EQUALS(numeric_limits<double>::max(),
+                    rp.cpuTimeLeft());
+            RunPar_t rp1;
+            processTimes(rp1, "maxwalltime=100", "deadlinemargin=150");
+            TS_ASSERT(rp1.wallTimeLeft() <= -50.0);
+            TS_ASSERT(rp1.outOfWallTime());
+        }
+
+
+        void test_invalid_deadlinemargin()
+        {
+            RunPar_t rp;
+            TS_ASSERT_THROWS(
+                    processTimes(rp, "maxwalltime=100", "deadlinemargin=-1"),
+                    ParseArgsError);
+        }
+
+
+        void test_eventlog_efficiency_sharing()
+        {
+            RunPar_t rp;
+            TS_ASSERT_THROWS(
+                    processTimes(rp, "trialsharing=efficiency",
+                        "eventlog=/dev/null"),
+                    ParseArgsError);
+            RunPar_t rp1;
+            TS_ASSERT_THROWS(
+                    processTimes(rp1, "triangsharing=efficiency",
+                        "replay=/dev/null"),
+                    ParseArgsError);
+        }
+};  // class TestRunPar_t
+
+// End of file
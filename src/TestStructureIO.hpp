@@ -0,0 +1,90 @@
+/***********************************************************************
+* Short Title: unit tests for native structure readers
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <fstream>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "StructureIO.hpp"
+#include "Atom_t.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+class TestStructureIO : public CxxTest::TestSuite
+{
+    private:
+
+        string filename;
+
+        void writeFile(const char* content)
+        {
+            ofstream fid(filename.c_str());
+            fid << content;
+        }
+
+    public:
+
+        void setUp()
+        {
+            char tmpname[] = "/tmp/TestStructureIO-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            filename = tmpname;
+        }
+
+
+        void tearDown()
+        {
+            unlink(filename.c_str());
+        }
+
+
+        void test_XYZFrameReader()
+        {
+            writeFile(
+                    "2\n"
+                    "frame 0\n"
+                    "C 0 0 0\n"
+                    "C 1 0 0\n"
+                    "\n"
+                    "2\n"
+                    "\n"
+                    "C 0 0 0\n"
+                    "N 1.5 0 0\n");
+            XYZFrameReader reader(filename);
+            vector<Atom_t> atoms;
+            TS_ASSERT(reader.next(atoms));
+            TS_ASSERT_EQUALS(2u, atoms.size());
+            TS_ASSERT_EQUALS(1.0, atoms[1].r[0]);
+            TS_ASSERT(reader.next(atoms));
+            TS_ASSERT_EQUALS(2u, atoms.size());
+            TS_ASSERT_EQUALS("N", atoms[1].element);
+            TS_ASSERT_EQUALS(1.5, atoms[1].r[0]);
+            TS_ASSERT_EQUALS(2, reader.countFrames());
+            TS_ASSERT(!reader.next(atoms));
+            TS_ASSERT(atoms.empty());
+        }
+
+
+        void test_XYZFrameReader_errors()
+        {
+            vector<Atom_t> atoms;
+            writeFile("2\ntitle\nC 0 0 0\n");
+            XYZFrameReader reader(filename);
+            TS_ASSERT_THROWS(reader.next(atoms), IOError);
+            writeFile("C 0 0 0\nC 1 0 0\n");
+            XYZFrameReader rawreader(filename);
+            TS_ASSERT_THROWS(rawreader.next(atoms), IOError);
+            TS_ASSERT_THROWS(XYZFrameReader("/nonexistent/file.xyz"), IOError);
+        }
+
+};  // class TestStructureIO
+
+// End of file
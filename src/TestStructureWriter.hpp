@@ -0,0 +1,62 @@
+/***********************************************************************
+* Short Title: unit tests for StructureWriter
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "StructureWriter.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+class TestStructureWriter : public CxxTest::TestSuite
+{
+    private:
+
+        string readFile(const string& filename)
+        {
+            ifstream fid(filename.c_str());
+            istreambuf_iterator<char> fbegin(fid), fend;
+            return string(fbegin, fend);
+        }
+
+    public:
+
+        void test_write()
+        {
+            char filename[] = "/tmp/TestStructureWriter-XXXXXX";
+            int fd = mkstemp(filename);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            StructureWriter writer(1);
+            writer.write(filename, "first\n");
+            writer.write(filename, "second\n");
+            writer.write(filename, "third\n");
+            writer.flush();
+            TS_ASSERT_EQUALS(string("third\n"), readFile(filename));
+            TS_ASSERT(writer.countWritten() >= 1);
+            TS_ASSERT(writer.countWritten() <= 3);
+            unlink(filename);
+        }
+
+
+        void test_write_error()
+        {
+            StructureWriter writer;
+            writer.write("/nonexistent/dir/stru.xyz", "lost\n");
+            TS_ASSERT_THROWS(writer.flush(), IOError);
+            TS_ASSERT_EQUALS(0u, writer.countWritten());
+            // error is raised only once
+            writer.flush();
+        }
+};  // class TestStructureWriter
+
+// End of file
@@ -0,0 +1,101 @@
+/***********************************************************************
+* Short Title: unit tests for SymmetricMatrix class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cxxtest/TestSuite.h>
+
+#include "Matrix.hpp"
+
+using namespace std;
+
+class TestSymmetricMatrix : public CxxTest::TestSuite
+{
+    private:
+
+        SymmetricMatrix<int> smx;
+
+    public:
+
+        void setUp()
+        {
+            smx = SymmetricMatrix<int>(4);
+            for (size_t i = 0; i != 4; ++i)
+            {
+                for (size_t j = 0; j <= i; ++j)     smx(i, j) = 10 * i + j;
+            }
+        }
+
+
+        void test_elements()
+        {
+            TS_ASSERT_EQUALS(4u, smx.rows());
+            TS_ASSERT_EQUALS(4u, smx.columns());
+            TS_ASSERT_EQUALS(31, smx(3, 1));
+            TS_ASSERT_EQUALS(31, smx(1, 3));
+            TS_ASSERT_EQUALS(22, smx(2, 2));
+            const int* row2 = smx.rowBegin(2);
+            TS_ASSERT_EQUALS(20, row2[0]);
+            TS_ASSERT_EQUALS(21, row2[1]);
+            TS_ASSERT_EQUALS(22, row2[2]);
+        }
+
+
+        void test_fillRow()
+        {
+            smx.fillRow(1, -1);
+            vector<int> row1 = smx.rowVector(1);
+            TS_ASSERT_EQUALS(4u, row1.size());
+            for (size_t j = 0; j != 4; ++j)     TS_ASSERT_EQUALS(-1, row1[j]);
+            TS_ASSERT_EQUALS(0, smx(0, 0));
+            TS_ASSERT_EQUALS(20, smx(2, 0));
+            TS_ASSERT_EQUALS(32, smx(3, 2));
+        }
+
+
+        void test_resize()
+        {
+            smx.resize(6, 7);
+            TS_ASSERT_EQUALS(6u, smx.rows());
+            TS_ASSERT_EQUALS(31, smx(1, 3));
+            TS_ASSERT_EQUALS(7, smx(5, 0));
+            TS_ASSERT_EQUALS(7, smx(4, 4));
+            smx.resize(2, 0);
+            TS_ASSERT_EQUALS(2u, smx.rows());
+            TS_ASSERT_EQUALS(10, smx(0, 1));
+        }
+
+
+        void test_copy()
+        {
+            SymmetricMatrix<int> smx1 = smx;
+            smx1(3, 0) = 100;
+            TS_ASSERT_EQUALS(30, smx(3, 0));
+            TS_ASSERT_EQUALS(100, smx1(0, 3));
+            smx1.fill(5);
+            TS_ASSERT_EQUALS(30, smx(0, 3));
+            TS_ASSERT_EQUALS(5, smx1(2, 1));
+        }
+
+
+        void test_const_access()
+        {
+            SymmetricMatrix<int> smx1 = smx;
+            double halfbytes = smx.storageBytes();
+            const SymmetricMatrix<int>& csmx1 = smx1;
+            TS_ASSERT_EQUALS(31, csmx1(1, 3));
+            TS_ASSERT_EQUALS(21, csmx1.rowBegin(2)[1]);
+            // const reads keep the storage shared
+            TS_ASSERT_EQUALS(halfbytes, smx.storageBytes());
+            TS_ASSERT_EQUALS(halfbytes, smx1.storageBytes());
+            smx1(1, 3) = 0;
+            TS_ASSERT_EQUALS(2 * halfbytes, smx1.storageBytes());
+            TS_ASSERT_EQUALS(31, smx(1, 3));
+        }
+
+};  // class TestSymmetricMatrix
+
+// End of file
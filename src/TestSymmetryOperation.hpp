@@ -0,0 +1,103 @@
+/***********************************************************************
+* Short Title: unit tests for SymmetryOperation class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <cxxtest/TestSuite.h>
+
+#include "SymmetryOperation.hpp"
+#include "Exceptions.hpp"
+#include "ParseArgs.hpp"
+
+using namespace std;
+
+class TestSymmetryOperation : public CxxTest::TestSuite
+{
+    private:
+
+        string filename;
+
+        void writeSymmetryFile(const char* content)
+        {
+            ofstream fid(filename.c_str());
+            fid << content;
+        }
+
+    public:
+
+        void setUp()
+        {
+            char tmpname[] = "/tmp/TestSymmetryOperation-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            filename = tmpname;
+        }
+
+
+        void tearDown()
+        {
+            unlink(filename.c_str());
+        }
+
+
+        void test_fromXYZ()
+        {
+            SymmetryOperation op = SymmetryOperation::fromXYZ("-y, x-y, z+1/3");
+            R3::Vector lv = op(R3::Vector(0.1, 0.2, 0.3));
+            TS_ASSERT_DELTA(-0.2, lv[0], 1e-12);
+            TS_ASSERT_DELTA(-0.1, lv[1], 1e-12);
+            TS_ASSERT_DELTA(0.3 + 1.0/3, lv[2], 1e-12);
+            TS_ASSERT(!op.isIdentity());
+            op = SymmetryOperation::fromXYZ("1/2+X,Y,0.5-Z");
+            TS_ASSERT_EQUALS(-1.0, op.R(2,2));
+            TS_ASSERT_EQUALS(0.5, op.t[0]);
+            TS_ASSERT(SymmetryOperation::fromXYZ("x+1,y,z-2").isEquivalent(
+                        SymmetryOperation()));
+            TS_ASSERT_THROWS(SymmetryOperation::fromXYZ("x,y"),
+                    invalid_argument);
+            TS_ASSERT_THROWS(SymmetryOperation::fromXYZ("x,y,w"),
+                    invalid_argument);
+            TS_ASSERT_THROWS(SymmetryOperation::fromXYZ("x,y,z,"),
+                    invalid_argument);
+            TS_ASSERT_THROWS(SymmetryOperation::fromXYZ("x,y,z+1/0"),
+                    invalid_argument);
+        }
+
+
+        void test_readSymmetryFile()
+        {
+            writeSymmetryFile(
+                    "# P 21/c\n"
+                    "1 'x, y, z'\n"
+                    "2 '-x, y+1/2, -z+1/2'\n"
+                    "-x, -y, -z\n"
+                    "x, -y+1/2, z+1/2  # glide\n");
+            vector<SymmetryOperation> ops =
+                SymmetryOperation::readSymmetryFile(filename);
+            TS_ASSERT_EQUALS(4u, ops.size());
+            TS_ASSERT(ops[0].isIdentity());
+            TS_ASSERT_EQUALS(0.5, ops[1].t[1]);
+            TS_ASSERT(SymmetryOperation::isGroup(ops));
+            ops.pop_back();
+            TS_ASSERT(!SymmetryOperation::isGroup(ops));
+            writeSymmetryFile("x,y,z\n-x,-y,-z\n-x,y,z\n");
+            TS_ASSERT_THROWS(SymmetryOperation::readSymmetryFile(filename),
+                    ParseArgsError);
+            writeSymmetryFile("x,y,z\nx,y,q\n");
+            TS_ASSERT_THROWS(SymmetryOperation::readSymmetryFile(filename),
+                    ParseArgsError);
+            TS_ASSERT_THROWS(
+                SymmetryOperation::readSymmetryFile("/nonexistent/file.sym"),
+                IOError);
+        }
+
+};  // class TestSymmetryOperation
+
+// End of file
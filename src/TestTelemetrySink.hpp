@@ -0,0 +1,159 @@
+/***********************************************************************
+* Short Title: unit tests for TelemetrySink
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cxxtest/TestSuite.h>
+
+#include "TelemetrySink.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+class TestTelemetrySink : public CxxTest::TestSuite
+{
+    private:
+
+        string filename;
+
+        string readFile() const
+        {
+            ifstream fid(filename.c_str());
+            ostringstream content;
+            content << fid.rdbuf();
+            return content.str();
+        }
+
+
+        // listening Unix socket at filename
+        int listenSocket() const
+        {
+            sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strcpy(addr.sun_path, filename.c_str());
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            TS_ASSERT(fd >= 0);
+            TS_ASSERT_EQUALS(0, bind(fd,
+                        reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+            TS_ASSERT_EQUALS(0, listen(fd, 1));
+            return fd;
+        }
+
+    public:
+
+        void setUp()
+        {
+            char tmpname[] = "/tmp/TestTelemetrySink-XXXXXX";
+            int fd = mkstemp(tmpname);
+            TS_ASSERT(fd >= 0);
+            close(fd);
+            filename = tmpname;
+        }
+
+
+        void tearDown()
+        {
+            unlink(filename.c_str());
+        }
+
+
+        void test_file()
+        {
+            ostringstream expected;
+            {
+                // few pending records make send wait for the writer
+                TelemetrySink sink(filename, 2);
+                TS_ASSERT_EQUALS(filename, sink.target());
+                for (int i = 0; i != 100; ++i)
+                {
+                    ostringstream record;
+                    record << "{\"season\": " << i << "}";
+                    sink.send(record.str());
+                    expected << record.str() << '\n';
+                }
+            }
+            // pending records are written when the sink is destroyed
+            TS_ASSERT_EQUALS(expected.str(), readFile());
+        }
+
+
+        void test_flush()
+        {
+            TelemetrySink sink(filename);
+            sink.send("first");
+            sink.send("second");
+            sink.flush();
+            TS_ASSERT_EQUALS("first\nsecond\n", readFile());
+            sink.flush();
+            TS_ASSERT_EQUALS("first\nsecond\n", readFile());
+        }
+
+
+        void test_socket()
+        {
+            unlink(filename.c_str());
+            int lfd = listenSocket();
+            {
+                TelemetrySink sink("unix:" + filename);
+                sink.send("alpha");
+                sink.send("beta");
+            }
+            int fd = accept(lfd, NULL, NULL);
+            TS_ASSERT(fd >= 0);
+            string received;
+            char buf[64];
+            ssize_t cnt;
+            while ((cnt = read(fd, buf, sizeof(buf))) > 0)
+            {
+                received.append(buf, cnt);
+            }
+            TS_ASSERT_EQUALS("alpha\nbeta\n", received);
+            close(fd);
+            close(lfd);
+        }
+
+
+        void test_write_error()
+        {
+            unlink(filename.c_str());
+            int lfd = listenSocket();
+            TelemetrySink sink("unix:" + filename);
+            close(accept(lfd, NULL, NULL));
+            close(lfd);
+            // the failed write is raised by a later call
+            bool raised = false;
+            for (int i = 0; i != 100 && !raised; ++i)
+            {
+                try {
+                    sink.send("lost");
+                    sink.flush();
+                }
+                catch (IOError&) {
+                    raised = true;
+                }
+            }
+            TS_ASSERT(raised);
+        }
+
+
+        void test_invalid_target()
+        {
+            TS_ASSERT_THROWS(TelemetrySink("/nonexistent/dir/telemetry"),
+                    IOError);
+            unlink(filename.c_str());
+            TS_ASSERT_THROWS(TelemetrySink("unix:" + filename), IOError);
+        }
+};  // class TestTelemetrySink
+
+// End of file
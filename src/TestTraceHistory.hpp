@@ -0,0 +1,91 @@
+/***********************************************************************
+* Short Title: unit tests for TraceHistory class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <sstream>
+#include <cxxtest/TestSuite.h>
+
+#include "TraceHistory.hpp"
+
+using namespace std;
+
+class TestTraceHistory : public CxxTest::TestSuite
+{
+    private:
+
+        static TraceId_t traceId(int season, long id)
+        {
+            TraceId_t tid = {season, 2, 3, 0.5, id};
+            return tid;
+        }
+
+    public:
+
+        void test_push_back()
+        {
+            TraceHistory th;
+            TS_ASSERT(th.empty());
+            TS_ASSERT_EQUALS(0u, th.size());
+            TS_ASSERT(th.begin() == th.end());
+            th.push_back(traceId(1, 7));
+            th.push_back(traceId(2, 8));
+            TS_ASSERT(!th.empty());
+            TS_ASSERT_EQUALS(2u, th.size());
+            TS_ASSERT_EQUALS(2, th.back().season);
+            TraceHistory::const_iterator ti = th.begin();
+            TS_ASSERT_EQUALS(8, ti->mol_id);
+            ++ti;
+            TS_ASSERT_EQUALS(7, ti->mol_id);
+            ++ti;
+            TS_ASSERT(ti == th.end());
+            th.clear();
+            TS_ASSERT(th.empty());
+        }
+
+
+        void test_shared_copies()
+        {
+            TraceHistory th0;
+            th0.push_back(traceId(1, 7));
+            TraceHistory th1 = th0;
+            th1.push_back(traceId(2, 8));
+            th0.push_back(traceId(3, 9));
+            TS_ASSERT_EQUALS(2u, th0.size());
+            TS_ASSERT_EQUALS(2u, th1.size());
+            TS_ASSERT_EQUALS(9, th0.back().mol_id);
+            TS_ASSERT_EQUALS(8, th1.back().mol_id);
+            // both copies share the oldest entry
+            TS_ASSERT_EQUALS(&(*(++th0.begin())), &(*(++th1.begin())));
+            th0.clear();
+            TS_ASSERT_EQUALS(7, (++th1.begin())->mol_id);
+        }
+
+
+        void test_long_chain()
+        {
+            TraceHistory th;
+            for (int i = 0; i != 1000000; ++i)  th.push_back(traceId(i, i));
+            TS_ASSERT_EQUALS(1000000u, th.size());
+            // must not overflow the stack
+            th.clear();
+            TS_ASSERT(th.empty());
+        }
+
+
+        void test_write()
+        {
+            TraceHistory th;
+            th.push_back(traceId(1, 7));
+            th.push_back(traceId(2, 8));
+            ostringstream out;
+            th.write(out);
+            TS_ASSERT_EQUALS("TR 1 2 3 0.5 7\nTR 2 2 3 0.5 8\n", out.str());
+        }
+
+};  // class TestTraceHistory
+
+// End of file
@@ -0,0 +1,159 @@
+/***********************************************************************
+* Short Title: unit tests for TrialDistributor classes
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <memory>
+#include <cxxtest/TestSuite.h>
+
+#include "TrialDistributor.hpp"
+
+using namespace std;
+
+// distributor with adjustable base level
+class BaseLevelDistributor : public TrialDistributorEqual
+{
+    public:
+
+        void setBaseLevel(int lv)   { base_level = lv; }
+};
+
+
+class TestTrialDistributor : public CxxTest::TestSuite
+{
+    private:
+
+        BaseLevelDistributor tdist;
+
+        // levels 1 to 4 take a millisecond per trial
+        void timeLevels()
+        {
+            for (int lv = 1; lv != 5; ++lv)
+            {
+                tdist.setLevelTrialTime(lv, 1000.0, 1.0);
+                tdist.tshares[lv] = 100.0;
+            }
+        }
+
+
+        // distributor with equal improvements at levels 2 and 3
+        TrialDistributor* createImproving(TrialDistributor::DistributorType tp)
+        {
+            TrialDistributor* td = TrialDistributor::create(tp);
+            td->resize(6);
+            for (int i = 0; i != 4; ++i)
+            {
+                td->setLevelBadness(2, 1.0 / (i + 1));
+                td->setLevelBadness(3, 1.0 / (i + 1));
+            }
+            return td;
+        }
+
+    public:
+
+        void setUp()
+        {
+            tdist.resize(6);
+            tdist.setBaseLevel(1);
+            tdist.tshares[0] = 7.0;
+        }
+
+
+        void test_estimateSeasonTime()
+        {
+            TS_ASSERT_EQUALS(0.0, tdist.estimateSeasonTime());
+            timeLevels();
+            TS_ASSERT_DELTA(0.4, tdist.estimateSeasonTime(), 1e-12);
+        }
+
+
+        void test_fitSeasonTime()
+        {
+            timeLevels();
+            // enough time keeps all shares
+            TS_ASSERT(tdist.fitSeasonTime(1.0));
+            TS_ASSERT_DELTA(0.4, tdist.estimateSeasonTime(), 1e-12);
+            // levels are cut from the base level up
+            TS_ASSERT(tdist.fitSeasonTime(0.25));
+            TS_ASSERT_EQUALS(7.0, tdist.tshares[0]);
+            TS_ASSERT_EQUALS(0.0, tdist.tshares[1]);
+            TS_ASSERT_DELTA(50.0, tdist.tshares[2], 1e-9);
+            TS_ASSERT_EQUALS(100.0, tdist.tshares[3]);
+            TS_ASSERT_EQUALS(100.0, tdist.tshares[4]);
+            TS_ASSERT_DELTA(0.25, tdist.estimateSeasonTime(), 1e-12);
+        }
+
+
+        void test_fitSeasonTime_zero()
+        {
+            timeLevels();
+            TS_ASSERT(!tdist.fitSeasonTime(0.0));
+            for (int lv = 1; lv != 5; ++lv)
+            {
+                TS_ASSERT_EQUALS(0.0, tdist.tshares[lv]);
+            }
+            TS_ASSERT_EQUALS(7.0, tdist.tshares[0]);
+            timeLevels();
+            TS_ASSERT(!tdist.fitSeasonTime(-1.0));
+            TS_ASSERT_EQUALS(0.0, tdist.estimateSeasonTime());
+        }
+
+
+        void test_fitSeasonTime_untimed()
+        {
+            // levels without trial time cost no seconds and keep shares
+            for (int lv = 1; lv != 5; ++lv)     tdist.tshares[lv] = 100.0;
+            TS_ASSERT(tdist.fitSeasonTime(0.0));
+            for (int lv = 1; lv != 5; ++lv)
+            {
+                TS_ASSERT_EQUALS(100.0, tdist.tshares[lv]);
+            }
+            // levels with trials but zero seconds take the average time
+            tdist.setLevelTrialTime(3, 1000.0, 0.0);
+            tdist.setLevelTrialTime(4, 1000.0, 2.0);
+            TS_ASSERT_DELTA(0.5, tdist.estimateSeasonTime(), 1e-12);
+            TS_ASSERT(tdist.fitSeasonTime(0.35));
+            TS_ASSERT_DELTA(50.0, tdist.tshares[2], 1e-9);
+            TS_ASSERT_EQUALS(0.0, tdist.tshares[1]);
+        }
+
+
+        void test_share_efficiency()
+        {
+            auto_ptr<TrialDistributor> success(
+                    createImproving(TrialDistributor::SUCCESS));
+            auto_ptr<TrialDistributor> efficiency(
+                    createImproving(TrialDistributor::EFFICIENCY));
+            // without timing data both distributors agree
+            success->share(1000);
+            efficiency->share(1000);
+            for (int lv = 0; lv != 6; ++lv)
+            {
+                TS_ASSERT_DELTA(success->tshares[lv],
+                        efficiency->tshares[lv], 1e-9);
+            }
+            // level 1 is cheap and level 3 expensive, both get
+            // half of the level 3 improvement rate
+            for (int lv = 0; lv != 5; ++lv)
+            {
+                double seconds = (lv == 1) ? 0.5 : (lv == 3) ? 2.0 : 1.0;
+                success->setLevelTrialTime(lv, 1000.0, seconds);
+                efficiency->setLevelTrialTime(lv, 1000.0, seconds);
+            }
+            success->share(1000);
+            efficiency->share(1000);
+            TS_ASSERT(success->tshares[1] < success->tshares[3]);
+            TS_ASSERT(efficiency->tshares[1] > efficiency->tshares[3]);
+            TS_ASSERT(efficiency->tshares[1] > success->tshares[1]);
+            TS_ASSERT(efficiency->tshares[3] < success->tshares[3]);
+            TS_ASSERT(efficiency->tshares[2] > efficiency->tshares[0]);
+            TS_ASSERT(efficiency->tshares[2] > efficiency->tshares[4]);
+            TS_ASSERT_EQUALS(0.0, efficiency->tshares[5]);
+            TS_ASSERT_DELTA(1000.0, efficiency->tshares.sum(), 1e-9);
+        }
+};  // class TestTrialDistributor
+
+// End of file
@@ -0,0 +1,92 @@
+/***********************************************************************
+* Short Title: unit tests for UsageMask class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <stdexcept>
+#include <cxxtest/TestSuite.h>
+
+#include "UsageMask.hpp"
+
+using namespace std;
+
+class TestUsageMask : public CxxTest::TestSuite
+{
+    private:
+
+        UsageMask mask;
+
+    public:
+
+        void setUp()
+        {
+            mask.resize(150);
+        }
+
+
+        void test_setUsed()
+        {
+            TS_ASSERT_EQUALS(150u, mask.countFree());
+            mask.setUsed(3);
+            mask.setUsed(64);
+            TS_ASSERT(mask.isUsed(64));
+            TS_ASSERT(!mask.isUsed(65));
+            TS_ASSERT_EQUALS(2u, mask.countUsed());
+            mask.setFree(3);
+            TS_ASSERT(!mask.isUsed(3));
+            TS_ASSERT_EQUALS(149u, mask.countFree());
+            mask.clear();
+            TS_ASSERT_EQUALS(0u, mask.countUsed());
+            TS_ASSERT(!mask.isUsed(64));
+        }
+
+
+        void test_index_range()
+        {
+            mask.setUsed(149);
+            TS_ASSERT_THROWS(mask.isUsed(150), out_of_range);
+            TS_ASSERT_THROWS(mask.setUsed(150), out_of_range);
+            TS_ASSERT_THROWS(mask.setFree(size_t(-1)), out_of_range);
+            TS_ASSERT_EQUALS(1u, mask.countUsed());
+            UsageMask empty;
+            TS_ASSERT_THROWS(empty.isUsed(0), out_of_range);
+        }
+
+
+        void test_nextFree()
+        {
+            for (int i = 10; i < 140; ++i)  mask.setUsed(i);
+            TS_ASSERT_EQUALS(5u, mask.nextFree(5));
+            TS_ASSERT_EQUALS(140u, mask.nextFree(10));
+            TS_ASSERT_EQUALS(140u, mask.nextFree(63));
+            TS_ASSERT_EQUALS(9, mask.prevFree(139));
+            TS_ASSERT_EQUALS(9, mask.prevFree(64));
+            TS_ASSERT_EQUALS(140, mask.prevFree(140));
+            TS_ASSERT_EQUALS(10u, mask.nextUsed(0));
+            TS_ASSERT_EQUALS(150u, mask.nextUsed(140));
+            for (int i = 140; i < 150; ++i)  mask.setUsed(i);
+            TS_ASSERT_EQUALS(150u, mask.nextFree(10));
+            for (int i = 0; i < 10; ++i)  mask.setUsed(i);
+            TS_ASSERT_EQUALS(-1, mask.prevFree(149));
+        }
+
+
+        void test_selectFree()
+        {
+            for (int i = 0; i < 100; ++i)  mask.setUsed(i);
+            mask.setUsed(120);
+            TS_ASSERT_EQUALS(100u, mask.selectFree(0));
+            TS_ASSERT_EQUALS(119u, mask.selectFree(19));
+            TS_ASSERT_EQUALS(121u, mask.selectFree(20));
+            TS_ASSERT_EQUALS(149u, mask.selectFree(48));
+            TS_ASSERT_THROWS(mask.selectFree(49), out_of_range);
+            mask.clear();
+            TS_ASSERT_EQUALS(7u, mask.selectFree(7));
+        }
+
+};  // class TestUsageMask
+
+// End of file
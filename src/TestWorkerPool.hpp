@@ -0,0 +1,139 @@
+/***********************************************************************
+* Short Title: unit tests for WorkerPool class
+*
+* Comments:
+*
+* <license text>
+***********************************************************************/
+
+#include <stdexcept>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <cxxtest/TestSuite.h>
+
+#include "Exceptions.hpp"
+#include "WorkerPool.hpp"
+
+using namespace std;
+
+class TestWorkerPool : public CxxTest::TestSuite
+{
+    private:
+
+        vector<int> workers;
+        vector<boost::thread::id> threads;
+
+    public:
+
+        void noteWorker(size_t task)
+        {
+            workers[task] = WorkerPool::workerIndex();
+        }
+
+
+        void failTask(size_t task)
+        {
+            if (task == 5)  throw invalid_argument("task 5 failed");
+            workers[task] = WorkerPool::workerIndex();
+        }
+
+
+        void failMolecule(size_t task)
+        {
+            if (task == 3)  throw InvalidMolecule("task 3 failed");
+        }
+
+
+        void noteThread(size_t task)
+        {
+            threads[task] = boost::this_thread::get_id();
+        }
+
+
+        void test_execute()
+        {
+            WorkerPool pool(3);
+            workers.assign(10, -2);
+            WorkerPool::MethodJob<TestWorkerPool>
+                job(this, &TestWorkerPool::noteWorker);
+            pool.execute(job, 10);
+            for (size_t task = 0; task != workers.size(); ++task)
+            {
+                TS_ASSERT(0 <= workers[task] && workers[task] < 3);
+            }
+            TS_ASSERT_EQUALS(-1, WorkerPool::workerIndex());
+        }
+
+
+        void test_executeBlocks()
+        {
+            WorkerPool pool(3);
+            pool.setNodeAffinity(true);
+            WorkerPool::MethodJob<TestWorkerPool>
+                job(this, &TestWorkerPool::noteWorker);
+            size_t ntasks[3] = {10, 3, 2};
+            for (int i = 0; i != 3; ++i)
+            {
+                size_t n = ntasks[i];
+                workers.assign(n, -2);
+                pool.executeBlocks(job, n);
+                for (size_t task = 0; task != n; ++task)
+                {
+                    TS_ASSERT_EQUALS(pool.blockWorker(task, n), workers[task]);
+                    // blocks are contiguous
+                    if (task)   TS_ASSERT(workers[task - 1] <= workers[task]);
+                }
+            }
+            TS_ASSERT_EQUALS(0, workers[0]);
+            TS_ASSERT_EQUALS(1, workers[1]);
+        }
+
+
+        void test_failure()
+        {
+            WorkerPool pool(3);
+            WorkerPool::MethodJob<TestWorkerPool>
+                failjob(this, &TestWorkerPool::failTask);
+            workers.assign(10, -2);
+            TS_ASSERT_THROWS(pool.execute(failjob, 10), invalid_argument);
+            TS_ASSERT_EQUALS(-2, workers[5]);
+            workers.assign(10, -2);
+            TS_ASSERT_THROWS(pool.executeBlocks(failjob, 10),
+                    invalid_argument);
+            // LIGA exceptions keep their type
+            WorkerPool::MethodJob<TestWorkerPool>
+                molecjob(this, &TestWorkerPool::failMolecule);
+            TS_ASSERT_THROWS(pool.execute(molecjob, 10), InvalidMolecule);
+            // the pool is usable after a failure
+            WorkerPool::MethodJob<TestWorkerPool>
+                job(this, &TestWorkerPool::noteWorker);
+            workers.assign(10, -2);
+            pool.execute(job, 10);
+            for (size_t task = 0; task != workers.size(); ++task)
+            {
+                TS_ASSERT(0 <= workers[task] && workers[task] < 3);
+            }
+        }
+
+
+        void test_persistent_workers()
+        {
+            WorkerPool pool(3);
+            WorkerPool::MethodJob<TestWorkerPool>
+                job(this, &TestWorkerPool::noteThread);
+            threads.assign(3, boost::thread::id());
+            pool.executeBlocks(job, 3);
+            vector<boost::thread::id> threads0 = threads;
+            // the same threads run every job
+            for (int i = 0; i != 5; ++i)
+            {
+                threads.assign(3, boost::thread::id());
+                pool.executeBlocks(job, 3);
+                TS_ASSERT(threads0 == threads);
+            }
+            TS_ASSERT(threads0[0] != threads0[1]);
+            TS_ASSERT(threads0[0] != boost::this_thread::get_id());
+        }
+};  // class TestWorkerPool
+
+// End of file
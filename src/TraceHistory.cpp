@@ -0,0 +1,109 @@
+/***********************************************************************
+* Short Title: persistent history of trace points of a Liga competitor
+*
+* Comments: implementation of TraceHistory
+*
+* <license text>
+***********************************************************************/
+
+#include <cassert>
+#include <ostream>
+#include <vector>
+
+#include "TraceHistory.hpp"
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////
+// class TraceHistory::Node
+//////////////////////////////////////////////////////////////////////////////
+
+// Release older nodes in a loop, recursive destruction of a long chain
+// could overflow the stack.
+
+TraceHistory::Node::~Node()
+{
+    boost::shared_ptr<const Node> nd;
+    nd.swap(this->previous);
+    while (nd.unique())
+    {
+        boost::shared_ptr<const Node> older;
+        older.swap(const_cast<Node&>(*nd).previous);
+        nd.swap(older);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// class TraceHistory
+//////////////////////////////////////////////////////////////////////////////
+
+// Public Methods ------------------------------------------------------------
+
+void TraceHistory::push_back(const TraceId_t& tid)
+{
+    Node* nd = new Node;
+    nd->tid = tid;
+    nd->count = this->size() + 1;
+    nd->previous = this->last;
+    this->last.reset(nd);
+}
+
+
+void TraceHistory::clear()
+{
+    this->last.reset();
+}
+
+
+bool TraceHistory::empty() const
+{
+    return !this->last;
+}
+
+
+size_t TraceHistory::size() const
+{
+    return this->last ? this->last->count : 0;
+}
+
+
+const TraceId_t& TraceHistory::back() const
+{
+    assert(!this->empty());
+    return this->last->tid;
+}
+
+
+TraceHistory::const_iterator TraceHistory::begin() const
+{
+    return const_iterator(this->last.get());
+}
+
+
+TraceHistory::const_iterator TraceHistory::end() const
+{
+    return const_iterator();
+}
+
+
+void TraceHistory::write(ostream& out) const
+{
+    vector<const TraceId_t*> entries;
+    entries.reserve(this->size());
+    for (const_iterator ti = this->begin(); ti != this->end(); ++ti)
+    {
+        entries.push_back(&(*ti));
+    }
+    vector<const TraceId_t*>::reverse_iterator tii = entries.rbegin();
+    for (; tii != entries.rend(); ++tii)
+    {
+        const TraceId_t& tid = **tii;
+        out << "TR " << tid.season <<
+            ' ' << tid.level <<
+            ' ' << tid.mol_natoms <<
+            ' ' << tid.mol_norm_badness <<
+            ' ' << tid.mol_id << '\n';
+    }
+}
+
+// End of file
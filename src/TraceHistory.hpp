@@ -0,0 +1,81 @@
+/***********************************************************************
+* Short Title: persistent history of trace points of a Liga competitor
+*
+* Comments: TraceHistory is an immutable chain of reference counted
+*     TraceId_t nodes linked from the newest to the oldest entry.
+*     Copies share all their nodes, so that copying a molecule with
+*     a long trace takes constant time.  An appended entry creates
+*     a new node which points to the unchanged older ones.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef TRACEHISTORY_HPP_INCLUDED
+#define TRACEHISTORY_HPP_INCLUDED
+
+#include <iosfwd>
+#include <boost/shared_ptr.hpp>
+
+#include "TraceId_t.hpp"
+
+class TraceHistory
+{
+    private:
+
+        // types
+        struct Node
+        {
+            TraceId_t tid;
+            size_t count;
+            boost::shared_ptr<const Node> previous;
+            ~Node();
+        };
+
+    public:
+
+        // iterator from the newest to the oldest entry
+        class const_iterator
+        {
+            public:
+
+                const_iterator(const Node* nd=NULL) : node(nd)  { }
+                const TraceId_t& operator*() const  { return node->tid; }
+                const TraceId_t* operator->() const { return &(node->tid); }
+                const_iterator& operator++()
+                {
+                    node = node->previous.get();
+                    return *this;
+                }
+                bool operator==(const const_iterator& other) const
+                {
+                    return node == other.node;
+                }
+                bool operator!=(const const_iterator& other) const
+                {
+                    return node != other.node;
+                }
+
+            private:
+
+                const Node* node;
+        };
+
+        // methods
+        void push_back(const TraceId_t& tid);
+        void clear();
+        bool empty() const;
+        size_t size() const;
+        const TraceId_t& back() const;
+        const_iterator begin() const;
+        const_iterator end() const;
+        // write one "TR season level natoms cost id" line per entry
+        // from the oldest to the newest
+        void write(std::ostream& out) const;
+
+    private:
+
+        // data
+        boost::shared_ptr<const Node> last;
+};
+
+#endif  // TRACEHISTORY_HPP_INCLUDED
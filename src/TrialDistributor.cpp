@@ -8,6 +8,7 @@
 
 #include "TrialDistributor.hpp"
 #include "RunPar_t.hpp"
+#include "LigaUtils.hpp"
 
 using namespace std;
 
@@ -45,6 +46,7 @@ TrialDistributor* TrialDistributor::create(DistributorType tp)
         case EQUAL:     return new TrialDistributorEqual();
         case SIZE:      return new TrialDistributorSize();
         case SUCCESS:   return new TrialDistributorSuccess();
+        case EFFICIENCY:    return new TrialDistributorEfficiency();
         default:
             ostringstream emsg;
             emsg << "Unhandled value of DistributorType " << tp;
@@ -89,18 +91,178 @@ void TrialDistributor::setLevelFillRate(size_t lv, double fr)
     fillrate[lv] = fr;
 }
 
+void TrialDistributor::setLevelTrialTime(size_t lv, double trials,
+        double seconds)
+{
+    if (!(trials > 0.0))    return;
+    // older seasons fade out over about histsize samples
+    const double decay = 1.0 - 1.0 / histsize;
+    trialcount[lv] = decay * trialcount[lv] + trials;
+    trialtime[lv] = decay * trialtime[lv] + seconds;
+}
+
 void TrialDistributor::resize(size_t sz)
 {
     // clear history at every level
     lvbadlog.clear();
     lvbadlog.resize(sz);
     fillrate.resize(sz, 0.0);
+    trialcount.clear();
+    trialcount.resize(sz, 0.0);
+    trialtime.clear();
+    trialtime.resize(sz, 0.0);
     tshares.resize(sz, 0.0);
     top_level = sz - 1;
 }
 
+void TrialDistributor::writeCheckpoint(ostream& out) const
+{
+    write_binary(out, lvbadlog.size());
+    deque<BadnessHistory>::const_iterator hii;
+    for (hii = lvbadlog.begin(); hii != lvbadlog.end(); ++hii)
+    {
+        write_binary(out, hii->size());
+        BadnessHistory::const_iterator bii;
+        for (bii = hii->begin(); bii != hii->end(); ++bii)
+        {
+            write_binary(out, *bii);
+        }
+    }
+    deque<double>::const_iterator fii;
+    for (fii = fillrate.begin(); fii != fillrate.end(); ++fii)
+    {
+        write_binary(out, *fii);
+    }
+    for (size_t lv = 0; lv != trialcount.size(); ++lv)
+    {
+        write_binary(out, trialcount[lv]);
+        write_binary(out, trialtime[lv]);
+    }
+    write_binary(out, base_level);
+    write_binary(out, top_level);
+}
+
+bool TrialDistributor::readCheckpoint(istream& in)
+{
+    size_t sz;
+    if (!read_binary(in, sz) || sz != size())   return false;
+    deque<BadnessHistory>::iterator hii;
+    for (hii = lvbadlog.begin(); hii != lvbadlog.end(); ++hii)
+    {
+        size_t hsz;
+        if (!read_binary(in, hsz) || hsz > histsize)    return false;
+        hii->resize(hsz);
+        BadnessHistory::iterator bii;
+        for (bii = hii->begin(); bii != hii->end(); ++bii)
+        {
+            if (!read_binary(in, *bii))     return false;
+        }
+    }
+    deque<double>::iterator fii;
+    for (fii = fillrate.begin(); fii != fillrate.end(); ++fii)
+    {
+        if (!read_binary(in, *fii))     return false;
+    }
+    for (size_t lv = 0; lv != trialcount.size(); ++lv)
+    {
+        bool isread = read_binary(in, trialcount[lv]) &&
+            read_binary(in, trialtime[lv]);
+        if (!isread)    return false;
+    }
+    return read_binary(in, base_level) && read_binary(in, top_level);
+}
+
+double TrialDistributor::estimateSeasonTime() const
+{
+    valarray<double> secs = trialSeconds();
+    return (secs * tshares).sum();
+}
+
+bool TrialDistributor::fitSeasonTime(double seconds)
+{
+    valarray<double> secs = trialSeconds();
+    // structures started at the lowest levels would not grow to the top
+    // before the deadline, so these levels give up their trials first
+    double left = max(0.0, seconds);
+    for (int lv = top_level - 1; lv >= base_level; --lv)
+    {
+        double lvtime = tshares[lv] * secs[lv];
+        if (lvtime <= left)
+        {
+            left -= lvtime;
+            continue;
+        }
+        tshares[lv] = left / secs[lv];
+        left = 0.0;
+    }
+    for (int lv = base_level; lv < top_level; ++lv)
+    {
+        if (tshares[lv] > 0.0)  return true;
+    }
+    return false;
+}
+
 // protected methods
 
+valarray<double> TrialDistributor::successWeights()
+{
+    // calculate improvement ratio at each level
+    valarray<double> scwt(0.0, size());
+    for (int lv = base_level; lv <= top_level; ++lv)
+    {
+        BadnessHistory& hist = lvbadlog[lv];
+        double tothwt = 0.0;
+        int hwt = histsize - 1;
+        for (int i = hist.size() - 1;  i > 0 && hwt > 0.0;  --i, --hwt)
+        {
+            double improvement = (hist[i] < hist[i-1]) ?
+                (hist[i-1] - hist[i])/tolcost : 0;
+            scwt[lv] += hwt * improvement;
+            tothwt += hwt;
+        }
+        if (tothwt > 0.0)   scwt[lv] /= tothwt;
+    }
+    // split half of success weight to the levels below
+    // for the last level move all success weitht to the former level
+    for (int lo = 0, hi = 1; hi <= top_level; ++lo, ++hi)
+    {
+        double scshift = (hi < top_level) ? scwt[hi]/2 : scwt[hi];
+        scwt[lo] += scshift;
+        scwt[hi] -= scshift;
+    }
+    return scwt;
+}
+
+valarray<double> TrialDistributor::sizeWeights()
+{
+    valarray<double> szwt(0.0, size());
+    for (int lv = base_level; lv < top_level; ++lv)     szwt[lv] = lv;
+    szwt /= szwt.sum();
+    return szwt;
+}
+
+valarray<double> TrialDistributor::trialSeconds() const
+{
+    // wall time per trial at each level, levels without timing data
+    // are assumed to be average
+    valarray<double> secs(0.0, lvbadlog.size());
+    double totcount = 0.0;
+    double tottime = 0.0;
+    for (int lv = base_level; lv < top_level; ++lv)
+    {
+        totcount += trialcount[lv];
+        tottime += trialtime[lv];
+    }
+    if (!(totcount > 0.0 && tottime > 0.0))     return secs;
+    double avgcost = tottime / totcount;
+    for (int lv = base_level; lv < top_level; ++lv)
+    {
+        bool timed = trialcount[lv] > 0.0 && trialtime[lv] > 0.0;
+        secs[lv] = timed ? trialtime[lv] / trialcount[lv] : avgcost;
+    }
+    return secs;
+}
+
 // private class methods
 
 map<string,TrialDistributor::DistributorType>&
@@ -148,37 +310,42 @@ void TrialDistributorSuccess::share(int seasontrials)
 {
     tshares = 0.0;
     if (base_level >= top_level)    return;
-    // calculate improvement ratio at each level
-    valarray<double> scwt(0.0, size());
-    for (int lv = base_level; lv <= top_level; ++lv)
+    // average success and size shares
+    tshares = successWeights() + sizeWeights();
+    tshares[top_level] = 0.0;
+    tshares *= seasontrials/tshares.sum();
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// class TrialDistributorEfficiency
+////////////////////////////////////////////////////////////////////////
+
+void TrialDistributorEfficiency::share(int seasontrials)
+{
+    tshares = 0.0;
+    if (base_level >= top_level)    return;
+    // wall time per trial relative to the average of timed levels,
+    // levels without timing data are assumed to be average
+    valarray<double> relcost(1.0, size());
+    double totcount = 0.0;
+    double tottime = 0.0;
+    for (int lv = base_level; lv < top_level; ++lv)
     {
-        BadnessHistory& hist = lvbadlog[lv];
-        double tothwt = 0.0;
-        int hwt = histsize - 1;
-        for (int i = hist.size() - 1;  i > 0 && hwt > 0.0;  --i, --hwt)
-        {
-            double improvement = (hist[i] < hist[i-1]) ?
-                (hist[i-1] - hist[i])/tolcost : 0;
-            scwt[lv] += hwt * improvement;
-            tothwt += hwt;
-        }
-        if (tothwt > 0.0)   scwt[lv] /= tothwt;
+        totcount += trialcount[lv];
+        tottime += trialtime[lv];
     }
-    // split half of success weight to the levels below
-    // for the last level move all success weitht to the former level
-    for (int lo = 0, hi = 1; hi <= top_level; ++lo, ++hi)
+    if (totcount > 0.0 && tottime > 0.0)
     {
-        double scshift = (hi < top_level) ? scwt[hi]/2 : scwt[hi];
-        scwt[lo] += scshift;
-        scwt[hi] -= scshift;
+        double avgcost = tottime / totcount;
+        for (int lv = base_level; lv < top_level; ++lv)
+        {
+            if (!(trialcount[lv] > 0.0 && trialtime[lv] > 0.0))  continue;
+            relcost[lv] = trialtime[lv] / trialcount[lv] / avgcost;
+        }
     }
-    // calculate tshares
-    // get size share weights
-    valarray<double> szwt(0.0, size());
-    for (int lv = base_level; lv < top_level; ++lv)     szwt[lv] = lv;
-    szwt /= szwt.sum();
-    // average success and size shares
-    tshares = scwt + szwt;
+    // success weight per time unit, size shares keep the growth going
+    tshares = successWeights() / relcost + sizeWeights();
     tshares[top_level] = 0.0;
     tshares *= seasontrials/tshares.sum();
 }
@@ -193,6 +360,7 @@ namespace {
 bool regTrialDistributorEqual = TrialDistributorEqual().Register();
 bool regTrialDistributorSize = TrialDistributorSize().Register();
 bool regTrialDistributorSuccess = TrialDistributorSuccess().Register();
+bool regTrialDistributorEfficiency = TrialDistributorEfficiency().Register();
 
 }   // namespace
 
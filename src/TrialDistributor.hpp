@@ -23,7 +23,7 @@ class TrialDistributor
 {
     public:
 
-        enum DistributorType { EQUAL, SIZE, SUCCESS };
+        enum DistributorType { EQUAL, SIZE, SUCCESS, EFFICIENCY };
 
         // class methods
         static TrialDistributor* create(RunPar_t* rp);
@@ -35,6 +35,8 @@ class TrialDistributor
         TrialDistributor()
         {
             tolcost = 1.0e-8;
+            base_level = 0;
+            top_level = -1;
         }
         // destructor
         virtual ~TrialDistributor() { }
@@ -50,9 +52,17 @@ class TrialDistributor
         // methods
         void setLevelBadness(size_t lv, double bd);
         void setLevelFillRate(size_t lv, double fr);
+        void setLevelTrialTime(size_t lv, double trials, double seconds);
         void resize(size_t sz);
+        void writeCheckpoint(std::ostream& out) const;
+        bool readCheckpoint(std::istream& in);
         inline size_t size()    { return lvbadlog.size(); }
         virtual void share(int seasontrials) = 0;
+        // wall time of the trials in tshares, 0 when levels are not timed
+        double estimateSeasonTime() const;
+        // cut tshares to the specified wall time from the lowest levels,
+        // return false when no trials are left for the season
+        bool fitSeasonTime(double seconds);
 
     protected:
 
@@ -65,11 +75,17 @@ class TrialDistributor
         // data members
         std::deque<BadnessHistory> lvbadlog;
         std::deque<double> fillrate;
+        // decaying sums of trials and their wall time at each level
+        std::deque<double> trialcount;
+        std::deque<double> trialtime;
         int base_level;
         int top_level;
         double tolcost;
 
         // protected methods
+        std::valarray<double> successWeights();
+        std::valarray<double> sizeWeights();
+        std::valarray<double> trialSeconds() const;
 
     private:
 
@@ -127,4 +143,20 @@ class TrialDistributorSuccess : public TrialDistributor
 };  // class TrialDistributorSuccess
 
 
+class TrialDistributorEfficiency : public TrialDistributor
+{
+    public:
+
+        // constructor and destructor
+        TrialDistributorEfficiency() : TrialDistributor() { }
+        virtual ~TrialDistributorEfficiency() { }
+
+        // methods
+        virtual DistributorType type()  { return EFFICIENCY; }
+        virtual std::string typeStr()   { return "efficiency"; }
+        virtual void share(int seasontrials);
+
+};  // class TrialDistributorEfficiency
+
+
 #endif  // TRIALDISTRIBUTOR_HPP_INCLUDED
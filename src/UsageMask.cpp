@@ -0,0 +1,177 @@
+/***********************************************************************
+* Short Title: bitmap of used entries in a fixed-size table
+*
+* Comments: UsageMask marks entries of an immutable sorted table as
+*     used, so that the table itself does not have to shrink.  Free
+*     entries are located by scanning 64-bit words of the bitmap.
+*
+* <license text>
+***********************************************************************/
+
+#include <cassert>
+#include <stdexcept>
+
+#include "UsageMask.hpp"
+
+using namespace std;
+using boost::uint64_t;
+
+namespace {
+
+const int WORD_BITS = 64;
+const uint64_t ONE = 1;
+
+inline size_t wordIndex(size_t idx)
+{
+    return idx / WORD_BITS;
+}
+
+inline uint64_t bitMask(size_t idx)
+{
+    return ONE << (idx % WORD_BITS);
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class UsageMask
+//////////////////////////////////////////////////////////////////////////////
+
+// Constructor ---------------------------------------------------------------
+
+UsageMask::UsageMask(size_t sz) : msize(0), mcount_used(0)
+{
+    this->resize(sz);
+}
+
+// Public Methods ------------------------------------------------------------
+
+size_t UsageMask::size() const
+{
+    return msize;
+}
+
+
+void UsageMask::resize(size_t sz)
+{
+    msize = sz;
+    mwords.assign((sz + WORD_BITS - 1) / WORD_BITS, 0);
+    mcount_used = 0;
+}
+
+
+void UsageMask::clear()
+{
+    if (mcount_used == 0)   return;
+    mwords.assign(mwords.size(), 0);
+    mcount_used = 0;
+}
+
+
+size_t UsageMask::countUsed() const
+{
+    return mcount_used;
+}
+
+
+size_t UsageMask::countFree() const
+{
+    return msize - mcount_used;
+}
+
+
+bool UsageMask::isUsed(size_t idx) const
+{
+    this->checkIndex(idx);
+    return mwords[wordIndex(idx)] & bitMask(idx);
+}
+
+
+void UsageMask::setUsed(size_t idx)
+{
+    this->checkIndex(idx);
+    assert(!this->isUsed(idx));
+    mwords[wordIndex(idx)] |= bitMask(idx);
+    ++mcount_used;
+}
+
+
+void UsageMask::setFree(size_t idx)
+{
+    this->checkIndex(idx);
+    assert(this->isUsed(idx));
+    mwords[wordIndex(idx)] &= ~bitMask(idx);
+    --mcount_used;
+}
+
+
+size_t UsageMask::nextFree(size_t idx) const
+{
+    if (idx >= msize)   return msize;
+    if (mcount_used == 0)   return idx;
+    size_t w = wordIndex(idx);
+    // free bits in the first word at or above idx
+    uint64_t fbits = ~mwords[w] & ~(bitMask(idx) - 1);
+    while (!fbits && ++w < mwords.size())  fbits = ~mwords[w];
+    if (!fbits)     return msize;
+    size_t rv = w * WORD_BITS + __builtin_ctzll(fbits);
+    return (rv < msize) ? rv : msize;
+}
+
+
+int UsageMask::prevFree(int idx) const
+{
+    if (idx < 0)    return -1;
+    assert(size_t(idx) < msize);
+    if (mcount_used == 0)   return idx;
+    int w = wordIndex(idx);
+    // free bits in the first word at or below idx
+    uint64_t below = (bitMask(idx) << 1) - 1;
+    uint64_t fbits = ~mwords[w] & below;
+    while (!fbits && --w >= 0)  fbits = ~mwords[w];
+    if (!fbits)     return -1;
+    return w * WORD_BITS + (WORD_BITS - 1 - __builtin_clzll(fbits));
+}
+
+
+size_t UsageMask::nextUsed(size_t idx) const
+{
+    if (idx >= msize || mcount_used == 0)   return msize;
+    size_t w = wordIndex(idx);
+    uint64_t ubits = mwords[w] & ~(bitMask(idx) - 1);
+    while (!ubits && ++w < mwords.size())  ubits = mwords[w];
+    if (!ubits)     return msize;
+    return w * WORD_BITS + __builtin_ctzll(ubits);
+}
+
+
+size_t UsageMask::selectFree(size_t k) const
+{
+    if (k >= this->countFree())
+    {
+        const char* emsg = "UsageMask index of free entry out of range.";
+        throw out_of_range(emsg);
+    }
+    if (mcount_used == 0)   return k;
+    size_t w = 0;
+    uint64_t fbits = ~mwords[w];
+    for (size_t nfree; k >= (nfree = __builtin_popcountll(fbits));)
+    {
+        k -= nfree;
+        fbits = ~mwords[++w];
+    }
+    // drop the k lowest free bits
+    for (; k > 0; --k)  fbits &= fbits - 1;
+    return w * WORD_BITS + __builtin_ctzll(fbits);
+}
+
+// Private Methods -----------------------------------------------------------
+
+void UsageMask::checkIndex(size_t idx) const
+{
+    if (idx < msize)    return;
+    const char* emsg = "UsageMask index out of range.";
+    throw out_of_range(emsg);
+}
+
+// End of file
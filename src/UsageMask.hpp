@@ -0,0 +1,53 @@
+/***********************************************************************
+* Short Title: bitmap of used entries in a fixed-size table
+*
+* Comments: UsageMask marks entries of an immutable sorted table as
+*     used, so that the table itself does not have to shrink.  Free
+*     entries are located by scanning 64-bit words of the bitmap.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef USAGEMASK_HPP_INCLUDED
+#define USAGEMASK_HPP_INCLUDED
+
+#include <vector>
+#include <boost/cstdint.hpp>
+
+class UsageMask
+{
+    public:
+
+        // constructor
+        UsageMask(size_t sz=0);
+
+        // methods
+        size_t size() const;
+        void resize(size_t sz);
+        void clear();
+        size_t countUsed() const;
+        size_t countFree() const;
+        bool isUsed(size_t idx) const;
+        void setUsed(size_t idx);
+        void setFree(size_t idx);
+        // first free entry at or after idx, size() when none
+        size_t nextFree(size_t idx) const;
+        // last free entry at or before idx, -1 when none
+        int prevFree(int idx) const;
+        // first used entry at or after idx, size() when none
+        size_t nextUsed(size_t idx) const;
+        // index of the k-th free entry
+        size_t selectFree(size_t k) const;
+
+    private:
+
+        // data
+        std::vector<boost::uint64_t> mwords;
+        size_t msize;
+        size_t mcount_used;
+
+        // methods
+        void checkIndex(size_t idx) const;
+};
+
+#endif  // USAGEMASK_HPP_INCLUDED
@@ -0,0 +1,351 @@
+/***********************************************************************
+* Short Title: pool of worker threads for concurrent LIGA tasks
+*
+* Comments: WorkerPool runs a Job for a range of task indices with
+*     several persistent threads and waits until all tasks are done.
+*
+* <license text>
+***********************************************************************/
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <sched.h>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "WorkerPool.hpp"
+#include "Counter.hpp"
+#include "Exceptions.hpp"
+#include "SectionTimer.hpp"
+
+using namespace std;
+
+namespace {
+
+__thread bool is_worker_thread = false;
+__thread int worker_index = -1;
+
+// parse CPU list such as "0-3,8-11", return false when invalid
+
+bool parseCPUList(const string& s, vector<int>& cpus)
+{
+    cpus.clear();
+    istringstream words(s);
+    string w;
+    while (getline(words, w, ','))
+    {
+        int lo, hi;
+        char dash;
+        istringstream range(w);
+        if (!(range >> lo))     return false;
+        hi = lo;
+        if (range >> dash && (dash != '-' || !(range >> hi)))   return false;
+        for (int c = lo; c <= hi; ++c)  cpus.push_back(c);
+    }
+    return !cpus.empty();
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// class WorkerPool::Failure
+//////////////////////////////////////////////////////////////////////////////
+
+class WorkerPool::Failure
+{
+    public:
+
+        virtual ~Failure() { }
+        virtual void rethrow() const = 0;
+};
+
+
+template <class E>
+class WorkerPool::TypedFailure : public WorkerPool::Failure
+{
+    public:
+
+        TypedFailure(const E& e) : _exception(e)  { }
+        void rethrow() const    { throw _exception; }
+
+    private:
+
+        E _exception;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// class WorkerPool
+//////////////////////////////////////////////////////////////////////////////
+
+// class methods
+
+bool WorkerPool::isWorkerThread()
+{
+    return is_worker_thread;
+}
+
+
+int WorkerPool::workerIndex()
+{
+    return worker_index;
+}
+
+
+vector< vector<int> > WorkerPool::numaNodeCPUs()
+{
+    vector< vector<int> > rv;
+    vector<int> cpus;
+    for (int node = 0; true; ++node)
+    {
+        char path[64];
+        snprintf(path, sizeof(path),
+                "/sys/devices/system/node/node%i/cpulist", node);
+        ifstream fid(path);
+        string line;
+        if (!getline(fid, line) || !parseCPUList(line, cpus))   break;
+        rv.push_back(cpus);
+    }
+    return rv;
+}
+
+// constructor
+
+WorkerPool::WorkerPool(int nthreads) : _nthreads(nthreads),
+    _job(NULL), _ntasks(0), _next_task(0), _blocks(false),
+    _node_affinity(false), _timer_parent(NULL), _generation(0),
+    _nactive(0), _stopped(false)
+{
+    if (nthreads < 1)
+    {
+        const char* emsg = "WorkerPool requires at least one thread.";
+        throw invalid_argument(emsg);
+    }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+    {
+        boost::mutex::scoped_lock lock(_lock);
+        _stopped = true;
+    }
+    _job_ready.notify_all();
+    _threads.join_all();
+}
+
+// public methods
+
+int WorkerPool::size() const
+{
+    return _nthreads;
+}
+
+
+void WorkerPool::execute(Job& job, size_t ntasks)
+{
+    this->launch(job, ntasks, false);
+}
+
+
+void WorkerPool::executeBlocks(Job& job, size_t ntasks)
+{
+    this->launch(job, ntasks, true);
+}
+
+
+int WorkerPool::blockWorker(size_t task, size_t ntasks) const
+{
+    assert(task < ntasks);
+    size_t nworkers = min(size_t(_nthreads), ntasks);
+    // the first task of block i is i * ntasks / nworkers
+    int rv = ((task + 1) * nworkers - 1) / ntasks;
+    return rv;
+}
+
+
+void WorkerPool::setNodeAffinity(bool flag)
+{
+    _node_affinity = flag;
+    _node_cpus.clear();
+    if (_node_affinity)     _node_cpus = WorkerPool::numaNodeCPUs();
+}
+
+// private methods
+
+void WorkerPool::launch(Job& job, size_t ntasks, bool blocks)
+{
+    boost::mutex::scoped_lock launchlock(_launch_lock);
+    boost::shared_ptr<Failure> failure;
+    {
+        boost::mutex::scoped_lock lock(_lock);
+        // threads start with the first job, a pool created before
+        // fork has no threads to lose in the child process
+        if (_threads.size() == 0)   this->startWorkers();
+        _job = &job;
+        _ntasks = ntasks;
+        _next_task = 0;
+        _blocks = blocks;
+        _failure.reset();
+        _timer_parent = SectionTimer::currentNode();
+        _nactive = _nthreads;
+        ++_generation;
+        _job_ready.notify_all();
+        while (_nactive)    _job_done.wait(lock);
+        _job = NULL;
+        failure.swap(_failure);
+    }
+    if (failure)    failure->rethrow();
+}
+
+
+void WorkerPool::startWorkers()
+{
+    for (int i = 0; i < _nthreads; ++i)
+    {
+        _threads.create_thread(boost::bind(&WorkerPool::workerLoop, this, i));
+    }
+}
+
+
+void WorkerPool::workerLoop(int index)
+{
+    is_worker_thread = true;
+    worker_index = index;
+    unsigned long generation = 0;
+    while (true)
+    {
+        {
+            boost::mutex::scoped_lock lock(_lock);
+            while (!_stopped && _generation == generation)
+            {
+                _job_ready.wait(lock);
+            }
+            if (_stopped)   return;
+            generation = _generation;
+        }
+        this->runTasks(index);
+        boost::mutex::scoped_lock lock(_lock);
+        if (--_nactive == 0)    _job_done.notify_all();
+    }
+}
+
+
+void WorkerPool::runTasks(int index)
+{
+    int nworkers = min(size_t(_nthreads), _ntasks);
+    if (index >= nworkers)  return;
+    this->pinWorker(index, nworkers);
+    // gather counts in a private table, merge when the job is done
+    Counter::ThreadTally tally;
+    // time sections below the section that launched the job
+    SectionTimer::ThreadTree timertree(_timer_parent);
+    // block of tasks of this worker, used only by executeBlocks
+    size_t nextblock = index * _ntasks / nworkers;
+    size_t endblock = (index + 1) * _ntasks / nworkers;
+    size_t task;
+    while (_blocks ? nextBlockTask(task, nextblock, endblock) :
+            nextTask(task))
+    {
+        // the most derived LIGA and standard types are kept
+        try {
+            _job->run(task);
+        }
+        catch (IOError& e) {
+            noteFailure(new TypedFailure<IOError>(e));
+        }
+        catch (TriangulationError& e) {
+            noteFailure(new TypedFailure<TriangulationError>(e));
+        }
+        catch (InvalidDistanceTable& e) {
+            noteFailure(new TypedFailure<InvalidDistanceTable>(e));
+        }
+        catch (InvalidMolecule& e) {
+            noteFailure(new TypedFailure<InvalidMolecule>(e));
+        }
+        catch (ReplayError& e) {
+            noteFailure(new TypedFailure<ReplayError>(e));
+        }
+        catch (range_error& e) {
+            noteFailure(new TypedFailure<range_error>(e));
+        }
+        catch (overflow_error& e) {
+            noteFailure(new TypedFailure<overflow_error>(e));
+        }
+        catch (runtime_error& e) {
+            noteFailure(new TypedFailure<runtime_error>(e));
+        }
+        catch (invalid_argument& e) {
+            noteFailure(new TypedFailure<invalid_argument>(e));
+        }
+        catch (out_of_range& e) {
+            noteFailure(new TypedFailure<out_of_range>(e));
+        }
+        catch (logic_error& e) {
+            noteFailure(new TypedFailure<logic_error>(e));
+        }
+        catch (bad_alloc& e) {
+            noteFailure(new TypedFailure<bad_alloc>(e));
+        }
+        catch (exception& e) {
+            runtime_error err(e.what());
+            noteFailure(new TypedFailure<runtime_error>(err));
+        }
+        catch (...) {
+            const char* emsg =
+                "WorkerPool: unknown exception in worker thread.";
+            runtime_error err(emsg);
+            noteFailure(new TypedFailure<runtime_error>(err));
+        }
+    }
+}
+
+
+// contiguous groups of workers share the CPUs of a NUMA node
+
+void WorkerPool::pinWorker(int index, int nworkers) const
+{
+    if (_node_cpus.empty())     return;
+    int nnodes = _node_cpus.size();
+    const vector<int>& cpus = _node_cpus[index * nnodes / nworkers];
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    vector<int>::const_iterator ci = cpus.begin();
+    for (; ci != cpus.end(); ++ci)
+    {
+        if (*ci < CPU_SETSIZE)  CPU_SET(*ci, &cpuset);
+    }
+    // pinning only improves locality, ignore failures
+    sched_setaffinity(0, sizeof(cpuset), &cpuset);
+}
+
+
+bool WorkerPool::nextTask(size_t& task)
+{
+    boost::mutex::scoped_lock lock(_lock);
+    if (_failure || !(_next_task < _ntasks))   return false;
+    task = _next_task++;
+    return true;
+}
+
+
+bool WorkerPool::nextBlockTask(size_t& task, size_t& next, size_t end)
+{
+    boost::mutex::scoped_lock lock(_lock);
+    if (_failure || !(next < end))  return false;
+    task = next++;
+    return true;
+}
+
+
+void WorkerPool::noteFailure(Failure* failure)
+{
+    boost::shared_ptr<Failure> pf(failure);
+    boost::mutex::scoped_lock lock(_lock);
+    if (!_failure)  _failure = pf;
+}
+
+// End of file
@@ -0,0 +1,120 @@
+/***********************************************************************
+* Short Title: pool of worker threads for concurrent LIGA tasks
+*
+* Comments: WorkerPool runs a Job for a range of task indices with
+*     several threads and waits until all tasks are done.  Tasks are
+*     either taken in turns by idle workers or split in contiguous
+*     blocks, one per worker.  Workers can be pinned to the CPUs of
+*     NUMA nodes, so that the memory they allocate stays node-local.
+*     The worker threads start with the first job and wait for the
+*     next one until the pool is destroyed, hence their thread-local
+*     buffers are reused by all jobs.  The first exception raised by
+*     a task is rethrown with its type in the calling thread.
+*
+* <license text>
+***********************************************************************/
+
+#ifndef WORKERPOOL_HPP_INCLUDED
+#define WORKERPOOL_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "SectionTimer.hpp"
+
+class WorkerPool
+{
+    public:
+
+        // task executed by the pool
+        class Job
+        {
+            public:
+
+                virtual ~Job() { }
+                virtual void run(size_t task) = 0;
+        };
+
+        // Job adaptor which calls a method for every task index
+        template <class T>
+        class MethodJob : public Job
+        {
+            public:
+
+                typedef void (T::*Method)(size_t);
+                MethodJob(T* obj, Method m) : _obj(obj), _method(m)  { }
+                void run(size_t task)   { (_obj->*_method)(task); }
+
+            private:
+
+                T* _obj;
+                Method _method;
+        };
+
+        // class methods
+        static bool isWorkerThread();
+        // index of the running worker, -1 outside of workers
+        static int workerIndex();
+        // CPU numbers of every NUMA node, empty when not available
+        static std::vector< std::vector<int> > numaNodeCPUs();
+
+        // constructor and destructor
+        WorkerPool(int nthreads);
+        ~WorkerPool();
+
+        // methods
+        int size() const;
+        void execute(Job& job, size_t ntasks);
+        // worker i runs the i-th contiguous block of tasks
+        void executeBlocks(Job& job, size_t ntasks);
+        // index of the worker that runs task in executeBlocks
+        int blockWorker(size_t task, size_t ntasks) const;
+        // pin workers to NUMA nodes in contiguous groups
+        void setNodeAffinity(bool flag);
+
+    private:
+
+        // types
+        // first exception of the tasks, rethrown after the job
+        class Failure;
+        template <class E> class TypedFailure;
+
+        // data
+        int _nthreads;
+        Job* _job;
+        size_t _ntasks;
+        size_t _next_task;
+        bool _blocks;
+        bool _node_affinity;
+        std::vector< std::vector<int> > _node_cpus;
+        boost::shared_ptr<Failure> _failure;
+        boost::mutex _lock;
+        SectionTimer::Node* _timer_parent;
+        // persistent workers wait for a new job generation and
+        // count down the active workers when the job is done
+        boost::thread_group _threads;
+        boost::condition_variable _job_ready;
+        boost::condition_variable _job_done;
+        unsigned long _generation;
+        int _nactive;
+        bool _stopped;
+        // jobs of several calling threads run one after another
+        boost::mutex _launch_lock;
+
+        // methods
+        void launch(Job& job, size_t ntasks, bool blocks);
+        void startWorkers();
+        void workerLoop(int index);
+        void runTasks(int index);
+        void pinWorker(int index, int nworkers) const;
+        bool nextTask(size_t& task);
+        bool nextBlockTask(size_t& task, size_t& next, size_t end);
+        void noteFailure(Failure* failure);
+
+};
+
+#endif  // WORKERPOOL_HPP_INCLUDED
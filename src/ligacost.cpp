@@ -0,0 +1,510 @@
+/*****************************************************************************
+* Short Title: Python extension module for cost evaluation
+*
+* Comments: ligacost exposes DistanceTable, Molecule and Crystal to
+*     Python.  Coordinates are read through the buffer protocol, so that
+*     C-contiguous float64 numpy arrays are used without copying.  The
+*     batchCosts method scores a stack of structures in one call with
+*     the GIL released, molecules can be scored with several threads.
+*
+*     >>> import numpy, ligacost
+*     >>> tbl = ligacost.DistanceTable(distances)
+*     >>> mol = ligacost.Molecule(tbl, "C60")
+*     >>> costs = mol.batchCosts(xyz)       # xyz.shape = (nstru, 60, 3)
+*
+*****************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <boost/python.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Crystal.hpp"
+#include "DistanceTable.hpp"
+#include "Lattice.hpp"
+#include "Molecule.hpp"
+#include "WorkerPool.hpp"
+
+using namespace std;
+using namespace boost::python;
+namespace python = boost::python;
+
+// Local helpers for the ligacost module -------------------------------------
+
+namespace {
+
+// C-contiguous view of a float64 buffer, released on destruction.
+// The view also keeps the exporting object alive.
+
+class DoubleBuffer
+{
+    public:
+
+        DoubleBuffer(object obj, bool writable=false)
+        {
+            int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT |
+                (writable ? PyBUF_WRITABLE : 0);
+            if (PyObject_GetBuffer(obj.ptr(), &mview, flags) != 0)
+            {
+                throw_error_already_set();
+            }
+            string fmt = mview.format ? mview.format : "B";
+            if (!fmt.empty() && strchr("@=<", fmt[0]))  fmt.erase(0, 1);
+            if (fmt != "d" || mview.itemsize != sizeof(double))
+            {
+                PyBuffer_Release(&mview);
+                const char* emsg = "buffer must contain float64 values.";
+                throw invalid_argument(emsg);
+            }
+        }
+
+
+        ~DoubleBuffer()
+        {
+            PyBuffer_Release(&mview);
+        }
+
+
+        double* data() const
+        {
+            return static_cast<double*>(mview.buf);
+        }
+
+
+        size_t size() const
+        {
+            return mview.len / sizeof(double);
+        }
+
+
+        int ndim() const
+        {
+            return mview.ndim;
+        }
+
+
+        size_t shape(int i) const
+        {
+            return mview.shape ? mview.shape[i] : this->size();
+        }
+
+    private:
+
+        Py_buffer mview;
+
+        // disable copying
+        DoubleBuffer(const DoubleBuffer&);
+        DoubleBuffer& operator=(const DoubleBuffer&);
+};
+
+
+// release the GIL for the lifetime of the instance
+
+class ScopedGILRelease
+{
+    public:
+
+        ScopedGILRelease() : mstate(PyEval_SaveThread())  { }
+        ~ScopedGILRelease()     { PyEval_RestoreThread(mstate); }
+
+    private:
+
+        PyThreadState* mstate;
+};
+
+
+// Static calculators of the cost functions are shared by all molecules
+// outside of worker threads.  Batches run with the GIL released, hence
+// every wrapper that evaluates or changes a molecule holds this mutex.
+
+boost::mutex& batch_mutex()
+{
+    static boost::mutex mtx;
+    return mtx;
+}
+
+
+// Hold batch_mutex() for the lifetime of the instance.  The mutex is
+// acquired with the GIL released so that a batch which finishes can
+// restore the GIL, the wrapped call then runs with the GIL held.
+
+class BatchLock
+{
+    public:
+
+        BatchLock() : mlock(batch_mutex(), boost::defer_lock)
+        {
+            ScopedGILRelease nogil;
+            mlock.lock();
+        }
+
+    private:
+
+        boost::unique_lock<boost::mutex> mlock;
+};
+
+
+// Wrappers of Molecule methods that run under BatchLock
+
+template <class T, class R, R (T::*method)() const>
+R lockedGetter(const T& obj)
+{
+    BatchLock lock;
+    return (obj.*method)();
+}
+
+
+template <class T, class A, void (T::*method)(A)>
+void lockedSetter(T& obj, A a)
+{
+    BatchLock lock;
+    (obj.*method)(a);
+}
+
+
+template <class T, class A, class B, void (T::*method)(A, B)>
+void lockedSetter2(T& obj, A a, B b)
+{
+    BatchLock lock;
+    (obj.*method)(a, b);
+}
+
+
+// values from a float64 buffer or any Python sequence of numbers
+
+vector<double> toDoubleVector(object obj)
+{
+    if (PyObject_CheckBuffer(obj.ptr()))
+    {
+        DoubleBuffer buf(obj);
+        return vector<double>(buf.data(), buf.data() + buf.size());
+    }
+    vector<double> rv;
+    stl_input_iterator<double> first(obj), last;
+    rv.assign(first, last);
+    return rv;
+}
+
+
+// Scoring of a C-contiguous (nstru, natoms, 3) coordinate array.
+
+class BatchCosts
+{
+    public:
+
+        BatchCosts(const Molecule& mol, const double* xyz,
+                size_t nstru, size_t natoms,
+                const vector<string>& elements, double* costs) :
+            mmol(mol), mxyz(xyz), mnstru(nstru), mnatoms(natoms),
+            melements(elements), mcosts(costs), mnthreads(1)
+        { }
+
+
+        void run(int nthreads)
+        {
+            mnthreads = 1;
+            bool concurrent = nthreads > 1 && mnstru > 1;
+            merrors.assign(concurrent ? nthreads : 1, string());
+            if (!concurrent)
+            {
+                this->scoreBlock(0);
+                return;
+            }
+            mnthreads = nthreads;
+            WorkerPool workers(nthreads);
+            WorkerPool::MethodJob<BatchCosts>
+                scorejob(this, &BatchCosts::scoreBlock);
+            workers.executeBlocks(scorejob, nthreads);
+        }
+
+
+        // first error message, empty when all structures were scored
+        string error() const
+        {
+            for (size_t i = 0; i != merrors.size(); ++i)
+            {
+                if (!merrors[i].empty())    return merrors[i];
+            }
+            return string();
+        }
+
+    private:
+
+        // data
+        const Molecule& mmol;
+        const double* mxyz;
+        size_t mnstru;
+        size_t mnatoms;
+        const vector<string>& melements;
+        double* mcosts;
+        int mnthreads;
+        vector<string> merrors;
+
+        // score a contiguous block of structures with a private copy
+        void scoreBlock(size_t block)
+        {
+            size_t lo = block * mnstru / mnthreads;
+            size_t hi = (block + 1) * mnstru / mnthreads;
+            auto_ptr<Molecule> m(mmol.copy());
+            vector<Atom_t> atoms;
+            for (size_t k = lo; k != hi; ++k)
+            {
+                const double* pxyz = mxyz + k * mnatoms * R3::Ndim;
+                atoms.clear();
+                for (size_t i = 0; i != mnatoms; ++i, pxyz += R3::Ndim)
+                {
+                    R3::Vector rc;
+                    rc = pxyz[0], pxyz[1], pxyz[2];
+                    atoms.push_back(Atom_t(melements[i], rc));
+                }
+                try {
+                    m->setAtoms(atoms);
+                    mcosts[k] = m->cost();
+                }
+                catch (exception& e) {
+                    mcosts[k] = numeric_limits<double>::quiet_NaN();
+                    if (!merrors[block].empty())    continue;
+                    ostringstream emsg;
+                    emsg << "structure " << k << ": " << e.what();
+                    merrors[block] = emsg.str();
+                }
+            }
+        }
+};
+
+
+vector<string> elementsFor(const Molecule& mol, object elements,
+        size_t natoms)
+{
+    vector<string> rv;
+    if (elements.is_none())
+    {
+        rv = mol.getChemicalFormula().expand();
+    }
+    else if (PyUnicode_Check(elements.ptr()))
+    {
+        rv.assign(natoms, extract<string>(elements)());
+    }
+    else
+    {
+        stl_input_iterator<string> first(elements), last;
+        rv.assign(first, last);
+    }
+    if (rv.size() != natoms)
+    {
+        ostringstream emsg;
+        emsg << "Expected " << natoms << " elements, got " <<
+            rv.size() << '.';
+        throw invalid_argument(emsg.str());
+    }
+    return rv;
+}
+
+// Python wrappers -----------------------------------------------------------
+
+boost::shared_ptr<DistanceTable>
+newDistanceTable(object distances, object esds)
+{
+    boost::shared_ptr<DistanceTable> rv(
+            new DistanceTable(toDoubleVector(distances)));
+    if (!esds.is_none())    rv->setESDs(toDoubleVector(esds));
+    return rv;
+}
+
+
+void setMoleculeTable(Molecule& mol, const DistanceTable& tbl,
+        const string& formula)
+{
+    mol.setDistanceTable(tbl);
+    if (!formula.empty())   mol.setChemicalFormula(formula);
+}
+
+
+boost::shared_ptr<Molecule>
+newMolecule(const DistanceTable& tbl, const string& formula)
+{
+    BatchLock lock;
+    boost::shared_ptr<Molecule> rv(new Molecule);
+    setMoleculeTable(*rv, tbl, formula);
+    return rv;
+}
+
+
+boost::shared_ptr<Crystal>
+newCrystal(const DistanceTable& tbl, object latpar,
+        const string& formula, double rmax)
+{
+    vector<double> lp = toDoubleVector(latpar);
+    if (lp.size() != 6)
+    {
+        const char* emsg = "latpar must define 6 lattice parameters.";
+        throw invalid_argument(emsg);
+    }
+    BatchLock lock;
+    boost::shared_ptr<Crystal> rv(new Crystal);
+    setMoleculeTable(*rv, tbl, formula);
+    rv->setLattice(Lattice(lp[0], lp[1], lp[2], lp[3], lp[4], lp[5]));
+    if (rmax > 0.0)     rv->setRmax(rmax);
+    return rv;
+}
+
+
+// Cost of every structure in the xyz array of shape (nstru, natoms, 3)
+// or (natoms, 3).  Costs are stored in the writable float64 buffer out
+// when specified, otherwise they are returned in a list.  Failed
+// structures get NaN cost and raise ValueError after the batch.
+
+object batchCosts(const Molecule& mol, object xyz, object elements,
+        int nthreads, object out)
+{
+    if (nthreads < 1)
+    {
+        const char* emsg = "nthreads must be at least 1.";
+        throw invalid_argument(emsg);
+    }
+    DoubleBuffer bxyz(xyz);
+    bool shapeok = (bxyz.ndim() == 2 || bxyz.ndim() == 3) &&
+        bxyz.shape(bxyz.ndim() - 1) == size_t(R3::Ndim);
+    if (!shapeok)
+    {
+        const char* emsg = "xyz must have shape (nstru, natoms, 3).";
+        throw invalid_argument(emsg);
+    }
+    const size_t nstru = (bxyz.ndim() == 3) ? bxyz.shape(0) : 1;
+    const size_t natoms = bxyz.shape(bxyz.ndim() - 2);
+    vector<string> elems = elementsFor(mol, elements, natoms);
+    auto_ptr<DoubleBuffer> bout;
+    vector<double> costs;
+    double* pcosts = NULL;
+    if (!out.is_none())
+    {
+        bout.reset(new DoubleBuffer(out, true));
+        if (bout->size() != nstru)
+        {
+            const char* emsg = "out must have one value per structure.";
+            throw invalid_argument(emsg);
+        }
+        pcosts = bout->data();
+    }
+    else
+    {
+        costs.resize(nstru);
+        pcosts = nstru ? &costs[0] : NULL;
+    }
+    BatchCosts batch(mol, bxyz.data(), nstru, natoms, elems, pcosts);
+    {
+        ScopedGILRelease nogil;
+        boost::mutex::scoped_lock lock(batch_mutex());
+        batch.run(nthreads);
+    }
+    string emsg = batch.error();
+    if (!emsg.empty())  throw invalid_argument(emsg);
+    if (!out.is_none())     return out;
+    boost::python::list rv;
+    for (size_t k = 0; k != nstru; ++k)     rv.append(costs[k]);
+    return rv;
+}
+
+
+void setAtomsXYZ(Molecule& mol, object xyz, object elements)
+{
+    DoubleBuffer bxyz(xyz);
+    if (bxyz.ndim() != 2 || bxyz.shape(1) != size_t(R3::Ndim))
+    {
+        const char* emsg = "xyz must have shape (natoms, 3).";
+        throw invalid_argument(emsg);
+    }
+    const size_t natoms = bxyz.shape(0);
+    vector<string> elems = elementsFor(mol, elements, natoms);
+    vector<Atom_t> atoms;
+    const double* pxyz = bxyz.data();
+    for (size_t i = 0; i != natoms; ++i, pxyz += R3::Ndim)
+    {
+        R3::Vector rc;
+        rc = pxyz[0], pxyz[1], pxyz[2];
+        atoms.push_back(Atom_t(elems[i], rc));
+    }
+    BatchLock lock;
+    mol.setAtoms(atoms);
+}
+
+
+void translateInvalidArgument(const invalid_argument& e)
+{
+    PyErr_SetString(PyExc_ValueError, e.what());
+}
+
+
+void translateRuntimeError(const runtime_error& e)
+{
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+}
+
+}   // namespace
+
+// Module definition ---------------------------------------------------------
+
+BOOST_PYTHON_MODULE(ligacost)
+{
+    // std::arg is visible as well
+    using python::arg;
+
+    register_exception_translator<invalid_argument>(
+            &translateInvalidArgument);
+    register_exception_translator<runtime_error>(&translateRuntimeError);
+
+    class_<DistanceTable, boost::shared_ptr<DistanceTable> >(
+            "DistanceTable", no_init)
+        .def("__init__", make_constructor(&newDistanceTable,
+                    default_call_policies(),
+                    (arg("distances"), arg("esds")=object())))
+        .def("__len__", &DistanceTable::size)
+        .def("hasESDs", &DistanceTable::hasESDs)
+        ;
+
+    class_<Molecule, boost::shared_ptr<Molecule>, boost::noncopyable>(
+            "Molecule", no_init)
+        .def("__init__", make_constructor(&newMolecule,
+                    default_call_policies(),
+                    (arg("table"), arg("formula")="")))
+        .def("setDistReuse", &lockedSetter<Molecule, bool,
+                &Molecule::setDistReuse>)
+        .def("setChemicalFormula", &lockedSetter<Molecule, const string&,
+                &Molecule::setChemicalFormula>)
+        .def("setAtomRadiiTable", &lockedSetter<Molecule, const string&,
+                &Molecule::setAtomRadiiTable>)
+        .def("setSamePairRadius", &lockedSetter<Molecule, double,
+                &Molecule::setSamePairRadius>)
+        .def("setAtomCostPenalty", &lockedSetter2<Molecule, const string&,
+                double, &Molecule::setAtomCostPenalty>)
+        .def("setAtomOverlapScale", &lockedSetter<Molecule, double,
+                &Molecule::setAtomOverlapScale>)
+        .def("setAtoms", &setAtomsXYZ,
+                (arg("xyz"), arg("elements")=object()))
+        .def("countAtoms", &Molecule::countAtoms)
+        .def("cost", &lockedGetter<Molecule, double, &Molecule::cost>)
+        .def("costDistance", &lockedGetter<Molecule, double,
+                &Molecule::costDistance>)
+        .def("costOverlap", &lockedGetter<Molecule, double,
+                &Molecule::costOverlap>)
+        .def("batchCosts", &batchCosts,
+                (arg("xyz"), arg("elements")=object(),
+                 arg("nthreads")=1, arg("out")=object()))
+        ;
+
+    class_<Crystal, boost::shared_ptr<Crystal>, bases<Molecule>,
+        boost::noncopyable>("Crystal", no_init)
+        .def("__init__", make_constructor(&newCrystal,
+                    default_call_policies(),
+                    (arg("table"), arg("latpar"), arg("formula")="",
+                     arg("rmax")=0.0)))
+        .def("setRmax", &lockedSetter<Crystal, double, &Crystal::setRmax>)
+        .def("getRmax", &lockedGetter<Crystal, double, &Crystal::getRmax>)
+        ;
+}
+
+// End of file
@@ -0,0 +1,475 @@
+/*****************************************************************************
+* Short Title: benchmarks of LIGA hot paths and reference runs
+*
+* Comments: micro-benchmarks repeat one operation on a fixture until the
+*     minimum time is spent, macro-benchmarks play a fixed number of
+*     seasons with a fixed seed.  Results are written as one JSON line
+*     per benchmark.
+*
+*****************************************************************************/
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "DistanceTable.hpp"
+#include "Molecule.hpp"
+#include "Crystal.hpp"
+#include "Lattice.hpp"
+#include "AtomCost.hpp"
+#include "AtomCostCrystal.hpp"
+#include "PointsInSphere.hpp"
+#include "RunPar_t.hpp"
+#include "Liga_t.hpp"
+#include "Exceptions.hpp"
+#include "tests_dir.hpp"
+
+using namespace std;
+
+const int EXIT_INPUT_ERROR = 2;
+
+// results of benchmarked calls, which must not be optimized away
+volatile double bench_sink = 0.0;
+
+//////////////////////////////////////////////////////////////////////////////
+// Timing
+//////////////////////////////////////////////////////////////////////////////
+
+double wall_seconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Fixtures
+//////////////////////////////////////////////////////////////////////////////
+
+DistanceTable readDistanceTable(const string& filename)
+{
+    string fullpath = prepend_tests_dir(filename);
+    ifstream fid(fullpath.c_str());
+    if (!fid)
+    {
+        ostringstream emsg;
+        emsg << "Unable to read '" << fullpath << "'";
+        throw IOError(emsg.str());
+    }
+    DistanceTable dtbl;
+    fid >> dtbl;
+    return dtbl;
+}
+
+
+// C60 molecule with its last atom removed
+class BuckyFixture
+{
+    public:
+
+        DistanceTable dtbl;
+        Molecule mol;
+        vector<Atom_t> trials;
+
+        BuckyFixture()
+        {
+            dtbl = readDistanceTable("solids/bucky.dst");
+            mol.setDistanceTable(dtbl);
+            mol.ReadFile(prepend_tests_dir("solids/bucky.xyz"));
+            int lastidx = mol.countAtoms() - 1;
+            Atom_t a = mol.getAtom(lastidx);
+            mol.Pop(lastidx);
+            // the removed atom and its small displacements
+            for (int i = 0; i < 16; ++i)
+            {
+                double dx = 0.01 * (i % 4);
+                double dy = 0.01 * ((i / 4) % 2);
+                double dz = 0.01 * (i / 8);
+                trials.push_back(Atom_t(a.element,
+                            a.r[0] + dx, a.r[1] + dy, a.r[2] + dz));
+            }
+        }
+};
+
+
+// rocksalt unit cell with all 8 atoms
+class RocksaltFixture
+{
+    public:
+
+        DistanceTable dtbl;
+        Lattice lattice;
+        Crystal crst;
+        vector<R3::Vector> separations;
+
+        RocksaltFixture() : lattice(5.64, 5.64, 5.64, 90, 90, 90)
+        {
+            dtbl = readDistanceTable("crystals/rocksalt.dst");
+            crst.setLattice(this->lattice);
+            crst.setChemicalFormula("C8");
+            crst.setRmax(10.0);
+            crst.setDistanceTable(dtbl);
+            const double xyz[8][3] = {
+                {0.0, 0.0, 0.0}, {0.0, 0.5, 0.5},
+                {0.5, 0.0, 0.5}, {0.5, 0.5, 0.0},
+                {0.5, 0.0, 0.0}, {0.5, 0.5, 0.5},
+                {0.0, 0.0, 0.5}, {0.0, 0.5, 0.0},
+            };
+            for (int i = 0; i < 8; ++i)
+            {
+                R3::Vector rf(xyz[i][0], xyz[i][1], xyz[i][2]);
+                crst.AddAt("C", lattice.cartesian(rf));
+            }
+            // Cartesian separations of slightly displaced pairs
+            for (int i = 0; i < 64; ++i)
+            {
+                R3::Vector rf(0.125 * (i % 4) + 0.01,
+                        0.125 * ((i / 4) % 4) + 0.02,
+                        0.125 * (i / 16) + 0.03);
+                separations.push_back(lattice.cartesian(rf));
+            }
+        }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+//////////////////////////////////////////////////////////////////////////////
+
+class Benchmark
+{
+    public:
+
+        virtual ~Benchmark() { }
+        virtual string name() const = 0;
+        // micro-benchmarks run iterations of one operation,
+        // macro-benchmarks run only once
+        virtual bool isMacro() const  { return false; }
+        virtual void run(long iterations) = 0;
+        // extra JSON fields of the results
+        virtual string details() const  { return string(); }
+};
+
+
+class AtomCostEval : public Benchmark
+{
+    public:
+
+        string name() const  { return "AtomCost::eval/C60"; }
+
+        void run(long iterations)
+        {
+            AtomCost* atomcost = fx.mol.getAtomCostCalculator();
+            size_t ntrials = fx.trials.size();
+            for (long i = 0; i < iterations; ++i)
+            {
+                bench_sink = atomcost->eval(fx.trials[i % ntrials]);
+            }
+        }
+
+    private:
+
+        BuckyFixture fx;
+};
+
+
+class PairCostCount : public Benchmark
+{
+    public:
+
+        string name() const
+        {
+            return "AtomCostCrystal::pairCostCount/rocksalt";
+        }
+
+        void run(long iterations)
+        {
+            AtomCostCrystal* atomcost = static_cast<AtomCostCrystal*>(
+                    fx.crst.getAtomCostCalculator());
+            // evaluate once to assign the cluster and flags
+            Atom_t a("C", fx.separations[0]);
+            atomcost->eval(a);
+            size_t nsep = fx.separations.size();
+            for (long i = 0; i < iterations; ++i)
+            {
+                bench_sink = atomcost->pairCostCount(
+                        fx.separations[i % nsep]).first;
+            }
+        }
+
+    private:
+
+        RocksaltFixture fx;
+};
+
+
+class PointsInSphereLoop : public Benchmark
+{
+    public:
+
+        PointsInSphereLoop() : lattice(5.64, 5.64, 5.64, 90, 90, 90)
+        { }
+
+        string name() const  { return "PointsInSphere/rocksalt-20A"; }
+
+        void run(long iterations)
+        {
+            PointsInSphere sph(0.0, 20.0, lattice);
+            for (long i = 0; i < iterations; ++i)
+            {
+                double rsum = 0.0;
+                for (sph.rewind(); !sph.finished(); sph.next())
+                {
+                    rsum += sph.r();
+                }
+                bench_sink = rsum;
+            }
+        }
+
+    private:
+
+        Lattice lattice;
+};
+
+
+class FindNearest : public Benchmark
+{
+    public:
+
+        FindNearest()
+        {
+            double dmax = fx.dtbl.maxDistance();
+            for (int i = 0; i < 1024; ++i)
+            {
+                queries.push_back(dmax * (i + 0.5) / 1024);
+            }
+            fx.dtbl.buildBucketIndex();
+        }
+
+        string name() const  { return "DistanceTable::find_nearest/C60"; }
+
+        void run(long iterations)
+        {
+            size_t nqueries = queries.size();
+            for (long i = 0; i < iterations; ++i)
+            {
+                bench_sink = *fx.dtbl.find_nearest(queries[i % nqueries]);
+            }
+        }
+
+    private:
+
+        BuckyFixture fx;
+        vector<double> queries;
+};
+
+
+class MoleculeAssign : public Benchmark
+{
+    public:
+
+        string name() const  { return "Molecule::operator=/C60"; }
+
+        void run(long iterations)
+        {
+            Molecule tgt;
+            const Molecule* src[2] = { &fx.mol, &other };
+            other = fx.mol;
+            other.Pop(0);
+            for (long i = 0; i < iterations; ++i)
+            {
+                tgt = *src[i % 2];
+                bench_sink = tgt.cost();
+            }
+        }
+
+    private:
+
+        BuckyFixture fx;
+        Molecule other;
+};
+
+
+// fixed-seed run of a reference problem for a given number of seasons
+class LigaRun : public Benchmark
+{
+    public:
+
+        LigaRun(const string& nm, int seasons, const char* args[]) :
+            _name(nm), _seasons(seasons), _played(0), _solved(false)
+        {
+            _args.push_back("mpbcbench");
+            for (; *args; ++args)   _args.push_back(*args);
+            _args[1] = prepend_tests_dir(_args[1]);
+        }
+
+        string name() const  { return _name; }
+        bool isMacro() const  { return true; }
+
+        void run(long iterations)
+        {
+            // silence the run output
+            ofstream devnull("/dev/null");
+            streambuf* coutbuf = cout.rdbuf(devnull.rdbuf());
+            try {
+                for (long i = 0; i < iterations; ++i)   this->playOnce();
+            }
+            catch (...) {
+                cout.rdbuf(coutbuf);
+                throw;
+            }
+            cout.rdbuf(coutbuf);
+        }
+
+        string details() const
+        {
+            ostringstream out;
+            out << ", \"seasons\": " << _played <<
+                ", \"solved\": " << (_solved ? "true" : "false");
+            return out.str();
+        }
+
+    private:
+
+        string _name;
+        int _seasons;
+        vector<string> _args;
+        int _played;
+        bool _solved;
+
+        void playOnce()
+        {
+            vector<char*> argv;
+            for (size_t i = 0; i < _args.size(); ++i)
+            {
+                argv.push_back(const_cast<char*>(_args[i].c_str()));
+            }
+            argv.push_back(NULL);
+            RunPar_t rp;
+            rp.processArguments(argv.size() - 1, &argv[0]);
+            Liga_t liga(&rp);
+            liga.prepare();
+            for (_played = 0; _played < _seasons && !liga.finished();)
+            {
+                liga.playSeason();
+                ++_played;
+            }
+            _solved = liga.solutionFound();
+        }
+};
+
+
+vector<Benchmark*> createBenchmarks()
+{
+    vector<Benchmark*> rv;
+    rv.push_back(new AtomCostEval);
+    rv.push_back(new PairCostCount);
+    rv.push_back(new PointsInSphereLoop);
+    rv.push_back(new FindNearest);
+    rv.push_back(new MoleculeAssign);
+    const char* args_c60[] = { "solids/bucky.dst", "crystal=false",
+        "formula=C60", "rngseed=7", "seasontrials=16384", "verbose=",
+        NULL };
+    rv.push_back(new LigaRun("mpbcliga/C60", 100, args_c60));
+    const char* args_rocksalt[] = { "crystals/rocksalt.dst",
+        "crystal=true", "latpar=5.64,5.64,5.64,90,90,90", "formula=C8",
+        "rngseed=7", "seasontrials=4096", "verbose=", NULL };
+    rv.push_back(new LigaRun("mpbcliga/rocksalt", 20, args_rocksalt));
+    return rv;
+}
+
+
+// repeat micro-benchmark with doubled iterations until mintime is spent
+void runBenchmark(Benchmark& bm, double mintime)
+{
+    long iterations = 1;
+    double seconds;
+    while (true)
+    {
+        double t0 = wall_seconds();
+        bm.run(iterations);
+        seconds = wall_seconds() - t0;
+        if (bm.isMacro() || seconds >= mintime)     break;
+        iterations *= 2;
+    }
+    cout << "{\"benchmark\": \"" << bm.name() << "\", " <<
+        "\"iterations\": " << iterations << ", " <<
+        "\"seconds\": " << seconds << ", " <<
+        "\"ns_per_op\": " << 1e9 * seconds / iterations <<
+        bm.details() << "}" << endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MAIN
+//////////////////////////////////////////////////////////////////////////////
+
+const char* usage =
+"usage: mpbcbench [-t SECONDS] [PATTERN...]\n"
+"run LIGA benchmarks and write one JSON line of results per benchmark.\n"
+"PATTERN selects benchmarks that contain it in their name.\n"
+"Options:\n"
+"  -t SECONDS    [0.5] minimum time of micro-benchmark timing\n"
+"  -l, --list    list benchmark names and exit\n"
+"  -h, --help    display this message\n"
+;
+
+int main(int argc, char *argv[])
+{
+    double mintime = 0.5;
+    bool listonly = false;
+    vector<string> patterns;
+    for (int i = 1; i < argc; ++i)
+    {
+        string a = argv[i];
+        if (a == "-h" || a == "--help")
+        {
+            cout << usage;
+            return EXIT_SUCCESS;
+        }
+        else if (a == "-l" || a == "--list")    listonly = true;
+        else if (a == "-t" && i + 1 < argc)     mintime = atof(argv[++i]);
+        else if (!a.empty() && a[0] == '-')
+        {
+            cerr << "Invalid option '" << a << "'\n" << usage;
+            return EXIT_INPUT_ERROR;
+        }
+        else    patterns.push_back(a);
+    }
+    vector<Benchmark*> benchmarks;
+    try {
+        benchmarks = createBenchmarks();
+        vector<Benchmark*>::iterator bm;
+        for (bm = benchmarks.begin(); bm != benchmarks.end(); ++bm)
+        {
+            string nm = (*bm)->name();
+            bool selected = patterns.empty();
+            for (size_t i = 0; !selected && i < patterns.size(); ++i)
+            {
+                selected = (nm.find(patterns[i]) != string::npos);
+            }
+            if (!selected)  continue;
+            if (listonly)   cout << nm << '\n';
+            else            runBenchmark(**bm, mintime);
+        }
+    }
+    catch (IOError(e)) {
+        cerr << e.what() << endl;
+        return EXIT_INPUT_ERROR;
+    }
+    catch (ParseArgsError(e)) {
+        cerr << e.what() << endl;
+        return EXIT_INPUT_ERROR;
+    }
+    catch (runtime_error(e)) {
+        cerr << e.what() << endl;
+        return EXIT_INPUT_ERROR;
+    }
+    vector<Benchmark*>::iterator bm;
+    for (bm = benchmarks.begin(); bm != benchmarks.end(); ++bm)  delete *bm;
+    return EXIT_SUCCESS;
+}
+
+// End of file
@@ -1,17 +1,26 @@
 /*****************************************************************************
 * Short Title: calculate cost value of a structure file
 *
-* Comments:
+* Comments: structure files are read in the main thread, because they
+*     are parsed with Python.  Their costs are evaluated for batches
+*     of files by nthreads workers and printed in the input order.
+*     With trajectory=true the files are scored serially as frames of
+*     one trajectory, multi-frame xyz files are read one frame at a time.
 *
 *****************************************************************************/
 
 #include <cstdlib>
+#include <fstream>
+#include <list>
 #include <memory>
+#include <sstream>
 #include <boost/foreach.hpp>
 
 #include "Exceptions.hpp"
 #include "RunPar_t.hpp"
 #include "Liga_t.hpp"
+#include "StructureIO.hpp"
+#include "WorkerPool.hpp"
 
 using namespace std;
 
@@ -32,12 +41,16 @@ class RunParCost : public RunPar_t
 
         // data
         vector<string> strufiles;
+        string strulist;
+        string resultformat;
+        bool trajectory;
+        double trajectorytol;
 
     protected:
 
         virtual void process_cmdline_args()
         {
-            if (this->args->args.size() > 1)
+            if (!this->args->args.empty())
             {
                 const string& parfile = this->args->args[0];
                 this->args->ReadPars(parfile);
@@ -45,11 +58,44 @@ class RunParCost : public RunPar_t
                 this->strufiles = this->args->args;
                 this->strufiles.erase(this->strufiles.begin());
             }
-            if (this->strufiles.empty())
+            this->strulist = this->args->GetPar<string>("strulist", "");
+            if (this->strufiles.empty() && this->strulist.empty())
             {
                 const char* emsg = "Structure file not defined.";
                 throw ParseArgsError(emsg);
             }
+            this->resultformat =
+                this->args->GetPar<string>("resultformat", "text");
+            if (this->resultformat != "text" &&
+                this->resultformat != "csv" &&
+                this->resultformat != "json")
+            {
+                const char* emsg = "resultformat must be one of (text, csv, json).";
+                throw ParseArgsError(emsg);
+            }
+            this->trajectory = this->args->GetPar<bool>("trajectory", false);
+            this->trajectorytol =
+                this->args->GetPar<double>("trajectorytol", Molecule::tol_r);
+            if (this->trajectorytol < 0.0)
+            {
+                const char* emsg = "trajectorytol cannot be negative.";
+                throw ParseArgsError(emsg);
+            }
+        }
+
+
+        virtual const list<string>& validpars() const
+        {
+            static list<string> vpars;
+            if (vpars.empty())
+            {
+                vpars = this->RunPar_t::validpars();
+                vpars.push_back("strulist");
+                vpars.push_back("resultformat");
+                vpars.push_back("trajectory");
+                vpars.push_back("trajectorytol");
+            }
+            return vpars;
         }
 
 
@@ -66,7 +112,14 @@ class RunParCost : public RunPar_t
                 "  -V, --version         show program version\n"
                 "  --db-abortstop        stop process on SIGABRT, allows to attach gdb\n"
                 "IO parameters:\n"
-                "  distfile=FILE         target distance table\n"
+                "  distfile=FILE         target distance table, text or binary dtbl\n"
+                "  strulist=FILE         file with structure files, one per line,\n"
+                "                        use \"-\" to read them from standard input\n"
+                "  resultformat=string   [text] output format from (text, csv, json)\n"
+                "  trajectory=bool       [false] score structures as trajectory frames,\n"
+                "                        update only atoms moved from the last frame,\n"
+                "                        xyz files can hold several frames\n"
+                "  trajectorytol=double  [1e-8] displacement of atoms kept in place\n"
                 "  verbose=array         [] output flags from (all, )\n"
                 "Liga parameters:\n"
                 "  ndim={1,2,3}          [3] search in n-dimensional space\n"
@@ -82,6 +135,7 @@ class RunParCost : public RunPar_t
                 "  samepairradius=double [-1] optional radius for a pair of equal atoms\n"
                 "  fixed_atoms=ranges    [] indices of fixed atoms in inistru (start at 0)\n"
                 "  rngseed=int           seed of random number generator\n"
+                "  nthreads=int          [1] number of threads for cost evaluation\n"
                 ;
         }
 
@@ -93,6 +147,389 @@ class RunParCost : public RunPar_t
         }
 };
 
+
+// cost evaluation of one structure file
+
+struct StructureCost
+{
+    string filename;
+    vector<Atom_t> atoms;
+    int natoms;
+    double cost;
+    double costdistance;
+    double costoverlap;
+    string error;
+};
+
+
+// Cost evaluation for batches of structure files.  The files are read
+// serially, the costs are calculated concurrently when nthreads > 1.
+
+class BatchScorer
+{
+    public:
+
+        // constructor
+        BatchScorer(RunParCost* rp) : mrp(rp), mfailed(false)
+        {
+            // crystal files also define the lattice, they are scored
+            // one at a time in the main thread
+            bool concurrent = (rp->nthreads > 1 && !rp->crystal &&
+                    !rp->trajectory);
+            if (concurrent)  mworkers.reset(new WorkerPool(rp->nthreads));
+            if (rp->resultformat == "csv")
+            {
+                cout << "filename,natoms,cost,costdistance,costoverlap,error\n";
+            }
+        }
+
+        // methods
+        size_t batchSize() const
+        {
+            return mworkers.get() ? 16 * mworkers->size() : 1;
+        }
+
+
+        void score(const vector<string>& strufiles)
+        {
+            mbatch.resize(strufiles.size());
+            for (size_t i = 0; i != mbatch.size(); ++i)
+            {
+                StructureCost& sc = mbatch[i];
+                sc.filename = strufiles[i];
+                sc.atoms.clear();
+                sc.error.clear();
+                sc.natoms = 0;
+                sc.cost = sc.costdistance = sc.costoverlap = 0.0;
+                if (mrp->trajectory)  this->scoreFrames(sc);
+                else if (mworkers.get())  this->readAtoms(sc);
+                else  this->scoreSerial(sc);
+            }
+            if (mworkers.get())
+            {
+                WorkerPool::MethodJob<BatchScorer>
+                    scorejob(this, &BatchScorer::scoreTask);
+                mworkers->execute(scorejob, mbatch.size());
+                BOOST_FOREACH (const StructureCost& sc, mbatch)
+                {
+                    this->printResult(sc);
+                }
+            }
+            cout.flush();
+        }
+
+
+        bool failed() const
+        {
+            return mfailed;
+        }
+
+    private:
+
+        // data
+        RunParCost* mrp;
+        auto_ptr<WorkerPool> mworkers;
+        vector<StructureCost> mbatch;
+        bool mfailed;
+        // trajectory state, elements of the last frame and the
+        // frame index of every atom in the molecule
+        vector<string> mframe_elements;
+        vector<int> mframe_index;
+
+        // methods
+        void readAtoms(StructureCost& sc)
+        {
+            try {
+                sc.atoms = mrp->mol->ReadFileAtoms(sc.filename);
+            }
+            catch (runtime_error(e)) {
+                sc.error = e.what();
+            }
+        }
+
+
+        // evaluate and print in the main thread, print structure when verbose
+        void scoreSerial(StructureCost& sc)
+        {
+            Molecule& m = *(mrp->mol);
+            try {
+                m.ReadFile(sc.filename);
+                this->evalCost(m, sc);
+            }
+            catch (runtime_error(e)) {
+                sc.error = e.what();
+            }
+            catch (invalid_argument(e)) {
+                sc.error = e.what();
+            }
+            this->printResult(sc);
+            using NS_LIGA_VERBOSE_FLAG::ALL;
+            bool printstru = sc.error.empty() &&
+                mrp->verbose[ALL] && mrp->resultformat == "text";
+            if (printstru)  cout << m;
+        }
+
+
+        // score all frames in a trajectory file, files that are not
+        // in xyz format are read as a single frame
+        void scoreFrames(StructureCost& sc0)
+        {
+            vector<Atom_t> atoms;
+            auto_ptr<XYZFrameReader> reader;
+            try {
+                reader.reset(new XYZFrameReader(sc0.filename));
+                if (!reader->next(atoms))   reader.reset();
+            }
+            catch (IOError(e)) {
+                reader.reset();
+            }
+            if (!reader.get())
+            {
+                try {
+                    atoms = mrp->mol->ReadFileAtoms(sc0.filename);
+                }
+                catch (runtime_error(e)) {
+                    sc0.error = e.what();
+                    this->printResult(sc0);
+                    return;
+                }
+            }
+            for (bool hasframe = true; hasframe;)
+            {
+                StructureCost sc = sc0;
+                if (reader.get())
+                {
+                    ostringstream fname;
+                    fname << sc0.filename << ':' <<
+                        (reader->countFrames() - 1);
+                    sc.filename = fname.str();
+                }
+                this->scoreFrame(atoms, sc);
+                this->printResult(sc);
+                try {
+                    hasframe = reader.get() && reader->next(atoms);
+                }
+                catch (IOError(e)) {
+                    sc0.error = e.what();
+                    this->printResult(sc0);
+                    hasframe = false;
+                }
+            }
+        }
+
+
+        void scoreFrame(const vector<Atom_t>& atoms, StructureCost& sc)
+        {
+            Molecule& m = *(mrp->mol);
+            try {
+                this->updateFrame(atoms);
+                m.recalculate();
+                sc.natoms = m.countAtoms();
+                sc.cost = m.cost();
+                sc.costdistance = m.costDistance();
+                sc.costoverlap = m.costOverlap();
+            }
+            catch (runtime_error(e)) {
+                sc.error = e.what();
+            }
+            catch (invalid_argument(e)) {
+                sc.error = e.what();
+            }
+            if (!sc.error.empty())  mframe_elements.clear();
+        }
+
+
+        // Move the molecule to the atoms of the next frame.  Atoms displaced
+        // by more than trajectorytol are popped and added again, the
+        // other atoms keep their pair costs and assigned distances.
+
+        void updateFrame(const vector<Atom_t>& atoms)
+        {
+            Molecule& m = *(mrp->mol);
+            bool incremental = (atoms.size() == mframe_elements.size() &&
+                    m.countAtoms() == int(atoms.size()));
+            for (size_t i = 0; incremental && i != atoms.size(); ++i)
+            {
+                incremental = (atoms[i].element == mframe_elements[i]);
+            }
+            list<int> moved;
+            for (int k = 0; incremental && k != m.countAtoms(); ++k)
+            {
+                const R3::Vector& rk = atoms[mframe_index[k]].r;
+                double dr = R3::distance(m.getAtom(k).r, rk);
+                if (dr > mrp->trajectorytol)    moved.push_back(k);
+            }
+            // update of most atoms is slower than building the molecule
+            if (!incremental || 2 * moved.size() > atoms.size())
+            {
+                mframe_elements.clear();
+                m.setAtoms(atoms);
+                m.CheckIntegrity();
+                if (!mrp->formula.empty())  m.setChemicalFormula(mrp->formula);
+                mframe_index.resize(atoms.size());
+                for (size_t i = 0; i != atoms.size(); ++i)
+                {
+                    mframe_elements.push_back(atoms[i].element);
+                    mframe_index[i] = i;
+                }
+                return;
+            }
+            vector<char> ismoved(m.countAtoms(), 0);
+            vector<string> elements;
+            vector<int> index;
+            BOOST_FOREACH (int k, moved)
+            {
+                ismoved[k] = 1;
+                elements.push_back(m.getAtom(k).element);
+            }
+            // the remaining atoms keep their order, moved atoms go last
+            for (int k = 0; k != m.countAtoms(); ++k)
+            {
+                if (!ismoved[k])    index.push_back(mframe_index[k]);
+            }
+            m.Pop(moved);
+            list<int>::const_iterator k = moved.begin();
+            for (size_t j = 0; j != elements.size(); ++j, ++k)
+            {
+                int i = mframe_index[*k];
+                m.AddAt(elements[j], atoms[i].r);
+                index.push_back(i);
+            }
+            mframe_index.swap(index);
+        }
+
+
+        // evaluate a copy of the molecule in a worker thread
+        void scoreTask(size_t task)
+        {
+            StructureCost& sc = mbatch[task];
+            if (!sc.error.empty())  return;
+            try {
+                Molecule m(*(mrp->mol));
+                m.setAtoms(sc.atoms);
+                m.CheckIntegrity();
+                this->evalCost(m, sc);
+            }
+            catch (runtime_error(e)) {
+                sc.error = e.what();
+            }
+            catch (invalid_argument(e)) {
+                sc.error = e.what();
+            }
+        }
+
+
+        void evalCost(Molecule& m, StructureCost& sc) const
+        {
+            if (!mrp->formula.empty())  m.setChemicalFormula(mrp->formula);
+            m.recalculate();
+            sc.natoms = m.countAtoms();
+            sc.cost = m.cost();
+            sc.costdistance = m.costDistance();
+            sc.costoverlap = m.costOverlap();
+        }
+
+
+        void printResult(const StructureCost& sc)
+        {
+            if (!sc.error.empty())  mfailed = true;
+            const string& fmt = mrp->resultformat;
+            if (fmt == "csv")
+            {
+                cout << csvQuoted(sc.filename) << ',';
+                if (sc.error.empty())
+                {
+                    cout << sc.natoms << ',' << sc.cost << ',' <<
+                        sc.costdistance << ',' << sc.costoverlap << ",\n";
+                }
+                else
+                {
+                    cout << ",,,," << csvQuoted(sc.error) << '\n';
+                }
+            }
+            else if (fmt == "json")
+            {
+                cout << "{\"filename\": " << jsonQuoted(sc.filename);
+                if (sc.error.empty())
+                {
+                    cout << ", \"natoms\": " << sc.natoms <<
+                        ", \"cost\": " << sc.cost <<
+                        ", \"costdistance\": " << sc.costdistance <<
+                        ", \"costoverlap\": " << sc.costoverlap;
+                }
+                else
+                {
+                    cout << ", \"error\": " << jsonQuoted(sc.error);
+                }
+                cout << "}\n";
+            }
+            else if (sc.error.empty())
+            {
+                cout << sc.filename << ' ' << sc.natoms << ' ' << sc.cost <<
+                    " dc " << sc.costdistance << " oc " << sc.costoverlap <<
+                    '\n';
+            }
+            else
+            {
+                cout.flush();
+                cerr << sc.filename << ": " << sc.error << endl;
+            }
+        }
+
+
+        static string csvQuoted(const string& s)
+        {
+            if (s.find_first_of(",\"\n") == string::npos)  return s;
+            string rv = "\"";
+            BOOST_FOREACH (char c, s)
+            {
+                if (c == '"')   rv += '"';
+                rv += c;
+            }
+            rv += '"';
+            return rv;
+        }
+
+
+        static string jsonQuoted(const string& s)
+        {
+            ostringstream rv;
+            rv << '"';
+            BOOST_FOREACH (char c, s)
+            {
+                if (c == '"' || c == '\\')  rv << '\\' << c;
+                else if (c == '\n')  rv << "\\n";
+                else if (c == '\t')  rv << "\\t";
+                else if ((unsigned char)(c) < 0x20)
+                {
+                    rv << "\\u00" << "0123456789abcdef"[c >> 4] <<
+                        "0123456789abcdef"[c & 0xf];
+                }
+                else  rv << c;
+            }
+            rv << '"';
+            return rv.str();
+        }
+};
+
+
+// Read structure file names from strulist, one per line.
+// Empty lines and lines starting with '#' are skipped.
+
+bool nextListedFile(istream& fid, string& filename)
+{
+    string line;
+    while (getline(fid, line))
+    {
+        size_t pb = line.find_first_not_of(" \t\r");
+        if (pb == string::npos || line[pb] == '#')  continue;
+        size_t pe = line.find_last_not_of(" \t\r");
+        filename = line.substr(pb, pe - pb + 1);
+        return true;
+    }
+    return false;
+}
+
 }   // namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -102,21 +539,41 @@ class RunParCost : public RunPar_t
 int main(int argc, char *argv[])
 {
     RunParCost rp;
+    auto_ptr<BatchScorer> scorer;
     // Catch exceptions
     try {
         rp.processArguments(argc, argv);
+        scorer.reset(new BatchScorer(&rp));
+        vector<string> batch;
         BOOST_FOREACH (string stru, rp.strufiles)
         {
-            rp.mol->ReadFile(stru);
-            if (!rp.formula.empty())  rp.mol->setChemicalFormula(rp.formula);
-            rp.mol->recalculate();
-            const Molecule& m = *(rp.mol);
-            cout << stru << ' ' << m.countAtoms() << ' ' << m.cost() <<
-                " dc " << m.costDistance() << " oc " << m.costOverlap() <<
-                endl;
-            using NS_LIGA_VERBOSE_FLAG::ALL;
-            if (rp.verbose[ALL])  cout << m;
+            batch.push_back(stru);
+            if (batch.size() < scorer->batchSize())  continue;
+            scorer->score(batch);
+            batch.clear();
+        }
+        if (!rp.strulist.empty())
+        {
+            ifstream listfid;
+            bool usestdin = (rp.strulist == "-");
+            if (!usestdin)  listfid.open(rp.strulist.c_str());
+            istream& fid = usestdin ? cin : listfid;
+            if (!fid)
+            {
+                ostringstream emsg;
+                emsg << "Unable to read '" << rp.strulist << "'";
+                throw IOError(emsg.str());
+            }
+            string stru;
+            while (nextListedFile(fid, stru))
+            {
+                batch.push_back(stru);
+                if (batch.size() < scorer->batchSize())  continue;
+                scorer->score(batch);
+                batch.clear();
+            }
         }
+        if (!batch.empty())  scorer->score(batch);
     }
     catch (IOError(e)) {
         cerr << e.what() << endl;
@@ -134,7 +591,8 @@ int main(int argc, char *argv[])
         cerr << e.what() << endl;
         return EXIT_INPUT_ERROR;
     }
-    return EXIT_SUCCESS;
+    int exit_code = scorer->failed() ? EXIT_INPUT_ERROR : EXIT_SUCCESS;
+    return exit_code;
 }
 
 // End of file
@@ -0,0 +1,90 @@
+/*****************************************************************************
+* Short Title: convert distance table to the binary dtbl format
+*
+* Comments: the dtbl file holds sorted distances, ESDs, resolution and
+*     the nearest distance lookup index, which are loaded without parsing
+*     when used as distfile in mpbcliga or mpbccost.
+*
+*****************************************************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "DistanceTable.hpp"
+#include "Exceptions.hpp"
+
+using namespace std;
+
+const int EXIT_INPUT_ERROR = 2;
+
+namespace {
+
+void print_help(const char* cmd)
+{
+    cout <<
+        "usage: " << cmd << " DISTFILE DTBLFILE\n"
+        "convert text distance table DISTFILE to binary DTBLFILE.\n"
+        "DISTFILE can be in any format accepted by mpbcliga.\n"
+        "Options:\n"
+        "  -h, --help            display this message\n"
+        ;
+}
+
+}   // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// MAIN
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    const char* cmd = argv[0];
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help"))
+        {
+            print_help(cmd);
+            return EXIT_SUCCESS;
+        }
+    }
+    if (argc != 3)
+    {
+        print_help(cmd);
+        return EXIT_INPUT_ERROR;
+    }
+    const string distfile = argv[1];
+    const string dtblfile = argv[2];
+    // Catch exceptions
+    try {
+        DistanceTable dtab;
+        if (DistanceTable::isBinaryFile(distfile))
+        {
+            dtab.readBinary(distfile);
+        }
+        else
+        {
+            ifstream dstfid(distfile.c_str());
+            if (!dstfid)
+            {
+                throw IOError("Unable to read '" + distfile + "'");
+            }
+            dstfid >> dtab;
+        }
+        dtab.writeBinary(dtblfile);
+        cout << dtblfile << ' ' << dtab.size() << " distances" <<
+            (dtab.hasESDs() ? " with ESDs" : "") << endl;
+    }
+    catch (IOError(e)) {
+        cerr << e.what() << endl;
+        return EXIT_INPUT_ERROR;
+    }
+    catch (runtime_error(e)) {
+        cerr << e.what() << endl;
+        return EXIT_INPUT_ERROR;
+    }
+    return EXIT_SUCCESS;
+}
+
+// End of file
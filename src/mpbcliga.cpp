@@ -10,9 +10,17 @@
 #include <memory>
 #include <unistd.h>
 #include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "ParseArgs.hpp"
 #include "Exceptions.hpp"
 #include "Liga_t.hpp"
+#include "IslandRing.hpp"
+#include "ChampionBoard.hpp"
+#include "LatticeSweep.hpp"
 
 using namespace std;
 
@@ -32,20 +40,54 @@ void SIGHUP_handler(int signum)
 }
 
 //////////////////////////////////////////////////////////////////////////////
-// MAIN
+// Single job and server loop
 //////////////////////////////////////////////////////////////////////////////
 
-int main(int argc, char *argv[])
+int runJob(int argc, char *argv[], bool server=false)
 {
     RunPar_t rp;
+    auto_ptr<ChampionBoard> board;
+    auto_ptr<IslandRing> islands;
     auto_ptr<Liga_t> liga;
     // Catch exceptions
     try {
         // process arguments
         rp.processArguments(argc, argv);
-        liga.reset(new Liga_t(&rp));
+        if (server && rp.islands > 1)
+        {
+            const char* emsg = "islands are not supported in server mode.";
+            throw ParseArgsError(emsg);
+        }
         // watch for HUP
         signal(SIGHUP, SIGHUP_handler);
+        // rank lattice hypotheses instead of a single run
+        if (!rp.sweep.empty())
+        {
+            LatticeSweep sweep(&rp);
+            sweep.useStopFlag(&SIGHUP_received);
+            sweep.run();
+            if (SIGHUP_received)    return SIGHUP + 128;
+            return sweep.solutionFound() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        // fork island processes, only the main island writes results
+        if (rp.islands > 1)
+        {
+            // the board must exist before the islands are forked
+            if (rp.championboard)
+            {
+                int maxatoms = rp.mol->getMaxAtomCount();
+                board.reset(new ChampionBoard(maxatoms));
+            }
+            islands.reset(new IslandRing(rp.islands));
+            if (!islands->isMain())
+            {
+                rp.clearIslandOutputs();
+                if (!freopen("/dev/null", "w", stdout))  perror("/dev/null");
+            }
+        }
+        liga.reset(new Liga_t(&rp));
+        liga->useIslands(islands.get());
+        liga->useChampionBoard(board.get());
         liga->useStopFlag(&SIGHUP_received);
         // main loop
         liga->prepare();
@@ -77,4 +119,50 @@ int main(int argc, char *argv[])
     return exit_code;
 }
 
+
+// Read jobs from standard input, one command line per line, and run them
+// in turn in this process.  Blank lines and lines starting with '#' are
+// ignored.  Every job output is enclosed in "# job N" and
+// "# job N exit CODE" lines.  Parsed distance tables and the Python
+// interpreter stay loaded between the jobs.
+
+int runServer(const char* appname)
+{
+    string line;
+    int jobcount = 0;
+    while (getline(cin, line))
+    {
+        istringstream linestream(line);
+        vector<string> words;
+        string w;
+        while (linestream >> w)     words.push_back(w);
+        if (words.empty() || words[0][0] == '#')    continue;
+        vector<char*> jobargv(1, const_cast<char*>(appname));
+        for (size_t i = 0; i != words.size(); ++i)
+        {
+            jobargv.push_back(const_cast<char*>(words[i].c_str()));
+        }
+        jobargv.push_back(NULL);
+        ++jobcount;
+        cout << "# job " << jobcount << endl;
+        SIGHUP_received = 0;
+        int rv = runJob(jobargv.size() - 1, &(jobargv[0]), true);
+        cout << "# job " << jobcount << " exit " << rv << endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MAIN
+//////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+    if (argc == 2 && string(argv[1]) == "--server")
+    {
+        return runServer(argv[0]);
+    }
+    return runJob(argc, argv);
+}
+
 // End of file
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+
+"""Unit tests for the ligacost Python extension module.
+
+Run with the directory of the built module in PYTHONPATH, for example
+by the "scons testligacost" target.
+"""
+
+import array
+import math
+import random
+import threading
+import unittest
+
+import ligacost
+
+# regular tetrahedron with unit edges
+TETRAHEDRON = [
+    (+1, +1, +1), (+1, -1, -1), (-1, +1, -1), (-1, -1, +1)]
+TETRAHEDRON = [tuple(c / math.sqrt(8) for c in r) for r in TETRAHEDRON]
+
+
+def makeXYZ(structures):
+    """Return C-contiguous float64 buffer of shape (nstru, natoms, 3)."""
+    flat = [c for stru in structures for r in stru for c in r]
+    shape = (len(structures), len(structures[0]), 3)
+    return memoryview(array.array('d', flat)).cast('B').cast('d', shape)
+
+
+def shaken(stru, rng, sd=0.05):
+    return [tuple(c + rng.gauss(0, sd) for c in r) for r in stru]
+
+
+class TestBatchCosts(unittest.TestCase):
+
+    def setUp(self):
+        self.table = ligacost.DistanceTable([1.0] * 6)
+        self.mol = ligacost.Molecule(self.table, "C4")
+        rng = random.Random(7)
+        self.structures = [TETRAHEDRON] + [
+            shaken(TETRAHEDRON, rng) for i in range(7)]
+        return
+
+
+    def test_list(self):
+        "batchCosts returns a list of costs"
+        costs = self.mol.batchCosts(makeXYZ(self.structures))
+        self.assertEqual(8, len(costs))
+        self.assertAlmostEqual(0.0, costs[0])
+        self.assertTrue(all(c > 0 for c in costs[1:]))
+        # single structure of shape (natoms, 3)
+        xyz1 = makeXYZ(self.structures[3:4])
+        xyz1 = xyz1.cast('B').cast('d', (4, 3))
+        self.assertEqual(costs[3:4], self.mol.batchCosts(xyz1))
+        # costs agree with setAtoms
+        self.mol.setAtoms(xyz1)
+        self.assertEqual(costs[3], self.mol.cost())
+        return
+
+
+    def test_out(self):
+        "batchCosts stores costs in the out buffer"
+        xyz = makeXYZ(self.structures)
+        costs = self.mol.batchCosts(xyz)
+        out = array.array('d', [-1.0] * 8)
+        rv = self.mol.batchCosts(xyz, out=out)
+        self.assertTrue(rv is out)
+        self.assertEqual(costs, out.tolist())
+        return
+
+
+    def test_nthreads(self):
+        "threads do not change the costs"
+        xyz = makeXYZ(self.structures)
+        costs1 = self.mol.batchCosts(xyz, nthreads=1)
+        for n in (2, 3, 8, 16):
+            self.assertEqual(costs1, self.mol.batchCosts(xyz, nthreads=n))
+        self.assertRaises(ValueError, self.mol.batchCosts, xyz, nthreads=0)
+        return
+
+
+    def test_bad_structure(self):
+        "failed structures get NaN cost and raise ValueError"
+        # 4 atoms need more distances than this table has
+        table = ligacost.DistanceTable([1.0] * 5)
+        mol = ligacost.Molecule(table, "C4")
+        mol.setDistReuse(False)
+        out = array.array('d', [-1.0] * 8)
+        xyz = makeXYZ(self.structures)
+        self.assertRaises(ValueError, mol.batchCosts, xyz, out=out)
+        self.assertTrue(all(math.isnan(c) for c in out))
+        self.assertRaises(ValueError, mol.batchCosts, xyz, nthreads=3)
+        return
+
+
+    def test_python_threads(self):
+        "cost methods may run in Python threads during batches"
+        xyz = makeXYZ(self.structures * 50)
+        costs = self.mol.batchCosts(xyz)
+        xyz1 = makeXYZ(self.structures[3:4]).cast('B').cast('d', (4, 3))
+        other = ligacost.Molecule(self.table, "C4")
+        other.setAtoms(xyz1)
+        cost1 = other.cost()
+        results = []
+        def batches():
+            for i in range(5):
+                results.append(self.mol.batchCosts(xyz, nthreads=2))
+            return
+        threads = [threading.Thread(target=batches) for i in range(2)]
+        for t in threads:
+            t.start()
+        singles = []
+        while any(t.is_alive() for t in threads):
+            other.setAtoms(xyz1)
+            singles.append(other.cost())
+        for t in threads:
+            t.join()
+        self.assertEqual(10, len(results))
+        self.assertTrue(all(r == costs for r in results))
+        self.assertTrue(all(abs(c - cost1) < 1e-12 for c in singles))
+        return
+
+
+    def test_wrong_shape(self):
+        "arrays of wrong shape or type raise ValueError"
+        bc = self.mol.batchCosts
+        xyz = makeXYZ(self.structures)
+        self.assertRaises(ValueError, bc, xyz.cast('B').cast('d', (8, 6, 2)))
+        self.assertRaises(ValueError, bc, xyz.cast('B').cast('d', (96,)))
+        # formula has 4 atoms
+        self.assertRaises(ValueError, bc, xyz.cast('B').cast('d', (16, 2, 3)))
+        self.assertRaises(ValueError, bc, xyz, elements=["C"] * 3)
+        self.assertRaises(ValueError, bc, xyz, out=array.array('d', [0.0]))
+        self.assertRaises(ValueError, bc, xyz, out=array.array('f', [0.0] * 8))
+        self.assertRaises(ValueError, bc, array.array('f', [0.0] * 12))
+        return
+
+# End of class TestBatchCosts
+
+
+if __name__ == '__main__':
+    unittest.main()
+
+# End of file